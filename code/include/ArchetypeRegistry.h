@@ -0,0 +1,139 @@
+#ifndef ARCHETYPE_REGISTRY_H
+#define ARCHETYPE_REGISTRY_H
+
+#include "MonsterArchetypes.h"
+#include "LootTable.h"
+#include "StatusEffects.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <ctime>
+#include <pthread.h>
+
+/**
+ * ArchetypeData - Everything a spawn needs to know about its kind
+ */
+struct ArchetypeData {
+    std::string name;
+    int max_hp;
+    int attack;
+    int defense;
+    int experience;
+    int gold;
+    int damage_bonus;                          // flat damage on top of the attack roll
+    std::string attack_message;
+    LootTable loot;                            // rolled when the monster drops it
+    EffectSpec on_hit;                         // put on whoever it strikes (burn or poison)
+};
+
+/**
+ * ArchetypeTable class - One immutable version of every archetype
+ *
+ * Archetype ids are indexes: the built-ins come first in MonsterArchetype
+ * order, archetypes added by data files follow, and an id keeps its
+ * meaning in every later version. A table is never changed once
+ * published - a reload builds a new one - so anyone holding a reference
+ * can read it without locks. The last release() frees it.
+ *
+ * Named loot tables ("@rare") live here too, so an archetype's loot and
+ * the tables it nests always come from the same version.
+ */
+class ArchetypeTable {
+public:
+    static const unsigned int NOT_FOUND = (unsigned int)-1;
+
+private:
+    std::vector<ArchetypeData> entries;
+    std::vector<LootTable> loot_tables;
+    std::vector<std::string> loot_names;       // without the '@', same order
+    unsigned int version;
+    mutable int refs;                          // changed with atomic builtins
+
+    friend class ArchetypeRegistry;
+    ArchetypeTable() : version(1), refs(1) { }
+
+public:
+    std::size_t size() const { return entries.size(); }
+    const ArchetypeData& operator[](unsigned int id) const { return entries[id]; }
+    unsigned int getVersion() const { return version; }
+
+    // Id by name (case-insensitive), NOT_FOUND if none
+    // in ArchetypeRegistry.cpp
+    unsigned int find(const std::string& name) const;
+
+    // Named loot tables, for LootTable::roll
+    const std::vector<LootTable>& lootTables() const { return loot_tables; }
+
+    // Loot table index by name (no '@', case-insensitive), NOT_FOUND if none
+    // in ArchetypeRegistry.cpp
+    unsigned int findLootTable(const std::string& name) const;
+
+    // Reference counting - safe from any thread once you hold a reference
+    void retain() const { __sync_fetch_and_add(&refs, 1); }
+    void release() const { if(__sync_sub_and_fetch(&refs, 1) == 0){ delete this; } }
+};
+
+/**
+ * ArchetypeRegistry class - Publishes the current ArchetypeTable
+ *
+ * Read-copy-update: a reload parses the data file into a brand-new table
+ * (copied from the current one, so unchanged archetypes and ids carry
+ * over) and swaps it in with one pointer store. Monsters retain the
+ * table they were made from, so a fight already under way keeps the old
+ * numbers and messages while every new spawn gets the new ones; the old
+ * table goes away when its last monster does.
+ *
+ * Data file, one archetype or loot table per line ('#' starts a comment):
+ *     name | hp | attack | defense | exp | gold | damage bonus | attack message | loot [| on hit]
+ *     @table | rolls | loot
+ * where loot is a comma-separated list of entries (may be empty):
+ *     Item Name     always dropped (an item catalog name)
+ *     @table        always rolled
+ *     25 Item Name  weighted: each of the table's rolls picks one of these
+ *     25 @table     ... and rolls that table
+ *     25 -          ... and drops nothing
+ * On hit is an optional burn or poison effect put on whoever the monster
+ * strikes ("burn 4 3", see EffectSpec).
+ * An archetype's loot rolls once. A table can only nest tables defined
+ * before it. A name that already exists is redefined in place (same id);
+ * a new one is added.
+ */
+class ArchetypeRegistry {
+private:
+    const ArchetypeTable* current;
+    pthread_mutex_t lock;
+    std::string watched_path;                  // file polled by reloadIfChanged
+    time_t watched_mtime;
+
+    // in ArchetypeRegistry.cpp
+    ArchetypeRegistry();
+    ~ArchetypeRegistry();
+    void publish(ArchetypeTable* table);
+
+    // Not copyable - there is only one
+    ArchetypeRegistry(const ArchetypeRegistry&);
+    ArchetypeRegistry& operator=(const ArchetypeRegistry&);
+
+public:
+    // in ArchetypeRegistry.cpp
+    static ArchetypeRegistry& instance();
+
+    // The current table, retained - call release() when done with it
+    // in ArchetypeRegistry.cpp
+    const ArchetypeTable* acquire();
+
+    // Parse a data file and publish the result; on any error print it,
+    // keep the current table and return false
+    // in ArchetypeRegistry.cpp
+    bool loadFile(const std::string& path);
+
+    // Reload the last loaded file if its modification time changed
+    // Returns true if a new table was published
+    // in ArchetypeRegistry.cpp
+    bool reloadIfChanged();
+
+    // in ArchetypeRegistry.cpp
+    unsigned int getVersion();
+};
+
+#endif // ARCHETYPE_REGISTRY_H
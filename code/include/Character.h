@@ -3,6 +3,12 @@
 
 #include <string>
 #include <iostream>
+#include "Random.h"
+#include "StatusEffects.h"
+#include "StatBlock.h"
+
+class ByteWriter;
+class ByteReader;
 
 /**
  * Character class - Base class for all characters in the game
@@ -12,6 +18,10 @@
  * - Encapsulation (private data, public interface)
  * - Virtual functions (for polymorphism)
  * - Member functions vs free functions
+ *
+ * Max HP, attack and defense are a StatBlock: the base values (set by the
+ * constructor and the set* functions) plus modifiers from levels,
+ * equipment and buffs. The getters return the effective, cached totals.
  * 
  * MY LEARNING OBJECTIVES:
  * - Practice writing constructors with initializer lists
@@ -22,57 +32,90 @@
 class Character {
 private:
     std::string name;
-    int max_hp;
+    StatBlock stats;            // max HP, attack, defense and their modifiers
     int current_hp;
-    int attack;
-    int defense;
     bool alive;
+    mutable RandomStream rng;   // this character's own rolls (see Random.h)
+    unsigned int effects;       // first of its status effects (StatusEffects::NO_EFFECT if none)
+    StatusEffects* effect_engine;   // the engine that has them (set on the first one)
+
+    // StatusEffects keeps the list of this character's effects
+    friend class StatusEffects;
 
 public:
     // Constructor - Initialize all character stats
     // in Character.cpp
     Character(const std::string& name, int hp, int attack, int defense);
     
-    // Destructor
-    // in Character.cpp (debug output)
-    ~Character();
+    // Destructor - takes any status effects off
+    // in Character.cpp
+    virtual ~Character();
     
     // Getters (inline functions - defined in header)
     // These are simple one-liners, so we define them here
     std::string getName() const { return name; }
-    int getMaxHP() const { return max_hp; }
+    int getMaxHP() const { return stats.get(STAT_MAX_HP); }
     int getCurrentHP() const { return current_hp; }
-    int getAttack() const { return attack; }
-    int getDefense() const { return defense; }
+    int getAttack() const { return stats.get(STAT_ATTACK); }
+    int getDefense() const { return stats.get(STAT_DEFENSE); }
     bool isAlive() const { return alive; }
     
-    // Setters for derived classes to modify stats
+    // Setters for derived classes to modify stats (the base values)
     void setName(const std::string& n) { name = n; }
-    void setMaxHP(int hp) { max_hp = hp; }
+    void setMaxHP(int hp) { stats.setBase(STAT_MAX_HP, hp); }
     void setCurrentHP(int hp) { current_hp = hp; }
-    void setAttack(int atk) { attack = atk; }
-    void setDefense(int def) { defense = def; }
+    void setAttack(int atk) { stats.setBase(STAT_ATTACK, atk); }
+    void setDefense(int def) { stats.setBase(STAT_DEFENSE, def); }
     void setAlive(bool a) { alive = a; }
+
+    // Modifiers on top of the base stats; current HP never stays above a
+    // lowered max HP
+    // in Character.cpp
+    void setModifier(ModifierSource source, StatKind stat, int value);
+    void addModifier(ModifierSource source, StatKind stat, int delta) { setModifier(source, stat, stats.getBonus(source, stat) + delta); }
+    const StatBlock& getStats() const { return stats; }
+
+    // Random stream for this character's rolls; the Game seeds it per session
+    void seedRandom(unsigned long long seed, unsigned long long stream) { rng.reseed(seed, stream); }
+    bool isRandomSeeded() const { return rng.isSeeded(); }
+    RandomStream& getRandom() const { return rng; }
     
     // Combat methods
     // Virtual so derived classes can override
     // in Character.cpp
     virtual int calculateDamage() const;
     
+    // Damage over time (burn, poison) skips defense
+    // Messages go to `out` (the game's output)
     // in Character.cpp
-    void takeDamage(int damage);
+    void takeDamage(int damage, std::ostream& out, bool ignore_defense = false);
     
+    // Poison halves healing while it lasts
     // in Character.cpp
-    void heal(int amount);
+    void heal(int amount, std::ostream& out);
+
+    // Status effects (see StatusEffects.h)
+    bool hasEffects() const { return effects != StatusEffects::NO_EFFECT; }
     
     // Display methods
     // Virtual with default implementation - can be overridden
     // in Character.cpp
-    virtual void displayStats() const;
+    virtual void displayStats(std::ostream& out) const;
     
     // Brief status display (for combat)
     // in Character.cpp
-    void displayStatus() const;
+    void displayStatus(std::ostream& out) const;
+
+    // "  Effects: ..." line, nothing if it has none
+    // in Character.cpp
+    void displayEffects(std::ostream& out) const;
+
+protected:
+    // Binary state for snapshots: HP, alive, random stream position, base
+    // stats and every modifier (set as saved, nothing recomputed)
+    // in Character.cpp
+    void writeState(ByteWriter& out) const;
+    bool readState(ByteReader& in);
 };
 
 #endif // CHARACTER_H
@@ -0,0 +1,43 @@
+#ifndef COMBAT_RULES_H
+#define COMBAT_RULES_H
+
+/**
+ * CombatRules - The damage arithmetic, in one place
+ *
+ * Character, Player and Dragon use these for interactive fights and the
+ * CombatSimulator uses them for headless ones, so a balance run always
+ * plays by exactly the rules the game does. Everything is a pure
+ * function of its arguments; the caller supplies the random roll.
+ */
+class CombatRules {
+public:
+    static const int ROLL_RANGE = 5;    // calculateDamage adds 0 .. ROLL_RANGE-1
+
+    // Damage of a plain attack (Character::calculateDamage)
+    static int strike(int attack, unsigned int roll) { return attack + (int)(roll % ROLL_RANGE); }
+
+    // Damage of a player swing - no roll, the weapon adds a flat bonus
+    static int weaponStrike(int attack, int weapon_bonus) { return attack + weapon_bonus; }
+
+    // Damage that gets through defense; negative means the blow glances off
+    static int mitigate(int damage, int defense) { return damage - defense; }
+
+    // Apply damage that got through; returns false once the target is dead
+    // (HP is clamped to 0 only when it goes below zero)
+    static bool applyDamage(int& hp, int actual) {
+        hp -= actual;
+        if(hp < 0){
+            hp = 0;
+            return false;
+        }
+        return true;
+    }
+
+    // Healing while poisoned (StatusEffects) is halved
+    static int poisonedHeal(int amount) { return amount / 2; }
+
+    // Healing is capped at max HP
+    static int heal(int hp, int amount, int max_hp) { return (hp + amount > max_hp) ? max_hp : hp + amount; }
+};
+
+#endif // COMBAT_RULES_H
@@ -0,0 +1,131 @@
+#ifndef COMBAT_SIMULATOR_H
+#define COMBAT_SIMULATOR_H
+
+#include "MonsterArchetypes.h"
+#include <string>
+#include <vector>
+
+/**
+ * PlayerBuild - The player side of a simulated fight
+ *
+ * Defaults match a new character with the Rusty Dagger equipped.
+ * Policy: drink a potion (instead of attacking) while HP is below
+ * heal_below and potions are left; otherwise attack.
+ */
+struct PlayerBuild {
+    int hp;
+    int attack;
+    int defense;
+    int weapon_bonus;
+    int armor_bonus;      // worn armor, all slots (the game's equipment defense)
+    int potions;
+    int potion_heal;
+    int heal_below;
+
+    // in CombatSimulator.cpp
+    PlayerBuild();
+};
+
+/**
+ * SimulationConfig - What to simulate and how hard
+ */
+struct SimulationConfig {
+    PlayerBuild player;
+    std::string monster;          // "Goblin", "Skeleton" or "Dragon"
+    unsigned long long fights;
+    unsigned long long seed;
+    int threads;                  // 0 = one per CPU
+
+    // in CombatSimulator.cpp
+    SimulationConfig();
+};
+
+/**
+ * SimulationStats - Outcome of a balance run
+ *
+ * turns[t] counts fights that ended after t rounds (index MAX_TURNS
+ * collects stalemates that hit the turn cap).
+ */
+struct SimulationStats {
+    std::string monster;
+    unsigned long long fights;
+    unsigned long long wins;
+    unsigned long long losses;
+    unsigned long long draws;
+    unsigned long long potions_used;
+    unsigned long long player_hp_left;   // summed over wins
+    std::vector<unsigned long long> win_turns;
+    std::vector<unsigned long long> loss_turns;
+    int threads;
+    double seconds;
+
+    // in CombatSimulator.cpp
+    SimulationStats();
+    void print() const;
+};
+
+/**
+ * CombatSimulator class - Headless Monte Carlo fights for balancing
+ *
+ * Plays the same rounds as Game::combat - player acts, then a living
+ * monster strikes back - with the arithmetic from CombatRules, but with
+ * no input or output. The fight loop is instantiated per archetype from
+ * ArchetypeTraits, so the monster's stats are compile-time constants and
+ * nothing in it is a virtual call. An archetype rebalanced or added by the
+ * archetype data file runs the same loop with its numbers in a FoeStats.
+ * Fights are split across worker threads.
+ *
+ * Every roll of fight i comes from RandomStream (seed, i), so the totals
+ * are the same for any thread count.
+ */
+class CombatSimulator {
+public:
+    static const int MAX_TURNS = 1000;   // a fight this long is a stalemate
+
+private:
+    // The monster's numbers when they aren't the compiled-in ones
+    // (same member names as ArchetypeTraits, so fight() takes either)
+    struct FoeStats {
+        int MAX_HP;
+        int ATTACK;
+        int DEFENSE;
+        int DAMAGE_BONUS;
+        int HIT_DAMAGE;          // on-hit burn/poison per round (0: none)
+        int HIT_TURNS;
+        bool HIT_POISON;
+    };
+
+    SimulationConfig config;
+    MonsterArchetype archetype;     // ARCHETYPE_COUNT: use foe
+    FoeStats foe;
+
+    struct Slice;
+    static void* runSlice(void* arg);
+
+    // One fight against Foe (ArchetypeTraits<A> or FoeStats); returns the
+    // number of rounds, sets the outcome
+    // in CombatSimulator.cpp
+    template<class Foe>
+    int fight(const Foe& monster, unsigned long long index, int& outcome, int& hp_left, int& potions_used) const;
+
+    // Fights [begin, end) of a slice against Foe
+    // in CombatSimulator.cpp
+    template<class Foe>
+    void fightRange(const Foe& monster, Slice& slice) const;
+
+public:
+    // in CombatSimulator.cpp
+    CombatSimulator(const SimulationConfig& config);
+
+    // Run config.fights fights; prints an error and returns false for an unknown monster
+    // in CombatSimulator.cpp
+    bool run(SimulationStats& stats);
+
+    // Horde benchmark: a party's volleys against `monsters` Goblins,
+    // Skeletons and Dragons, resolved per Monster object, then through a
+    // StatStore (scalar and SIMD); prints timings and checks they agree
+    // in CombatSimulator.cpp
+    static bool benchmarkHorde(unsigned int monsters, int rounds, unsigned long long seed);
+};
+
+#endif // COMBAT_SIMULATOR_H
@@ -0,0 +1,62 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <string>
+#include <cstddef>
+
+/**
+ * TextView - A piece of someone else's text: pointer and length, not
+ * owned and not NUL-terminated
+ *
+ * Valid only as long as the string it points into is left alone.
+ */
+struct TextView {
+    const char* data;
+    std::size_t size;
+
+    TextView() : data(""), size(0) { }
+    TextView(const char* data, std::size_t size) : data(data), size(size) { }
+
+    bool empty() const { return size == 0; }
+    std::string str() const { return std::string(data, size); }
+
+    // Case-insensitive comparison with a NUL-terminated word
+    // in Command.cpp
+    bool is(const char* word) const;
+};
+
+/**
+ * Command - One input line split into verb and object, without copying
+ *
+ * "  Pickup   Small Potion  " is verb "Pickup" and object "Small Potion":
+ * the verb is the first word, the object the rest of the line with the
+ * spaces around it trimmed. Both point into the line, so parsing never
+ * allocates; case is left alone (lookups fold it themselves).
+ */
+struct Command {
+    TextView verb;
+    TextView object;
+
+    // Empty verb if the line is blank
+    // in Command.cpp
+    static Command parse(const char* line, std::size_t size);
+    static Command parse(const std::string& line) { return parse(line.data(), line.size()); }
+
+    // Perfect hash of a verb for the game's command table: first and last
+    // letter (case folded) and length, in 0 .. VERB_SLOTS-1. The
+    // multipliers are chosen so every verb and alias the game knows lands
+    // in its own slot (see Game::VERB_TABLE)
+    static const unsigned int VERB_SLOTS = 64;
+    static unsigned int hashVerb(const TextView& verb) {
+        if(verb.empty()){
+            return 0;
+        }
+        unsigned int first = (unsigned char)verb.data[0];
+        unsigned int last = (unsigned char)verb.data[verb.size - 1];
+        first |= (first >= 'A' && first <= 'Z') ? 0x20 : 0;
+        last |= (last >= 'A' && last <= 'Z') ? 0x20 : 0;
+        return (first * 8 + last + (unsigned int)verb.size * 3) & (VERB_SLOTS - 1);
+    }
+};
+
+#endif // COMMAND_H
@@ -0,0 +1,160 @@
+#ifndef ENTITY_ARENA_H
+#define ENTITY_ARENA_H
+
+#include <cstddef>
+#include <iostream>
+#include <pthread.h>
+
+/**
+ * Entity kinds that get their own slab pool
+ */
+enum EntityKind {
+    ENTITY_ROOM = 0,
+    ENTITY_GOBLIN,
+    ENTITY_SKELETON,
+    ENTITY_DRAGON,
+    ENTITY_WEAPON,
+    ENTITY_ARMOR,
+    ENTITY_CONSUMABLE,
+    ENTITY_KIND_COUNT
+};
+
+/**
+ * SlabStats - Occupancy of one pool, for capacity planning
+ */
+struct SlabStats {
+    std::size_t object_size;      // bytes per block (header included)
+    std::size_t live;             // objects allocated right now
+    std::size_t peak;             // most objects live at once
+    std::size_t capacity;         // blocks in all slabs
+    std::size_t slabs;
+    unsigned long long allocations;
+
+    SlabStats() : object_size(0), live(0), peak(0), capacity(0), slabs(0), allocations(0) { }
+};
+
+/**
+ * SlabPool class - Fixed-size blocks carved out of big slabs
+ *
+ * Freed blocks go on an intrusive free list and are handed out again
+ * before a new slab is made. Slabs double in size (64 blocks up to 64K)
+ * and are only returned to the system when the pool is destroyed.
+ *
+ * Every block starts with a small header pointing back at its pool, so
+ * delete finds the right pool without being told the type. A mutex makes
+ * the pool safe for the generator's worker threads.
+ */
+class SlabPool {
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    std::size_t block_size;       // 0 until the first allocation fixes it
+    std::size_t next_slab_blocks;
+    FreeBlock* free_list;
+    void** slabs;                 // malloc'd array of slab pointers
+    std::size_t slab_count;
+    std::size_t slab_slots;
+    SlabStats stats;
+    pthread_mutex_t lock;
+
+    // in EntityArena.cpp
+    void addSlab();
+
+    // Not copyable - owns the slabs
+    SlabPool(const SlabPool&);
+    SlabPool& operator=(const SlabPool&);
+
+public:
+    // in EntityArena.cpp
+    SlabPool();
+    ~SlabPool();
+
+    // Returns NULL if size doesn't fit this pool's block size
+    // in EntityArena.cpp
+    void* allocate(std::size_t size);
+    void deallocate(void* block);
+    void release();
+    SlabStats getStats();
+};
+
+/**
+ * EntityArena class - One slab pool per entity kind
+ *
+ * Rooms, monsters and items allocate from their thread's active arena
+ * through their class operator new (see ARENA_ALLOCATED below). Each
+ * thread is handed one of SHARD_COUNT sets of pools, so the generator's
+ * workers don't all queue on the same mutex; a block is always freed to
+ * the pool it came from, whichever thread deletes it.
+ *
+ * The active arena is per thread. A Game owns an arena and activates it
+ * on its thread for its lifetime; a worker thread starts with none and
+ * adopts its creator's (see adopt). Activations nest and must be undone
+ * in reverse order - deactivating any other way is reported as an error
+ * and the arena is unlinked wherever it sits, so no thread is ever left
+ * pointing at a dead one.
+ *
+ * Destroying the arena hands every slab back to the system in one step
+ * instead of one free() per object. That is the memory only: whoever owns
+ * the objects still runs their destructors first (World::clear), since
+ * they hold strings and vectors from the normal heap.
+ *
+ * Objects made while no arena is active (and objects too big for their
+ * pool) fall back to the normal heap.
+ */
+class EntityArena {
+private:
+    static const int SHARD_COUNT = 8;
+
+    SlabPool pools[SHARD_COUNT][ENTITY_KIND_COUNT];
+    EntityArena* previous;        // active on this thread before us
+    bool active;
+    pthread_t owner;              // the thread we are active on
+
+    // in EntityArena.cpp
+    static int shardIndex();
+    static void setCurrent(EntityArena* arena);
+
+    // Not copyable - owns the pools
+    EntityArena(const EntityArena&);
+    EntityArena& operator=(const EntityArena&);
+
+public:
+    // in EntityArena.cpp
+    EntityArena();
+    ~EntityArena();
+
+    // Make this the arena new entities on this thread come from (until
+    // deactivate, on the same thread, after any arena activated since)
+    // in EntityArena.cpp
+    void activate();
+    void deactivate();
+
+    // This thread's active arena, or NULL
+    // A thread entry point calls adopt() with its creator's current() on
+    // the way in and adopt(NULL) on the way out
+    // in EntityArena.cpp
+    static EntityArena* current();
+    static void adopt(EntityArena* arena);
+
+    // Occupancy report (all shards added up)
+    // in EntityArena.cpp
+    SlabStats getStats(EntityKind kind);
+    void printStats(std::ostream& out);
+
+    // Used by ARENA_ALLOCATED classes
+    // in EntityArena.cpp
+    static void* allocate(EntityKind kind, std::size_t size);
+    static void deallocate(void* block);
+
+    static const char* kindName(EntityKind kind);
+};
+
+// Class-level operator new/delete that route a concrete class to its pool
+// (delete through a base pointer still lands here - the destructors are virtual)
+#define ARENA_ALLOCATED(kind) \
+    static void* operator new(std::size_t size) { return EntityArena::allocate(kind, size); } \
+    static void operator delete(void* block) { EntityArena::deallocate(block); }
+
+#endif // ENTITY_ARENA_H
@@ -3,8 +3,17 @@
 
 #include "Player.h"
 #include "Room.h"
-#include <map>
+#include "World.h"
+#include "WorldGenerator.h"
+#include "Pathfinder.h"
+#include "EntityArena.h"
+#include "Transport.h"
+#include "Command.h"
+#include "ScriptStats.h"
+#include "Journal.h"
+#include "SaveGame.h"
 #include <string>
+#include <vector>
 
 /**
  * Game class - Main game controller
@@ -16,27 +25,219 @@
  * - Game state (game over, victory)
  * - Command processing
  * - Combat system
+ *
+ * Input and output go through a Transport (the terminal unless another
+ * is set). Everything the game prints goes to its own `output` stream,
+ * passed down to every display function; while run() plays, that stream
+ * writes into a RenderBuffer that is sent once per command, right before
+ * the next line is read. std::cout is never redirected, so several games
+ * can play side by side, each with its own status effects.
  * 
  * MY LEARNING OBJECTIVES:
  * - Complex object lifetime management
- * - Map for world structure
+ * - Dense ids and a CSR exit table for world structure
  * - Command parsing and dispatch
  * - Game loop implementation
  */
-class Game {
+class Game : private EffectTargets {
 private:
+    EntityArena arena;                   // Slab pools for rooms, monsters, items (first = destroyed last)
+    std::ostream output;                 // what the game prints (std::cout's buffer, or the render buffer)
+    StatusEffects effects;               // on the player and monsters (outlives them all)
     Player* player;
     Room* current_room;
-    std::map<std::string, Room*> world;  // All rooms keyed by name - Game owns these!
+    World world;                         // All rooms by id + exit graph - World owns these!
+    Pathfinder pathfinder;               // Routes for "travel" (listens to world's exits)
     bool game_over;
     bool victory;
+
+    // Procedural world (used instead of the hand-built one when enabled)
+    bool use_generator;
+    GeneratorConfig generator_config;
+
+    // Compiled world file (used instead of building a world when set)
+    std::string world_file;
+
+    // Item catalog and monster file loaded before the game (empty: none),
+    // recorded in the setup block so a replay or load can tell if they changed
+    std::string item_file;
+    std::string monsters_file;
+
+    // Room paging budget in bytes (0 = keep every room in memory)
+    std::size_t paging_budget;
+
+    // Print entity pool occupancy when the game ends
+    bool show_pool_stats;
+
+    // Session seed for every combat roll (player and monster streams)
+    unsigned long long rng_seed;
+
+    // Where commands come from and output goes (terminal by default)
+    TerminalTransport terminal;
+    Transport* transport;
+    bool flush_lines;                    // send every line, not every command (--io-bench)
+    RenderBuffer* render;                // the output being collected, while run() plays
+
+    // Scripted (batch) play: no prompts, output kept only if asked for,
+    // each command timed into script_stats (if set)
+    bool script_mode;
+    bool script_output;
+    ScriptStats* script_stats;
+    unsigned long long line_started;     // when the command being handled was read (0 = none)
+    unsigned long long play_started;     // setup done, first command asked for (0 = not yet)
+
+    // Last check of the archetype file for edits (ScriptStats::now)
+    unsigned long long reload_checked;
+
+    // Commands read so far this session (keyframes are numbered by it)
+    unsigned long long commands;
+
+    // Journal being recorded (not owned), or NULL
+    JournalWriter* journal;
+
+    // Journal being replayed (not owned), or NULL: lines come from it
+    // instead of the transport, starting from replay_start's snapshot
+    // (if any), and output is hidden until command replay_seek
+    const JournalReader* replay;
+    const JournalReader::Keyframe* replay_start;
+    std::size_t replay_line;             // next line to play
+    unsigned long long replay_seek;
+    ReplayStats* replay_stats;
+
+    // Save file (not owned), or NULL: saved every autosave_every commands
+    // (0 = never by itself), on "save" and when the player leaves
+    SaveWriter* save_file;
+    unsigned int autosave_every;
+
+    // Saved game to resume from (not owned), or NULL
+    const SaveReader* resume_from;
+
+    // Rooms, each listed once in the order first added (`added` is
+    // indexed by id)
+    struct RoomSet {
+        std::vector<RoomId> ids;
+        std::vector<bool> added;
+
+        void add(RoomId id, std::size_t room_count) {
+            if(added.size() < room_count){
+                added.resize(room_count, false);
+            }
+            if(id < added.size() && !added[id]){
+                added[id] = true;
+                ids.push_back(id);
+            }
+        }
+        void clear() {
+            for(std::size_t i = 0; i < ids.size(); i++){
+                added[ids[i]] = false;
+            }
+            ids.clear();
+        }
+    };
+
+    // Rooms changed since the last save and since the last journal
+    // keyframe. A room only changes while the player is in it - fights,
+    // loot, pickups, monsters spawned on first look - or while a monster
+    // in it is under a status effect, so these are all an incremental
+    // save or a delta keyframe has to write
+    RoomSet save_rooms;
+    RoomSet keyframe_rooms;
     
+    // The game itself (run() sets up the output around it)
+    // in Game.cpp
+    void play();
+
+    // Send the output so far, then read the next line (from the replayed
+    // journal, if any) and journal it as `kind`; false at end of input,
+    // if the other end has gone away or if a replay has gone off course
+    // in Game.cpp
+    bool readLine(std::string& line, JournalRecord kind);
+
+    // Between commands: write a keyframe if one is due, or on replay
+    // check the state against the journal's and stop hiding output
+    // in Game.cpp
+    void checkpoint();
+
+    // Snapshot of everything a session changes - every room that exists,
+    // where the player is, the player, status effects - and putting one back
+    // into a game whose world was just built the same way
+    // in Game.cpp
+    bool saveState(ByteWriter& out);
+    bool restoreState(ByteReader& in);
+
+    // A journal keyframe: a full snapshot, or the same layout with only
+    // the rooms changed since the last keyframe; and a chain of them
+    // (full first) put back, the way restoreState would the last
+    // in Game.cpp
+    bool saveKeyframe(ByteWriter& out, bool full);
+    bool restoreKeyframes(const JournalReader::Keyframe* last);
+    bool readSetup(ByteReader& in, const char* source);
+
+    // The two halves of a snapshot: rooms by id (`ids`, or NULL for every
+    // room that exists); then where the player is, the player and the
+    // status effects (restored after the rooms, whose monsters they name)
+    // in Game.cpp
+    bool savePlayerState(ByteWriter& out);
+    uint32_t saveRoomStates(ByteWriter& out, const std::vector<RoomId>* ids);
+    bool restorePlayerState(ByteReader& in);
+    bool restoreRoomStates(ByteReader& in);
+
+    // EffectTargets: a monster under a status effect is saved as its
+    // room and its slot there (the player's room, then the other
+    // resident rooms, are searched)
+    // in Game.cpp
+    bool locate(const Character& target, uint32_t& where, uint32_t& slot) const;
+    Character* resolve(uint32_t where, uint32_t slot) const;
+
+    // Saved games: full the first time, then only the dirty rooms
+    // markDirty adds to both sets; resetDirty empties one down to what
+    // still changes (the player's room, rooms with monsters under effects)
+    // in Game.cpp
+    void markDirty(RoomId id);
+    void resetDirty(RoomSet& rooms);
+    bool saveGame(bool announce);
+    bool resumeSave();
+
+    // Command table: every verb and alias sits at its perfect-hash slot
+    // (Command::hashVerb), so dispatch is one hash, one comparison and a
+    // call, however many verbs there are. To add one, append it to VERBS;
+    // VERB_TABLE is filled from VERBS at startup, which stops the program
+    // if two verbs land in one slot (hashVerb then needs new multipliers)
+    typedef void (Game::*CommandHandler)(const TextView& object);
+    struct VerbEntry {
+        const char* verb;
+        CommandHandler handler;
+    };
+    static const VerbEntry VERBS[];
+    static unsigned char VERB_TABLE[Command::VERB_SLOTS];   // VERBS index + 1, 0 = empty
+    static const bool VERB_TABLE_BUILT;
+
+    // in Game.cpp
+    static bool buildVerbTable();
+
+    // Handlers: check the object, then call the command it names
+    // in Game.cpp
+    void doGo(const TextView& object);
+    void doTravel(const TextView& object);
+    void doLook(const TextView& object);
+    void doAttack(const TextView& object);
+    void doPickup(const TextView& object);
+    void doInventory(const TextView& object);
+    void doUse(const TextView& object);
+    void doEquip(const TextView& object);
+    void doStats(const TextView& object);
+    void doHelp(const TextView& object);
+    void doSave(const TextView& object);
+    void doQuit(const TextView& object);
+
     // Private helper methods - command handlers
     // in Game.cpp
     void processCommand(const std::string& command);
     void move(const std::string& direction);
+    void travel(const std::string& room_name);
+    void enterRoom(Room* room);
     void look();
-    void attack();
+    void attack(const std::string& target);
     void pickupItem(const std::string& item_name);
     void inventory();
     void useItem(const std::string& item_name);
@@ -44,8 +245,12 @@ private:
     void help();
     
     // Combat system
+    // Fights the whole group; focus is the default target
+    // in Game.cpp
+    void combat(MonsterGroup& group, Monster* focus);
+    // A dead member: rewards, loot, then it leaves the group
     // in Game.cpp
-    void combat(Monster* monster);
+    void defeat(MonsterGroup& group, std::size_t slot);
     
 public:
     // Constructor
@@ -55,17 +260,86 @@ public:
     // Destructor - CRITICAL for memory management!
     // in Game.cpp
     // - Must delete player
-    // - Must delete all rooms in world map
+    // - Rooms are deleted by the World member
     ~Game();
     
     // Game initialization
     // in Game.cpp
-	    void initializeWorld();
+    void initializeWorld();
     void createStartingInventory();
+
+    // Procedural world generation
+    // in Game.cpp
+    void setGenerator(const GeneratorConfig& config);
+    void generateWorld(GeneratorStats* stats);
+
+    // Compiled (binary, memory-mapped) worlds
+    // in Game.cpp
+    void setWorldFile(const std::string& path) { world_file = path; }
+    void setDataFiles(const std::string& items, const std::string& monsters) {
+        item_file = items;
+        monsters_file = monsters;
+    }
+    bool loadWorldFile();
+    bool compileWorld(const std::string& path);
+    const World& getWorld() const { return world; }
+
+    // Room paging
+    // in Game.cpp
+    void setPagingBudget(std::size_t bytes) { paging_budget = bytes; }
+    void startPaging();
+
+    // Random streams: same seed + same commands = same fights
+    void setRandomSeed(unsigned long long seed) { rng_seed = seed; }
+
+    // Input and output (not owned; NULL goes back to the terminal)
+    void setTransport(Transport* t) { transport = (t != NULL) ? t : &terminal; }
+    void setFlushEveryLine(bool every_line) { flush_lines = every_line; }
+
+    // Play the transport's input as a script (see ScriptStats)
+    void setScriptMode(ScriptStats* stats, bool keep_output) {
+        script_mode = true;
+        script_stats = stats;
+        script_output = keep_output;
+    }
+
+    // Session journal (see Journal.h): the setup block is what a replay
+    // needs to build the same game - seed, world, prompts - so write it
+    // once everything else is set
+    // in Game.cpp
+    void setJournal(JournalWriter* j) { journal = j; }
+    void writeSetup(ByteWriter& out) const;
+
+    // Replay a journal instead of reading input: the setup comes from it,
+    // play starts at its last keyframe at or before `seek` and output is
+    // shown from command `seek` on; false if the setup can't be used
+    // in Game.cpp
+    bool setReplay(const JournalReader* journal, unsigned long long seek, ReplayStats* stats);
+
+    // Save to a file as the game goes (not owned; see SaveGame.h)
+    void setSaveFile(SaveWriter* save, unsigned int every) {
+        save_file = save;
+        autosave_every = every;
+    }
+
+    // Resume a saved game: the setup (seed, world) comes from it, the
+    // player's name too, and the saved state replaces the new game's
+    // before the first command; false if the setup can't be used
+    // in Game.cpp
+    bool setResume(const SaveReader* save);
+
+    // Entity pools
+    void setPoolStats(bool show) { show_pool_stats = show; }
+    void printPoolStats() { arena.printStats(output); Monster::getSpawnStats().print(output); }
     
     // Main game loop
     // in Game.cpp
     void run();
+
+    // Play `commands` commands from memory twice - output sent every line
+    // (the old std::endl behaviour) and once per command - and compare
+    // in Game.cpp
+    static bool benchmarkTransport(unsigned int commands, unsigned long long seed);
     
     // World building helpers
     // in Game.cpp
@@ -3,6 +3,61 @@
 
 #include <string>
 #include <iostream>
+#include "EntityArena.h"
+#include "StatusEffects.h"
+
+class ByteWriter;
+class ByteReader;
+class Item;
+
+/**
+ * ItemKind - Compact type tag stored in every Item
+ *
+ * The numbers are also the item tags in paged-out room data, so don't
+ * renumber them.
+ */
+enum ItemKind {
+    ITEM_WEAPON = 0,
+    ITEM_ARMOR = 1,
+    ITEM_CONSUMABLE = 2
+};
+
+/**
+ * EquipSlot - Where the player wears an item
+ *
+ * Weapons go in the weapon slot; armor in the body slot unless the item
+ * catalog says otherwise (a helm on the head, a shield on the arm), so
+ * several pieces of armor can be worn at once. Consumables aren't worn.
+ */
+enum EquipSlot {
+    EQUIP_WEAPON,
+    EQUIP_BODY,
+    EQUIP_HEAD,
+    EQUIP_HANDS,
+    EQUIP_FEET,
+    EQUIP_SHIELD,
+    EQUIP_SLOT_COUNT,
+    EQUIP_NONE = EQUIP_SLOT_COUNT
+};
+
+/**
+ * ItemPrototype - The immutable part of an item, shared by every instance
+ *
+ * Prototypes are interned by ItemCatalog (see ItemCatalog.h) and live
+ * until the program exits, so items can keep a plain pointer to theirs.
+ */
+struct ItemPrototype {
+    std::string name;
+    std::string description;
+    ItemKind kind;
+    int value;  // Damage bonus, defense bonus, or healing amount
+    EffectSpec effect;  // consumables: put on whoever uses it (set by the catalog)
+    EquipSlot slot;     // where it is worn (EQUIP_NONE for consumables; set by the catalog)
+
+    // New instance of this prototype (Weapon, Armor or Consumable)
+    // in Item.cpp
+    Item* create() const;
+};
 
 /**
  * Item class - Base class for all items in the game
@@ -16,84 +71,130 @@
  * - Practice inheritance
  * - Override virtual functions
  * - Understand polymorphism through items
+ *
+ * Flyweight: an instance only holds a pointer to its shared prototype
+ * (name, description, kind, value) plus its own mutable state, such as
+ * Consumable::used. The name/description constructor interns the data in
+ * the ItemCatalog, so a million "Small Potion"s share one copy of the text.
  */
 class Item {
 private:
-    std::string name;
-    std::string description;
-    std::string type;  // "Weapon", "Armor", or "Consumable"
-    int value;  // Damage bonus, defense bonus, or healing amount
+    const ItemPrototype* proto;  // shared, never NULL
     
 public:
-    // Constructor
+    // Constructors
     // in Item.cpp
     Item(const std::string& name, const std::string& description, 
-         const std::string& type, int value);
+         ItemKind kind, int value);
+    explicit Item(const ItemPrototype* proto);
     
     // Destructor
     // in Item.cpp
     virtual ~Item();
     
     // Getters (inline)
-    std::string getName() const { return name; }
-    std::string getDescription() const { return description; }
-    std::string getType() const { return type; }
-    int getValue() const { return value; }
+    const std::string& getName() const { return proto->name; }
+    const std::string& getDescription() const { return proto->description; }
+    ItemKind getKind() const { return proto->kind; }
+    const char* getType() const { return kindName(getKind()); }   // "Weapon", ... for display
+    int getValue() const { return proto->value; }
+    const ItemPrototype* getPrototype() const { return proto; }
+    EquipSlot getSlot() const { return proto->slot; }
     
     // Virtual function with default implementation
     // Derived classes should override this
     // in Item.cpp
-    virtual void displayInfo() const;
+    virtual void displayInfo(std::ostream& out) const;
     
     // Virtual function for using items
     // Default does nothing - Consumable overrides
-    virtual void use() { }
+    virtual void use(std::ostream& out) { (void)out; }
     
     // Display brief item info
     // in Item.cpp
-    void displayBrief() const;
+    void displayBrief(std::ostream& out) const;
+
+    // Binary state (used when rooms are paged out)
+    // in Item.cpp
+    void serialize(ByteWriter& out) const;
+    static Item* deserialize(ByteReader& in);
+
+    // Rough heap footprint, for memory budgets (prototype text is shared, not counted)
+    std::size_t memoryFootprint() const { return sizeof(Item); }
+
+    // Display name of a kind
+    // in Item.cpp
+    static const char* kindName(ItemKind kind);
+
+    // Where items of a kind are worn unless the catalog says otherwise,
+    // and the slot's name ("weapon", "body", "head", ...)
+    // in Item.cpp
+    static EquipSlot defaultSlot(ItemKind kind);
+    static const char* slotName(EquipSlot slot);
 };
 
+/**
+ * item_cast - Checked downcast using the type tag (no RTTI)
+ *
+ * Returns NULL if the item is NULL or not of type T:
+ *     if(Weapon* w = item_cast<Weapon>(item)) { ... }
+ */
+template <class T>
+T* item_cast(Item* item) {
+    return (item != NULL && item->getKind() == T::KIND) ? static_cast<T*>(item) : NULL;
+}
+
+template <class T>
+const T* item_cast(const Item* item) {
+    return (item != NULL && item->getKind() == T::KIND) ? static_cast<const T*>(item) : NULL;
+}
+
 /**
  * Weapon class - Items that increase attack damage
  */
 class Weapon : public Item {
-private:
-    int damage_bonus;
-    
 public:
+    static const ItemKind KIND = ITEM_WEAPON;
+
+    // Allocated from the active EntityArena
+    ARENA_ALLOCATED(ENTITY_WEAPON)
+
     // Constructor
     // in Item.cpp
     // Must call base Item constructor in initializer list
     Weapon(const std::string& name, const std::string& description, int damage);
+    explicit Weapon(const ItemPrototype* proto) : Item(proto) { }
     
     // Override displayInfo to show weapon-specific format
     // in Item.cpp
-    void displayInfo() const;
+    void displayInfo(std::ostream& out) const;
     
     // Getter
-    int getDamageBonus() const { return damage_bonus; }
+    int getDamageBonus() const { return getValue(); }
 };
 
 /**
  * Armor class - Items that increase defense
  */
 class Armor : public Item {
-private:
-    int defense_bonus;
-    
 public:
+    static const ItemKind KIND = ITEM_ARMOR;
+
+    // Allocated from the active EntityArena
+    ARENA_ALLOCATED(ENTITY_ARMOR)
+
     // Constructor
     // in Item.cpp
     // Must call base Item constructor in initializer list
     Armor(const std::string& name, const std::string& description, int defense);
+    explicit Armor(const ItemPrototype* proto) : Item(proto) { }
     
     // Override displayInfo to show armor-specific format
     // in Item.cpp
-    void displayInfo() const;
+    void displayInfo(std::ostream& out) const;
     
     // Getter
-    int getDefenseBonus() const { return defense_bonus; }
+    int getDefenseBonus() const { return getValue(); }
 };
 
 /**
@@ -101,25 +202,31 @@ public:
  */
 class Consumable : public Item {
 private:
-    int healing_amount;
-    bool used;
+    bool used;      // the only per-instance state
     
 public:
+    static const ItemKind KIND = ITEM_CONSUMABLE;
+
+    // Allocated from the active EntityArena
+    ARENA_ALLOCATED(ENTITY_CONSUMABLE)
+
     // Constructor
     // in Item.cpp
     // Must call base Item constructor in initializer list
     Consumable(const std::string& name, const std::string& description, int healing);
+    explicit Consumable(const ItemPrototype* proto) : Item(proto), used(false) { }
     
     // Override displayInfo to show consumable-specific format
     // in Item.cpp
-    void displayInfo() const;
+    void displayInfo(std::ostream& out) const;
     
     // Override use function
     // in Item.cpp
-    void use();
+    void use(std::ostream& out);
     
     // Getters
-    int getHealingAmount() const { return healing_amount; }
+    int getHealingAmount() const { return getValue(); }
+    const EffectSpec& getEffect() const { return getPrototype()->effect; }
     bool isUsed() const { return used; }
 };
 
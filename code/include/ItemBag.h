@@ -0,0 +1,87 @@
+#ifndef ITEM_BAG_H
+#define ITEM_BAG_H
+
+#include "NameIndex.h"
+#include <vector>
+#include <string>
+#include <cstddef>
+
+class Item;
+
+/**
+ * ItemBag class - A list of items with a case-insensitive name index
+ *
+ * Items are kept in a vector (the order they are listed in), and a
+ * NameIndex maps each item's case-folded name to its position there. The
+ * folded key is built once in add(); find() and take() hash the query in
+ * place, so a lookup is O(1) and never allocates.
+ *
+ * Removing an item moves the last one into its place, so that is O(1)
+ * too: items are listed in the order they were added, except that one
+ * taken from the middle leaves the newest item in its spot.
+ *
+ * transfer()/transferAll() move items (and their already-folded index
+ * keys) from one bag to another - room floor, player inventory, monster
+ * loot. Space in the destination is reserved before anything is moved
+ * (growing it geometrically, like push_back would), so a transfer either
+ * happens completely or not at all.
+ *
+ * The bag does NOT own its items - whoever owns the bag decides when to
+ * delete them (see deleteAll).
+ */
+class ItemBag {
+private:
+    std::vector<Item*> items;
+    NameIndex index;              // folded name -> position in items
+
+    // in ItemBag.cpp
+    void removeAt(std::size_t pos);
+    void fillGap(std::size_t pos);
+    void makeRoom(std::size_t more);
+
+    // Not copyable - two bags would share the same items
+    ItemBag(const ItemBag&);
+    ItemBag& operator=(const ItemBag&);
+
+public:
+    // in ItemBag.cpp
+    ItemBag();
+
+    // Add an item (NULL is ignored)
+    // in ItemBag.cpp
+    void add(Item* item);
+
+    // Lookup by name, case-insensitive - NULL if missing
+    // in ItemBag.cpp
+    Item* find(const char* name, std::size_t len) const;
+    Item* find(const std::string& name) const { return find(name.data(), name.size()); }
+    bool contains(const std::string& name) const { return find(name) != NULL; }
+
+    // Take an item out of the bag (caller now owns it) - NULL if missing
+    // in ItemBag.cpp
+    Item* take(const std::string& name);
+    bool remove(Item* item);
+
+    // Move one item (by name) / every item into another bag
+    // Returns the item moved (NULL if missing) / how many were moved
+    // in ItemBag.cpp
+    Item* transfer(ItemBag& to, const char* name, std::size_t len);
+    Item* transfer(ItemBag& to, const std::string& name) { return transfer(to, name.data(), name.size()); }
+    std::size_t transferAll(ItemBag& to);
+
+    // Forget every item / delete every item
+    // in ItemBag.cpp
+    void clear();
+    void deleteAll();
+
+    // Listing order access
+    std::size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    Item* operator[](std::size_t i) const { return items[i]; }
+    const std::vector<Item*>& list() const { return items; }
+
+    // Bytes used by the list and the index (not the items themselves)
+    std::size_t memoryFootprint() const { return items.capacity() * sizeof(Item*) + index.bucketCount() * NameIndex::bucketBytes(); }
+};
+
+#endif // ITEM_BAG_H
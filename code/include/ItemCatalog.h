@@ -0,0 +1,86 @@
+#ifndef ITEM_CATALOG_H
+#define ITEM_CATALOG_H
+
+#include "Item.h"
+#include "NameIndex.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <pthread.h>
+
+/**
+ * ItemCatalog class - The one place item data lives (flyweight factory)
+ *
+ * Every distinct (kind, name, description, value, slot, effect) is stored
+ * once as an ItemPrototype; items only point at theirs. intern() hands back the
+ * existing prototype for data it has already seen, so the generator's
+ * thousands of "Health Potion"s cost one string each, not one per item.
+ *
+ * Prototypes are never freed before exit, so the pointers stay valid for
+ * as long as any item, room file or pager might hold them. The catalog is
+ * locked because the generator's worker threads intern in parallel.
+ *
+ * Named items (create("Small Potion")) come from the built-in list, which
+ * a data file can extend or override - see loadFile for the format.
+ */
+class ItemCatalog {
+private:
+    std::vector<ItemPrototype*> prototypes;   // owned, in creation order
+    std::vector<std::size_t> table;           // open addressing on the full contents (index + 1, 0 = empty)
+    NameIndex by_name;                        // folded name -> index in prototypes
+    pthread_mutex_t lock;
+
+    // in ItemCatalog.cpp
+    ItemCatalog();
+    ~ItemCatalog();
+    static unsigned int hashContents(const std::string& name, const std::string& description,
+                                     ItemKind kind, int value, EquipSlot equip, const EffectSpec& effect);
+    void growTable();
+    std::size_t internLocked(const std::string& name, const std::string& description,
+                             ItemKind kind, int value, EquipSlot equip, const EffectSpec& effect);
+
+    // Not copyable - there is only one
+    ItemCatalog(const ItemCatalog&);
+    ItemCatalog& operator=(const ItemCatalog&);
+
+public:
+    // in ItemCatalog.cpp
+    static ItemCatalog& instance();
+
+    // Shared prototype for this data (made on first sight), worn in `slot`
+    // (EQUIP_NONE: the kind's usual slot) and with `effect` when used
+    // The name is only registered for create() if nothing had it yet
+    // in ItemCatalog.cpp
+    const ItemPrototype* intern(const std::string& name, const std::string& description,
+                                ItemKind kind, int value, EquipSlot slot = EQUIP_NONE,
+                                const EffectSpec& effect = EffectSpec());
+
+    // Like intern, but the name now refers to this prototype (data files use this)
+    // in ItemCatalog.cpp
+    const ItemPrototype* define(const std::string& name, const std::string& description,
+                                ItemKind kind, int value, const EffectSpec& effect = EffectSpec(),
+                                EquipSlot slot = EQUIP_NONE);
+
+    // Lookup by name (case-insensitive) - NULL if unknown
+    // in ItemCatalog.cpp
+    const ItemPrototype* find(const std::string& name);
+
+    // New instance of a named item - NULL (and an error) if unknown
+    // in ItemCatalog.cpp
+    Item* create(const std::string& name);
+
+    // Add or override named items from a text file, one per line:
+    //     kind | name | description | value [| effect or slot]
+    // kind is weapon, armor or consumable; '#' starts a comment; the last
+    // field is a consumable's status effect such as "regeneration 5 6",
+    // or where an armor is worn (body, head, hands, feet, shield; body
+    // if left out)
+    // Prints an error and returns false if the file can't be read or parsed
+    // in ItemCatalog.cpp
+    bool loadFile(const std::string& path);
+
+    // in ItemCatalog.cpp
+    std::size_t size();
+};
+
+#endif // ITEM_CATALOG_H
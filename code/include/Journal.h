@@ -0,0 +1,196 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "Command.h"
+#include "Serializer.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * JournalRecord - Record types in a session journal
+ *
+ * The numbers are written to journal files, so don't renumber them.
+ */
+enum JournalRecord {
+    JOURNAL_NAME = 1,        // the player's name (the first line read)
+    JOURNAL_COMMAND = 2,     // a line handed to processCommand
+    JOURNAL_ACTION = 3,      // a line read during a fight
+    JOURNAL_KEYFRAME = 4,    // the game's state between two commands
+    JOURNAL_RELOAD = 5,      // the monster archetype file was reloaded
+    JOURNAL_DELTA = 6        // a keyframe of what changed since the one before
+};
+
+/**
+ * JournalWriter - Records a session to a binary journal file
+ *
+ * The file is "RPGJ", a version, the game's setup block (seed and world,
+ * written by Game::writeSetup), then records. Each record is a type byte
+ * followed, for a line, by its length as a varint and the text ("look"
+ * costs 6 bytes), or for a keyframe by the number of commands played and
+ * a snapshot of the game's state. Rolls come from counter-based streams
+ * keyed by the seed (see Random.h), so the setup and the lines are all it
+ * takes to play the session again exactly; the keyframes, every
+ * keyframe_every commands, let a replay start near the point of interest
+ * instead of at the beginning.
+ *
+ * Only every FULL_EVERY-th keyframe is a full snapshot (every room); the
+ * ones in between are deltas holding the rooms changed since the keyframe
+ * before and the player. A replay restores the last full keyframe and
+ * the deltas after it, in order.
+ *
+ * Records collect in memory and are written 4 KB at a time, at every
+ * keyframe and on flush() - the Game flushes after each line a person
+ * types, so a crash never loses the command that caused it.
+ */
+class JournalWriter {
+private:
+    int fd;
+    ByteWriter pending;                  // records not written yet
+    unsigned int keyframe_every;         // 0 = no keyframes
+    unsigned long long commands;         // command lines recorded
+    unsigned long long keyframe_at;      // commands at the last keyframe
+    unsigned long long keyframes;
+    unsigned long long skipped;          // keyframes due but not written
+    unsigned int deltas;                 // written since the last full keyframe
+    bool have_full;                      // a full keyframe has been written
+    unsigned long long bytes;            // written to the file so far
+    bool failed;
+
+    // Not copyable - owns the file
+    JournalWriter(const JournalWriter&);
+    JournalWriter& operator=(const JournalWriter&);
+
+public:
+    static const uint32_t MAGIC = 0x4A475052;     // "RPGJ"
+    static const uint32_t VERSION = 4;
+    static const std::size_t FLUSH_BYTES = 4096;
+    static const unsigned int FULL_EVERY = 16;
+
+    // in Journal.cpp
+    JournalWriter();
+    ~JournalWriter();
+
+    // Create (or truncate) the file and write the header and setup
+    // in Journal.cpp
+    bool open(const std::string& path, const std::string& setup, unsigned int keyframe_every);
+    bool isOpen() const { return fd >= 0; }
+
+    // in Journal.cpp
+    void recordLine(JournalRecord kind, const std::string& line);
+    void recordKeyframe(const std::string& state, bool full);
+    void skipKeyframe();
+    void recordReload(unsigned int version);
+
+    // A keyframe is due before the next command
+    bool keyframeDue() const {
+        return keyframe_every > 0 && commands > 0 && commands % keyframe_every == 0 && commands != keyframe_at;
+    }
+
+    // The keyframe due should be a full one (the first, then every FULL_EVERY-th)
+    bool fullKeyframeDue() const { return !have_full || deltas + 1 >= FULL_EVERY; }
+
+    // Write out what has collected; false once a write has failed
+    // in Journal.cpp
+    bool flush();
+    void close();
+
+    unsigned long long commandCount() const { return commands; }
+    unsigned long long keyframeCount() const { return keyframes; }
+    unsigned long long skippedCount() const { return skipped; }
+    unsigned long long bytesWritten() const { return bytes + pending.size(); }
+};
+
+/**
+ * JournalReader - A journal file loaded for replay
+ *
+ * load() reads the file in one go and indexes it in one pass: every line
+ * (kind and text, as views into the file's bytes) and every keyframe, so
+ * finding where to start a replay is a binary search. A delta whose full
+ * keyframe (or any delta since) is missing is left out of the index. A file cut short
+ * (the game crashed mid-write) loads up to its last whole record.
+ */
+class JournalReader {
+public:
+    struct Keyframe {
+        unsigned long long command;   // commands played before it
+        std::size_t line;             // lines read before it (the name included)
+        TextView state;               // Game snapshot, or a delta
+        bool full;
+        std::size_t base;             // index of the full keyframe a delta builds on
+    };
+
+private:
+    struct Line {
+        JournalRecord kind;
+        TextView text;
+    };
+
+    std::string data;                    // the whole file
+    TextView setup;
+    std::vector<Line> lines;
+    std::vector<Keyframe> keyframes;     // in command order
+    unsigned long long commands;
+    unsigned long long reloads;
+    bool truncated;
+
+    // Not copyable - the views point into data
+    JournalReader(const JournalReader&);
+    JournalReader& operator=(const JournalReader&);
+
+public:
+    // in Journal.cpp
+    JournalReader();
+
+    // Read and index a journal; false with a message if it isn't one
+    // in Journal.cpp
+    bool load(const std::string& path);
+
+    const TextView& getSetup() const { return setup; }
+    std::size_t lineCount() const { return lines.size(); }
+    JournalRecord lineKind(std::size_t i) const { return lines[i].kind; }
+    const TextView& line(std::size_t i) const { return lines[i].text; }
+
+    // The last keyframe at or before a command / the one exactly at it
+    // (NULL if none)
+    // in Journal.cpp
+    const Keyframe* findKeyframe(unsigned long long command) const;
+    const Keyframe* keyframeAt(unsigned long long command) const;
+
+    // What to restore, in order, to get to `last`: the full keyframe it
+    // builds on, then every delta after that up to `last`
+    // in Journal.cpp
+    void keyframeChain(const Keyframe* last, std::vector<const Keyframe*>& chain) const;
+
+    unsigned long long commandCount() const { return commands; }
+    std::size_t keyframeCount() const { return keyframes.size(); }
+    unsigned long long reloadCount() const { return reloads; }
+    bool isTruncated() const { return truncated; }
+};
+
+/**
+ * ReplayStats - What a replay did, and whether it matched the recording
+ *
+ * Whenever a replay reaches a command the journal has a keyframe for,
+ * the Game snapshots its own state and compares it byte for byte with
+ * the recorded one.
+ */
+struct ReplayStats {
+    unsigned long long start;            // commands already played at its keyframe (0 = none)
+    unsigned long long seek;             // first command shown (0 = everything)
+    unsigned long long commands;         // commands played
+    unsigned long long checked;          // keyframes compared
+    unsigned long long mismatched;
+    unsigned long long first_mismatch;   // command of the first one that differed
+    unsigned long long reloads;          // archetype reloads while recording
+    double seconds;
+
+    ReplayStats() : start(0), seek(0), commands(0), checked(0), mismatched(0),
+                    first_mismatch(0), reloads(0), seconds(0) { }
+
+    // in Journal.cpp
+    void print() const;
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,87 @@
+#ifndef LOOT_TABLE_H
+#define LOOT_TABLE_H
+
+#include <vector>
+#include <cstddef>
+
+struct ItemPrototype;
+class ItemBag;
+class RandomStream;
+
+/**
+ * LootDrop - One thing a loot table can give: an item, a roll on another
+ * table, or nothing at all (both unset)
+ */
+struct LootDrop {
+    const ItemPrototype* item;   // catalog prototype (never freed)
+    int table;                   // nested table index, -1 if none
+
+    LootDrop() : item(NULL), table(-1) { }
+};
+
+/**
+ * LootTable class - Guaranteed drops plus weighted rolls
+ *
+ * Every kill gets all of the `always` drops, then `rolls` picks from the
+ * weighted choices. Rarity tiers are just tables ("@rare") nested in
+ * other tables, so a goblin can roll the common tier most of the time
+ * and the rare one now and then.
+ *
+ * build() turns the weights into Vose's alias tables once, when the
+ * archetypes are loaded: a pick is then one random number, one multiply
+ * and one compare however many choices there are. Items are made only
+ * for what is actually picked.
+ *
+ * Nested tables are indexes into the owner's list (see ArchetypeTable);
+ * a table may only nest tables with a lower index, so rolls can't loop.
+ */
+class LootTable {
+public:
+    static const unsigned int MAX_WEIGHT = 1000000;
+    static const unsigned int MAX_CHOICES = 1024;
+    static const unsigned int MAX_ROLLS = 100;
+
+private:
+    std::vector<LootDrop> always;
+    std::vector<LootDrop> choices;
+    std::vector<unsigned int> weights;     // per choice, as given
+    std::vector<unsigned int> threshold;   // keep choice i if the low 32 bits are below this
+    std::vector<unsigned int> alias;       // ... otherwise take this one
+    unsigned int rolls;
+
+public:
+    LootTable() : rolls(1) { }
+
+    // Building (call build() after the last choice)
+    // in LootTable.cpp
+    void addAlways(const LootDrop& drop);
+    void addChoice(const LootDrop& drop, unsigned int weight);
+    void setRolls(unsigned int n) { rolls = n; }
+    void build();
+
+    // One kill's worth of loot: new items go straight into the bag
+    // in LootTable.cpp
+    void roll(const std::vector<LootTable>& tables, RandomStream& rng, ItemBag& into) const;
+
+    // One weighted pick (index into the choices)
+    // in LootTable.cpp
+    std::size_t pick(RandomStream& rng) const;
+
+    // Highest nested table index, -1 if none (for the no-loops rule)
+    // in LootTable.cpp
+    int maxNestedTable() const;
+
+    // Regression check: a common tier with a chance of nothing and of a
+    // nested rare tier, rolled `kills` times; false if any outcome's rate
+    // is more than five standard deviations from what the weights give,
+    // or a kill drops more than one item
+    // in LootTable.cpp
+    static bool check(unsigned int kills, unsigned long long seed);
+
+    std::size_t alwaysCount() const { return always.size(); }
+    std::size_t choiceCount() const { return choices.size(); }
+    unsigned int getRolls() const { return rolls; }
+    bool empty() const { return always.empty() && choices.empty(); }
+};
+
+#endif // LOOT_TABLE_H
@@ -3,8 +3,31 @@
 
 #include "Character.h"
 #include "Item.h"
+#include "ItemBag.h"
+#include "EntityArena.h"
+#include "ArchetypeRegistry.h"
 #include <vector>
 
+/**
+ * SpawnStats - How much of the world was never built
+ *
+ * Rooms hold a spawn descriptor until someone looks at the monster, and
+ * a monster rolls its loot only when it drops it; the differences are
+ * the Monsters and loot tables nobody ever needed.
+ */
+struct SpawnStats {
+    unsigned long long monsters_deferred;      // spawn descriptors given to rooms
+    unsigned long long monsters_materialized;  // ... turned into Monsters
+    unsigned long long loot_deferred;          // monsters made with loot not rolled
+    unsigned long long loot_rolled;            // ... that rolled it (on death)
+
+    SpawnStats() : monsters_deferred(0), monsters_materialized(0),
+                   loot_deferred(0), loot_rolled(0) { }
+
+    // in Monster.cpp
+    void print(std::ostream& out) const;
+};
+
 /**
  * Monster class - Base class for all enemy monsters
  * 
@@ -12,6 +35,12 @@
  * - Experience and gold rewards
  * - Loot table (items dropped when defeated)
  * - Attack messages (flavor text)
+ *
+ * Stats, messages and loot come from one line of an ArchetypeTable
+ * (ArchetypeRegistry.h); the monster keeps that table alive, so a reload
+ * mid-fight doesn't change it. The subclasses only pick the line and the
+ * entity pool, so nothing here needs a virtual call except the
+ * calculateDamage override inherited from Character.
  * 
  * MY LEARNING OBJECTIVES:
  * - Multi-level inheritance (Goblin -> Monster -> Character)
@@ -22,13 +51,21 @@ class Monster : public Character {
 private:
     int experience_reward;
     int gold_reward;
-    std::vector<Item*> loot_table;  // Monster owns these items!
+    const ArchetypeTable* table;    // retained for our lifetime
+    unsigned int archetype;         // id in table
+    bool loot_rolled;               // false until the table's loot is made
+    ItemBag loot_table;             // Monster owns these items!
+
+    // Stats and rewards from (*table)[archetype]
+    // in Monster.cpp
+    void applyArchetype();
+    void rollLoot();
     
 public:
-    // Constructor
+    // Constructor - stats from line `archetype` of the table (the
+    // registry's current one if NULL); its loot is made in dropLoot
     // Monster.cpp
-    Monster(const std::string& name, int hp, int attack, int defense, 
-            int exp_reward, int gold_reward);
+    explicit Monster(unsigned int archetype, const ArchetypeTable* table = NULL);
     
     // Destructor - CRITICAL for memory management!
     // in Monster.cpp
@@ -37,66 +74,83 @@ public:
     
     // Override displayStats from Character
     // in Monster.cpp
-    void displayStats() const;
+    void displayStats(std::ostream& out) const;
     
     // Loot management
     // in Monster.cpp
     void addLoot(Item* item);
-    std::vector<Item*> dropLoot();  // Transfers ownership!
-    
-    // Getters
-    int getExperienceReward() const { return experience_reward; }
-    int getGoldReward() const { return gold_reward; }
-    
-    // AI behavior - different monsters have different attack messages
+    std::size_t dropLoot(ItemBag& into);  // Rolls, then moves every item - transfers ownership!
+    void clearLoot();                     // Deletes all loot (none will be rolled)
+    const std::vector<Item*>& getLoot() const { return loot_table.list(); }  // only rolled/added loot
+    bool isLootRolled() const { return loot_rolled; }
+
+    // Switch an untouched monster to the registry's current table
+    // (called as a fight starts); false if nothing changed
     // in Monster.cpp
-    virtual std::string getAttackMessage() const;
-};
+    bool rebalance();
 
-/**
- * Goblin - Weak but common enemy
- */
-class Goblin : public Monster {
-public:
+    // Create a monster from its archetype name ("Goblin", ...) or id
+    // Returns NULL for unknown names
     // in Monster.cpp
-    // Call Monster constructor with appropriate stats
-    Goblin();
-    
-    // Override attack message
-    // TODO: Implement in Monster.cpp
-    std::string getAttackMessage() const;
-};
+    static Monster* create(const std::string& name);
+    static Monster* create(unsigned int archetype, const ArchetypeTable* table = NULL);
 
-/**
- * Skeleton - Undead warrior
- */
-class Skeleton : public Monster {
-public:
+    // Binary state: kind, HP, alive, random stream, loot (used when rooms are paged out)
     // in Monster.cpp
-    Skeleton();
-    
-    // Override attack message
+    void serialize(ByteWriter& out) const;
+    static Monster* deserialize(ByteReader& in);
+
+    // Rough heap footprint, for memory budgets
     // in Monster.cpp
-    std::string getAttackMessage() const;
-};
+    std::size_t memoryFootprint() const;
 
-/**
- * Dragon - Boss enemy
- * 
- * Special ability: Deals extra fire damage!
- */
-class Dragon : public Monster {
-public:
+    // Lazy spawning counters (Room reports its descriptors here)
     // in Monster.cpp
-    Dragon();
+    static void countSpawn(bool materialized);
+    static SpawnStats getSpawnStats();
     
-    // Override attack message
-    // in Monster.cpp
-    std::string getAttackMessage() const;
+    // Getters
+    int getExperienceReward() const { return experience_reward; }
+    int getGoldReward() const { return gold_reward; }
+    unsigned int getArchetypeId() const { return archetype; }
+    unsigned int getArchetypeVersion() const { return table->getVersion(); }
+
+    // Built-in kind, ARCHETYPE_COUNT for one added by a data file
+    MonsterArchetype getArchetype() const {
+        return archetype < ARCHETYPE_COUNT ? (MonsterArchetype)archetype : ARCHETYPE_COUNT;
+    }
     
-    // Override calculateDamage to add fire damage bonus
+    // Flavor text from the table - no string is built per turn
+    const char* getAttackMessage() const { return (*table)[archetype].attack_message.c_str(); }
+
+    // Flat damage added on top of calculateDamage's roll (the dragon's fire)
+    int getDamageBonus() const { return (*table)[archetype].damage_bonus; }
+
+    // Effect put on whoever it strikes (empty for most)
+    const EffectSpec& getOnHit() const { return (*table)[archetype].on_hit; }
+
+    // Attack roll plus the archetype's damage bonus
     // in Monster.cpp
     int calculateDamage() const;
 };
 
+/**
+ * Goblin, Skeleton, Dragon - one class per built-in archetype
+ *
+ * Each only binds its archetype id and its entity pool:
+ *     class Goblin : public Monster {
+ *         ARENA_ALLOCATED(ENTITY_GOBLIN)
+ *         explicit Goblin(const ArchetypeTable* table = NULL) : Monster(ARCHETYPE_GOBLIN, table) { }
+ *     };
+ * Archetypes added by a data file have no class; they are plain Monsters.
+ */
+#define MONSTER_CLASS(id, cls, hp, atk, def, exp, gold, bonus, pool, message, loot) \
+    class cls : public Monster { \
+    public: \
+        ARENA_ALLOCATED(pool) \
+        explicit cls(const ArchetypeTable* table = NULL) : Monster(ARCHETYPE_##id, table) { } \
+    };
+MONSTER_ARCHETYPES(MONSTER_CLASS)
+#undef MONSTER_CLASS
+
 #endif // MONSTER_H
@@ -0,0 +1,69 @@
+#ifndef MONSTER_ARCHETYPES_H
+#define MONSTER_ARCHETYPES_H
+
+#include "EntityArena.h"
+
+/**
+ * Monster archetypes - every kind of monster, declared in one table
+ *
+ * One line per archetype:
+ *   X(ID, Class, max HP, attack, defense, experience, gold, damage bonus,
+ *     arena pool, attack message, loot)
+ * where loot is a '|'-separated list of item catalog names.
+ *
+ * Everything else is generated from this list:
+ * - enum MonsterArchetype (ARCHETYPE_GOBLIN, ...)
+ * - ArchetypeTraits<ARCHETYPE_X>, the same numbers as compile-time
+ *   constants, so hot loops can be instantiated per archetype with no
+ *   virtual calls (see CombatSimulator)
+ * - version 1 of the ArchetypeRegistry table, which Monster reads
+ *   (a data file can rebalance these or add more; see ArchetypeRegistry.h)
+ * - the Goblin / Skeleton / Dragon classes (Monster.h)
+ *
+ * To add a built-in monster, add a line here (and an EntityKind for its pool).
+ */
+#define MONSTER_ARCHETYPES(X) \
+    X(GOBLIN,   Goblin,    30,  5,  2,  10,  5, 0, ENTITY_GOBLIN, \
+      "The goblin swipes at you with its rusty dagger!", \
+      "Small Potion") \
+    X(SKELETON, Skeleton,  40,  8,  4,  20, 10, 0, ENTITY_SKELETON, \
+      "The skeleton rattles its bones and slashes with a sword!", \
+      "Old Sword") \
+    X(DRAGON,   Dragon,   150, 20, 10, 100, 50, 5, ENTITY_DRAGON, \
+      "The dragon breathes fire at you!", \
+      "Dragon Slayer Sword|Dragon Scale Armor|Greater Health Potion")
+
+/**
+ * MonsterArchetype - ARCHETYPE_<ID> for each line of the table
+ */
+enum MonsterArchetype {
+#define ARCHETYPE_ENUM(id, cls, hp, atk, def, exp, gold, bonus, pool, message, loot) ARCHETYPE_##id,
+    MONSTER_ARCHETYPES(ARCHETYPE_ENUM)
+#undef ARCHETYPE_ENUM
+    ARCHETYPE_COUNT
+};
+
+/**
+ * ArchetypeTraits - One line of the table at compile time
+ * (built-ins have no on-hit effect; those come from the data file)
+ */
+template<MonsterArchetype A> struct ArchetypeTraits;
+
+#define ARCHETYPE_TRAITS(id, cls, hp, atk, def, exp, gold, bonus, pool, message, loot) \
+    template<> struct ArchetypeTraits<ARCHETYPE_##id> { \
+        static const int MAX_HP = hp; \
+        static const int ATTACK = atk; \
+        static const int DEFENSE = def; \
+        static const int EXPERIENCE = exp; \
+        static const int GOLD = gold; \
+        static const int DAMAGE_BONUS = bonus; \
+        static const int HIT_DAMAGE = 0; \
+        static const int HIT_TURNS = 0; \
+        static const bool HIT_POISON = false; \
+        static const char* name() { return #cls; } \
+        static const char* attackMessage() { return message; } \
+    };
+MONSTER_ARCHETYPES(ARCHETYPE_TRAITS)
+#undef ARCHETYPE_TRAITS
+
+#endif // MONSTER_ARCHETYPES_H
@@ -0,0 +1,86 @@
+#ifndef MONSTER_GROUP_H
+#define MONSTER_GROUP_H
+
+#include <string>
+#include <iostream>
+#include <cstddef>
+
+class Monster;
+
+/**
+ * MonsterGroup class - The monsters sharing a room (an encounter)
+ *
+ * Members sit in one small array with their initiative - a pointer and
+ * three byte counts, so a room with no monsters pays 16 bytes. Removing
+ * one (it died) moves the last member into its slot, so it is O(1) and
+ * the array never has holes; turn order is worked out from the
+ * initiatives when it is needed, not kept by position. A running count
+ * of living members makes "is anything here?" O(1) as well.
+ *
+ * The group owns its monsters. A member that dies must be removed (or
+ * the live count goes stale) - Game::combat does that right away.
+ */
+class MonsterGroup {
+public:
+    static const std::size_t MAX_SIZE = 16;
+    static const std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+    static const int NO_INITIATIVE = 0;
+
+private:
+    struct Member {
+        Monster* monster;
+        int initiative;           // 1-20, NO_INITIATIVE until rolled
+        bool counted;             // alive when added, so part of live
+    };
+
+    Member* members;              // new[]'d, NULL while empty
+    unsigned char count;
+    unsigned char capacity;
+    unsigned char live;
+
+    // Not copyable - owns the monsters
+    MonsterGroup(const MonsterGroup&);
+    MonsterGroup& operator=(const MonsterGroup&);
+
+public:
+    // in MonsterGroup.cpp
+    MonsterGroup();
+    ~MonsterGroup();
+
+    // Take ownership; false (and nothing changes) if the group is full
+    // in MonsterGroup.cpp
+    bool add(Monster* monster);
+
+    // Delete member i; the last member takes its slot
+    // in MonsterGroup.cpp
+    void removeAt(std::size_t i);
+    void clear();
+
+    std::size_t size() const { return count; }
+    std::size_t liveCount() const { return live; }
+    bool empty() const { return count == 0; }
+    Monster* operator[](std::size_t i) const { return members[i].monster; }
+    int getInitiative(std::size_t i) const { return members[i].initiative; }
+    void setInitiative(std::size_t i, int value) { members[i].initiative = value; }   // restoring saved state
+
+    // Roll initiative for members that haven't got one (their own streams)
+    // in MonsterGroup.cpp
+    void rollInitiative();
+
+    // Living members, highest initiative first (ties: lower slot first);
+    // fills order and returns how many
+    // in MonsterGroup.cpp
+    std::size_t turnOrder(std::size_t order[MAX_SIZE]) const;
+
+    // Pick a living target: "" (first in turn order), "2" (slot 2, as
+    // listed), "goblin" (first goblin) or "goblin 2" (second goblin)
+    // Returns NOT_FOUND if nothing matches
+    // in MonsterGroup.cpp
+    std::size_t findTarget(const std::string& target) const;
+
+    // One numbered line per living member, as targets are numbered
+    // in MonsterGroup.cpp
+    void display(std::ostream& out) const;
+};
+
+#endif // MONSTER_GROUP_H
@@ -0,0 +1,84 @@
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/**
+ * NameIndex class - Case-insensitive hash index from names to ids
+ *
+ * Every name is case-folded once when it is inserted, so lookups never
+ * copy or lowercase the query string - the hash and the comparison fold
+ * each character on the fly. Collisions are resolved with linear probing
+ * and erase uses backward shifting, so there are no tombstones.
+ *
+ * Duplicate names are allowed (two "Small Potion"s in one bag); find()
+ * returns any one of them, findNext() walks them all, erase() removes the
+ * entry holding that value.
+ */
+class NameIndex {
+public:
+    static const std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+
+private:
+    struct Entry {
+        unsigned int hash;
+        std::size_t value;
+        std::string key;       // already case-folded
+        bool used;
+    };
+
+    std::vector<Entry> slots;  // size is always zero or a power of two
+    std::size_t count;
+
+    void grow();
+    std::size_t probeStart(unsigned int hash) const { return hash & (slots.size() - 1); }
+    void eraseSlot(std::size_t slot);
+    std::size_t locate(const char* name, std::size_t len, std::size_t value) const;
+
+public:
+    // Constructor
+    // in NameIndex.cpp
+    NameIndex();
+
+    // Hash and compare helpers (case-insensitive, allocation-free)
+    // in NameIndex.cpp
+    static unsigned int hashName(const char* name, std::size_t len);
+    static bool equalsFolded(const std::string& folded, const char* name, std::size_t len);
+    static bool equalsIgnoreCase(const char* a, std::size_t a_len, const char* b, std::size_t b_len);
+    static std::string fold(const std::string& name);
+
+    // Index maintenance
+    // in NameIndex.cpp
+    void insert(const std::string& name, std::size_t value);
+    bool erase(const char* name, std::size_t len, std::size_t value);
+    bool erase(const std::string& name, std::size_t value) { return erase(name.data(), name.size(), value); }
+    void clear();
+    void reserve(std::size_t n);
+    void swap(NameIndex& other);
+    bool update(const char* name, std::size_t len, std::size_t value, std::size_t new_value);
+
+    // Move one entry (name + value) into another index, folded key and all,
+    // where it holds new_value
+    // Nothing is allocated if dest has room (see reserve)
+    // in NameIndex.cpp
+    bool moveTo(NameIndex& dest, const char* name, std::size_t len, std::size_t value, std::size_t new_value);
+
+    // Lookup - returns NOT_FOUND if the name is not present
+    // in NameIndex.cpp
+    std::size_t find(const char* name, std::size_t len) const;
+    std::size_t find(const std::string& name) const { return find(name.data(), name.size()); }
+
+    // Every value stored under a name: start with cursor = 0 and call
+    // again until NOT_FOUND (the index must not change in between)
+    // in NameIndex.cpp
+    std::size_t findNext(const char* name, std::size_t len, std::size_t& cursor) const;
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    std::size_t bucketCount() const { return slots.size(); }
+    static std::size_t bucketBytes() { return sizeof(Entry); }
+};
+
+#endif // NAME_INDEX_H
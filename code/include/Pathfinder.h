@@ -0,0 +1,104 @@
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+#include "World.h"
+#include <vector>
+#include <stdint.h>
+
+/**
+ * Pathfinder class - Shortest routes over the World's exit graph
+ *
+ * Works on room ids only (the CSR exit table), so it never forces rooms
+ * into memory. Three strategies:
+ *
+ * - BFS for small worlds or nearby rooms
+ * - A* when the world has a grid layout (generated dungeons), using the
+ *   Manhattan distance between grid cells as the heuristic
+ * - Hierarchical search for big worlds: rooms are grouped into clusters of
+ *   about CLUSTER_SIZE rooms; rooms with an exit into another cluster are
+ *   "borders". A* runs on the small graph of border rooms, using cached
+ *   border-to-border distances inside each cluster, and the result is then
+ *   refined into a room-by-room path with BFS inside each cluster.
+ *
+ * The per-cluster distance tables are the distance cache. They are built
+ * the first time a search crosses a cluster and are invalidated one
+ * cluster at a time when World::addExit (connectRooms) changes the
+ * topology around them - the rest of the cache stays valid.
+ */
+class Pathfinder : public ExitListener {
+private:
+    static const uint32_t NO_CLUSTER = 0xFFFFFFFFu;
+    static const uint32_t INFINITE = 0xFFFFFFFFu;
+    static const uint32_t CLUSTER_SIZE = 256;
+    static const std::size_t HIERARCHY_THRESHOLD = 4096;  // rooms
+
+    struct Cluster {
+        std::vector<RoomId> members;
+        std::vector<RoomId> borders;
+        std::vector<uint32_t> table;   // borders x borders distances (cache)
+        bool borders_valid;
+        bool table_valid;
+        Cluster() : borders_valid(false), table_valid(false) { }
+    };
+
+    const World& world;
+    bool clustered;
+    std::vector<uint32_t> cluster_of;     // room -> cluster
+    std::vector<uint32_t> border_index;   // room -> index in its cluster's borders
+    std::vector<uint8_t> is_border;
+    std::vector<Cluster> clusters;
+
+    // Stamped scratch arrays so searches never clear O(rooms) memory
+    std::vector<uint32_t> stamp;
+    std::vector<uint32_t> dist;
+    std::vector<RoomId> parent;
+    uint32_t generation;
+
+    std::vector<uint32_t> a_stamp;
+    std::vector<uint32_t> a_dist;
+    std::vector<RoomId> a_parent;
+    uint32_t a_generation;
+
+    unsigned long long table_builds;
+
+    // in Pathfinder.cpp
+    void prepareScratch();
+    uint32_t heuristic(RoomId from, RoomId to) const;
+    bool bfs(RoomId from, RoomId to, uint32_t only_cluster);
+    bool aStar(RoomId from, RoomId to);
+    void appendPath(RoomId from, RoomId to, std::vector<RoomId>& path) const;
+    bool hierarchical(RoomId from, RoomId to, std::vector<RoomId>& path);
+
+    void buildClusters();
+    void assignToCluster(RoomId room, uint32_t cluster);
+    void ensureBorders(uint32_t c);
+    void ensureTable(uint32_t c);
+    void invalidate(uint32_t c);
+
+public:
+    // in Pathfinder.cpp
+    Pathfinder(const World& world);
+
+    // Shortest path from -> to, including both ends
+    // Returns false if there is no route
+    // in Pathfinder.cpp
+    bool findPath(RoomId from, RoomId to, std::vector<RoomId>& path);
+
+    // World::addExit hook - invalidates only the affected clusters
+    // in Pathfinder.cpp
+    void exitAdded(RoomId from, RoomId to);
+    void worldReset();
+
+    // Number of cluster distance tables computed so far (cache misses)
+    unsigned long long tableBuilds() const { return table_builds; }
+
+    // Regression check: a generated world of `rooms` rooms, routes between
+    // `queries` random pairs compared with a plain BFS, then again after
+    // `jumps` up/down exits between random rooms (which must stop A* from
+    // trusting the grid); false if any route is longer than the BFS one
+    // or doesn't follow the exits
+    // in Pathfinder.cpp
+    static bool check(unsigned int rooms, unsigned int jumps, unsigned int queries, unsigned long long seed);
+};
+
+#endif // PATHFINDER_H
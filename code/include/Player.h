@@ -3,6 +3,7 @@
 
 #include "Character.h"
 #include "Item.h"
+#include "ItemBag.h"
 #include <vector>
 
 /**
@@ -11,8 +12,13 @@
  * Inherits from Character and adds:
  * - Leveling system (experience and levels)
  * - Inventory management
- * - Equipment system (weapons and armor)
+ * - Equipment system: one item per EquipSlot (weapon, body, head, ...)
  * - Gold currency
+ *
+ * Levels and equipment don't touch the base stats: each is a modifier
+ * (see StatBlock) adjusted when it changes - a level's bonuses on
+ * levelUp, an item's bonus on equip and unequip - so combat reads the
+ * precomputed totals and never walks the equipment.
  * 
  * MY LEARNING OBJECTIVES:
  * - Practice inheritance
@@ -25,9 +31,14 @@ private:
     int level;
     int experience;
     int gold;
-    std::vector<Item*> inventory;  // Player owns these items!
-    Item* equipped_weapon;         // Points to item in inventory (not separately owned)
-    Item* equipped_armor;          // Points to item in inventory (not separately owned)
+    ItemBag inventory;             // Player owns these items! (indexed by name)
+    Item* equipped[EQUIP_SLOT_COUNT];   // Point to items in inventory (not separately owned)
+
+    // Put an item from the inventory in its slot / empty a slot, moving
+    // its bonus in or out of the equipment modifiers
+    // in Player.cpp
+    void wear(Item* item);
+    void takeOff(EquipSlot slot);
     
 public:
     // Constructor
@@ -42,35 +53,44 @@ public:
     
     // Override displayStats from Character
     // in Player.cpp
-    void displayStats() const;
+    void displayStats(std::ostream& out) const;
     
-    // Override calculateDamage to include weapon bonus
+    // Override calculateDamage: the cached attack, weapon bonus included
     // in Player.cpp
     int calculateDamage() const;
     
     // Inventory management
     // in Player.cpp
-    void addItem(Item* item);
-    void removeItem(const std::string& item_name);
-    void displayInventory() const;
+    void addItem(Item* item, std::ostream& out);
+    void removeItem(const std::string& item_name, std::ostream& out);
+    void displayInventory(std::ostream& out) const;
     bool hasItem(const std::string& item_name) const;
     Item* getItem(const std::string& item_name);
+
+    // Move items out of another bag (room floor, loot) into the inventory
+    // One lookup per item, no copies - see ItemBag::transfer
+    // in Player.cpp
+    Item* pickUp(ItemBag& source, const std::string& item_name, std::ostream& out);
+    std::size_t pickUpAll(ItemBag& source, std::ostream& out);
     
     // Equipment management
     // in Player.cpp
-    void equipWeapon(const std::string& weapon_name);
-    void equipArmor(const std::string& armor_name);
-    void unequipWeapon();
-    void unequipArmor();
+    void equipWeapon(const std::string& weapon_name, std::ostream& out);
+    void equipArmor(const std::string& armor_name, std::ostream& out);
+    void unequipWeapon(std::ostream& out);
+    void unequipArmor(std::ostream& out);             // body armor
+    void unequip(EquipSlot slot, std::ostream& out);
+    Item* getEquipped(EquipSlot slot) const { return equipped[slot]; }
     
-    // Use consumable item from inventory
+    // Use consumable item from inventory (its effect goes on through
+    // the game's `effects`)
     // in Player.cpp
-    void useItem(const std::string& item_name);
+    void useItem(const std::string& item_name, StatusEffects& effects, std::ostream& out);
     
     // Level and experience
     // in Player.cpp
-    void gainExperience(int exp);
-    void levelUp();
+    void gainExperience(int exp, std::ostream& out);
+    void levelUp(std::ostream& out);
     
     // Getters
     int getLevel() const { return level; }
@@ -80,6 +100,13 @@ public:
     // Gold management
     void addGold(int amount) { gold += amount; }
     void spendGold(int amount) { gold -= amount; }
+
+    // Binary state for game snapshots: Character state, level, experience,
+    // gold, the inventory in order and what each slot holds. restore()
+    // replaces the inventory; the name stays (the Game makes the player)
+    // in Player.cpp
+    void serialize(ByteWriter& out) const;
+    bool restore(ByteReader& in);
 };
 
 #endif // PLAYER_H
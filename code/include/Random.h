@@ -0,0 +1,58 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstddef>
+
+/**
+ * RandomStream class - Counter-based random numbers (SplitMix64)
+ *
+ * Roll number i of a stream is mix64(key + i * GOLDEN): a pure function
+ * of the stream's key and a counter, with no shared state. Every session
+ * seed and stream id (player, a monster's room, a simulated fight, ...)
+ * gives its own key, so results depend only on the seed and on how many
+ * rolls each stream has taken - never on which thread ran first.
+ *
+ * This replaces rand(), whose hidden global state made runs impossible
+ * to reproduce and serialized every thread that rolled.
+ */
+class RandomStream {
+private:
+    static const unsigned long long GOLDEN = 0x9E3779B97F4A7C15ULL;
+
+    unsigned long long key;      // 0 = not seeded yet
+    unsigned long long counter;  // rolls taken so far
+
+public:
+    RandomStream() : key(0), counter(0) { }
+    RandomStream(unsigned long long seed, unsigned long long stream) : key(0), counter(0) { reseed(seed, stream); }
+
+    // SplitMix64 step: a good 64-bit mixer for counter-style hashing
+    static unsigned long long mix64(unsigned long long z) {
+        z += GOLDEN;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Start stream `stream` of a session seed from roll 0
+    // in Random.cpp
+    void reseed(unsigned long long seed, unsigned long long stream);
+    bool isSeeded() const { return key != 0; }
+
+    // Next roll
+    unsigned long long next() { return mix64(key + GOLDEN * counter++); }
+    unsigned int nextU32() { return (unsigned int)(next() >> 32); }
+    int below(int n) { return (int)(((next() >> 32) * (unsigned long long)n) >> 32); }   // 0 .. n-1
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }          // [0, 1)
+
+    // The next n rolls in one call (same values as n calls of nextU32)
+    // in Random.cpp
+    void fill(unsigned int* out, std::size_t n);
+
+    // Position, so a stream can be saved and resumed exactly
+    unsigned long long getKey() const { return key; }
+    unsigned long long getCounter() const { return counter; }
+    void restore(unsigned long long k, unsigned long long c) { key = k; counter = c; }
+};
+
+#endif // RANDOM_H
@@ -2,18 +2,24 @@
 #define ROOM_H
 
 #include "Monster.h"
+#include "MonsterGroup.h"
 #include "Item.h"
+#include "World.h"
+#include "EntityArena.h"
+#include "ItemBag.h"
 #include <string>
 #include <vector>
-#include <map>
 
 /**
  * Room class - Represents a location in the game world
  * 
  * Rooms can contain:
- * - A monster (blocking progress)
+ * - A group of monsters (blocking progress) - or just a spawn descriptor
+ *   (archetype id and count) that becomes Monsters the first time anyone
+ *   asks for them (display, hasMonster, getMonsters), so unvisited rooms
+ *   cost no Monster
  * - Items on the ground
- * - Exits to other rooms (stored in a map)
+ * - Exits to other rooms (stored in the World's exit table)
  * 
  * MY LEARNING OBJECTIVES:
  * - Use std::map for key-value storage
@@ -27,59 +33,100 @@ private:
     bool visited;
     
     // Room contents
-    Monster* monster;          // NULL if no monster - Room owns this!
-    std::vector<Item*> items;  // Items on ground - Room owns these!
+    mutable MonsterGroup monsters;      // Room owns these!
+    mutable unsigned int spawn;         // archetype id not yet built, NO_SPAWN if none
+    mutable unsigned char spawn_count;  // how many of it
+    ItemBag items;             // Items on ground - Room owns these! (indexed by name)
     
-    // Connections to other rooms
-    // Key: direction ("north", "south", "east", "west")
-    // Value: pointer to connected Room
-    // NOTE: Room does NOT own these - Game owns all rooms!
-    std::map<std::string, Room*> exits;
+    // Position in the world
+    // Exits are stored by the World in a CSR table keyed by this id
+    // NOTE: Room does NOT own the World - the World owns all rooms!
+    World* world;
+    RoomId id;
+
+    // Turn the spawn descriptor into Monsters
+    // in Room.cpp
+    void materialize() const;
+
+    // Everything serialize() writes after the name and description
+    // in Room.cpp
+    bool readContents(ByteReader& in);
     
 public:
+    static const unsigned int NO_SPAWN = ArchetypeTable::NOT_FOUND;
+
+    // Allocated from the active EntityArena
+    ARENA_ALLOCATED(ENTITY_ROOM)
+
     // Constructor
     // in Room.cpp
     Room(const std::string& name, const std::string& description);
     
     // Destructor - CRITICAL for memory management!
     // in Room.cpp
-    // - Must delete monster if present
+    // - Must delete monsters if present
     // - Must delete all items
-    // - DON'T delete rooms in exits map (Game owns those)
+    // - DON'T delete connected rooms (World owns those)
     ~Room();
     
     // Display room information
     // in Room.cpp
-    void display() const;
-    void displayExits() const;
+    void display(std::ostream& out) const;
+    void displayExits(std::ostream& out) const;
     
     // Room connections
+    // Only valid once the room has been added to a World
     // in Room.cpp
+    void attach(World* w, RoomId room_id) { world = w; id = room_id; }
     void addExit(const std::string& direction, Room* room);
     Room* getExit(const std::string& direction) const;
     bool hasExit(const std::string& direction) const;
     
     // Monster management
-    void setMonster(Monster* m) { monster = m; }
-    Monster* getMonster() { return monster; }
-    bool hasMonster() const { return monster != NULL && monster->isAlive(); }
-    
+    // getMonsters/hasMonster build a pending spawn first; hasMonster is
+    // O(1) (the group's live count)
     // in Room.cpp
-    void clearMonster();
+    bool addMonster(Monster* m);                 // false if the group is full
+    void setSpawn(unsigned int archetype, unsigned int count = 1);   // lazy: made on first look
+    void clearMonsters();
+    MonsterGroup& getMonsters() { materialize(); return monsters; }
+    bool hasMonster() const { materialize(); return monsters.liveCount() > 0; }
+
+    // Pending spawn and built monsters, without building anything
+    // (NO_SPAWN if none pending)
+    const MonsterGroup& getBuiltMonsters() const { return monsters; }
+    unsigned int getSpawn() const { return spawn; }
+    unsigned int getSpawnCount() const { return spawn_count; }
+    bool hasSpawn() const { return spawn != NO_SPAWN; }
     
     // Item management
     // in Room.cpp
     void addItem(Item* item);
-    void removeItem(const std::string& item_name);
-    void displayItems() const;
+    void removeItem(const std::string& item_name, std::ostream& out);
+    void displayItems(std::ostream& out) const;
     Item* getItem(const std::string& item_name);
     bool hasItems() const { return !items.empty(); }
+    const std::vector<Item*>& getItems() const { return items.list(); }
+    ItemBag& getItemBag() { return items; }   // for transfers (see ItemBag)
     
     // Getters/Setters
+    RoomId getId() const { return id; }
     std::string getName() const { return name; }
     std::string getDescription() const { return description; }
     bool isVisited() const { return visited; }
     void markVisited() { visited = true; }
+
+    // Binary state: name, description, visited, monsters, items
+    // Used by the pager to write cold rooms out and bring them back, and
+    // by game snapshots, which restore() into the room already in place
+    // in Room.cpp
+    void serialize(ByteWriter& out) const;
+    static Room* deserialize(ByteReader& in);
+    bool restore(ByteReader& in);
+
+    // Rough heap footprint (room + monsters + items), for memory budgets
+    // in Room.cpp
+    std::size_t memoryFootprint() const;
 };
 
 #endif // ROOM_H
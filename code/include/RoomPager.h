@@ -0,0 +1,121 @@
+#ifndef ROOM_PAGER_H
+#define ROOM_PAGER_H
+
+#include "World.h"
+#include <vector>
+#include <string>
+#include <iostream>
+#include <cstddef>
+#include <cstdio>
+#include <stdint.h>
+
+/**
+ * PagingStats - Counters for the room pager
+ */
+struct PagingStats {
+    unsigned long long hits;         // getRoom() found the room resident
+    unsigned long long misses;       // room had to be created or paged in
+    unsigned long long page_ins;     // misses served from the page file
+    unsigned long long evictions;    // rooms written out and deleted
+    std::size_t resident_rooms;
+    std::size_t resident_bytes;
+    std::size_t budget_bytes;
+
+    PagingStats() : hits(0), misses(0), page_ins(0), evictions(0),
+                    resident_rooms(0), resident_bytes(0), budget_bytes(0) { }
+
+    // in RoomPager.cpp
+    void print(std::ostream& out) const;
+};
+
+/**
+ * RoomPager class - Keeps only the hottest rooms in memory
+ *
+ * The World tells the pager every time a room is used (touch) or created
+ * (admit). Resident rooms are kept on an LRU list; when their estimated
+ * footprint goes over the budget, the least recently used rooms are
+ * serialized - monster, items, visited flag and all - to an anonymous page
+ * file and deleted. Asking the World for an evicted room later rebuilds it
+ * from its page.
+ *
+ * Pinned rooms (the player's room) and the room just admitted are never
+ * evicted. Neither is a room handed out while a World::RoomHold is open:
+ * it is held until that hold closes, so a caller can keep two rooms (or a
+ * room and its neighbour) without one paging the other out. Holds nest;
+ * closing one lets go of the rooms first fetched inside it and trims back
+ * to the budget. The Game holds rooms for the length of each command.
+ */
+class RoomPager {
+private:
+    // Where a room's page lives in the page file
+    struct PageSlot {
+        uint64_t offset;
+        uint32_t length;
+        uint32_t capacity;    // 0 = never paged out
+    };
+
+    World& world;
+    std::size_t budget;
+    FILE* page_file;
+    uint64_t page_file_end;
+    std::vector<PageSlot> pages;
+
+    // Intrusive LRU list over room ids (head = most recently used)
+    std::vector<RoomId> lru_prev;
+    std::vector<RoomId> lru_next;
+    std::vector<uint32_t> footprint;   // bytes charged for each resident room
+    RoomId lru_head;
+    RoomId lru_tail;
+
+    std::vector<RoomId> pinned;
+    std::vector<RoomId> held;          // fetched under the open holds, oldest first
+    std::vector<uint8_t> is_held;      // per room: on the held list
+    unsigned int hold_depth;
+    PagingStats stats;
+
+    // in RoomPager.cpp
+    void grow(RoomId id);
+    void unlink(RoomId id);
+    void pushFront(RoomId id);
+    bool isPinned(RoomId id) const;
+    void hold(RoomId id);
+    void evict(RoomId id);
+    void enforceBudget(RoomId keep);
+
+    // Not copyable - owns the page file
+    RoomPager(const RoomPager&);
+    RoomPager& operator=(const RoomPager&);
+
+public:
+    // in RoomPager.cpp
+    RoomPager(World& world, std::size_t budget_bytes);
+    ~RoomPager();
+
+    // Called by World
+    // in RoomPager.cpp
+    void touch(RoomId id);
+    void admit(RoomId id, Room* room);
+    void forget(RoomId id);
+    bool hasPage(RoomId id) const { return id < pages.size() && pages[id].capacity != 0; }
+    Room* pageIn(RoomId id);
+
+    // Pinning (pinned rooms are never evicted)
+    // in RoomPager.cpp
+    void pin(RoomId id);
+    void unpin(RoomId id);
+
+    // Holds (see World::RoomHold) - openHold returns the mark to close at
+    // in RoomPager.cpp
+    std::size_t openHold();
+    void closeHold(std::size_t mark);
+
+    // Resident rooms, most recently used first (NO_ROOM ends the list)
+    RoomId firstResident() const { return lru_head; }
+    RoomId nextResident(RoomId id) const { return lru_next[id]; }
+
+    // Counters
+    const PagingStats& getStats() const { return stats; }
+    void countMiss() { stats.misses++; }
+};
+
+#endif // ROOM_PAGER_H
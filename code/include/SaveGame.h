@@ -0,0 +1,131 @@
+#ifndef SAVE_GAME_H
+#define SAVE_GAME_H
+
+#include "Command.h"
+#include "Serializer.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * SaveRecord - Record types in a save file
+ *
+ * The numbers are written to save files, so don't renumber them.
+ */
+enum SaveRecord {
+    SAVE_FULL = 1,      // every room that exists
+    SAVE_DELTA = 2      // only the rooms touched since the save before it
+};
+
+/**
+ * SaveWriter - Writes a game to a save file, incrementally
+ *
+ * The file is "RPGS", a version, the game's setup block (seed and world,
+ * from Game::writeSetup) and the player's name, then records: a type
+ * byte, the player block (where the player is, the player, the status
+ * effects) and the rooms block (a count, then each room by id), both
+ * length-prefixed. The first record is a full save; each one after it
+ * only holds the rooms the Game marked dirty since the last save, so a
+ * save costs what was played, not how big the world is. Loading applies
+ * the records' rooms in order and the last record's player block.
+ *
+ * Once the deltas add up to more than the full save they follow, the
+ * next save is a full one: written to "<file>.tmp", synced and renamed
+ * over the file, so a crash leaves the old save or the new one. A delta
+ * is appended in one write; a crash mid-write loses only that record.
+ */
+class SaveWriter {
+private:
+    std::string path;
+    std::string setup;
+    int fd;                              // open for appending, once there is a full save
+    unsigned long long base_bytes;       // header and full record
+    unsigned long long delta_bytes;      // deltas appended after them
+
+    // What this session wrote
+    unsigned long long full_saves;
+    unsigned long long delta_saves;
+    unsigned long long full_written;
+    unsigned long long delta_written;
+
+    // Not copyable - owns the file
+    SaveWriter(const SaveWriter&);
+    SaveWriter& operator=(const SaveWriter&);
+
+    // in SaveGame.cpp
+    static void putRecord(ByteWriter& out, SaveRecord kind, const std::string& player, const std::string& rooms);
+    static bool writeAll(int fd, const std::string& data);
+
+public:
+    static const uint32_t MAGIC = 0x53475052;     // "RPGS"
+    static const uint32_t VERSION = 3;
+
+    // in SaveGame.cpp
+    SaveWriter();
+    ~SaveWriter();
+
+    // Save to `path` from now on. A new file is only written by the first
+    // save (a full one); `resume` instead appends deltas to the file the
+    // game was just loaded from (see SaveReader::baseBytes)
+    // in SaveGame.cpp
+    void open(const std::string& path, const std::string& setup);
+    bool resume(const std::string& path, const std::string& setup,
+                unsigned long long base_size, unsigned long long delta_size);
+    bool isOpen() const { return !path.empty(); }
+    const std::string& getPath() const { return path; }
+
+    // The next save has to be (or had better be) a full one
+    bool needsFull() const { return fd < 0 || delta_bytes > base_bytes; }
+
+    // in SaveGame.cpp
+    bool writeFull(const std::string& name, const std::string& player, const std::string& rooms);
+    bool writeDelta(const std::string& player, const std::string& rooms);
+    void close();
+
+    // in SaveGame.cpp
+    void print() const;
+};
+
+/**
+ * SaveReader - A save file loaded to resume from
+ *
+ * load() reads the file in one go and indexes its records (as views into
+ * its bytes). A record cut short is dropped with a warning - the game
+ * resumes from the save before it, and its next save is a full one, so
+ * nothing gets appended after the damage.
+ */
+class SaveReader {
+private:
+    std::string data;                    // the whole file
+    TextView setup;
+    std::string name;
+    std::vector<TextView> rooms;         // rooms blocks, from the last full record on
+    TextView player;                     // the last record's player block
+    unsigned long long base_bytes;       // header and last full record
+    unsigned long long delta_bytes;      // good records after them
+    bool damaged;                        // something after the last good record
+
+    // Not copyable - the views point into data
+    SaveReader(const SaveReader&);
+    SaveReader& operator=(const SaveReader&);
+
+public:
+    // in SaveGame.cpp
+    SaveReader();
+
+    // Read and index a save file; false with a message if it isn't one
+    // in SaveGame.cpp
+    bool load(const std::string& path);
+
+    const TextView& getSetup() const { return setup; }
+    const std::string& getName() const { return name; }
+    std::size_t roomBlockCount() const { return rooms.size(); }
+    const TextView& roomBlock(std::size_t i) const { return rooms[i]; }
+    const TextView& playerBlock() const { return player; }
+    unsigned long long baseBytes() const { return base_bytes; }
+    unsigned long long deltaBytes() const { return delta_bytes; }
+    bool isDamaged() const { return damaged; }
+};
+
+#endif // SAVE_GAME_H
@@ -0,0 +1,44 @@
+#ifndef SCRIPT_STATS_H
+#define SCRIPT_STATS_H
+
+#include <cstddef>
+
+/**
+ * ScriptStats - Throughput and latency of a scripted (batch) session
+ *
+ * Game records how long each command took to handle - from reading it
+ * to asking for the next line, its output included - into a
+ * log-linear histogram: 8 buckets per power of two of nanoseconds, so a
+ * percentile is within 1/8 of the true value however long the run,
+ * and recording is a few instructions with no allocation.
+ */
+struct ScriptStats {
+    static const unsigned int SUB_BUCKETS = 8;
+    static const unsigned int BUCKETS = 62 * SUB_BUCKETS;
+
+    unsigned long long commands;
+    unsigned long long total_ns;
+    unsigned long long max_ns;
+    unsigned long long histogram[BUCKETS];
+    double seconds;              // the whole session, set by the caller
+
+    // in ScriptStats.cpp
+    ScriptStats();
+
+    // One command's handling time
+    // in ScriptStats.cpp
+    void record(unsigned long long ns);
+
+    // Latency at or below which fraction p of the commands finished (bucket upper bound)
+    // in ScriptStats.cpp
+    unsigned long long percentile(double p) const;
+
+    // in ScriptStats.cpp
+    void print() const;
+
+    // Monotonic clock in nanoseconds
+    // in ScriptStats.cpp
+    static unsigned long long now();
+};
+
+#endif // SCRIPT_STATS_H
@@ -0,0 +1,66 @@
+#ifndef SERIALIZER_H
+#define SERIALIZER_H
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * ByteWriter / ByteReader - Minimal binary encoding helpers
+ *
+ * Fixed-width integers are written in native (little-endian) byte order,
+ * strings as a uint32 length followed by the raw bytes. Varints are
+ * LEB128 (7 bits a byte, low bits first), for small numbers that are
+ * written often - a 5-letter command's length is one byte, not four. The reader never
+ * reads past the end of its buffer; once a read fails, ok() stays false and
+ * every later read returns zero / empty.
+ */
+class ByteWriter {
+private:
+    std::string buffer;
+
+public:
+    // in Serializer.cpp
+    void putU8(uint8_t v);
+    void putU32(uint32_t v);
+    void putI32(int32_t v) { putU32((uint32_t)v); }
+    void putU64(uint64_t v);
+    void putVarU64(uint64_t v);
+    void putString(const std::string& s);
+    void putBytes(const void* data, std::size_t n) { buffer.append(static_cast<const char*>(data), n); }
+
+    const std::string& data() const { return buffer; }
+    std::size_t size() const { return buffer.size(); }
+    void clear() { buffer.clear(); }
+};
+
+class ByteReader {
+private:
+    const char* pos;
+    const char* end;
+    bool good;
+
+    // in Serializer.cpp
+    bool need(std::size_t n);
+
+public:
+    ByteReader(const char* data, std::size_t size) : pos(data), end(data + size), good(true) { }
+    ByteReader(const std::string& data) : pos(data.data()), end(data.data() + data.size()), good(true) { }
+
+    // in Serializer.cpp
+    uint8_t getU8();
+    uint32_t getU32();
+    int32_t getI32() { return (int32_t)getU32(); }
+    uint64_t getU64();
+    uint64_t getVarU64();
+    std::string getString();
+    bool getBytes(void* out, std::size_t n);
+    bool skip(std::size_t n);
+
+    bool ok() const { return good; }
+    bool atEnd() const { return pos == end; }
+    std::size_t remaining() const { return (std::size_t)(end - pos); }
+    const char* current() const { return pos; }   // where the next read starts
+};
+
+#endif // SERIALIZER_H
@@ -0,0 +1,74 @@
+#ifndef STAT_BLOCK_H
+#define STAT_BLOCK_H
+
+#include <iostream>
+
+/**
+ * StatKind - The stats that modifiers can raise or lower
+ */
+enum StatKind {
+    STAT_MAX_HP,
+    STAT_ATTACK,
+    STAT_DEFENSE,
+    STAT_KIND_COUNT
+};
+
+/**
+ * ModifierSource - Where a modifier comes from
+ * - Level: bonuses earned by levelling up (Player::levelUp)
+ * - Equipment: whatever is in the equipment slots (Player::equip...)
+ * - Effects: attack up / defense up buffs (StatusEffects)
+ */
+enum ModifierSource {
+    MOD_LEVEL,
+    MOD_EQUIPMENT,
+    MOD_EFFECTS,
+    MOD_SOURCE_COUNT
+};
+
+/**
+ * StatBlock class - A character's base stats plus every modifier on them
+ *
+ * Each source keeps one running total per stat, adjusted as things come
+ * and go (equip a sword: +5 equipment attack; the buff wears off: -4
+ * effects defense). The effective value of a stat - base plus all
+ * sources - is cached and only summed again after something touching
+ * that stat has changed, so combat, which reads attack and defense every
+ * swing, just loads a number. A change that leaves a total where it was
+ * doesn't even mark it dirty.
+ */
+class StatBlock {
+private:
+    int base[STAT_KIND_COUNT];
+    int bonus[MOD_SOURCE_COUNT][STAT_KIND_COUNT];
+    mutable int total[STAT_KIND_COUNT];
+    mutable unsigned char dirty;    // one bit per stat whose total is stale
+
+    // in StatBlock.cpp
+    void refresh(StatKind stat) const;
+
+public:
+    // in StatBlock.cpp
+    StatBlock(int max_hp, int attack, int defense);
+
+    // Effective value: base plus every source
+    int get(StatKind stat) const {
+        if(dirty & (1u << stat)){
+            refresh(stat);
+        }
+        return total[stat];
+    }
+    int getBase(StatKind stat) const { return base[stat]; }
+    int getBonus(ModifierSource source, StatKind stat) const { return bonus[source][stat]; }
+
+    // in StatBlock.cpp
+    void setBase(StatKind stat, int value);
+    void setBonus(ModifierSource source, StatKind stat, int value);
+    void addBonus(ModifierSource source, StatKind stat, int delta) { setBonus(source, stat, bonus[source][stat] + delta); }
+
+    // " (base 10, level +2, equipment +5)" - nothing if there are no modifiers
+    // in StatBlock.cpp
+    void displayBreakdown(StatKind stat, std::ostream& out) const;
+};
+
+#endif // STAT_BLOCK_H
@@ -0,0 +1,87 @@
+#ifndef STAT_STORE_H
+#define STAT_STORE_H
+
+#include <vector>
+#include <cstddef>
+
+class Character;
+
+/**
+ * StatStore class - Combat stats of a whole horde, structure-of-arrays
+ *
+ * Instead of one Character object per fighter, HP, max HP, attack,
+ * defense and the alive flag each live in their own contiguous array.
+ * Resolving a volley against a group is then one pass over a few arrays:
+ * applyDamage runs the same rule as Character::takeDamage (see
+ * CombatRules) on 8 fighters at a time with AVX2, 4 with SSE2, or one at
+ * a time on other CPUs.
+ *
+ * Ref gives the familiar scalar Character interface (getCurrentHP,
+ * takeDamage, ...) as a view onto one slot, so code that handles a single
+ * fighter doesn't need to know about the arrays.
+ */
+class StatStore {
+private:
+    std::vector<int> hp;
+    std::vector<int> max_hp;
+    std::vector<int> attack;
+    std::vector<int> defense;
+    std::vector<int> alive;      // all ones (-1) if alive, 0 if dead - a SIMD lane mask
+
+public:
+    /**
+     * Ref - One fighter, seen through the Character interface
+     */
+    class Ref {
+    private:
+        StatStore* store;
+        std::size_t slot;
+
+    public:
+        Ref(StatStore* store, std::size_t slot) : store(store), slot(slot) { }
+
+        int getMaxHP() const { return store->max_hp[slot]; }
+        int getCurrentHP() const { return store->hp[slot]; }
+        int getAttack() const { return store->attack[slot]; }
+        int getDefense() const { return store->defense[slot]; }
+        bool isAlive() const { return store->alive[slot] != 0; }
+        void setAttack(int atk) { store->attack[slot] = atk; }
+        void setDefense(int def) { store->defense[slot] = def; }
+
+        // Same rules as Character, without the messages
+        // in StatStore.cpp
+        void takeDamage(int damage);
+        void heal(int amount);
+    };
+
+    // Add a fighter; returns its slot
+    // in StatStore.cpp
+    std::size_t add(int hp, int attack, int defense);
+    std::size_t add(const Character& character);
+
+    Ref operator[](std::size_t slot) { return Ref(this, slot); }
+    std::size_t size() const { return hp.size(); }
+    void clear();
+
+    // Apply damage[i] to slot first + i for i < count (dead slots are skipped)
+    // Returns how many fighters died
+    // in StatStore.cpp
+    std::size_t applyDamage(const int* damage, std::size_t first, std::size_t count);
+
+    // The same, one slot at a time (reference for tests and benchmarks)
+    // in StatStore.cpp
+    std::size_t applyDamageScalar(const int* damage, std::size_t first, std::size_t count);
+
+    // in StatStore.cpp
+    std::size_t aliveCount() const;
+
+    // Copy a slot's HP and alive flag back into a Character
+    // in StatStore.cpp
+    void copyTo(std::size_t slot, Character& character) const;
+
+    // "avx2", "sse2" or "scalar" - whichever applyDamage uses on this CPU
+    // in StatStore.cpp
+    static const char* kernelName();
+};
+
+#endif // STAT_STORE_H
@@ -0,0 +1,167 @@
+#ifndef STATUS_EFFECTS_H
+#define STATUS_EFFECTS_H
+
+#include "TimerWheel.h"
+#include <string>
+#include <iostream>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+class Character;
+class ByteWriter;
+class ByteReader;
+
+/**
+ * EffectKind - What a status effect does
+ * - Burn, poison: damage every turn, through defense (poison also
+ *   halves healing while it lasts)
+ * - Regeneration: heals every turn
+ * - Attack up, defense up: raise the stat until the effect wears off
+ */
+enum EffectKind {
+    EFFECT_NONE,
+    EFFECT_BURN,
+    EFFECT_POISON,
+    EFFECT_REGENERATION,
+    EFFECT_ATTACK_UP,
+    EFFECT_DEFENSE_UP,
+    EFFECT_KIND_COUNT
+};
+
+/**
+ * EffectSpec - An effect as data files give it: "burn 4 3" is 4 damage a
+ * turn for 3 turns, "attack_up 5 10" is +5 attack for 10 turns
+ */
+struct EffectSpec {
+    EffectKind kind;
+    int power;
+    unsigned int turns;
+
+    EffectSpec() : kind(EFFECT_NONE), power(0), turns(0) { }
+    bool empty() const { return kind == EFFECT_NONE; }
+
+    // Parse "kind power turns" ("" is no effect); false with a message if bad
+    // in StatusEffects.cpp
+    static bool parse(const std::string& text, EffectSpec& spec, std::string& error);
+};
+
+/**
+ * EffectTargets - Names the characters a snapshot can't point at
+ *
+ * Effects are kept by Character*; to save one on a monster the game
+ * turns the monster into two numbers (its room and its slot there) and
+ * back. locate() fails if it can't; resolve() returns NULL.
+ */
+class EffectTargets {
+public:
+    virtual ~EffectTargets() { }
+    virtual bool locate(const Character& target, uint32_t& where, uint32_t& slot) const = 0;
+    virtual Character* resolve(uint32_t where, uint32_t slot) const = 0;
+};
+
+/**
+ * StatusEffects class - Every active effect on every Character
+ *
+ * Effects live in one array (reused through a free list) and are linked
+ * per character, so a character only carries the index of its first
+ * one. Nothing is scanned per turn: each effect's next event sits on a
+ * TimerWheel - the next tick for burn, poison and regeneration, the
+ * expiry for stat buffs - and advance() handles just the ones that fall
+ * due. A million buffs ticking down cost nothing until they expire.
+ *
+ * Damage and healing go through Character::takeDamage/heal, so the usual
+ * messages and death rules apply. Applying a kind the character already
+ * has refreshes it (longer duration, stronger power) instead of stacking.
+ *
+ * Each Game has its own engine, printing to the game's output. A
+ * Character remembers the engine its effects are on and takes them off
+ * when it is destroyed, so the engine must outlive everyone it has
+ * touched. Not thread-safe - only the game's thread applies and advances
+ * its effects (the combat simulator models burn itself).
+ */
+class StatusEffects {
+public:
+    static const unsigned int NO_EFFECT = 0xFFFFFFFFu;
+    static const unsigned int MAX_TURNS = 1000000;
+
+private:
+    struct Effect {
+        Character* target;        // NULL while on the free list
+        EffectKind kind;
+        int power;
+        unsigned int turns_left;  // ticks still to come (DoT/regen)
+        unsigned int next;        // next effect on the same character (or free)
+        unsigned int prev;
+    };
+
+    // Who an effect is on, in a snapshot
+    enum Holder { HOLDER_NONE = 0, HOLDER_OWNER = 1, HOLDER_OTHER = 2 };
+
+    std::vector<Effect> effects;
+    unsigned int free_list;
+    std::size_t active;
+    TimerWheel wheel;
+    std::vector<unsigned int> due;   // reused by advance()
+    std::ostream& output;            // where messages go (the game's output)
+    bool quiet;                      // no messages (benchmark)
+
+    // Not copyable - characters point back at their engine
+    StatusEffects(const StatusEffects&);
+    StatusEffects& operator=(const StatusEffects&);
+
+    unsigned int find(const Character& target, EffectKind kind) const;
+    void start(unsigned int id);
+    void finish(unsigned int id, bool revert);
+
+public:
+    // Messages about effects starting, ticking and ending go to `output`
+    // in StatusEffects.cpp
+    explicit StatusEffects(std::ostream& output);
+
+    // Put an effect on a character (or refresh the one it has)
+    // in StatusEffects.cpp
+    void apply(Character& target, const EffectSpec& spec);
+
+    // Take every effect off; buffs are reverted unless the character is
+    // going away anyway
+    // in StatusEffects.cpp
+    void clear(Character& target, bool revert = true);
+
+    // One turn: fire whatever falls due; returns how many fired
+    // in StatusEffects.cpp
+    std::size_t advance();
+
+    // in StatusEffects.cpp
+    bool has(const Character& target, EffectKind kind) const { return find(target, kind) != NO_EFFECT; }
+    void display(const Character& target, std::ostream& out) const;
+
+    // Everyone but `owner` with an effect on them, each once
+    // in StatusEffects.cpp
+    void others(const Character& owner, std::vector<const Character*>& out) const;
+
+    std::size_t activeCount() const { return active; }
+    unsigned long long getTurn() const { return wheel.getNow(); }
+
+    // Binary state of the whole engine - effects, free list, the wheel -
+    // for game snapshots, so a restored game ticks exactly like the
+    // original. `owner` (the player) is written as a flag, anyone else as
+    // `others` names them; restore needs an idle engine, and everyone
+    // back in place first. Restoring leaves the owner's stats alone - its
+    // effects modifiers are part of its own saved state - but puts other
+    // characters' buffs back on them
+    // in StatusEffects.cpp
+    bool serialize(const Character& owner, const EffectTargets& others, ByteWriter& out) const;
+    bool restore(Character& owner, const EffectTargets& others, ByteReader& in);
+
+    // "burning", "poisoned", ...
+    // in StatusEffects.cpp
+    static const char* describe(EffectKind kind);
+
+    // Time `effects` buffs (1 to `horizon` turns) expiring on the wheel
+    // against a per-turn scan of every effect, then exit
+    // in StatusEffects.cpp
+    static bool benchmark(unsigned int effects, unsigned int horizon, unsigned long long seed);
+};
+
+#endif // STATUS_EFFECTS_H
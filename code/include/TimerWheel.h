@@ -0,0 +1,82 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <vector>
+#include <cstddef>
+
+class ByteWriter;
+class ByteReader;
+
+/**
+ * TimerWheel class - Hierarchical timing wheel over integer handles
+ *
+ * Four levels of 64 slots. Level 0 holds whatever is due in the next 64
+ * ticks, one slot per tick; level 1 holds the next 64*64 ticks, one slot
+ * per 64, and so on (2^24 ticks in all - longer delays are parked in the
+ * top level and re-filed when it comes round). Each slot is a doubly
+ * linked list threaded through the node array, so scheduling and
+ * cancelling are O(1), and advancing a tick touches only the one slot
+ * that falls due. Every 64 ticks the next level's slot is emptied into
+ * the levels below ("cascading"), which costs each timer at most one
+ * move per level over its whole life.
+ *
+ * Nothing here scans the timers that aren't due, so a tick costs the
+ * same with ten timers or ten million.
+ *
+ * Handles are small dense integers chosen by the owner (see
+ * StatusEffects); the wheel grows its node array to fit them.
+ */
+class TimerWheel {
+public:
+    static const unsigned int LEVELS = 4;
+    static const unsigned int SLOT_BITS = 6;
+    static const unsigned int SLOTS = 1u << SLOT_BITS;
+    static const unsigned int NONE = 0xFFFFFFFFu;
+
+private:
+    struct Node {
+        unsigned long long deadline;
+        unsigned int next;
+        unsigned int prev;
+        unsigned int slot;        // level * SLOTS + index, NONE if not scheduled
+    };
+
+    std::vector<Node> nodes;      // by handle
+    unsigned int heads[LEVELS * SLOTS];
+    unsigned long long now;
+    std::size_t scheduled;
+
+    // in TimerWheel.cpp
+    void link(unsigned int handle);
+    void unlink(unsigned int handle);
+    void cascade(unsigned int level);
+
+public:
+    // in TimerWheel.cpp
+    TimerWheel();
+
+    // Fire `handle` `delay` ticks from now (at least 1); a handle that is
+    // already scheduled is moved
+    // in TimerWheel.cpp
+    void schedule(unsigned int handle, unsigned long long delay);
+
+    // in TimerWheel.cpp
+    void cancel(unsigned int handle);
+
+    // One tick: appends the handles that fall due to `due`
+    // in TimerWheel.cpp
+    void advance(std::vector<unsigned int>& due);
+
+    bool isScheduled(unsigned int handle) const { return handle < nodes.size() && nodes[handle].slot != NONE; }
+    unsigned long long getDeadline(unsigned int handle) const { return nodes[handle].deadline; }
+    unsigned long long getNow() const { return now; }
+    std::size_t size() const { return scheduled; }
+
+    // Binary state: the clock and every node and slot list as they are,
+    // so a restored wheel fires the same handles in the same order
+    // in TimerWheel.cpp
+    void serialize(ByteWriter& out) const;
+    bool deserialize(ByteReader& in);
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,222 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <string>
+#include <vector>
+#include <streambuf>
+#include <ostream>
+#include <cstddef>
+
+/**
+ * Transport class - Where a Game reads its commands and sends its output
+ *
+ * The Game only ever asks for the next line and hands over whole chunks
+ * of rendered text (see RenderBuffer), so one game can be played on the
+ * terminal, over a socket, or from memory without knowing which.
+ *
+ * Backends:
+ * - TerminalTransport: stdin/stdout, read and written in large blocks
+ * - SocketTransport: one TCP client on a local port
+ * - MemoryTransport: ring buffers in memory, for benchmarks and tests
+ */
+class Transport {
+public:
+    // in Transport.cpp
+    virtual ~Transport();
+
+    // Next line of input without its line ending; false at end of input
+    virtual bool readLine(std::string& line) = 0;
+
+    // Send bytes; false if the other end has gone away
+    virtual bool write(const char* data, std::size_t size) = 0;
+};
+
+/**
+ * FdTransport class - A pair of file descriptors
+ *
+ * Input is read a block at a time and split into lines here (a '\r'
+ * before the '\n' is dropped, for telnet clients); output goes out in a
+ * single write call per chunk.
+ */
+class FdTransport : public Transport {
+private:
+    int in_fd;
+    int out_fd;
+    std::vector<char> input;      // bytes read but not yet returned
+    std::size_t start;            // first of them
+    std::size_t end;
+    bool at_eof;
+
+protected:
+    // Write everything, retrying short writes; false on error
+    // in Transport.cpp
+    virtual bool writeAll(const char* data, std::size_t size);
+
+    int getOutput() const { return out_fd; }
+
+public:
+    // in Transport.cpp
+    FdTransport(int in_fd, int out_fd);
+
+    // in Transport.cpp
+    bool readLine(std::string& line);
+    bool write(const char* data, std::size_t size) { return writeAll(data, size); }
+};
+
+/**
+ * TerminalTransport class - The process's own stdin and stdout
+ */
+class TerminalTransport : public FdTransport {
+public:
+    TerminalTransport() : FdTransport(0, 1) { }
+};
+
+/**
+ * SocketTransport class - One connected TCP client
+ *
+ * accept() listens on the loopback interface, waits for one client and
+ * stops listening. Writes use MSG_NOSIGNAL, so a client that hangs up
+ * ends the game instead of killing the process.
+ */
+class SocketTransport : public FdTransport {
+private:
+    // in Transport.cpp
+    explicit SocketTransport(int fd);
+    SocketTransport(const SocketTransport&);
+    SocketTransport& operator=(const SocketTransport&);
+
+protected:
+    // in Transport.cpp
+    bool writeAll(const char* data, std::size_t size);
+
+public:
+    // Closes the connection
+    // in Transport.cpp
+    ~SocketTransport();
+
+    // Wait for a client on 127.0.0.1:port - NULL (and an error) on failure
+    // in Transport.cpp
+    static SocketTransport* accept(unsigned short port);
+};
+
+/**
+ * MemoryTransport class - Input and output held in ring buffers
+ *
+ * Input is fed in up front (feed grows its ring to fit); the game reads
+ * it line by line and reaches end of input when it runs out. Output
+ * lands in a fixed ring that keeps the most recent bytes: once it is
+ * full the oldest are overwritten, and bytesDropped() counts them, so a
+ * long benchmark never stalls or grows. peek() hands out the unread
+ * output in place (at most two spans, where the ring wraps) for a
+ * consumer to read without copying, and consume() releases it.
+ *
+ * Single-threaded: the game and whoever reads the output take turns.
+ */
+class MemoryTransport : public Transport {
+private:
+    struct Ring {
+        std::vector<char> data;   // size is a power of two
+        unsigned long long head;  // total bytes ever written
+        unsigned long long tail;  // total bytes ever read (or dropped)
+
+        std::size_t used() const { return (std::size_t)(head - tail); }
+        std::size_t mask() const { return data.size() - 1; }
+    };
+
+    Ring input;
+    Ring output;
+    unsigned long long written;
+    unsigned long long dropped;
+    unsigned long long writes;
+
+    // in Transport.cpp
+    static void put(Ring& ring, const char* data, std::size_t size);
+
+public:
+    // Output ring of at least `capacity` bytes (rounded up to a power of two)
+    // in Transport.cpp
+    explicit MemoryTransport(std::size_t capacity = 1 << 20);
+
+    // Queue input; "look\nstats\n" is two commands
+    // in Transport.cpp
+    void feed(const char* data, std::size_t size);
+    void feed(const std::string& text) { feed(text.data(), text.size()); }
+
+    // in Transport.cpp
+    bool readLine(std::string& line);
+    bool write(const char* data, std::size_t size);
+
+    // Unread output, in place: first span, then the wrapped-around part
+    // (size 0 if none); consume releases bytes once they've been read
+    // in Transport.cpp
+    void peek(const char*& first, std::size_t& first_size,
+              const char*& second, std::size_t& second_size) const;
+    void consume(std::size_t size);
+
+    // Copy out and release all unread output
+    // in Transport.cpp
+    std::string drain();
+
+    unsigned long long bytesWritten() const { return written; }
+    unsigned long long bytesDropped() const { return dropped; }
+    unsigned long long writeCount() const { return writes; }
+    std::size_t pendingInput() const { return input.used(); }
+};
+
+/**
+ * RenderBuffer class - Collects a command's output for one write
+ *
+ * A stream buffer that only ever appends to memory: std::endl's flush is
+ * ignored, so a command that prints forty lines costs one transport
+ * write (flush()) instead of forty. The storage is kept between
+ * commands and only grows.
+ *
+ * Capture points an ostream (the Game's output, which everything in the
+ * game prints to) at the buffer for as long as it lives, and puts the
+ * old one back even if an exception goes by.
+ *
+ * With flush_lines set every '\n' is sent straight away, the way the
+ * game used to write - only for comparing the two (see --io-bench).
+ */
+class RenderBuffer : public std::streambuf {
+private:
+    std::vector<char> storage;
+    Transport* transport;
+    bool flush_lines;
+    bool failed;
+
+protected:
+    // in Transport.cpp
+    int_type overflow(int_type c);
+    std::streamsize xsputn(const char* data, std::streamsize size);
+    int sync();
+
+public:
+    // in Transport.cpp
+    explicit RenderBuffer(Transport* transport, bool flush_lines = false);
+
+    // Send what has been rendered (if anything) and start over; false once
+    // the transport has failed
+    // in Transport.cpp
+    bool flush();
+
+    bool hasFailed() const { return failed; }
+    std::size_t pending() const { return (std::size_t)(pptr() - pbase()); }
+
+    /**
+     * Capture - Redirects an ostream into the buffer while in scope
+     */
+    class Capture {
+    private:
+        std::ostream& stream;
+        std::streambuf* saved;
+        Capture(const Capture&);
+        Capture& operator=(const Capture&);
+
+    public:
+        Capture(std::ostream& stream, RenderBuffer& buffer) : stream(stream), saved(stream.rdbuf(&buffer)) { }
+        ~Capture() { stream.rdbuf(saved); }
+    };
+};
+
+#endif // TRANSPORT_H
@@ -0,0 +1,205 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "NameIndex.h"
+#include <string>
+#include <vector>
+
+class Room;
+class MappedWorld;
+class RoomPager;
+struct PagingStats;
+
+// Rooms are addressed by dense integer ids (0 .. roomCount()-1)
+typedef unsigned int RoomId;
+const RoomId NO_ROOM = 0xFFFFFFFFu;
+
+/**
+ * ExitListener - Told about topology changes (see World::setExitListener)
+ */
+class ExitListener {
+public:
+    virtual ~ExitListener() { }
+    virtual void exitAdded(RoomId from, RoomId to) = 0;
+    virtual void worldReset() = 0;   // cleared, or replaced by a world file
+};
+
+/**
+ * World class - Owns every room and the exit graph between them
+ *
+ * Rooms live in a vector indexed by RoomId. Exits are kept in a
+ * compressed-sparse-row (CSR) table: the exits of room r are
+ * exit_targets[exit_offsets[r] .. exit_offsets[r+1]), with the matching
+ * direction ids in exit_dirs. Direction strings ("north", "up", ...) are
+ * interned once into small ids, so a move is a scan over a handful of
+ * bytes instead of a std::map lookup with string compares.
+ *
+ * addExit() appends to a pending edge list; the CSR arrays are rebuilt
+ * lazily (one counting-sort pass) the next time an exit is looked up.
+ * A later addExit for the same room and direction replaces the earlier one,
+ * just like assigning into the old exits map did.
+ *
+ * Name lookup goes through a separate case-insensitive hash index.
+ *
+ * A World can also be backed by a compiled world file (see WorldFile.h).
+ * Then the CSR arrays and the name hash are read straight out of the
+ * mapping and a Room object is only created the first time getRoom()
+ * asks for it.
+ *
+ * With paging enabled (enablePaging) a RoomPager keeps only the most
+ * recently used rooms resident and writes cold ones out to a page file.
+ * A Room* from getRoom() then stays valid only while the room is pinned
+ * or a RoomHold is open around the call (see RoomHold below).
+ */
+class World {
+private:
+    mutable std::vector<Room*> rooms;    // World owns these! (NULL = not created yet)
+    std::size_t room_total;              // ids handed out so far
+    NameIndex room_names;                // room name -> RoomId
+    MappedWorld* mapped;                 // compiled world file, or NULL
+    RoomPager* pager;                    // LRU room pager, or NULL
+    ExitListener* listener;              // e.g. the Pathfinder, or NULL
+
+    // Grid layout of generated rooms (grid_width 0 = no layout known)
+    RoomId grid_first;
+    std::size_t grid_count;
+    unsigned int grid_width;
+
+    // Direction id <-> name
+    std::vector<std::string> direction_names;
+    std::vector<unsigned char> direction_rank;  // alphabetical order, for display
+
+    // CSR exit table (mutable so const lookups can finish a pending build)
+    mutable std::vector<unsigned int> exit_offsets;   // roomCount()+1 entries
+    mutable std::vector<RoomId> exit_targets;
+    mutable std::vector<unsigned char> exit_dirs;
+
+    // The live CSR arrays: either the vectors above or the mapped file
+    mutable const unsigned int* csr_offsets;
+    mutable const RoomId* csr_targets;
+    mutable const unsigned char* csr_dirs;
+    mutable std::size_t csr_rooms;
+
+    // Edges added since the last build
+    struct PendingExit {
+        RoomId from;
+        RoomId to;
+        unsigned char dir;
+    };
+    mutable std::vector<PendingExit> pending;
+    mutable bool exits_dirty;            // rooms, edges or directions changed
+
+    // in World.cpp
+    void buildExits() const;
+    Room* lookupRoom(RoomId id) const;
+    void ensureBuilt() const { if(exits_dirty) buildExits(); }
+
+    // Not copyable - World owns raw pointers
+    World(const World&);
+    World& operator=(const World&);
+
+public:
+    // Constructor / Destructor
+    // in World.cpp
+    // Destructor deletes every room
+    World();
+    ~World();
+
+    // Room storage
+    // in World.cpp
+    RoomId addRoom(Room* room);
+    Room* getRoom(RoomId id) const { return (pager == NULL && id < rooms.size() && rooms[id] != NULL) ? rooms[id] : lookupRoom(id); }
+    RoomId findRoom(const std::string& name) const;
+    RoomId findRoom(const char* name, std::size_t len) const;
+    std::size_t roomCount() const { return room_total; }
+    bool isLoaded(RoomId id) const { return id < rooms.size() && rooms[id] != NULL; }
+    // Resident or paged out - a room that exists as an object, as opposed
+    // to one a world file has yet to create
+    // in World.cpp
+    bool isCreated(RoomId id) const;
+    void reserve(std::size_t room_count, std::size_t exit_count);
+    void clear();
+
+    // Walk the rooms in memory without using them (the pager's order and
+    // holds are left alone): the pager's resident list when paging, else
+    // every room created so far. NO_ROOM ends the walk
+    // in World.cpp
+    RoomId firstResident() const;
+    RoomId nextResident(RoomId id) const;
+    Room* peekRoom(RoomId id) const { return isLoaded(id) ? rooms[id] : NULL; }
+
+    // Back the world with a compiled world file (world must be empty)
+    // Returns the file's start room, or NO_ROOM if it could not be loaded
+    // in World.cpp
+    RoomId attachFile(const std::string& path);
+
+    // Paging: keep at most budget_bytes of rooms resident
+    // pinned_room (e.g. the player's room) is pinned before anything is evicted
+    // in World.cpp
+    void enablePaging(std::size_t budget_bytes, RoomId pinned_room);
+    const PagingStats* pagingStats() const;
+    void pin(RoomId id);
+    void unpin(RoomId id);
+    void prefetchNeighbours(RoomId id) const;
+
+    // Holds (use RoomHold rather than calling these)
+    // in World.cpp
+    std::size_t holdRooms() const;
+    void releaseRooms(std::size_t mark) const;
+
+    // Used by the pager to take a room out of (or put it back into) memory
+    // in World.cpp
+    Room* releaseRoom(RoomId id);
+    void restoreRoom(RoomId id, Room* room);
+
+    // Directions
+    // in World.cpp
+    int directionId(const std::string& direction) const;
+    int directionId(const char* direction, std::size_t len) const;
+    int internDirection(const std::string& direction);
+    const std::string& directionName(int dir) const { return direction_names[dir]; }
+    int directionCount() const { return (int)direction_names.size(); }
+
+    // Exits
+    // in World.cpp
+    void addExit(RoomId from, int dir, RoomId to);
+    RoomId getExit(RoomId from, int dir) const;
+    std::size_t exitCount() const { ensureBuilt(); return csr_offsets[csr_rooms]; }
+    void setExitListener(ExitListener* l) { listener = l; }
+
+    // Raw CSR access (exits of room r are [exitBegin(r), exitEnd(r)))
+    unsigned int exitBegin(RoomId r) const { ensureBuilt(); return csr_offsets[r]; }
+    unsigned int exitEnd(RoomId r) const { ensureBuilt(); return csr_offsets[r + 1]; }
+    RoomId exitTarget(unsigned int e) const { return csr_targets[e]; }
+    int exitDirection(unsigned int e) const { return csr_dirs[e]; }
+
+    // Grid layout: rooms first .. first+count-1 sit on a grid, width wide,
+    // and every exit between them joins neighbouring cells. addExit drops
+    // the layout as soon as an exit breaks that (gridPosition then
+    // answers false for every room)
+    // in World.cpp
+    void setGridLayout(RoomId first, std::size_t count, unsigned int width);
+    bool gridPosition(RoomId id, unsigned int& x, unsigned int& y) const;
+};
+
+/**
+ * RoomHold - Keeps every room fetched while it exists in memory
+ *
+ * Open one around any code that keeps a Room* across another getRoom()
+ * (the Game opens one per command). Holds nest; a no-op without paging.
+ */
+class RoomHold {
+private:
+    const World& world;
+    std::size_t mark;
+
+    // Not copyable - it is a scope
+    RoomHold(const RoomHold&);
+    RoomHold& operator=(const RoomHold&);
+
+public:
+    explicit RoomHold(const World& w) : world(w), mark(w.holdRooms()) { }
+    ~RoomHold() { world.releaseRooms(mark); }
+};
+
+#endif // WORLD_H
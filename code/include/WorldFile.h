@@ -0,0 +1,176 @@
+#ifndef WORLD_FILE_H
+#define WORLD_FILE_H
+
+#include "World.h"
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+class Room;
+
+/**
+ * Binary world file format (version 1)
+ *
+ * A compiled world is one file laid out so that it can be mmap'd and used
+ * in place. Every section starts on an 8 byte boundary:
+ *
+ *   WorldFileHeader
+ *   WorldFileRoom[room_count]          name/description/spawn range per room
+ *   uint32_t exit_offsets[room_count+1] CSR row starts (same as World)
+ *   uint32_t exit_targets[exit_count]
+ *   uint8_t  exit_dirs[exit_count]
+ *   WorldFileSpawn[spawn_count]        monsters and items placed in rooms
+ *   uint32_t name_hash[hash_size]      open-addressed room ids (NO_ROOM = empty)
+ *   WorldFileString[direction_count]   direction names
+ *   char strings[strings_size]         every name/description, deduplicated
+ *
+ * Strings are (offset, length) pairs into the string blob, not terminated.
+ * The header carries a version number; a loader refuses files whose
+ * version it does not understand.
+ */
+const uint32_t WORLD_FILE_VERSION = 2;
+
+enum SpawnKind {
+    SPAWN_GOBLIN = 1,
+    SPAWN_SKELETON = 2,
+    SPAWN_DRAGON = 3,
+    SPAWN_WEAPON = 16,
+    SPAWN_ARMOR = 17,
+    SPAWN_CONSUMABLE = 18
+};
+
+struct WorldFileString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct WorldFileHeader {
+    char magic[8];                // "DCWORLD\0"
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t room_count;
+    uint32_t exit_count;
+    uint32_t spawn_count;
+    uint32_t direction_count;
+    uint32_t hash_size;           // power of two
+    uint32_t start_room;
+    uint64_t rooms_offset;
+    uint64_t exit_offsets_offset;
+    uint64_t exit_targets_offset;
+    uint64_t exit_dirs_offset;
+    uint64_t spawns_offset;
+    uint64_t hash_offset;
+    uint64_t directions_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t file_size;
+};
+
+struct WorldFileRoom {
+    WorldFileString name;
+    WorldFileString description;
+    uint32_t spawn_begin;
+    uint32_t spawn_count;
+};
+
+struct WorldFileSpawn {
+    uint8_t kind;                 // SpawnKind
+    uint8_t slot;                 // item's EquipSlot (version 2)
+    uint8_t effect;               // item's EffectKind when used (version 2)
+    uint8_t reserved;
+    int32_t value;                // item bonus / healing (unused for monsters)
+    int32_t effect_power;         // (version 2)
+    uint32_t effect_turns;        // (version 2)
+    WorldFileString name;         // item name (empty for monsters)
+    WorldFileString description;  // item description (empty for monsters)
+};
+
+
+/**
+ * MappedWorld class - Read-only view of a compiled world file
+ *
+ * open() maps the file and validates it: the header, the section bounds,
+ * and in one linear pass the exit table (every row in order, every target
+ * a room, every direction a known one) and the room names. After that
+ * every accessor reads straight out of the mapping. Nothing is allocated
+ * per room; the check takes about 20 ms for a million rooms.
+ */
+class MappedWorld {
+private:
+    void* base;
+    std::size_t size;
+    const WorldFileHeader* header;
+    const WorldFileRoom* rooms;
+    const uint32_t* exit_offsets;
+    const uint32_t* exit_targets;
+    const uint8_t* exit_dirs;
+    const WorldFileSpawn* spawns;
+    const uint32_t* name_hash;
+    const WorldFileString* directions;
+    const char* strings;
+
+    // Not copyable - owns the mapping
+    MappedWorld(const MappedWorld&);
+    MappedWorld& operator=(const MappedWorld&);
+
+    // in WorldFile.cpp
+    bool validate();
+
+public:
+    // in WorldFile.cpp
+    MappedWorld();
+    ~MappedWorld();
+
+    // Map a compiled world file - prints an error and returns false if invalid
+    // in WorldFile.cpp
+    bool open(const std::string& path);
+    void close();
+
+    // Header data
+    uint32_t roomCount() const { return header->room_count; }
+    uint32_t exitCount() const { return header->exit_count; }
+    uint32_t startRoom() const { return header->start_room; }
+    uint32_t directionCount() const { return header->direction_count; }
+
+    // Strings (not NUL terminated - always use the length)
+    const char* text(const WorldFileString& s) const { return strings + s.offset; }
+    const char* roomName(RoomId id) const { return text(rooms[id].name); }
+    std::size_t roomNameLength(RoomId id) const { return rooms[id].name.length; }
+    const char* roomDescription(RoomId id) const { return text(rooms[id].description); }
+    std::size_t roomDescriptionLength(RoomId id) const { return rooms[id].description.length; }
+    const WorldFileString& directionName(int dir) const { return directions[dir]; }
+
+    // Exits (raw CSR arrays inside the mapping)
+    const uint32_t* exitOffsets() const { return exit_offsets; }
+    const uint32_t* exitTargets() const { return exit_targets; }
+    const uint8_t* exitDirs() const { return exit_dirs; }
+
+    // Spawn table of one room
+    const WorldFileSpawn* spawnBegin(RoomId id) const { return spawns + rooms[id].spawn_begin; }
+    const WorldFileSpawn* spawnEnd(RoomId id) const { return spawns + rooms[id].spawn_begin + rooms[id].spawn_count; }
+
+    // Case-insensitive room lookup through the on-disk hash table
+    // in WorldFile.cpp
+    RoomId findRoom(const char* name, std::size_t len) const;
+
+    // Build a Room object (with monsters and items) from its record
+    // in WorldFile.cpp
+    Room* createRoom(RoomId id) const;
+};
+
+
+/**
+ * WorldCompiler - Writes a World to the binary world file format
+ *
+ * Used offline: build (or generate) a world once, compile it, and ship the
+ * file. Only the initial state is written - visited flags, monster damage
+ * and so on are not part of the format.
+ */
+class WorldCompiler {
+public:
+    // Returns false (and prints an error) if the file can't be written
+    // in WorldFile.cpp
+    static bool compile(const World& world, RoomId start_room, const std::string& path);
+};
+
+#endif // WORLD_FILE_H
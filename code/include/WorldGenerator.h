@@ -0,0 +1,98 @@
+#ifndef WORLD_GENERATOR_H
+#define WORLD_GENERATOR_H
+
+#include "World.h"
+#include <string>
+#include <iostream>
+
+/**
+ * GeneratorConfig - Knobs for a procedurally generated dungeon
+ *
+ * Densities are probabilities per room (0.0 - 1.0).
+ */
+struct GeneratorConfig {
+    unsigned int room_count;
+    unsigned long long seed;
+    double monster_density;   // chance a room has a monster
+    double item_density;      // chance a room has an item on the ground
+    double loop_density;      // chance of an extra exit that makes a loop
+    int threads;              // worker threads (0 = one per CPU)
+
+    // in WorldGenerator.cpp
+    GeneratorConfig();
+};
+
+/**
+ * GeneratorStats - What the generator built and what it cost
+ */
+struct GeneratorStats {
+    unsigned int rooms;
+    unsigned int exits;
+    unsigned int monsters;
+    unsigned int items;
+    int threads;
+    double seconds;
+    long peak_rss_kb;
+
+    GeneratorStats() : rooms(0), exits(0), monsters(0), items(0),
+                       threads(0), seconds(0.0), peak_rss_kb(0) { }
+
+    // in WorldGenerator.cpp
+    void print(std::ostream& out) const;
+};
+
+struct ItemPrototype;
+class ArchetypeTable;
+
+/**
+ * WorldGenerator class - Seeded, multi-threaded dungeon builder
+ *
+ * Rooms are laid out on a square grid (room i sits at column i % width,
+ * row i / width). Every room except the first is joined to its north or
+ * west neighbour, which is a spanning tree, so the dungeon is always
+ * connected; loop_density adds the other edge as well.
+ *
+ * Every random decision for room i is a pure function of (seed, i), so
+ * worker threads can build disjoint slices of the world and the result is
+ * identical for any thread count. Rooms are then added to the World and
+ * connected in id order on the calling thread.
+ *
+ * Room 0 is the Entrance (no monster) and the last room holds the Dragon.
+ * Other monsters are Goblins (packs of 1-3) and Skeletons (1-2), plus
+ * any archetypes the archetype data file adds. Rooms get spawn descriptors, not Monsters;
+ * each is built the first time the player sees it.
+ */
+class WorldGenerator {
+private:
+    GeneratorConfig config;
+    unsigned int width;
+
+    // Every item the generator can roll, interned once before the workers
+    // start so they never queue on the catalog lock: [kind][name][value - 1]
+    const ItemPrototype* item_protos[3][4][10];
+
+    // Archetype table the monster kinds are rolled from, held for the
+    // duration of generate()
+    const ArchetypeTable* archetypes;
+
+    struct Slice;
+    static void* buildSlice(void* arg);
+
+    // in WorldGenerator.cpp
+    unsigned long long roll(unsigned int room, unsigned int salt) const;
+    double chance(unsigned int room, unsigned int salt) const;
+
+public:
+    // in WorldGenerator.cpp
+    WorldGenerator(const GeneratorConfig& config);
+
+    // Build the whole dungeon into an empty World
+    // Returns the id of the starting room
+    // in WorldGenerator.cpp
+    RoomId generate(World& world, GeneratorStats* stats);
+
+    // Grid helpers
+    unsigned int getWidth() const { return width; }
+};
+
+#endif // WORLD_GENERATOR_H
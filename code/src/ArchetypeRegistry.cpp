@@ -0,0 +1,347 @@
+#include "ArchetypeRegistry.h"
+#include "ItemCatalog.h"
+#include "NameIndex.h"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/stat.h>
+
+const unsigned int ArchetypeTable::NOT_FOUND;
+
+// find - linear, tables hold a handful of archetypes
+unsigned int ArchetypeTable::find(const std::string& name) const {
+	for(std::size_t i = 0; i < entries.size(); i++){
+		if(NameIndex::equalsIgnoreCase(entries[i].name.data(), entries[i].name.size(),
+		                               name.data(), name.size())){
+			return (unsigned int)i;
+		}
+	}
+	return NOT_FOUND;
+}
+
+
+// findLootTable - linear as well
+unsigned int ArchetypeTable::findLootTable(const std::string& name) const {
+	for(std::size_t i = 0; i < loot_names.size(); i++){
+		if(NameIndex::equalsIgnoreCase(loot_names[i].data(), loot_names[i].size(),
+		                               name.data(), name.size())){
+			return (unsigned int)i;
+		}
+	}
+	return NOT_FOUND;
+}
+
+
+// split
+// - Fields between separators, trimmed of spaces and tabs
+//
+static std::vector<std::string> split(const std::string& line, char separator) {
+	std::vector<std::string> fields;
+	std::size_t start = 0;
+	for(;;){
+		std::size_t end = line.find(separator, start);
+		std::string field = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+		std::size_t first = field.find_first_not_of(" \t\r");
+		std::size_t last = field.find_last_not_of(" \t\r");
+		fields.push_back(first == std::string::npos ? "" : field.substr(first, last - first + 1));
+		if(end == std::string::npos){ break; }
+		start = end + 1;
+	}
+	return fields;
+}
+
+
+// parseLoot
+// - Entries of a loot field into a built LootTable (see ArchetypeRegistry.h)
+// - Nested tables must have an index below `limit`
+// - Returns false with a message for the first bad entry
+//
+static bool parseLoot(const std::string& field, const ArchetypeTable& table, unsigned int limit,
+                      LootTable& loot, std::string& error) {
+	std::vector<std::string> entries = split(field, ',');
+	unsigned long long total = 0;
+	for(std::size_t i = 0; i < entries.size(); i++){
+		std::string entry = entries[i];
+		if(entry.empty()){ continue; }
+
+		//optional leading weight
+		bool weighted = (entry[0] >= '0' && entry[0] <= '9');
+		unsigned long weight = 0;
+		if(weighted){
+			char* end = NULL;
+			weight = strtoul(entry.c_str(), &end, 10);
+			std::size_t rest = entry.find_first_not_of(" \t", end - entry.c_str());
+			if(weight > LootTable::MAX_WEIGHT || rest == std::string::npos || rest == (std::size_t)(end - entry.c_str())){
+				error = "bad weight in '" + entry + "'";
+				return false;
+			}
+			entry = entry.substr(rest);
+			total += weight;
+		}
+
+		LootDrop drop;
+		if(entry == "-"){
+			if(!weighted){
+				error = "'-' (nothing) needs a weight";
+				return false;
+			}
+		} else if(entry[0] == '@'){
+			unsigned int index = table.findLootTable(entry.substr(1));
+			if(index == ArchetypeTable::NOT_FOUND || index >= limit){
+				error = "loot table " + entry + " must be defined above this line";
+				return false;
+			}
+			drop.table = (int)index;
+		} else {
+			drop.item = ItemCatalog::instance().find(entry);
+			if(drop.item == NULL){
+				error = "no item named " + entry + " in the catalog";
+				return false;
+			}
+		}
+
+		if(weighted){
+			loot.addChoice(drop, (unsigned int)weight);
+		} else {
+			loot.addAlways(drop);
+		}
+	}
+	if(loot.choiceCount() > LootTable::MAX_CHOICES){
+		error = "too many weighted entries";
+		return false;
+	}
+	if(loot.choiceCount() > 0 && total == 0){
+		error = "weights add up to 0";
+		return false;
+	}
+	loot.build();
+	return true;
+}
+
+
+// ArchetypeRegistry constructor
+// - Version 1 is the compiled-in table (MonsterArchetypes.h)
+//
+ArchetypeRegistry::ArchetypeRegistry() : current(NULL), watched_mtime(0) {
+	pthread_mutex_init(&lock, NULL);
+
+	ArchetypeTable* table = new ArchetypeTable();
+	std::string error;
+#define ARCHETYPE_BUILTIN(id, cls, hp, atk, def, exp, coins, bonus, pool, message, drops) \
+	{ \
+		ArchetypeData data; \
+		data.name = #cls; \
+		data.max_hp = hp; \
+		data.attack = atk; \
+		data.defense = def; \
+		data.experience = exp; \
+		data.gold = coins; \
+		data.damage_bonus = bonus; \
+		data.attack_message = message; \
+		std::string loot = drops; \
+		std::replace(loot.begin(), loot.end(), '|', ','); \
+		parseLoot(loot, *table, 0, data.loot, error); \
+		table->entries.push_back(data); \
+	}
+	MONSTER_ARCHETYPES(ARCHETYPE_BUILTIN)
+#undef ARCHETYPE_BUILTIN
+	current = table;
+}
+
+
+// ArchetypeRegistry destructor - drop our reference at exit
+ArchetypeRegistry::~ArchetypeRegistry() {
+	current->release();
+	pthread_mutex_destroy(&lock);
+}
+
+
+// instance - built on first use
+ArchetypeRegistry& ArchetypeRegistry::instance() {
+	static ArchetypeRegistry registry;
+	return registry;
+}
+
+
+// acquire
+// - Retain under the lock, so the table can't be released between
+//   reading the pointer and taking the reference
+//
+const ArchetypeTable* ArchetypeRegistry::acquire() {
+	pthread_mutex_lock(&lock);
+	const ArchetypeTable* table = current;
+	table->retain();
+	pthread_mutex_unlock(&lock);
+	return table;
+}
+
+
+// publish
+// - Swap in the new table, then drop the registry's hold on the old one
+//   (monsters still using it keep it alive)
+//
+void ArchetypeRegistry::publish(ArchetypeTable* table) {
+	pthread_mutex_lock(&lock);
+	const ArchetypeTable* old = current;
+	table->version = old->version + 1;
+	current = table;
+	pthread_mutex_unlock(&lock);
+	old->release();
+}
+
+
+// loadFile
+// - Copy the current table, apply every line, publish only if all parse
+//
+bool ArchetypeRegistry::loadFile(const std::string& path) {
+	std::ifstream in(path.c_str());
+	if(!in){
+		std::cout << "Error: cannot open monster archetypes " << path << std::endl;
+		return false;
+	}
+	struct stat info;
+	time_t mtime = (stat(path.c_str(), &info) == 0) ? info.st_mtime : 0;
+
+	const ArchetypeTable* base = acquire();
+	ArchetypeTable* table = new ArchetypeTable();
+	table->entries = base->entries;
+	table->loot_tables = base->loot_tables;
+	table->loot_names = base->loot_names;
+	base->release();
+
+	std::string line;
+	int line_number = 0;
+	while(std::getline(in, line)){
+		line_number++;
+		std::size_t comment = line.find('#');
+		if(comment != std::string::npos){
+			line.erase(comment);
+		}
+		if(line.find_first_not_of(" \t\r") == std::string::npos){
+			continue;
+		}
+
+		std::vector<std::string> fields = split(line, '|');
+		std::string error;
+
+		//named loot table: @name | rolls | loot
+		if(!fields[0].empty() && fields[0][0] == '@'){
+			std::string name = fields[0].substr(1);
+			char* end = NULL;
+			unsigned long rolls = (fields.size() == 3) ? strtoul(fields[1].c_str(), &end, 10) : 0;
+			if(name.empty() || fields.size() != 3 || fields[1].empty() || *end != '\0' ||
+			   rolls < 1 || rolls > LootTable::MAX_ROLLS){
+				std::cout << "Error: " << path << ":" << line_number
+				          << ": expected '@table | rolls (1-" << LootTable::MAX_ROLLS << ") | loot'" << std::endl;
+				delete table;
+				return false;
+			}
+			unsigned int index = table->findLootTable(name);
+			unsigned int limit = (index == ArchetypeTable::NOT_FOUND) ? (unsigned int)table->loot_tables.size() : index;
+			LootTable loot;
+			loot.setRolls((unsigned int)rolls);
+			if(!parseLoot(fields[2], *table, limit, loot, error)){
+				std::cout << "Error: " << path << ":" << line_number << ": " << error << std::endl;
+				delete table;
+				return false;
+			}
+			if(index == ArchetypeTable::NOT_FOUND){
+				table->loot_tables.push_back(loot);
+				table->loot_names.push_back(name);
+			} else {
+				table->loot_tables[index] = loot;
+			}
+			continue;
+		}
+
+		ArchetypeData data;
+		int* numbers[] = { &data.max_hp, &data.attack, &data.defense,
+		                   &data.experience, &data.gold, &data.damage_bonus };
+		bool ok = ((fields.size() == 9 || fields.size() == 10) && !fields[0].empty());
+		for(int n = 0; ok && n < 6; n++){
+			char* end = NULL;
+			*numbers[n] = (int)strtol(fields[n + 1].c_str(), &end, 10);
+			ok = !fields[n + 1].empty() && *end == '\0';
+		}
+		ok = ok && data.max_hp > 0;
+		if(!ok){
+			std::cout << "Error: " << path << ":" << line_number
+			          << ": expected 'name | hp | attack | defense | exp | gold | bonus | message | loot [| on hit]'" << std::endl;
+			delete table;
+			return false;
+		}
+
+		if(!parseLoot(fields[8], *table, (unsigned int)table->loot_tables.size(), data.loot, error)){
+			std::cout << "Error: " << path << ":" << line_number << ": " << error << std::endl;
+			delete table;
+			return false;
+		}
+		if(fields.size() == 10){
+			if(!EffectSpec::parse(fields[9], data.on_hit, error)){
+				std::cout << "Error: " << path << ":" << line_number << ": " << error << std::endl;
+				delete table;
+				return false;
+			}
+			if(!data.on_hit.empty() && data.on_hit.kind != EFFECT_BURN && data.on_hit.kind != EFFECT_POISON){
+				std::cout << "Error: " << path << ":" << line_number << ": on hit effects are burn or poison" << std::endl;
+				delete table;
+				return false;
+			}
+		}
+		data.name = fields[0];
+		data.attack_message = fields[7];
+
+		//rebalance an existing archetype (same id) or add a new one
+		unsigned int id = table->find(data.name);
+		if(id == ArchetypeTable::NOT_FOUND){
+			table->entries.push_back(data);
+		} else {
+			data.name = table->entries[id].name;
+			table->entries[id] = data;
+		}
+	}
+
+	publish(table);
+	pthread_mutex_lock(&lock);
+	watched_path = path;
+	watched_mtime = mtime;
+	pthread_mutex_unlock(&lock);
+	return true;
+}
+
+
+// reloadIfChanged
+// - One stat() per call, cheap enough to do between commands
+//
+bool ArchetypeRegistry::reloadIfChanged() {
+	pthread_mutex_lock(&lock);
+	std::string path = watched_path;
+	time_t seen = watched_mtime;
+	pthread_mutex_unlock(&lock);
+	if(path.empty()){
+		return false;
+	}
+
+	struct stat info;
+	if(stat(path.c_str(), &info) != 0 || info.st_mtime == seen){
+		return false;
+	}
+	if(!loadFile(path)){
+		//don't retry a broken file until it changes again
+		pthread_mutex_lock(&lock);
+		watched_mtime = info.st_mtime;
+		pthread_mutex_unlock(&lock);
+		return false;
+	}
+	return true;
+}
+
+
+// getVersion - of the current table
+unsigned int ArchetypeRegistry::getVersion() {
+	pthread_mutex_lock(&lock);
+	unsigned int version = current->version;
+	pthread_mutex_unlock(&lock);
+	return version;
+}
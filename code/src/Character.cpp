@@ -1,5 +1,6 @@
 #include "Character.h"
-#include <cstdlib>
+#include "CombatRules.h"
+#include "Serializer.h"
 
 // Character constructor
 // - Use initializer list to initialize all member variables
@@ -8,8 +9,8 @@
 // - Format: Character::Character(params) : member1(value1), member2(value2) { }
 //
 Character::Character(const std::string& name, int hp, int attack, int defense)
-    : name(name), max_hp(hp), current_hp(hp), attack(attack), 
-      defense(defense), alive(true) {
+    : name(name), stats(hp, attack, defense), current_hp(hp),
+      alive(true), effects(StatusEffects::NO_EFFECT), effect_engine(NULL) {
 }
 
 
@@ -17,61 +18,74 @@ Character::Character(const std::string& name, int hp, int attack, int defense)
 // - For base Character class, clean up any dynamic resources if needed
 // - Add (and later remove) a debug print statement if helpful for tracking object lifetime
 // - Example: std::cout << "Character " << name << " destroyed" << std::endl;
+// - Take any status effects off their engine (no need to undo buffs)
 //
 Character::~Character() {
+	if(hasEffects()){
+		effect_engine->clear(*this, false);
+	}
 }
 
 
 // calculateDamage
 // - Return attack damage plus a random bonus (0-4)
-// - Use: rand() % 5 to get random number from 0 to 4
+// - The roll comes from this character's own stream, not rand()
+// - The arithmetic lives in CombatRules::strike (shared with the simulator)
 //
 int Character::calculateDamage() const {
     // Calculate and return damage
     // Base damage is attack stat plus small random bonus
 
-	//Use: rand() % 5 to get random number from 0 to 4
-	int rando = rand() % 5;
-
 	//Return attack damage plus a random bonus (0-4)
-	rando += attack;
-	return rando;
+	return CombatRules::strike(getAttack(), rng.nextU32());
+}
+
+
+// setModifier
+// - Set one source's total for a stat (the effective value is refreshed
+//   the next time it is read)
+// - Clamp current HP if max HP went down
+//
+void Character::setModifier(ModifierSource source, StatKind stat, int value) {
+	stats.setBonus(source, stat, value);
+	if(stat == STAT_MAX_HP && current_hp > getMaxHP()){
+		current_hp = getMaxHP();
+	}
 }
 
 
 // takeDamage
 // - Reduce damage by defense value (actual_damage = damage - defense)
-// - Make sure actual damage is not negative (minimum 0)
+// - Make sure actual damage is not negative (a blow that doesn't get
+//   through does nothing)
 // - Subtract actual damage from current_hp
 // - If hp drops to 0 or below: set hp to 0 and set alive to false
 // - Print damage message showing damage taken and remaining HP
 // - Format: "Name takes X damage! (Y/Z HP)"
+// - Defense is the effective value (armor and buffs included)
+// - Damage over time (ignore_defense) isn't reduced
 //
-void Character::takeDamage(int damage) {
+void Character::takeDamage(int damage, std::ostream& out, bool ignore_defense) {
     // Calculate actual damage after defense
 
 	//Reduce damage by defense value
-	int actual_damage = damage - defense;
+	int actual_damage = ignore_defense ? damage : CombatRules::mitigate(damage, getDefense());
 
 	//Make sure actual damage is not negative (minimum 0)
 	if(actual_damage < 0){
-		//if less than 0, print error message and return
-		std::cout << "takeDamage Error" << std::endl;
+		//if less than 0, the blow glances off (common once armor counts)
+		out << name << " shrugs off the blow! (" << current_hp << "/" << getMaxHP() << " HP)" << std::endl;
 		return;
 	}
 
-        //Apply damage to current_hp
-	current_hp -= actual_damage;
-
-        //Check if character died (hp <= 0)
-	if(current_hp < 0){
-		//set hp to 0 and set alive to false
-		current_hp = 0;
+        //Apply damage to current_hp; if character died, hp is set to 0
+	if(!CombatRules::applyDamage(current_hp, actual_damage)){
+		//set alive to false
 		alive = false;
 	}
 
 	//Print damage message with remaining HP
-	std::cout << name << " takes " << actual_damage << " damage! (" << current_hp << "/" << max_hp << " HP)" << std::endl;
+	out << name << " takes " << actual_damage << " damage! (" << current_hp << "/" << getMaxHP() << " HP)" << std::endl;
 
 }
 
@@ -81,17 +95,19 @@ void Character::takeDamage(int damage) {
 // - Make sure current_hp doesn't exceed max_hp (cap at maximum)
 // - Print healing message showing amount healed and current HP
 // - Format: "Name heals X HP! (Y/Z HP)"
+// - Poison halves the amount
 //
-void Character::heal(int amount) {
-        //Add amount to current_hp
-	current_hp += amount;
+void Character::heal(int amount, std::ostream& out) {
+	//only characters with effects look them up
+	if(hasEffects() && effect_engine->has(*this, EFFECT_POISON)){
+		amount = CombatRules::poisonedHeal(amount);
+	}
 
-	//Cap at max_hp
-	if(current_hp > max_hp)
-		current_hp = max_hp;
+        //Add amount to current_hp, capped at max_hp
+	current_hp = CombatRules::heal(current_hp, amount, getMaxHP());
 
         //Print healing message
-	std::cout << name << " heals " << amount << " HP! (" << current_hp << "/" << max_hp << " HP)" << std::endl;
+	out << name << " heals " << amount << " HP! (" << current_hp << "/" << getMaxHP() << " HP)" << std::endl;
 }
 
 
@@ -100,9 +116,9 @@ void Character::heal(int amount) {
 // - Format: "Name [HP: current/max]"
 // - This is the default implementation - derived classes can override
 //
-void Character::displayStats() const {
+void Character::displayStats(std::ostream& out) const {
     // Print character stats
-	std::cout << name << " [HP: " << current_hp << "/" << max_hp << "]" << std::endl;
+	out << name << " [HP: " << current_hp << "/" << getMaxHP() << "]" << std::endl;
 }
 
 
@@ -111,7 +127,68 @@ void Character::displayStats() const {
 // - Don't add newline at the end (combat system will add it)
 // - Format: "Name [HP: current/max]"
 //
-void Character::displayStatus() const {
+void Character::displayStatus(std::ostream& out) const {
     // Print brief status (no newline)
-	std::cout << name << " [HP: " << current_hp << "/" << max_hp << "]" << std::endl;
+	out << name << " [HP: " << current_hp << "/" << getMaxHP() << "]" << std::endl;
+}
+
+
+// displayEffects - asks the engine its effects are on
+void Character::displayEffects(std::ostream& out) const {
+	if(hasEffects()){
+		effect_engine->display(*this, out);
+	}
+}
+
+
+// writeState
+// - Current HP, alive flag, random stream position
+// - Each stat's base, then each source's modifier for it
+//
+void Character::writeState(ByteWriter& out) const {
+	out.putI32(current_hp);
+	out.putU8(alive ? 1 : 0);
+	out.putU64(rng.getKey());
+	out.putU64(rng.getCounter());
+	for(int s = 0; s < STAT_KIND_COUNT; s++){
+		out.putI32(stats.getBase((StatKind)s));
+		for(int m = 0; m < MOD_SOURCE_COUNT; m++){
+			out.putI32(stats.getBonus((ModifierSource)m, (StatKind)s));
+		}
+	}
+}
+
+
+// readState
+// - Everything writeState wrote, straight into place (no HP clamping:
+//   the saved HP already fit the saved stats)
+// - False if the data is truncated
+//
+bool Character::readState(ByteReader& in) {
+	int hp = in.getI32();
+	bool is_alive = in.getU8() != 0;
+	uint64_t rng_key = in.getU64();
+	uint64_t rng_counter = in.getU64();
+	int base[STAT_KIND_COUNT];
+	int bonus[STAT_KIND_COUNT][MOD_SOURCE_COUNT];
+	for(int s = 0; s < STAT_KIND_COUNT; s++){
+		base[s] = in.getI32();
+		for(int m = 0; m < MOD_SOURCE_COUNT; m++){
+			bonus[s][m] = in.getI32();
+		}
+	}
+	if(!in.ok()){
+		return false;
+	}
+
+	for(int s = 0; s < STAT_KIND_COUNT; s++){
+		stats.setBase((StatKind)s, base[s]);
+		for(int m = 0; m < MOD_SOURCE_COUNT; m++){
+			stats.setBonus((ModifierSource)m, (StatKind)s, bonus[s][m]);
+		}
+	}
+	current_hp = hp;
+	alive = is_alive;
+	rng.restore(rng_key, rng_counter);
+	return true;
 }
@@ -0,0 +1,431 @@
+#include "CombatSimulator.h"
+#include "CombatRules.h"
+#include "Random.h"
+#include "Monster.h"
+#include "ArchetypeRegistry.h"
+#include "StatStore.h"
+#include <iostream>
+#include <iomanip>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+const int CombatSimulator::MAX_TURNS;
+
+// Outcomes of one fight
+static const int OUTCOME_WIN = 0;
+static const int OUTCOME_LOSS = 1;
+static const int OUTCOME_DRAW = 2;
+
+// Monster rolls drawn per RandomStream::fill (most fights need fewer)
+static const int ROLL_BLOCK = 16;
+
+// nowSeconds - wall clock for throughput
+static double nowSeconds() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+// PlayerBuild constructor - a fresh level 1 player with the Rusty Dagger, no armor
+PlayerBuild::PlayerBuild()
+    : hp(100), attack(10), defense(5), weapon_bonus(2), armor_bonus(0),
+      potions(0), potion_heal(30), heal_below(40) {
+}
+
+
+// SimulationConfig constructor - a million goblin fights on every CPU
+SimulationConfig::SimulationConfig()
+    : monster("Goblin"), fights(1000000), seed(1), threads(0) {
+}
+
+
+// SimulationStats constructor
+SimulationStats::SimulationStats()
+    : fights(0), wins(0), losses(0), draws(0), potions_used(0), player_hp_left(0),
+      win_turns(CombatSimulator::MAX_TURNS + 1, 0),
+      loss_turns(CombatSimulator::MAX_TURNS + 1, 0),
+      threads(0), seconds(0.0) {
+}
+
+
+// percentile
+// - Smallest turn count t with at least p of the histogram at or below t
+//
+static int percentile(const std::vector<unsigned long long>& histogram,
+                      unsigned long long total, double p) {
+	unsigned long long target = (unsigned long long)(total * p);
+	if(target == 0){ target = 1; }
+	unsigned long long seen = 0;
+	for(std::size_t t = 0; t < histogram.size(); t++){
+		seen += histogram[t];
+		if(seen >= target){
+			return (int)t;
+		}
+	}
+	return (int)histogram.size() - 1;
+}
+
+
+// printTurns - mean and percentiles of one turns histogram
+static void printTurns(const char* label, const std::vector<unsigned long long>& histogram,
+                       unsigned long long total) {
+	std::cout << "  " << label;
+	if(total == 0){
+		std::cout << "-" << std::endl;
+		return;
+	}
+	unsigned long long sum = 0;
+	for(std::size_t t = 0; t < histogram.size(); t++){
+		sum += histogram[t] * t;
+	}
+	std::cout << "mean " << std::fixed << std::setprecision(2) << (double)sum / total
+	          << "  p50 " << percentile(histogram, total, 0.50)
+	          << "  p90 " << percentile(histogram, total, 0.90)
+	          << "  p99 " << percentile(histogram, total, 0.99)
+	          << "  max " << percentile(histogram, total, 1.0) << std::endl;
+}
+
+
+// print
+// - One summary block: win rate, turns-to-kill, throughput
+//
+void SimulationStats::print() const {
+	double rate = fights ? 100.0 * wins / fights : 0.0;
+	std::cout << "========================================" << std::endl;
+	std::cout << "Combat simulation vs " << monster << std::endl;
+	std::cout << "  Fights:       " << fights << std::endl;
+	std::cout << "  Win rate:     " << std::fixed << std::setprecision(2) << rate << "% ("
+	          << wins << " won, " << losses << " lost, " << draws << " stalemates)" << std::endl;
+	printTurns("Turns to win: ", win_turns, wins);
+	printTurns("Turns to die: ", loss_turns, losses);
+	if(wins > 0){
+		std::cout << "  HP left:      " << std::setprecision(1) << (double)player_hp_left / wins
+		          << " on average after a win" << std::endl;
+	}
+	if(potions_used > 0){
+		std::cout << "  Potions:      " << std::setprecision(2) << (double)potions_used / fights
+		          << " per fight" << std::endl;
+	}
+	std::cout << "  Threads:      " << threads << std::endl;
+	std::cout << "  Time:         " << std::setprecision(3) << seconds << " s ("
+	          << std::setprecision(0) << (seconds > 0 ? fights / seconds : 0.0) << " fights/s)" << std::endl;
+	std::cout << "========================================" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+}
+
+
+// One worker's share of the fights [begin, end)
+struct CombatSimulator::Slice {
+	const CombatSimulator* simulator;
+	unsigned long long begin;
+	unsigned long long end;
+	SimulationStats stats;
+};
+
+
+// CombatSimulator constructor - the monster is looked up in run()
+CombatSimulator::CombatSimulator(const SimulationConfig& config)
+    : config(config), archetype(ARCHETYPE_COUNT), foe() {
+}
+
+
+// fight
+// - The rounds of Game::combat without the I/O:
+//   player drinks a potion or attacks, then a living monster strikes,
+//   then its burn or poison ticks
+// - Rolls come from stream `index` of the seed, one per monster strike,
+//   drawn a block at a time
+// - The monster's numbers are ArchetypeTraits<A> constants when Foe is
+//   a traits class, plain loads from a FoeStats otherwise
+//
+template<class Foe>
+int CombatSimulator::fight(const Foe& monster, unsigned long long index, int& outcome, int& hp_left, int& potions_used) const {
+	const PlayerBuild& p = config.player;
+	RandomStream stream(config.seed, index);
+	unsigned int rolls[ROLL_BLOCK];
+	int used = ROLL_BLOCK;
+	int player_hp = p.hp;
+	int monster_hp = monster.MAX_HP;
+	int potions = p.potions;
+	int dot_left = 0;        //rounds of on-hit burn/poison still to come
+	potions_used = 0;
+
+	for(int turn = 1; turn <= MAX_TURNS; turn++){
+		//player's action
+		if(player_hp < p.heal_below && potions > 0){
+			int amount = (monster.HIT_POISON && dot_left > 0) ? CombatRules::poisonedHeal(p.potion_heal) : p.potion_heal;
+			player_hp = CombatRules::heal(player_hp, amount, p.hp);
+			potions--;
+			potions_used++;
+		} else {
+			int actual = CombatRules::mitigate(CombatRules::weaponStrike(p.attack, p.weapon_bonus), monster.DEFENSE);
+			if(actual >= 0 && !CombatRules::applyDamage(monster_hp, actual)){
+				outcome = OUTCOME_WIN;
+				hp_left = player_hp;
+				return turn;
+			}
+		}
+
+		//monster's turn
+		if(used == ROLL_BLOCK){
+			stream.fill(rolls, ROLL_BLOCK);
+			used = 0;
+		}
+		int damage = CombatRules::strike(monster.ATTACK, rolls[used++]) + monster.DAMAGE_BONUS;
+		int actual = CombatRules::mitigate(damage, p.defense + p.armor_bonus);
+		if(actual >= 0 && !CombatRules::applyDamage(player_hp, actual)){
+			outcome = OUTCOME_LOSS;
+			hp_left = 0;
+			return turn;
+		}
+
+		//its on-hit effect refreshes, then ticks at the end of the round
+		//(StatusEffects: refreshing keeps the longer duration)
+		if(monster.HIT_TURNS > dot_left){
+			dot_left = monster.HIT_TURNS;
+		}
+		if(dot_left > 0){
+			dot_left--;
+			if(!CombatRules::applyDamage(player_hp, monster.HIT_DAMAGE)){
+				outcome = OUTCOME_LOSS;
+				hp_left = 0;
+				return turn;
+			}
+		}
+	}
+	outcome = OUTCOME_DRAW;
+	hp_left = player_hp;
+	return MAX_TURNS;
+}
+
+
+// fightRange - fight [begin, end) into the slice's own stats
+template<class Foe>
+void CombatSimulator::fightRange(const Foe& monster, Slice& slice) const {
+	SimulationStats& s = slice.stats;
+	for(unsigned long long i = slice.begin; i < slice.end; i++){
+		int outcome = OUTCOME_DRAW;
+		int hp_left = 0;
+		int potions = 0;
+		int turns = fight(monster, i, outcome, hp_left, potions);
+		s.potions_used += potions;
+		if(outcome == OUTCOME_WIN){
+			s.wins++;
+			s.player_hp_left += hp_left;
+			s.win_turns[turns]++;
+		} else if(outcome == OUTCOME_LOSS){
+			s.losses++;
+			s.loss_turns[turns]++;
+		} else {
+			s.draws++;
+		}
+	}
+}
+
+
+// runSlice
+// - Thread entry: pick the fight loop compiled for this archetype once,
+//   not once per roll (the FoeStats loop for data-file archetypes)
+//
+void* CombatSimulator::runSlice(void* arg) {
+	Slice* slice = static_cast<Slice*>(arg);
+	const CombatSimulator* sim = slice->simulator;
+	switch(sim->archetype){
+#define ARCHETYPE_RUN(id, cls, hp, atk, def, exp, gold, bonus, pool, message, loot) \
+	case ARCHETYPE_##id: sim->fightRange(ArchetypeTraits<ARCHETYPE_##id>(), *slice); break;
+	MONSTER_ARCHETYPES(ARCHETYPE_RUN)
+#undef ARCHETYPE_RUN
+	default: sim->fightRange(sim->foe, *slice); break;
+	}
+	return NULL;
+}
+
+
+// run
+// - Find the archetype by name in the current archetype table; use its
+//   compiled loop only if the table still has the compiled-in numbers
+// - Split the fights across threads and add up their stats
+//
+bool CombatSimulator::run(SimulationStats& stats) {
+	const ArchetypeTable* table = ArchetypeRegistry::instance().acquire();
+	unsigned int id = table->find(config.monster);
+	if(id == ArchetypeTable::NOT_FOUND){
+		std::cout << "Error: unknown monster " << config.monster << " (expected";
+		for(std::size_t a = 0; a < table->size(); a++){
+			std::cout << (a == 0 ? " " : ", ") << (*table)[a].name;
+		}
+		std::cout << ")" << std::endl;
+		table->release();
+		return false;
+	}
+	const ArchetypeData& data = (*table)[id];
+	std::string name = data.name;
+	foe.MAX_HP = data.max_hp;
+	foe.ATTACK = data.attack;
+	foe.DEFENSE = data.defense;
+	foe.DAMAGE_BONUS = data.damage_bonus;
+	foe.HIT_DAMAGE = data.on_hit.empty() ? 0 : data.on_hit.power;
+	foe.HIT_TURNS = data.on_hit.empty() ? 0 : (int)data.on_hit.turns;
+	foe.HIT_POISON = (data.on_hit.kind == EFFECT_POISON);
+	table->release();
+
+	archetype = ARCHETYPE_COUNT;
+	switch(id){
+#define ARCHETYPE_SAME(id, cls, hp, atk, def, exp, gold, bonus, pool, message, loot) \
+	case ARCHETYPE_##id: \
+		if(foe.MAX_HP == hp && foe.ATTACK == atk && foe.DEFENSE == def && foe.DAMAGE_BONUS == bonus && \
+		   foe.HIT_TURNS == 0){ \
+			archetype = ARCHETYPE_##id; \
+		} \
+		break;
+	MONSTER_ARCHETYPES(ARCHETYPE_SAME)
+#undef ARCHETYPE_SAME
+	default: break;
+	}
+
+	double start = nowSeconds();
+	unsigned long long n = config.fights;
+
+	//decide thread count
+	int threads = config.threads;
+	if(threads <= 0){
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if(threads < 1){
+		threads = 1;
+	}
+	if(n > 0 && (unsigned long long)threads > n){
+		threads = (int)n;
+	}
+
+	std::vector<Slice> slices(threads);
+	std::vector<pthread_t> workers(threads);
+
+	//launch workers (slice 0 runs on this thread)
+	unsigned long long chunk = (n + threads - 1) / threads;
+	for(int t = 0; t < threads; t++){
+		Slice& s = slices[t];
+		s.simulator = this;
+		s.begin = t * chunk < n ? t * chunk : n;
+		s.end = (t + 1) * chunk < n ? (t + 1) * chunk : n;
+		if(t > 0 && pthread_create(&workers[t], NULL, runSlice, &s) != 0){
+			//could not start a thread - run this slice ourselves
+			runSlice(&s);
+			workers[t] = pthread_self();
+		}
+	}
+	runSlice(&slices[0]);
+
+	stats = SimulationStats();
+	stats.monster = name;
+	stats.fights = n;
+	for(int t = 0; t < threads; t++){
+		if(t > 0 && !pthread_equal(workers[t], pthread_self())){
+			pthread_join(workers[t], NULL);
+		}
+		const SimulationStats& s = slices[t].stats;
+		stats.wins += s.wins;
+		stats.losses += s.losses;
+		stats.draws += s.draws;
+		stats.potions_used += s.potions_used;
+		stats.player_hp_left += s.player_hp_left;
+		for(int turn = 0; turn <= MAX_TURNS; turn++){
+			stats.win_turns[turn] += s.win_turns[turn];
+			stats.loss_turns[turn] += s.loss_turns[turn];
+		}
+	}
+	stats.threads = threads;
+	stats.seconds = nowSeconds() - start;
+	return true;
+}
+
+
+// benchmarkHorde
+// - Same monsters three ways: Monster objects (virtual, one at a time,
+//   messages muted), StatStore one slot at a time, StatStore with SIMD
+// - Every round's damage is rolled before the clocks start
+// - Returns false if the three disagree
+//
+bool CombatSimulator::benchmarkHorde(unsigned int monsters, int rounds, unsigned long long seed) {
+	static const char* const KINDS[] = { "Goblin", "Skeleton", "Dragon" };
+	static const int PARTY_ATTACK = 12;   // a party member with a decent weapon
+
+	std::vector<Monster*> horde(monsters);
+	StatStore scalar;
+	StatStore simd;
+	RandomStream kinds(seed, 0);
+	for(unsigned int i = 0; i < monsters; i++){
+		horde[i] = Monster::create(KINDS[kinds.below(3)]);
+		scalar.add(*horde[i]);
+		simd.add(*horde[i]);
+	}
+
+	std::vector<unsigned int> rolls(monsters);
+	std::vector<int> damage(monsters);
+	double object_time = 0.0;
+	double scalar_time = 0.0;
+	double simd_time = 0.0;
+	std::size_t object_deaths = 0;
+	std::size_t scalar_deaths = 0;
+	std::size_t simd_deaths = 0;
+
+	for(int round = 0; round < rounds; round++){
+		RandomStream volley(seed, (unsigned long long)round + 1);
+		volley.fill(monsters ? &rolls[0] : NULL, monsters);
+		for(unsigned int i = 0; i < monsters; i++){
+			damage[i] = CombatRules::strike(PARTY_ATTACK, rolls[i]);
+		}
+
+		//per object: what Game::combat does today, minus the screen (a
+		//stream with no buffer drops every message)
+		double start = nowSeconds();
+		std::ostream silent(NULL);
+		for(unsigned int i = 0; i < monsters; i++){
+			Monster* m = horde[i];
+			if(m->isAlive()){
+				m->takeDamage(damage[i], silent);
+				if(!m->isAlive()){ object_deaths++; }
+			}
+		}
+		object_time += nowSeconds() - start;
+
+		if(monsters == 0){ continue; }
+		start = nowSeconds();
+		scalar_deaths += scalar.applyDamageScalar(&damage[0], 0, monsters);
+		scalar_time += nowSeconds() - start;
+
+		start = nowSeconds();
+		simd_deaths += simd.applyDamage(&damage[0], 0, monsters);
+		simd_time += nowSeconds() - start;
+	}
+
+	//all three must agree slot for slot
+	bool same = (object_deaths == scalar_deaths && scalar_deaths == simd_deaths);
+	for(unsigned int i = 0; i < monsters && same; i++){
+		same = horde[i]->getCurrentHP() == simd[i].getCurrentHP() &&
+		       horde[i]->isAlive() == simd[i].isAlive() &&
+		       scalar[i].getCurrentHP() == simd[i].getCurrentHP();
+	}
+	for(unsigned int i = 0; i < monsters; i++){
+		delete horde[i];
+	}
+
+	double hits = (double)monsters * rounds;
+	std::cout << "========================================" << std::endl;
+	std::cout << "Horde benchmark: " << monsters << " monsters x " << rounds << " rounds" << std::endl;
+	std::cout << "  Deaths:           " << simd_deaths << " (" << simd.aliveCount() << " left standing)" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "  Monster objects:  " << object_time * 1e9 / hits << " ns/hit" << std::endl;
+	std::cout << "  StatStore scalar: " << scalar_time * 1e9 / hits << " ns/hit ("
+	          << object_time / scalar_time << "x)" << std::endl;
+	std::cout << "  StatStore " << StatStore::kernelName() << ":   " << simd_time * 1e9 / hits << " ns/hit ("
+	          << object_time / simd_time << "x)" << std::endl;
+	std::cout << "  Results match:    " << (same ? "yes" : "NO") << std::endl;
+	std::cout << "========================================" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+	return same;
+}
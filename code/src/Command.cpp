@@ -0,0 +1,37 @@
+#include "Command.h"
+#include "NameIndex.h"
+#include <cstring>
+
+const unsigned int Command::VERB_SLOTS;
+
+// isSpace - the separators between words
+static bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+
+// is - same letters, any case
+bool TextView::is(const char* word) const {
+	return NameIndex::equalsIgnoreCase(data, size, word, strlen(word));
+}
+
+
+// parse
+// - Skip leading spaces; the verb runs to the next space
+// - The object is whatever follows, trimmed at both ends
+//
+Command Command::parse(const char* line, std::size_t size) {
+	Command command;
+	const char* end = line + size;
+	const char* p = line;
+	while(p < end && isSpace(*p)){ p++; }
+
+	const char* verb = p;
+	while(p < end && !isSpace(*p)){ p++; }
+	command.verb = TextView(verb, p - verb);
+
+	while(p < end && isSpace(*p)){ p++; }
+	while(end > p && isSpace(end[-1])){ end--; }
+	command.object = TextView(p, end - p);
+	return command;
+}
@@ -0,0 +1,325 @@
+#include "EntityArena.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+
+// Block header: the owning pool (NULL = plain heap block)
+// 16 bytes keeps the payload as aligned as malloc's
+static const std::size_t HEADER_SIZE = 16;
+static const std::size_t FIRST_SLAB_BLOCKS = 64;
+static const std::size_t MAX_SLAB_BLOCKS = 65536;
+
+// Per-thread shard number (stored +1 so NULL means "not assigned yet")
+// and per-thread active arena
+static pthread_key_t shard_key;
+static pthread_key_t active_key;
+static pthread_once_t keys_once = PTHREAD_ONCE_INIT;
+static unsigned int next_shard = 0;
+
+static void createKeys() {
+	pthread_key_create(&shard_key, NULL);
+	pthread_key_create(&active_key, NULL);
+}
+
+
+// SlabPool constructor - block size is fixed by the first allocation
+SlabPool::SlabPool()
+    : block_size(0), next_slab_blocks(FIRST_SLAB_BLOCKS), free_list(NULL),
+      slabs(NULL), slab_count(0), slab_slots(0) {
+	pthread_mutex_init(&lock, NULL);
+}
+
+
+// SlabPool destructor - every slab goes back at once
+SlabPool::~SlabPool() {
+	release();
+	pthread_mutex_destroy(&lock);
+}
+
+
+// release
+// - Free all slabs (live objects in them are gone without destructors)
+//
+void SlabPool::release() {
+	for(std::size_t i = 0; i < slab_count; i++){
+		std::free(slabs[i]);
+	}
+	std::free(slabs);
+	slabs = NULL;
+	slab_count = 0;
+	slab_slots = 0;
+	free_list = NULL;
+	next_slab_blocks = FIRST_SLAB_BLOCKS;
+	stats.live = 0;
+	stats.capacity = 0;
+	stats.slabs = 0;
+}
+
+
+// addSlab
+// - Allocate the next slab and thread all its blocks onto the free list
+// - Called with the lock held
+//
+void SlabPool::addSlab() {
+	if(slab_count == slab_slots){
+		std::size_t slots = slab_slots == 0 ? 16 : slab_slots * 2;
+		void** grown = (void**)std::realloc(slabs, slots * sizeof(void*));
+		if(grown == NULL){
+			throw std::bad_alloc();
+		}
+		slabs = grown;
+		slab_slots = slots;
+	}
+
+	std::size_t blocks = next_slab_blocks;
+	char* slab = (char*)std::malloc(blocks * block_size);
+	if(slab == NULL){
+		throw std::bad_alloc();
+	}
+	slabs[slab_count++] = slab;
+	if(next_slab_blocks < MAX_SLAB_BLOCKS){
+		next_slab_blocks *= 2;
+	}
+
+	//link back to front so blocks are handed out in address order
+	for(std::size_t i = blocks; i > 0; i--){
+		FreeBlock* block = (FreeBlock*)(slab + (i - 1) * block_size);
+		block->next = free_list;
+		free_list = block;
+	}
+	stats.capacity += blocks;
+	stats.slabs++;
+}
+
+
+// allocate
+// - Pop a block from the free list (adding a slab if it is empty)
+// - Returns the payload, just after the header
+//
+void* SlabPool::allocate(std::size_t size) {
+	pthread_mutex_lock(&lock);
+	if(block_size == 0){
+		block_size = (size + HEADER_SIZE + 15) & ~(std::size_t)15;
+		stats.object_size = block_size;
+	}
+	if(size + HEADER_SIZE > block_size){
+		pthread_mutex_unlock(&lock);
+		return NULL;
+	}
+
+	if(free_list == NULL){
+		try {
+			addSlab();
+		} catch(...) {
+			pthread_mutex_unlock(&lock);
+			throw;
+		}
+	}
+	FreeBlock* block = free_list;
+	free_list = block->next;
+	stats.live++;
+	stats.allocations++;
+	if(stats.live > stats.peak){
+		stats.peak = stats.live;
+	}
+	pthread_mutex_unlock(&lock);
+
+	*(SlabPool**)block = this;
+	return (char*)block + HEADER_SIZE;
+}
+
+
+// deallocate - push the block back on the free list
+void SlabPool::deallocate(void* payload) {
+	FreeBlock* block = (FreeBlock*)((char*)payload - HEADER_SIZE);
+	pthread_mutex_lock(&lock);
+	block->next = free_list;
+	free_list = block;
+	stats.live--;
+	pthread_mutex_unlock(&lock);
+}
+
+
+// getStats - copy under the lock
+SlabStats SlabPool::getStats() {
+	pthread_mutex_lock(&lock);
+	SlabStats copy = stats;
+	pthread_mutex_unlock(&lock);
+	return copy;
+}
+
+
+// EntityArena constructor / destructor
+// - The pools free their slabs when the arena goes away
+//
+EntityArena::EntityArena() : previous(NULL), active(false), owner(pthread_self()) {
+}
+
+EntityArena::~EntityArena() {
+	if(active){
+		deactivate();
+	}
+}
+
+
+// current / setCurrent - this thread's active arena
+EntityArena* EntityArena::current() {
+	pthread_once(&keys_once, createKeys);
+	return (EntityArena*)pthread_getspecific(active_key);
+}
+
+void EntityArena::setCurrent(EntityArena* arena) {
+	pthread_once(&keys_once, createKeys);
+	pthread_setspecific(active_key, arena);
+}
+
+
+// adopt
+// - A worker thread allocating from the arena of the thread that
+//   started it (NULL when it is done)
+//
+void EntityArena::adopt(EntityArena* arena) {
+	setCurrent(arena);
+}
+
+
+// activate / deactivate
+// - Arenas nest on each thread: deactivate brings back whichever was
+//   active before
+// - Out of order (or from another thread) is a bug in the caller: say so,
+//   and unlink this arena from its thread's chain if we can reach it
+//
+void EntityArena::activate() {
+	if(active){
+		std::cout << "Error: entity arena activated twice" << std::endl;
+		return;
+	}
+	previous = current();
+	owner = pthread_self();
+	active = true;
+	setCurrent(this);
+}
+
+void EntityArena::deactivate() {
+	if(!active){
+		return;
+	}
+	if(!pthread_equal(owner, pthread_self())){
+		std::cout << "Error: entity arena deactivated from another thread" << std::endl;
+	} else if(current() == this){
+		setCurrent(previous);
+	} else {
+		std::cout << "Error: entity arenas deactivated out of order" << std::endl;
+		for(EntityArena* a = current(); a != NULL; a = a->previous){
+			if(a->previous == this){
+				a->previous = previous;
+				break;
+			}
+		}
+	}
+	previous = NULL;
+	active = false;
+}
+
+
+// shardIndex
+// - Threads take shards round-robin the first time they allocate
+//
+int EntityArena::shardIndex() {
+	pthread_once(&keys_once, createKeys);
+	void* value = pthread_getspecific(shard_key);
+	if(value == NULL){
+		unsigned int shard = __sync_fetch_and_add(&next_shard, 1) % SHARD_COUNT;
+		value = (void*)(std::size_t)(shard + 1);
+		pthread_setspecific(shard_key, value);
+	}
+	return (int)((std::size_t)value - 1);
+}
+
+
+// allocate
+// - From this thread's pool for the kind in this thread's active arena
+// - Plain heap (header = NULL) when there is no arena or the object is too big
+//
+void* EntityArena::allocate(EntityKind kind, std::size_t size) {
+	EntityArena* arena = current();
+	if(arena != NULL){
+		void* payload = arena->pools[shardIndex()][kind].allocate(size);
+		if(payload != NULL){
+			return payload;
+		}
+	}
+
+	char* block = (char*)std::malloc(size + HEADER_SIZE);
+	if(block == NULL){
+		throw std::bad_alloc();
+	}
+	*(SlabPool**)block = NULL;
+	return block + HEADER_SIZE;
+}
+
+
+// deallocate - the header says where the block came from
+void EntityArena::deallocate(void* payload) {
+	if(payload == NULL){
+		return;
+	}
+	char* block = (char*)payload - HEADER_SIZE;
+	SlabPool* pool = *(SlabPool**)block;
+	if(pool != NULL){
+		pool->deallocate(payload);
+	} else {
+		std::free(block);
+	}
+}
+
+
+// getStats
+// - Sum of the kind's pool in every shard
+// - Peaks are per shard, so their sum can overstate the true peak a little
+//
+SlabStats EntityArena::getStats(EntityKind kind) {
+	SlabStats total;
+	for(int i = 0; i < SHARD_COUNT; i++){
+		SlabStats s = pools[i][kind].getStats();
+		if(s.object_size != 0){
+			total.object_size = s.object_size;
+		}
+		total.live += s.live;
+		total.peak += s.peak;
+		total.capacity += s.capacity;
+		total.slabs += s.slabs;
+		total.allocations += s.allocations;
+	}
+	return total;
+}
+
+
+const char* EntityArena::kindName(EntityKind kind) {
+	static const char* const NAMES[ENTITY_KIND_COUNT] = {
+		"Room", "Goblin", "Skeleton", "Dragon", "Weapon", "Armor", "Consumable"
+	};
+	return NAMES[kind];
+}
+
+
+// printStats
+// - One line per entity kind: live / peak / capacity and slab memory
+//
+void EntityArena::printStats(std::ostream& out) {
+	out << "========================================" << std::endl;
+	out << "Entity pools" << std::endl;
+	out << "  " << std::left << std::setw(12) << "Kind" << std::right
+	          << std::setw(10) << "Live" << std::setw(10) << "Peak"
+	          << std::setw(10) << "Capacity" << std::setw(8) << "Slabs"
+	          << std::setw(10) << "KB" << std::endl;
+	for(int k = 0; k < ENTITY_KIND_COUNT; k++){
+		SlabStats s = getStats((EntityKind)k);
+		out << "  " << std::left << std::setw(12) << kindName((EntityKind)k) << std::right
+		          << std::setw(10) << s.live << std::setw(10) << s.peak
+		          << std::setw(10) << s.capacity << std::setw(8) << s.slabs
+		          << std::setw(10) << s.capacity * s.object_size / 1024 << std::endl;
+	}
+	out << "========================================" << std::endl;
+}
@@ -1,11 +1,37 @@
 #include "Game.h"
+#include "WorldFile.h"
+#include "RoomPager.h"
+#include "ItemCatalog.h"
+#include "ArchetypeRegistry.h"
 #include <iostream>
-#include <sstream>
-#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <sys/time.h>
+
+// Random stream ids within a session
+static const unsigned long long STREAM_PLAYER = 0;
+static const unsigned long long STREAM_MONSTERS = 1;    // + room id * group size + slot
+
+// How often the archetype file is checked for edits (its mtime only has
+// whole seconds anyway); a script running a million commands a second
+// would otherwise spend much of its time in stat()
+static const unsigned long long RELOAD_CHECK_NS = 100000000ULL;
 
 // Game constructor
-Game::Game() : player(NULL), current_room(NULL), 
-               game_over(false), victory(false) {
+Game::Game() : output(std::cout.rdbuf()), effects(output), player(NULL), current_room(NULL), pathfinder(world),
+               game_over(false), victory(false), use_generator(false),
+               paging_budget(0), show_pool_stats(false), rng_seed(1),
+               transport(&terminal), flush_lines(false), render(NULL),
+               script_mode(false), script_output(false), script_stats(NULL), line_started(0), play_started(0),
+               reload_checked(0), commands(0), journal(NULL), replay(NULL), replay_start(NULL),
+               replay_line(0), replay_seek(0), replay_stats(NULL), save_file(NULL),
+               autosave_every(0), resume_from(NULL) {
+	//rooms, monsters and items made on this thread from now on come from our pools
+	arena.activate();
+
+	//keep the pathfinder's distance cache in step with new exits
+	world.setExitListener(&pathfinder);
 }
 
 
@@ -19,14 +45,16 @@ Game::~Game() {
 		delete player;
 	}
 
-	//iterate through map
-	for (std::map<std::string, Room*>::iterator it = world.begin(); it != world.end(); ++it){
-		delete it->second;
-	}
-
-	//clear the world
+	//delete all rooms (their destructors still run one by one - the
+	//arena only saves the free() of each block)
 	world.clear();
 
+	//the pathfinder is destroyed before the world
+	world.setExitListener(NULL);
+
+	//the arena member frees all slabs at once after this
+	arena.deactivate();
+
 }
 
 
@@ -34,7 +62,7 @@ Game::~Game() {
 // - Create all rooms with new
 // - Add each room to world using addRoom()
 // - Connect rooms using connectRooms()
-// - Add monsters to appropriate rooms using room->setMonster()
+// - Add monsters to appropriate rooms using room->setSpawn()
 // - Add items to rooms using room->addItem()
 // - Set current_room to starting room (entrance)
 //
@@ -46,7 +74,7 @@ Game::~Game() {
 //                 [Entrance]
 //
 // MONSTERS:
-// - Hallway: Goblin
+// - Hallway: two Goblins
 // - Armory: Skeleton
 // - Treasury: Skeleton
 // - Throne Room: Dragon (boss!)
@@ -80,56 +108,119 @@ void Game::initializeWorld() {
 	connectRooms("Hallway", "east", "Treasury");
 	connectRooms("Hallway", "west", "Armory");
 
-    // Add monsters
-	hallway->setMonster(new Goblin());
-	armory->setMonster(new Skeleton());
-	treasury->setMonster(new Skeleton());
-	throneRoom->setMonster(new Dragon());
+    // Add monsters (built when the player first sees them)
+	hallway->setSpawn(ARCHETYPE_GOBLIN, 2);
+	armory->setSpawn(ARCHETYPE_SKELETON);
+	treasury->setSpawn(ARCHETYPE_SKELETON);
+	throneRoom->setSpawn(ARCHETYPE_DRAGON);
 
-    // Add items
-	entrance->addItem(new Consumable("Small Potion", "Restores 10 HP", 10));
-	armory->addItem(new Weapon("Iron Sword", "A sturdy blade", 5));
-	armory->addItem(new Armor("Chain Mail", "Protective armor", 3));
-	treasury->addItem(new Consumable("Health Potion", "Restores health", 30));
+    // Add items (from the shared item catalog)
+	ItemCatalog& catalog = ItemCatalog::instance();
+	entrance->addItem(catalog.create("Small Potion"));
+	armory->addItem(catalog.create("Iron Sword"));
+	armory->addItem(catalog.create("Chain Mail"));
+	treasury->addItem(catalog.create("Health Potion"));
 
     // Set starting room
 	current_room = entrance;
 }
 
 
+// setGenerator
+// - Use a procedurally generated world instead of initializeWorld()
+//
+void Game::setGenerator(const GeneratorConfig& config) {
+	generator_config = config;
+	use_generator = true;
+}
+
+
+// generateWorld
+// - Build the dungeon with WorldGenerator
+// - Set current_room to the starting room (entrance)
+//
+void Game::generateWorld(GeneratorStats* stats) {
+	WorldGenerator generator(generator_config);
+	RoomId start = generator.generate(world, stats);
+	current_room = world.getRoom(start);
+}
+
+
+// loadWorldFile
+// - Map the compiled world file set with setWorldFile()
+// - Only the starting room is created now; the rest appear as they are reached
+// - Return false if the file could not be loaded
+//
+bool Game::loadWorldFile() {
+	RoomId start = world.attachFile(world_file);
+	if(start == NO_ROOM){
+		return false;
+	}
+	current_room = world.getRoom(start);
+	return current_room != NULL;
+}
+
+
+// compileWorld
+// - Build the world the normal way (hand-built or generated)
+// - Write it out with WorldCompiler, starting room included
+//
+bool Game::compileWorld(const std::string& path) {
+	if(use_generator){
+		generateWorld(NULL);
+	} else {
+		initializeWorld();
+	}
+	return WorldCompiler::compile(world, current_room->getId(), path);
+}
+
+
+// startPaging
+// - If a paging budget was set, turn on the room pager
+// - The player's room is pinned so it can never be paged out
+//
+void Game::startPaging() {
+	if(paging_budget > 0 && current_room != NULL){
+		world.enablePaging(paging_budget, current_room->getId());
+	}
+}
+
+
 // createStartingInventory
 // - Give player starting weapon: Rusty Dagger (damage +2)
 // - Give player starting food: Bread (heals 5 HP)
-// - Use: player->addItem(new Weapon(...))
+// - Use: player->addItem(catalog.create("Name"))
 //
 void Game::createStartingInventory() {
     // Give player starting items
+	ItemCatalog& catalog = ItemCatalog::instance();
+
 	// - Give player starting weapon: Rusty Dagger (damage +2)
-	player->addItem(new Weapon("Rusty Dagger", "Does minor damage", 2));
+	player->addItem(catalog.create("Rusty Dagger"), output);
 
 	// - Give player starting food: Bread (heals 5 HP)
-	player->addItem(new Consumable("Bread", "A hearty food", 5));
+	player->addItem(catalog.create("Bread"), output);
 }
 
 
 // addRoom
 // - Check if room pointer is not NULL
-// - Add to world map using room's name as key
-// - Use: world[room->getName()] = room
+// - Add to world (assigns the room its id and indexes its name)
+// - Use: world.addRoom(room)
 //
 void Game::addRoom(Room* room) {
     // Add room to world map
 
 	//if room ptr is not null
 	if(room != NULL){
-		//add room to world map using room's name as key
-		world[room->getName()] = room;
+		//add room to world, World assigns the id
+		world.addRoom(room);
 	}
 }
 
 
 // connectRooms
-// - Look up both rooms in world map
+// - Look up both rooms in the world's name index
 // - If both exist:
 //   - Add forward direction: room1->addExit(direction, room2)
 //   - Determine reverse direction:
@@ -141,19 +232,20 @@ void Game::connectRooms(const std::string& room1_name, const std::string& direct
                        const std::string& room2_name) {
     // Connect rooms bidirectionally
 
-        //iterate through world map to find rooms
-        std::map<std::string, Room*>::const_iterator it1 = world.find(room1_name);
-        std::map<std::string, Room*>::const_iterator it2 = world.find(room2_name);
+        //look up room ids by name
+        RoomId id1 = world.findRoom(room1_name);
+        RoomId id2 = world.findRoom(room2_name);
 
 	//make sure both rooms exist
-	if (it1 == world.end() || it2 == world.end()) {
-		std::cout << "Error: one or both rooms not found" << std::endl;
+	if (id1 == NO_ROOM || id2 == NO_ROOM) {
+		output << "Error: one or both rooms not found" << std::endl;
 		return;
 	}
 
-        //store room pointers
-        Room* room1 = it1->second;
-        Room* room2 = it2->second;
+        //store room pointers (held, so fetching room2 can't page room1 out)
+        RoomHold hold(world);
+        Room* room1 = world.getRoom(id1);
+        Room* room2 = world.getRoom(id2);
 
 	//add forward direction (room1 to room2)
 	room1->addExit(direction, room2);
@@ -170,12 +262,150 @@ void Game::connectRooms(const std::string& room1_name, const std::string& direct
 		room2->addExit(reverse, room1);
 	} else {
 		//if reverse is empty, print error message
-		std::cout << "Error: reverse direction not found" << std::endl;
+		output << "Error: reverse direction not found" << std::endl;
 	}
 }
 
 
-// run - main game loop
+// run
+// - Point our output at a render buffer on the transport for the whole
+//   game, play it, and send whatever is left at the end
+// - A script that doesn't keep its output sets the output's badbit, so
+//   every << in the game returns at once without formatting anything;
+//   so does a replay until it reaches the command it seeks
+// - Time the session for the script's stats from the first command on
+//   (world building and loading are setup, not throughput), and the
+//   whole of it for a replay's
+//
+void Game::run() {
+	unsigned long long start = ScriptStats::now();
+	RenderBuffer buffer(transport, flush_lines);
+	{
+		RenderBuffer::Capture capture(output, buffer);
+		render = &buffer;
+		if((script_mode && !script_output) || (replay != NULL && replay_seek > 0)){
+			output.setstate(std::ios::badbit);
+		}
+		play();
+		output.clear();
+		buffer.flush();
+	}
+	render = NULL;
+	if(script_stats != NULL && play_started != 0){
+		script_stats->seconds = (ScriptStats::now() - play_started) / 1e9;
+	}
+	if(replay_stats != NULL){
+		replay_stats->commands = commands - replay_stats->start;
+		replay_stats->seconds = (ScriptStats::now() - start) / 1e9;
+	}
+}
+
+
+// nowSeconds - wall clock for the transport benchmark
+static double nowSeconds() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+// benchmarkTransport
+// - The same session (look, stats, inventory, help over and over) on a
+//   MemoryTransport twice: sending each line as std::endl used to, and
+//   sending each command's output once
+// - Both must produce exactly the same bytes
+//
+bool Game::benchmarkTransport(unsigned int commands, unsigned long long seed) {
+	static const char* const CYCLE[] = { "look", "stats", "inventory", "help" };
+	std::string script = "Bench\n";
+	for(unsigned int i = 0; i < commands; i++){
+		script += CYCLE[i % (sizeof(CYCLE) / sizeof(CYCLE[0]))];
+		script += '\n';
+	}
+	script += "quit\n";
+
+	double seconds[2];
+	unsigned long long writes[2];
+	unsigned long long bytes[2];
+	for(int every_command = 0; every_command < 2; every_command++){
+		MemoryTransport memory(1 << 16);
+		memory.feed(script);
+		Game game;
+		game.setRandomSeed(seed);
+		game.setTransport(&memory);
+		game.setFlushEveryLine(every_command == 0);
+		double start = nowSeconds();
+		game.run();
+		seconds[every_command] = nowSeconds() - start;
+		writes[every_command] = memory.writeCount();
+		bytes[every_command] = memory.bytesWritten();
+	}
+
+	bool same = bytes[0] == bytes[1];
+	double per = commands ? (double)commands : 1.0;
+	std::cout << "========================================" << std::endl;
+	std::cout << "Transport benchmark: " << commands << " commands, " << bytes[1] / per << " bytes each" << std::endl;
+	std::cout << "  Every line:    " << seconds[0] * 1e9 / per << " ns per command, "
+	          << writes[0] / per << " writes per command" << std::endl;
+	std::cout << "  Every command: " << seconds[1] * 1e9 / per << " ns per command, "
+	          << writes[1] / per << " writes per command" << std::endl;
+	std::cout << "  Results:       " << (same ? "identical" : "MISMATCH") << std::endl;
+	std::cout << "========================================" << std::endl;
+	return same;
+}
+
+
+// readLine
+// - Everything the last command printed goes out in one write, then the
+//   next line comes in: from the transport, or the journal being replayed
+//   (which must have the same kind of line next, or the replay has gone
+//   off course)
+// - The journal being recorded gets the line at once, and straight to
+//   disk when a person is playing
+// - In a script, the time from reading a command to asking for the next
+//   line is that command's latency; the name and fight actions aren't
+//   timed (the setup after the name would count as its latency)
+//
+bool Game::readLine(std::string& line, JournalRecord kind) {
+	bool sent = (render == NULL || render->flush());
+
+	//the line before this one is done (its output included)
+	if(script_stats != NULL && line_started != 0){
+		script_stats->record(ScriptStats::now() - line_started);
+		line_started = 0;
+	}
+	if(!sent){
+		return false;
+	}
+	if(replay != NULL){
+		if(replay_line >= replay->lineCount()){
+			return false;
+		}
+		if(replay->lineKind(replay_line) != kind){
+			output.clear();
+			output << "Error: replay went off course at line " << replay_line + 1 << ": the game wants "
+			          << (kind == JOURNAL_ACTION ? "a fight action" : "a command") << ", the journal has "
+			          << (replay->lineKind(replay_line) == JOURNAL_ACTION ? "a fight action" : "a command") << std::endl;
+			return false;
+		}
+		line = replay->line(replay_line++).str();
+	} else if(!transport->readLine(line)){
+		return false;
+	}
+	if(journal != NULL){
+		journal->recordLine(kind, line);
+		if(!script_mode){
+			journal->flush();
+		}
+	}
+	if(script_stats != NULL && kind == JOURNAL_COMMAND){
+		line_started = ScriptStats::now();
+	}
+	return true;
+}
+
+
+// play - main game loop
 // - Print welcome message and game title
 // - Get player name from input 
 // - Create player: player
@@ -185,81 +415,685 @@ void Game::connectRooms(const std::string& room1_name, const std::string& direct
 // - Mark starting room as visited
 // - Main loop:
 //   - Print prompt: "> "
-//   - Get command (use std::getline)
-//   - Convert to lowercase (use std::transform)
+//   - Get command (readLine; the game ends with the input)
+//   - (no lowercasing: verbs and names are matched in any case)
 //   - Call processCommand()
 //   - Check victory condition
 //   - Check defeat condition (player dead)
 //
-void Game::run() {
+void Game::play() {
     // Implement main game loop
 
 	//print Welcome Message
-	std::cout << std::endl << "=== DUNGEON CRAWLER RPG ===" << std::endl;
+	output << std::endl << "=== DUNGEON CRAWLER RPG ===" << std::endl;
 
-	//Get player name from input
+	//Get player name from input (a saved game has it already)
 	std::string playerName = "";
-	std::cout << "Enter your name, brave adventurer: ";
-	std::getline(std::cin, playerName);
+	if(resume_from != NULL){
+		playerName = resume_from->getName();
+	} else {
+		if(!script_mode){
+			output << "Enter your name, brave adventurer: ";
+		}
+		if(!readLine(playerName, JOURNAL_NAME)){
+			game_over = true;
+			return;
+		}
+	}
 
-	//Create Player
+	//Create Player (stream 0 of the session seed)
 	player = new Player(playerName);
+	player->seedRandom(rng_seed, STREAM_PLAYER);
 
-	//Call initializeWorld()
-	initializeWorld();
+	//Call initializeWorld() (or build a generated dungeon, or map a compiled one)
+	if(!world_file.empty()){
+		if(!loadWorldFile()){
+			game_over = true;
+			return;
+		}
+	} else if(use_generator){
+		GeneratorStats stats;
+		generateWorld(&stats);
+		stats.print(output);
+	} else {
+		initializeWorld();
+	}
+
+	//Page cold rooms out if a memory budget was given
+	startPaging();
 
 	//Call createStartingInventory()
 	createStartingInventory();
 
 	//display welcome and help messages
-	std::cout << std::endl;
-	std::cout << "Welcome, " << playerName << "!" << std::endl;
-	std::cout << "Your quest: Defeat the dragon in the throne room!" << std::endl;
-	std::cout << "Type 'help' for commands." << std::endl;
+	output << std::endl;
+	output << "Welcome, " << playerName << "!" << std::endl;
+	output << "Your quest: Defeat the dragon in the throne room!" << std::endl;
+	output << "Type 'help' for commands." << std::endl;
+
+	//a saved game picks up where it was left
+	if(resume_from != NULL){
+		if(!resumeSave()){
+			output << "Error: the saved game cannot be restored" << std::endl;
+			game_over = true;
+			return;
+		}
+		output << "Your saved game is loaded." << std::endl;
+	}
+	markDirty(current_room->getId());
 
 	//Display starting room
-	current_room->display();
+	current_room->display(output);
+
+	//a replay that seeks starts from the journal's last keyframe before it
+	//(the full one under it, then each delta)
+	if(replay_start != NULL){
+		if(!restoreKeyframes(replay_start)){
+			output.clear();
+			output << "Error: the journal's keyframe at command " << replay_start->command
+			          << " cannot be restored" << std::endl;
+			game_over = true;
+			return;
+		}
+		commands = replay_start->command;
+		replay_line = replay_start->line;
+	}
+
+	//setup is over: the script's clock starts here
+	play_started = ScriptStats::now();
 
 	//MAIN GAME LOOP
 	//while game is nont over
 	while(!game_over){
+		//keyframe due, or replay check
+		checkpoint();
+
 		//print prompt
-		std::cout << " > ";
+		if(!script_mode){
+			output << " > ";
+		}
 
 		//Get command
 		std::string command = "";
-		std::getline(std::cin, command);
-
-		//Convert to lowercase
-		std::transform(command.begin(), command.end(), command.begin(), ::tolower);
+		if(!readLine(command, JOURNAL_COMMAND)){
+			output << std::endl << "Exiting game..." << std::endl;
+			game_over = true;
+			break;
+		}
+		commands++;
+
+		//pick up edits to the monster archetype file between commands
+		//(a replay keeps the archetypes it started with)
+		unsigned long long now = ScriptStats::now();
+		if(replay == NULL && now - reload_checked >= RELOAD_CHECK_NS){
+			reload_checked = now;
+			if(ArchetypeRegistry::instance().reloadIfChanged()){
+				output << "Monster archetypes reloaded (version "
+				          << ArchetypeRegistry::instance().getVersion() << ")" << std::endl;
+				if(journal != NULL){
+					journal->recordReload(ArchetypeRegistry::instance().getVersion());
+				}
+			}
+		}
 
 		//Call processCommand()
+		unsigned long long turn = effects.getTurn();
 		processCommand(command);
 
+		//every command takes at least a turn (a fight ticks once per round)
+		if(effects.getTurn() == turn){
+			effects.advance();
+		}
+
 		//Check defeat condition (player dead)
 		if(!player->isAlive()){
-			std::cout << "You have died. Game Over!" << std::endl;
+			output << "You have died. Game Over!" << std::endl;
 			game_over = true;
 
 		//Check victory condition
 		} else if(victory == true){
-			std::cout << "VICTORY! WOU WIN!!!" << std::endl;
+			output << "VICTORY! WOU WIN!!!" << std::endl;
 			game_over = true;
+
+		//autosave every so many commands
+		} else if(save_file != NULL && autosave_every > 0 && commands % autosave_every == 0){
+			saveGame(false);
+		}
+
+
+	}
+
+	//save on the way out; a game that is won or lost keeps its last save
+	if(save_file != NULL && player->isAlive() && !victory){
+		saveGame(false);
+	}
+
+	//report paging counters if the pager was on
+	if(world.pagingStats() != NULL){
+		world.pagingStats()->print(output);
+	}
+	if(show_pool_stats){
+		printPoolStats();
+	}
+}
+
+
+// checkpoint
+// - Recording: a keyframe every so many commands, full or delta as the
+//   journal says (skipped, with a warning, if the state can't be saved;
+//   the next delta then still covers everything since the last one)
+// - Replaying: show output from the command being sought, and compare
+//   our state with each keyframe the journal has for this point (except
+//   the one we started from); either way the rooms start over from there
+//
+void Game::checkpoint() {
+	if(journal != NULL && journal->keyframeDue()){
+		ByteWriter state;
+		bool full = journal->fullKeyframeDue();
+		if(saveKeyframe(state, full)){
+			journal->recordKeyframe(state.data(), full);
+			resetDirty(keyframe_rooms);
+		} else {
+			journal->skipKeyframe();
+			output << "Warning: no keyframe at command " << commands
+			          << " (a status effect is on a monster that isn't in memory)." << std::endl;
+		}
+	}
+	if(replay == NULL){
+		return;
+	}
+
+	if(replay_seek > 0 && commands + 1 == replay_seek){
+		output.clear();
+		output << "=== Replay from command " << replay_seek << ", in "
+		          << current_room->getName() << " ===" << std::endl;
+	}
+
+	const JournalReader::Keyframe* keyframe = replay->keyframeAt(commands);
+	if(keyframe == NULL || keyframe == replay_start){
+		return;
+	}
+	if(replay_stats != NULL){
+		ByteWriter state;
+		bool same = saveKeyframe(state, keyframe->full) && state.size() == keyframe->state.size &&
+		            memcmp(state.data().data(), keyframe->state.data, state.size()) == 0;
+		replay_stats->checked++;
+		if(!same && replay_stats->mismatched++ == 0){
+			replay_stats->first_mismatch = commands;
 		}
+	}
+	resetDirty(keyframe_rooms);
+}
 
 
+// saveState
+// - Every room that exists, by id: the hand-built and generated worlds
+//   have them all, a world file only the ones created so far (the rest
+//   are still as the file has them); paged-out rooms are read back
+// - Then the player's room and the victory flag, the player, the status
+//   effects (which may name monsters in those rooms)
+// - False if a status effect is on a monster that isn't resident
+//
+bool Game::saveState(ByteWriter& out) {
+	saveRoomStates(out, NULL);
+	return savePlayerState(out);
+}
+
+
+// restoreState
+// - Put a saveState() snapshot into this game, whose world has just been
+//   built from the same setup: each saved room's contents replace what
+//   it has, then the player moves to the saved room
+// - False if the snapshot is bad (the game is then not fit to play)
+//
+bool Game::restoreState(ByteReader& in) {
+	return restoreRoomStates(in) && restorePlayerState(in);
+}
+
+
+// saveKeyframe - saveState, or the same with only the keyframe's dirty rooms
+bool Game::saveKeyframe(ByteWriter& out, bool full) {
+	saveRoomStates(out, full ? NULL : &keyframe_rooms.ids);
+	return savePlayerState(out);
+}
+
+
+// restoreKeyframes
+// - The rooms of every keyframe from the full one to `last`, in order
+//   (later ones win), then `last`'s player
+// - Afterwards the rooms start over, as they did when `last` was taken
+//
+bool Game::restoreKeyframes(const JournalReader::Keyframe* last) {
+	std::vector<const JournalReader::Keyframe*> chain;
+	replay->keyframeChain(last, chain);
+	for(std::size_t i = 0; i + 1 < chain.size(); i++){
+		ByteReader rooms(chain[i]->state.data, chain[i]->state.size);
+		if(!restoreRoomStates(rooms)){
+			return false;
+		}
+	}
+	ByteReader state(last->state.data, last->state.size);
+	if(!restoreState(state) || !state.atEnd()){
+		return false;
 	}
+	resetDirty(keyframe_rooms);
+	return true;
+}
+
+
+// savePlayerState
+// - Player's room and the victory flag, the player, the status effects
+//
+bool Game::savePlayerState(ByteWriter& out) {
+	out.putU32(current_room->getId());
+	out.putU8(victory ? 1 : 0);
+	player->serialize(out);
+	return effects.serialize(*player, *this, out);
+}
+
+
+// saveRoomStates
+// - Count, then each room's id and contents; every room that exists if
+//   no ids are given
+//
+uint32_t Game::saveRoomStates(ByteWriter& out, const std::vector<RoomId>* ids) {
+	if(ids != NULL){
+		out.putU32((uint32_t)ids->size());
+		for(std::size_t i = 0; i < ids->size(); i++){
+			out.putU32((*ids)[i]);
+			RoomHold hold(world);
+			world.getRoom((*ids)[i])->serialize(out);
+		}
+		return (uint32_t)ids->size();
+	}
+
+	uint32_t count = 0;
+	for(RoomId id = 0; id < world.roomCount(); id++){
+		count += world.isCreated(id) ? 1 : 0;
+	}
+	out.putU32(count);
+	for(RoomId id = 0; id < world.roomCount(); id++){
+		if(world.isCreated(id)){
+			out.putU32(id);
+			RoomHold hold(world);
+			world.getRoom(id)->serialize(out);
+		}
+	}
+	return count;
+}
+
+
+// restorePlayerState
+// - The player and the status effects, then into the saved room
+// - The rooms must be restored already: effects on monsters are put
+//   back on the monsters those rooms now have
+//
+bool Game::restorePlayerState(ByteReader& in) {
+	RoomId here = in.getU32();
+	bool won = in.getU8() != 0;
+	RoomHold hold(world);
+	if(!in.ok() || !player->restore(in) || !effects.restore(*player, *this, in)){
+		return false;
+	}
+	Room* room = world.getRoom(here);
+	if(!in.ok() || room == NULL){
+		return false;
+	}
+	if(room != current_room){
+		enterRoom(room);
+	}
+	victory = won;
+	return true;
+}
+
+
+// restoreRoomStates - each saved room's contents replace what it has
+bool Game::restoreRoomStates(ByteReader& in) {
+	uint32_t count = in.getU32();
+	for(uint32_t i = 0; i < count && in.ok(); i++){
+		RoomHold hold(world);
+		Room* room = world.getRoom(in.getU32());
+		if(room == NULL || !room->restore(in)){
+			return false;
+		}
+	}
+	return in.ok();
+}
+
+
+// findMonster - the slot of `target` in this room, or false
+static bool findMonster(const Room* room, const Character& target, uint32_t& slot) {
+	const MonsterGroup& monsters = room->getBuiltMonsters();
+	for(std::size_t m = 0; m < monsters.size(); m++){
+		if(monsters[m] == &target){
+			slot = (uint32_t)m;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// locate
+// - The player's room first (where fights happen), then the other
+//   resident rooms; paged-out monsters have already lost their effects
+//
+bool Game::locate(const Character& target, uint32_t& where, uint32_t& slot) const {
+	RoomId here = current_room->getId();
+	if(findMonster(current_room, target, slot)){
+		where = here;
+		return true;
+	}
+	for(RoomId id = world.firstResident(); id != NO_ROOM; id = world.nextResident(id)){
+		if(id != here && findMonster(world.peekRoom(id), target, slot)){
+			where = id;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// resolve - the monster at this slot of this room, or NULL
+Character* Game::resolve(uint32_t where, uint32_t slot) const {
+	Room* room = where < world.roomCount() ? world.getRoom(where) : NULL;
+	if(room == NULL || slot >= room->getBuiltMonsters().size()){
+		return NULL;
+	}
+	return room->getBuiltMonsters()[slot];
+}
+
+
+// markDirty - the next save and the next keyframe write this room
+void Game::markDirty(RoomId id) {
+	save_rooms.add(id, world.roomCount());
+	keyframe_rooms.add(id, world.roomCount());
+}
+
+
+// resetDirty
+// - After a save or keyframe: only the player's room (they are still in
+//   it) and the rooms of monsters whose effects keep ticking stay dirty
+//
+void Game::resetDirty(RoomSet& rooms) {
+	rooms.clear();
+	rooms.add(current_room->getId(), world.roomCount());
+	std::vector<const Character*> others;
+	effects.others(*player, others);
+	for(std::size_t i = 0; i < others.size(); i++){
+		uint32_t where, slot;
+		if(locate(*others[i], where, slot)){
+			rooms.add(where, world.roomCount());
+		}
+	}
+}
+
+
+// saveGame
+// - A full save the first time, and again once the deltas have outgrown
+//   it; otherwise only the rooms entered since the last save
+// - Afterwards only what still changes is dirty (see resetDirty)
+//
+bool Game::saveGame(bool announce) {
+	if(save_file == NULL){
+		output << "Error: there is no save file (start the game with --save FILE)." << std::endl;
+		return false;
+	}
+	ByteWriter hero;
+	if(!savePlayerState(hero)){
+		output << "Error: cannot save while a monster that isn't in memory is under a status effect." << std::endl;
+		return false;
+	}
+	bool full = save_file->needsFull();
+	ByteWriter rooms;
+	uint32_t count = saveRoomStates(rooms, full ? NULL : &save_rooms.ids);
+	bool saved = full ? save_file->writeFull(player->getName(), hero.data(), rooms.data())
+	                  : save_file->writeDelta(hero.data(), rooms.data());
+	if(!saved){
+		return false;
+	}
+
+	resetDirty(save_rooms);
+
+	if(announce){
+		output << "Game saved (" << count << (count == 1 ? " room" : " rooms")
+		          << (full ? ", full save" : "") << ")." << std::endl;
+	}
+	return true;
+}
+
+
+// resumeSave
+// - The rooms of every record in order (later ones win), then the last
+//   record's player, who moves into the saved room
+//
+bool Game::resumeSave() {
+	for(std::size_t i = 0; i < resume_from->roomBlockCount(); i++){
+		ByteReader rooms(resume_from->roomBlock(i).data, resume_from->roomBlock(i).size);
+		if(!restoreRoomStates(rooms) || !rooms.atEnd()){
+			return false;
+		}
+	}
+	ByteReader hero(resume_from->playerBlock().data, resume_from->playerBlock().size);
+	return restorePlayerState(hero) && hero.atEnd();
+}
+
+
+// hashFile
+// - FNV-1a (64-bit) over a data file's bytes; 0 for none or unreadable
+//
+static uint64_t hashFile(const std::string& path) {
+	if(path.empty()){
+		return 0;
+	}
+	std::ifstream in(path.c_str(), std::ios::binary);
+	if(!in){
+		return 0;
+	}
+	uint64_t h = 14695981039346656037ULL;
+	char chunk[4096];
+	while(in.read(chunk, sizeof(chunk)) || in.gcount() > 0){
+		for(std::streamsize i = 0; i < in.gcount(); i++){
+			h ^= (unsigned char)chunk[i];
+			h *= 1099511628211ULL;
+		}
+	}
+	return h;
+}
+
+
+// writeSetup
+// - What it takes to build this game again: combat seed, whether
+//   prompts are printed, world file, generator settings, paging budget,
+//   and the item and monster files with a hash of each
+//
+void Game::writeSetup(ByteWriter& out) const {
+	out.putU64(rng_seed);
+	out.putU8(script_mode ? 1 : 0);
+	out.putString(world_file);
+	out.putU8(use_generator ? 1 : 0);
+	out.putU32(generator_config.room_count);
+	out.putU64(generator_config.seed);
+	out.putBytes(&generator_config.monster_density, sizeof(double));
+	out.putBytes(&generator_config.item_density, sizeof(double));
+	out.putBytes(&generator_config.loop_density, sizeof(double));
+	out.putU64(paging_budget);
+	out.putString(item_file);
+	out.putU64(hashFile(item_file));
+	out.putString(monsters_file);
+	out.putU64(hashFile(monsters_file));
+}
+
+
+// warnDataFile
+// - The data files are this run's own (options or defaults), so a
+//   different one only gets a warning: fights and loot may not match
+//
+static void warnDataFile(std::ostream& out, const char* source, const char* what,
+                         const std::string& recorded, uint64_t recorded_hash, const std::string& loaded) {
+	if(hashFile(loaded) == recorded_hash){
+		return;
+	}
+	out << "Warning: the " << source << " was made with ";
+	if(recorded.empty()){
+		out << "no " << what;
+	} else {
+		out << what << " " << recorded;
+	}
+	if(loaded.empty()){
+		out << ", this run has none";
+	} else if(loaded == recorded){
+		out << ", which has changed since";
+	} else {
+		out << ", this run has " << loaded;
+	}
+	out << " - fights and loot may differ" << std::endl;
+}
+
+
+// readSetup
+// - Settings written by writeSetup(); a recorded script plays back
+//   without prompts but with its output
+// - Item and monster files are checked against this run's, not taken
+//
+bool Game::readSetup(ByteReader& in, const char* source) {
+	unsigned long long seed = in.getU64();
+	bool no_prompts = in.getU8() != 0;
+	std::string file = in.getString();
+	bool generated = in.getU8() != 0;
+	GeneratorConfig config;
+	config.room_count = in.getU32();
+	config.seed = in.getU64();
+	in.getBytes(&config.monster_density, sizeof(double));
+	in.getBytes(&config.item_density, sizeof(double));
+	in.getBytes(&config.loop_density, sizeof(double));
+	uint64_t budget = in.getU64();
+	std::string items = in.getString();
+	uint64_t items_hash = in.getU64();
+	std::string monsters = in.getString();
+	uint64_t monsters_hash = in.getU64();
+	if(!in.ok()){
+		return false;
+	}
+
+	rng_seed = seed;
+	script_mode = no_prompts;
+	script_output = true;
+	world_file = file;
+	use_generator = generated;
+	generator_config = config;
+	paging_budget = (std::size_t)budget;
+	warnDataFile(output, source, "item catalog", items, items_hash, item_file);
+	warnDataFile(output, source, "monster file", monsters, monsters_hash, monsters_file);
+	return true;
+}
+
+
+// setResume
+// - Take the save's setup (seed, world), but keep this run's prompts
+//   and output settings
+//
+bool Game::setResume(const SaveReader* save) {
+	bool prompts_off = script_mode;
+	bool keep_output = script_output;
+	ByteReader setup(save->getSetup().data, save->getSetup().size);
+	if(!readSetup(setup, "save file")){
+		output << "Error: the save file's setup block is damaged" << std::endl;
+		return false;
+	}
+	script_mode = prompts_off;
+	script_output = keep_output;
+	resume_from = save;
+	return true;
+}
+
+
+// setReplay
+// - Take the journal's setup
+// - Command `seek` (counting from 1; past the end is the last one) is
+//   the first shown, so start from the last keyframe taken at most
+//   seek - 1 commands in
+//
+bool Game::setReplay(const JournalReader* source, unsigned long long seek, ReplayStats* stats) {
+	ByteReader setup(source->getSetup().data, source->getSetup().size);
+	if(!readSetup(setup, "journal")){
+		output << "Error: the journal's setup block is damaged" << std::endl;
+		return false;
+	}
+	replay = source;
+	replay_seek = (seek < source->commandCount()) ? seek : source->commandCount();
+	replay_start = (replay_seek > 0) ? source->findKeyframe(replay_seek - 1) : NULL;
+	replay_line = 0;
+	replay_stats = stats;
+	if(stats != NULL){
+		stats->start = (replay_start != NULL) ? replay_start->command : 0;
+		stats->seek = replay_seek;
+		stats->reloads = source->reloadCount();
+	}
+	return true;
+}
+
+
+// Verbs and aliases (buildVerbTable puts each one at its hash)
+const Game::VerbEntry Game::VERBS[] = {
+	{ "go",        &Game::doGo },
+	{ "move",      &Game::doGo },
+	{ "travel",    &Game::doTravel },
+	{ "look",      &Game::doLook },
+	{ "l",         &Game::doLook },
+	{ "attack",    &Game::doAttack },
+	{ "fight",     &Game::doAttack },
+	{ "pickup",    &Game::doPickup },
+	{ "get",       &Game::doPickup },
+	{ "take",      &Game::doPickup },
+	{ "inventory", &Game::doInventory },
+	{ "i",         &Game::doInventory },
+	{ "use",       &Game::doUse },
+	{ "equip",     &Game::doEquip },
+	{ "e",         &Game::doEquip },
+	{ "stats",     &Game::doStats },
+	{ "help",      &Game::doHelp },
+	{ "h",         &Game::doHelp },
+	{ "?",         &Game::doHelp },
+	{ "quit",      &Game::doQuit },
+	{ "exit",      &Game::doQuit },
+	{ "save",      &Game::doSave }
+};
+
+// Slot (Command::hashVerb) -> VERBS index + 1, filled in before main()
+unsigned char Game::VERB_TABLE[Command::VERB_SLOTS];
+const bool Game::VERB_TABLE_BUILT = Game::buildVerbTable();
+
+
+// buildVerbTable
+// - Put each verb's index + 1 at its hash slot
+// - Two verbs in one slot would make one of them unreachable: say which
+//   and stop, before anyone can play
+//
+bool Game::buildVerbTable() {
+	for(std::size_t i = 0; i < sizeof(VERBS) / sizeof(VERBS[0]); i++){
+		unsigned int slot = Command::hashVerb(TextView(VERBS[i].verb, strlen(VERBS[i].verb)));
+		if(VERB_TABLE[slot] != 0){
+			std::cerr << "Error: verbs \"" << VERBS[VERB_TABLE[slot] - 1].verb << "\" and \""
+			          << VERBS[i].verb << "\" share command table slot " << slot
+			          << "; Command::hashVerb needs new multipliers" << std::endl;
+			std::abort();
+		}
+		VERB_TABLE[slot] = (unsigned char)(i + 1);
+	}
+	return true;
 }
 
 
 // processCommand
-// - Parse command into verb and object
-// - Extract first word as verb
-// - Rest of line is object
-// - Dispatch to appropriate method based on verb:
+// - Split the line into verb and object (views into it - no copies)
+// - Look the verb up in the perfect-hash table: its slot holds the only
+//   verb that can match, so one case-insensitive compare settles it
+// - Call the handler with the object:
 //   * "go" or "move" → move(object)
+//   * "travel" → travel(object)
 //   * "look" or "l" → look()
-//   * "attack" or "fight" → attack()
+//   * "attack" or "fight" → attack(object)
 //   * "pickup" or "get" or "take" → pickupItem(object)
 //   * "inventory" or "i" → inventory()
 //   * "use" → useItem(object)
@@ -271,125 +1105,99 @@ void Game::run() {
 void Game::processCommand(const std::string& command) {
     // Parse and dispatch command
 
-	//use istringstream to extract parts of command
-	std::istringstream separate(command);
+	//rooms fetched during the command stay in memory until it is done
+	RoomHold hold(world);
 
-	//string to parse command to verb
-	std::string verb;
-
-	//parse command to verb, if empty, return
-	if(!(separate >> verb)) {
+	//split into verb and object, if empty, return
+	Command parsed = Command::parse(command);
+	if(parsed.verb.empty()){
 		return;
 	}
 
-	//string to parse remaining part of command to object
-	std::string object;
-
-	//parse remainder to object
-	std::getline(separate, object);
+	//the one verb that hashes here, if any
+	unsigned char entry = VERB_TABLE[Command::hashVerb(parsed.verb)];
+	if(entry != 0 && parsed.verb.is(VERBS[entry - 1].verb)){
+		(this->*VERBS[entry - 1].handler)(parsed.object);
+	}
 
-	// Trim leading spaces from object
+	//Command doesn't exist, print error message
+	else {
+        	output << "Error: Command does not exist." << std::endl;
+	}
+}
 
-	//find first not space character
-	std::size_t start = object.find_first_not_of(" \t");
 
-	//get rid of the leading spaces
-	if(start != std::string::npos){
-	        object = object.substr(start);
+// Command handlers
+// - Commands that need an object say so if it is missing
+//
+void Game::doGo(const TextView& object) {
+	if(!object.empty()){
+		move(object.str());
 	} else {
-		object.clear();
+		output << "Error: empty object" << std::endl;
 	}
+}
 
-	//Dispatch based on verb
-
-	//if verb is "go" or "move"
-	if(verb == "go" || verb == "move") {
-		//if object exists
-        	if (!object.empty()) {
-			//move object
-        		move(object);
-		//otherwise
-        	} else {
-			//error message
-        		std::cout << "Error: empty object" << std::endl;
-        	}
-
-	//if verb is "look" of "l"
-	} else if (verb == "look" || verb == "l") {
-		//call look
-        	look();
+void Game::doTravel(const TextView& object) {
+	if(!object.empty()){
+		travel(object.str());
+	} else {
+		output << "Error: empty object" << std::endl;
 	}
+}
 
-	//if verb is "attack" or "fight"
-	else if (verb == "attack" || verb == "fight") {
-        	attack();
-	}
+void Game::doLook(const TextView&) {
+	look();
+}
 
-	//if verb is "pickup" or "get" or "take"
-	else if (verb == "pickup" || verb == "get" || verb == "take") {
-		//if object exists
-        	if (!object.empty()) {
-			//pick up object
-        		pickupItem(object);
-		//otherwise
-        	} else {
-			//error message
-        		std::cout << "Error: object does not exist." << std::endl;
-        	}
-	}
+void Game::doAttack(const TextView& object) {
+	attack(object.str());
+}
 
-	//if verb is "inventory" or "i"
-	else if (verb == "inventory" || verb == "i") {
-		//call inventory
-        	inventory();
+void Game::doPickup(const TextView& object) {
+	if(!object.empty()){
+		pickupItem(object.str());
+	} else {
+		output << "Error: object does not exist." << std::endl;
 	}
+}
 
-	//if verb is "use"
-	else if (verb == "use") {
-		//if object exists
-        	if (!object.empty()) {
-			//use object
-        		useItem(object);
-		//otherwise
-        	} else {
-			//error message
-        		std::cout << "Error: object does not exist." << std::endl;
-        	}
-	}
+void Game::doInventory(const TextView&) {
+	inventory();
+}
 
-	//if verb is "equip" or "e"
-	else if (verb == "equip" || verb == "e") {
-        	if (!object.empty()) {
-        		equip(object);
-        	} else {
-        		std::cout << "Error: object does not exist." << std::endl;
-        	}
+void Game::doUse(const TextView& object) {
+	if(!object.empty()){
+		useItem(object.str());
+	} else {
+		output << "Error: object does not exist." << std::endl;
 	}
+}
 
-	//if verb is "stats"
-	else if (verb == "stats") {
-		//display stats of player
-        	player->displayStats();
+void Game::doEquip(const TextView& object) {
+	if(!object.empty()){
+		equip(object.str());
+	} else {
+		output << "Error: object does not exist." << std::endl;
 	}
+}
 
-	//if verb is "help" or "h" or "?"
-	else if (verb == "help" || verb == "h" || verb == "?") {
-		//call help
-	        help();
-	}
+void Game::doStats(const TextView&) {
+	player->displayStats(output);
+}
 
-	//if verb is "quit" or "exit"
-	else if (verb == "quit" || verb == "exit") {
-		//print message and leave by setting game_over to true
-        	std::cout << "Exiting game..." << std::endl;
-        	game_over = true;
-	}
+void Game::doHelp(const TextView&) {
+	help();
+}
 
-	//Command doesn't exist, print error message
-	else {
-        	std::cout << "Error: Command does not exist." << std::endl;
-	}
+void Game::doSave(const TextView&) {
+	saveGame(true);
+}
 
+void Game::doQuit(const TextView&) {
+	//print message and leave by setting game_over to true
+	output << "Exiting game..." << std::endl;
+	game_over = true;
 }
 
 
@@ -409,7 +1217,7 @@ void Game::move(const std::string& direction) {
 	//if monster is in the room
 	if(current_room->hasMonster()){
 		//path is blocked. print message and return
-		std::cout << "You cannpt leave while a monster blocks your path!" << std::endl;
+		output << "You cannot leave while a monster blocks your path!" << std::endl;
 		return;
 	}
 
@@ -419,10 +1227,10 @@ void Game::move(const std::string& direction) {
 	//If exit exists:
 	if(exit){
 		//Update current_room
-		current_room = exit;
+		enterRoom(exit);
 
 		//Display new room
-		current_room->display();
+		current_room->display(output);
 
 		//Mark as visited
 		current_room->markVisited();
@@ -430,186 +1238,334 @@ void Game::move(const std::string& direction) {
 
 	//Otherwise print error message
 	else {
-		std::cout << "You can't go that way!" << std::endl;
+		output << "You can't go that way!" << std::endl;
 	}
 }
 
 
+// enterRoom
+// - Make room the current room (the next save writes it)
+// - The player's room stays pinned in memory
+// - Bring the rooms around it in before the player reaches them
+//
+void Game::enterRoom(Room* room) {
+	markDirty(room->getId());
+	world.pin(room->getId());
+	world.unpin(current_room->getId());
+	current_room = room;
+	world.prefetchNeighbours(current_room->getId());
+}
+
+
+// travel() function
+// - Look up the destination room by name
+// - Ask the pathfinder for the shortest route
+// - Walk it one room at a time, like move() would
+// - Stop early when a monster blocks the way
+//
+void Game::travel(const std::string& room_name) {
+	//same rule as move()
+	if(current_room->hasMonster()){
+		output << "You cannot leave while a monster blocks your path!" << std::endl;
+		return;
+	}
+
+	RoomId target = world.findRoom(room_name);
+	if(target == NO_ROOM){
+		output << "Error: no room called " << room_name << std::endl;
+		return;
+	}
+	if(target == current_room->getId()){
+		output << "You are already there." << std::endl;
+		return;
+	}
+
+	std::vector<RoomId> path;
+	if(!pathfinder.findPath(current_room->getId(), target, path)){
+		output << "You can't find a way there!" << std::endl;
+		return;
+	}
+
+	for(std::size_t i = 1; i < path.size(); i++){
+		//name the exit we take
+		RoomId here = current_room->getId();
+		for(unsigned int e = world.exitBegin(here); e < world.exitEnd(here); e++){
+			if(world.exitTarget(e) == path[i]){
+				output << "You go " << world.directionName(world.exitDirection(e)) << "." << std::endl;
+				break;
+			}
+		}
+
+		//one step at a time, so a long journey doesn't hold every room on it
+		RoomHold hold(world);
+		Room* next = world.getRoom(path[i]);
+		if(next == NULL){
+			output << "Error: room " << path[i] << " is missing" << std::endl;
+			return;
+		}
+		enterRoom(next);
+
+		//a monster ends the journey here
+		if(current_room->hasMonster() && i + 1 < path.size()){
+			output << "Your way is blocked!" << std::endl;
+			break;
+		}
+		if(i + 1 < path.size()){
+			current_room->markVisited();
+		}
+	}
+
+	current_room->display(output);
+	current_room->markVisited();
+}
+
+
 // look() function
 // - Simply display current room
 //
 void Game::look() {
     // Display current room
-	current_room->display();
+	current_room->display(output);
 }
 
 
 // attack() function
 // - Check if monster in room
 // - If no monster, print message and return
+// - If a target was named, check it's there
 // - If monster present, call combat()
 //
-void Game::attack() {
+void Game::attack(const std::string& target) {
     // Attack monster in room
 
 	//Check if monster in room
-	if(current_room->hasMonster()){
-		//If monster present, call combat()
-		combat(current_room->getMonster());
-	} else {
+	if(!current_room->hasMonster()){
 		//If no monster, print message and return
-		std::cout << "Error, no monster present!" << std::endl;
+		output << "Error, no monster present!" << std::endl;
+		return;
 	}
 
+	MonsterGroup& group = current_room->getMonsters();
+	std::size_t first = group.findTarget(target);
+	if(first == MonsterGroup::NOT_FOUND){
+		output << "Error: no monster '" << target << "' here." << std::endl;
+		return;
+	}
+
+	//If monster present, call combat()
+	combat(group, group[first]);
 }
 
 
 // combat
-// - Print "=== COMBAT BEGINS ==="
-// - Combat loop: while both player and monster are alive
-//   - Prompt for player action: attack/use <item>/flee
+// - Print "=== COMBAT BEGINS ===" (and the lineup for a group)
+// - Every monster gets its stream and rolls initiative once
+// - Combat loop: while the player and any monster are alive
+//   - Prompt for player action: attack [target]/use <item>/flee
 //   - If attack:
+//     * Pick the target (named, numbered, or the focus)
 //     * Calculate player damage
 //     * Monster takes damage
-//     * If monster dead:
-//       - Print victory
-//       - Player gains exp and gold
-//       - Get loot from monster
-//       - Add loot to current room
-//       - Check if Dragon 
-//       - Clear monster from room
-//       - Break from loop
+//     * If monster dead: defeat() it
 //   - If use:
 //     * Extract item name from command
 //     * Call player->useItem()
 //   - If flee:
 //     * Print message and break
-//   - Monster turn (if alive):
+//   - Monster turns, highest initiative first:
 //     * Print attack message
 //     * Calculate monster damage
-//     * Player takes damage
+//     * Player takes damage, and the monster's on-hit effect
+//   - Status effects tick (one turn); defeat() any monster they killed
 // - Print "=== COMBAT ENDS ==="
 //
-void Game::combat(Monster* monster) {
+void Game::combat(MonsterGroup& group, Monster* focus) {
     // turn-based combat
 
 	//Print "=== COMBAT BEGINS ==="
-	std::cout << "=== COMBAT BEGINS ===" << std::endl;
+	output << "=== COMBAT BEGINS ===" << std::endl;
+
+	for(std::size_t i = 0; i < group.size(); i++){
+		//a monster nobody has fought yet picks up the latest archetype numbers;
+		//from here on it keeps whatever table it has until the fight is over
+		group[i]->rebalance();
+
+		//monsters roll from a stream keyed by their room and slot, seeded on
+		//first contact (it travels with the monster when its room is paged out)
+		if(!group[i]->isRandomSeeded()){
+			group[i]->seedRandom(rng_seed, STREAM_MONSTERS +
+			                     current_room->getId() * MonsterGroup::MAX_SIZE + i);
+		}
+	}
+	group.rollInitiative();
 
-	//Combat loop: while both player and monster are alive
-	while(player->isAlive() && monster->isAlive()){
+	//show who is here, numbered as targets
+	if(group.liveCount() > 1){
+		group.display(output);
+	}
 
-		//Prompt for player action: attack/use <item>/flee
-		std::string action = "";
-		std::cout << "Your turn, enter an action: ";
-		std::getline(std::cin, action);
+	//Combat loop: while the player and any monster are alive
+	while(player->isAlive() && group.liveCount() > 0){
 
-		//make action lowercase
-		std::transform(action.begin(), action.end(), action.begin(), ::tolower);
+		//Prompt for player action: attack [target]/use <item>/flee
+		std::string action = "";
+		if(!script_mode){
+			output << "Your turn, enter an action: ";
+		}
+		if(!readLine(action, JOURNAL_ACTION)){
+			//input is over: leave the fight, and the game
+			game_over = true;
+			break;
+		}
 
-                //for use condition, exctract use
-                std::string sub = action.substr(0,3);
+		//split into verb and target (any case, no copies)
+		Command parsed = Command::parse(action);
 
 		//if attack
-		if(action == "attack"){
+		if(parsed.verb.is("attack")){
+			//named target, or the focus while it lives, or the first to act
+			std::size_t slot = MonsterGroup::NOT_FOUND;
+			if(!parsed.object.empty()){
+				std::string target = parsed.object.str();
+				slot = group.findTarget(target);
+				if(slot == MonsterGroup::NOT_FOUND){
+					output << "Error: no monster '" << target << "' here." << std::endl;
+					continue;
+				}
+			} else {
+				for(std::size_t i = 0; i < group.size(); i++){
+					if(group[i] == focus){
+						slot = i;
+					}
+				}
+				if(slot == MonsterGroup::NOT_FOUND){
+					slot = group.findTarget("");
+				}
+			}
+			Monster* monster = group[slot];
+			focus = monster;
+
 			//Calculate player damage
 			int playerDamage = player->calculateDamage();
 
 			//Monster takes damage
-			std::cout << "========================================" << std::endl;
-			monster->takeDamage(playerDamage);
-			std::cout << std::endl;
+			output << "========================================" << std::endl;
+			monster->takeDamage(playerDamage, output);
+			output << std::endl;
 
 			//if monster is dead
 			if(!monster->isAlive()){
-				//Print victory
-				std::cout << "VICTORY! You defeated " << monster->getName() << "!" << std::endl;
+				defeat(group, slot);
 
-				//Player gains exp and gold
-				player->gainExperience(monster->getExperienceReward());
-				player->addGold(monster->getGoldReward());
-
-				//Get loot from monster
-				std::vector<Item*> getLoot = monster->dropLoot();
-
-				//Add loot to current room
-				for(int i = 0; i < (int)getLoot.size(); i++){
-					//add each loot item from loot table to toom items
-					current_room->addItem(getLoot[i]);
-				}
-
-				//Check if Dragon
-				if(monster->getName() == "Dragon"){
-					//if Dragon, player won the game, victory = true
-					victory = true;
+				//the rest of the group still gets its turn
+				if(group.liveCount() == 0){
+					break;
 				}
-
-				//Clear monster from room
-				current_room->clearMonster();
-
-				//Break from loop
-				break;
-
 			}
 		}
 
 		//if use
-		else if(sub == "use"){
+		else if(parsed.verb.is("use")){
 			//Parse and call use Item with processCommand
-			std::cout << "========================================" << std::endl;
+			output << "========================================" << std::endl;
 			processCommand(action);
-			std::cout << std::endl;
+			output << std::endl;
 		}
 
 		//if flee
-		else if(action == "flee"){
+		else if(parsed.verb.is("flee") && parsed.object.empty()){
 			//print message
-			std::cout << "Fleeing from combat..." << std::endl;
+			output << "Fleeing from combat..." << std::endl;
 
 			//break from loop
 			break;
 		}
 
-		//Monster's turn
-		//print monster attack message
-		std::cout << monster->getAttackMessage() << std::endl;
+		//Monsters' turns, highest initiative first
+		std::size_t order[MonsterGroup::MAX_SIZE];
+		std::size_t acting = group.turnOrder(order);
+		for(std::size_t i = 0; i < acting && player->isAlive(); i++){
+			Monster* monster = group[order[i]];
+
+			//print monster attack message
+			output << monster->getAttackMessage() << std::endl;
 
-		//calculate monster damage
-		int monstDamage = monster->getAttack();
+			//calculate monster damage (roll, plus the dragon's fire)
+			int monstDamage = monster->calculateDamage();
+
+			//player takes damage, and whatever it inflicts (the dragon's burn)
+			player->takeDamage(monstDamage, output);
+			effects.apply(*player, monster->getOnHit());
+		}
 
-		//player takes damage
-		player->takeDamage(monstDamage);
-		std::cout << "========================================" << std::endl;
+		//end of the round: status effects tick, and may finish monsters off
+		effects.advance();
+		for(std::size_t i = group.size(); i-- > 0; ){
+			if(!group[i]->isAlive()){
+				defeat(group, i);
+			}
+		}
+		output << "========================================" << std::endl;
 	}
 
 	//Print "=== COMBAT ENDS ==="
-	std::cout << "=== COMBAT ENDS ===" << std::endl;
+	output << "=== COMBAT ENDS ===" << std::endl;
+}
+
+
+// defeat
+// - A member of the group has died (a blow or an effect):
+//   - Print victory
+//   - Player gains exp and gold
+//   - Get loot from monster, add it to current room
+//   - Check if Dragon
+//   - Remove it from the group (the last member takes its slot)
+//
+void Game::defeat(MonsterGroup& group, std::size_t slot) {
+	Monster* monster = group[slot];
+
+	//Print victory
+	output << "VICTORY! You defeated " << monster->getName() << "!" << std::endl;
+
+	//Player gains exp and gold
+	player->gainExperience(monster->getExperienceReward(), output);
+	player->addGold(monster->getGoldReward());
+
+	//Move loot from monster straight onto the room floor
+	monster->dropLoot(current_room->getItemBag());
+
+	//Check if Dragon
+	if(monster->getArchetype() == ARCHETYPE_DRAGON){
+		//if Dragon, player won the game, victory = true
+		victory = true;
+	}
+
+	//Remove it from the group (O(1))
+	group.removeAt(slot);
 }
 
 
 // pickupItem
-// - Get item from current room
-// - If exists:
-//   - Add to player inventory
-//   - Remove from room (ownership transfer!)
-// - Otherwise print error
+// - "all" (any case): move every item in the room into the inventory
+// - Otherwise move the named item from room to player in one transfer
+//   (ownership moves with it)
+// - If the room doesn't have it print error
 //
 void Game::pickupItem(const std::string& item_name) {
     // Pick up item from room
 
-	//Get item from current room
-	Item* pickup = current_room->getItem(item_name);
-
-	//if exists:
-	if(pickup){
-		//Add to player inventory
-		player->addItem(pickup);
+	//take everything on the floor
+	if(NameIndex::equalsIgnoreCase(item_name.data(), item_name.size(), "all", 3)){
+		if(player->pickUpAll(current_room->getItemBag(), output) == 0){
+			output << "Error: nothing to pick up." << std::endl;
+		}
+		return;
+	}
 
-		//Remove from room (ownership transfer!)
-		current_room->removeItem(item_name);
-	} else {
+	//Move item from current room to player inventory
+	if(player->pickUp(current_room->getItemBag(), item_name, output) == NULL){
 		//Otherwise print error
-		std::cout << "Error: item not found." << std::endl;
+		output << "Error: item not found." << std::endl;
 	}
 }
 
@@ -618,7 +1574,7 @@ void Game::pickupItem(const std::string& item_name) {
 //
 void Game::inventory() {
     // Display player inventory
-	player->displayInventory();
+	player->displayInventory(output);
 }
 
 
@@ -627,16 +1583,16 @@ void Game::inventory() {
 //
 void Game::useItem(const std::string& item_name) {
     // Use item from inventory
-	player->useItem(item_name);
+	player->useItem(item_name, effects, output);
 }
 
 
 // equip
 // - Get item from player inventory
 // - Check if item exists
-// - Check item type:
-//   - If "Weapon": call player->equipWeapon()
-//   - If "Armor": call player->equipArmor()
+// - Switch on the item's type tag:
+//   - ITEM_WEAPON: call player->equipWeapon()
+//   - ITEM_ARMOR: call player->equipArmor()
 //   - Otherwise: print error (can't equip consumables)
 //
 void Game::equip(const std::string& item_name) {
@@ -647,26 +1603,27 @@ void Game::equip(const std::string& item_name) {
 
 	//Check if item exists
 	if(equipItem){
-		//If "Weapon"
-		if(equipItem->getType() == "Weapon") {
-			//call player->equipWeapon()
-			player->equipWeapon(equipItem->getName());
+		switch(equipItem->getKind()){
+		//If weapon, call player->equipWeapon()
+		case ITEM_WEAPON:
+			player->equipWeapon(equipItem->getName(), output);
+			break;
 
-		//If "Armor"
-		} else if(equipItem->getType() == "Armor") {
-			//call player->equipArmor()
-			player->equipArmor(equipItem->getName());
+		//If armor, call player->equipArmor()
+		case ITEM_ARMOR:
+			player->equipArmor(equipItem->getName(), output);
+			break;
 
-		//otherwise
-		} else {
-			//print error message
-			std::cout << "Can't equip item. Your item type is: " << equipItem->getType() << std::endl;
+		//otherwise print error message
+		default:
+			output << "Can't equip item. Your item type is: " << equipItem->getType() << std::endl;
+			break;
 		}
 
 	//if item isn't in inventory
 	} else {
 		//print error message
-		std::cout << "Error: item not present in inventory." << std::endl;
+		output << "Error: item not present in inventory." << std::endl;
 	}
 
 }
@@ -677,32 +1634,36 @@ void Game::equip(const std::string& item_name) {
 // - Format nicely with headers
 // - Commands:
 //   * go <direction> - Move
+//   * travel <room> - Walk to a room by name
 //   * look - Look around
-//   * attack - Attack monster
-//   * pickup <item> - Pick up item
+//   * attack [target] - Attack a monster (name, number)
+//   * pickup <item> - Pick up item (or "all")
 //   * inventory - Show inventory
 //   * use <item> - Use consumable
 //   * equip <item> - Equip weapon/armor
 //   * stats - Show character stats
 //   * help - Show this help
+//   * save - Save the game
 //   * quit - Exit game
 //
 void Game::help() {
     // Display help message
 
 	//Print all available commands with descriptions
-        std::cout << "========================================" << std::endl;
-	std::cout << "Commands:" << std::endl;
-	std::cout << " * go <direction> - Move" << std::endl;
-	std::cout << " * look - Look around" << std::endl;
-	std::cout << " * attack - Attack monster" << std::endl;
-	std::cout << " * pickup <item> - Pick up item" << std::endl;
-	std::cout << " * inventory - Show inventory" << std::endl;
-	std::cout << " * use <item> - Use consumable" << std::endl;
-	std::cout << " * equip <item> - Equip weapon/armor" << std::endl;
-	std::cout << " * stats - Show character stats" << std::endl;
-	std::cout << " * help - Show this help" << std::endl;
-	std::cout << " * quit - Exit game" << std::endl;
-	std::cout << "========================================" << std::endl;
+        output << "========================================" << std::endl;
+	output << "Commands:" << std::endl;
+	output << " * go <direction> - Move" << std::endl;
+	output << " * travel <room> - Walk to a room by name" << std::endl;
+	output << " * look - Look around" << std::endl;
+	output << " * attack [target] - Attack a monster (name, number)" << std::endl;
+	output << " * pickup <item> - Pick up item (or 'all')" << std::endl;
+	output << " * inventory - Show inventory" << std::endl;
+	output << " * use <item> - Use consumable" << std::endl;
+	output << " * equip <item> - Equip weapon/armor" << std::endl;
+	output << " * stats - Show character stats" << std::endl;
+	output << " * help - Show this help" << std::endl;
+	output << " * save - Save the game" << std::endl;
+	output << " * quit - Exit game" << std::endl;
+	output << "========================================" << std::endl;
 
 }
@@ -1,16 +1,71 @@
 #include "Item.h"
+#include "Serializer.h"
+#include "ItemCatalog.h"
 
 // ============================================================================
 // Base Item class implementation
 // ============================================================================
 
-// Item constructor
-// - Use initializer list to initialize all member variables
-// - Parameters map directly to member variables
+// Item constructors
+// - The data is interned in the catalog; identical items share one prototype
+// - Or hand over a prototype that is already interned
 //
 Item::Item(const std::string& name, const std::string& description,
-           const std::string& type, int value)
-    : name(name), description(description), type(type), value(value) {
+           ItemKind kind, int value)
+    : proto(ItemCatalog::instance().intern(name, description, kind, value)) {
+}
+
+Item::Item(const ItemPrototype* proto) : proto(proto) {
+}
+
+
+// ItemPrototype::create
+// - New instance of the derived class matching the prototype's kind
+//
+Item* ItemPrototype::create() const {
+	switch(kind){
+	case ITEM_WEAPON: return new Weapon(this);
+	case ITEM_ARMOR: return new Armor(this);
+	case ITEM_CONSUMABLE: return new Consumable(this);
+	}
+	return NULL;
+}
+
+
+// kindName
+// - Display name of a type tag
+//
+const char* Item::kindName(ItemKind kind) {
+	switch(kind){
+	case ITEM_WEAPON: return "Weapon";
+	case ITEM_ARMOR: return "Armor";
+	case ITEM_CONSUMABLE: return "Consumable";
+	}
+	return "Item";
+}
+
+
+// defaultSlot
+// - Weapons in the hand, armor on the body, consumables nowhere
+//
+EquipSlot Item::defaultSlot(ItemKind kind) {
+	switch(kind){
+	case ITEM_WEAPON: return EQUIP_WEAPON;
+	case ITEM_ARMOR: return EQUIP_BODY;
+	case ITEM_CONSUMABLE: return EQUIP_NONE;
+	}
+	return EQUIP_NONE;
+}
+
+
+// slotName
+// - Name of an equipment slot, as in the item catalog
+//
+const char* Item::slotName(EquipSlot slot) {
+	static const char* const NAMES[EQUIP_SLOT_COUNT] = {
+		"weapon", "body", "head", "hands", "feet", "shield"
+	};
+	return slot < EQUIP_SLOT_COUNT ? NAMES[slot] : "none";
 }
 
 
@@ -28,17 +83,17 @@ Item::~Item() {
 //     Description text
 //     Value: X
 //
-void Item::displayInfo() const {
+void Item::displayInfo(std::ostream& out) const {
     // Display item information
 
 	//print object type + name
-	std::cout << "[ITEM] " << name << std::endl;
+	out << "[ITEM] " << getName() << std::endl;
 
 	//print description
-	std::cout << "  " << description << std::endl;
+	out << "  " << getDescription() << std::endl;
 
 	//print value
-	std::cout << "  Value: " << value << std::endl;
+	out << "  Value: " << getValue() << std::endl;
 }
 
 
@@ -46,11 +101,11 @@ void Item::displayInfo() const {
 // - One line format: "Name (Type)"
 // - Example: "Iron Sword (Weapon)"
 //
-void Item::displayBrief() const {
+void Item::displayBrief(std::ostream& out) const {
     // Display brief item info
 
 	//print name and type
-	std::cout << name << " (" << type << ")" << std::endl;
+	out << getName() << " (" << getType() << ")" << std::endl;
 }
 
 
@@ -60,13 +115,12 @@ void Item::displayBrief() const {
 
 // Weapon constructor
 // - MUST call base Item constructor using initializer list
-// - Type should be "Weapon"
-// - Value is the damage bonus
-// - Also initialize damage_bonus member
-// - Format: Weapon::Weapon(...) : Item(name, desc, "Weapon", damage), damage_bonus(damage) { }
+// - Kind is ITEM_WEAPON
+// - Value is the damage bonus (kept in the shared prototype)
+// - Format: Weapon::Weapon(...) : Item(name, desc, ITEM_WEAPON, damage) { }
 //
 Weapon::Weapon(const std::string& name, const std::string& description, int damage)
-    : Item(name, description, "Weapon", damage), damage_bonus(damage) {
+    : Item(name, description, ITEM_WEAPON, damage) {
 }
 
 
@@ -78,17 +132,17 @@ Weapon::Weapon(const std::string& name, const std::string& description, int dama
 //     Description
 //     Damage Bonus: +X
 //
-void Weapon::displayInfo() const {
+void Weapon::displayInfo(std::ostream& out) const {
     // Display weapon-specific information
 
 	//print type + name
-	std::cout << "[WEAPON] " << getName() << std::endl;
+	out << "[WEAPON] " << getName() << std::endl;
 
 	//print description
-	std::cout << "  " << getDescription() << std::endl;
+	out << "  " << getDescription() << std::endl;
 
 	//print damage bonus
-	std::cout << "  Damage Bonus: +" << getDamageBonus() << std::endl;
+	out << "  Damage Bonus: +" << getDamageBonus() << std::endl;
 }
 
 
@@ -98,12 +152,11 @@ void Weapon::displayInfo() const {
 
 //  Armor constructor
 // - MUST call base Item constructor using initializer list
-// - Type should be "Armor"
-// - Value is the defense bonus
-// - Also initialize defense_bonus member
+// - Kind is ITEM_ARMOR
+// - Value is the defense bonus (kept in the shared prototype)
 //
 Armor::Armor(const std::string& name, const std::string& description, int defense)
-    : Item(name, description, "Armor", defense), defense_bonus(defense) {
+    : Item(name, description, ITEM_ARMOR, defense) {
 }
 
 
@@ -113,18 +166,22 @@ Armor::Armor(const std::string& name, const std::string& description, int defens
 //   [ARMOR] ArmorName
 //     Description
 //     Defense Bonus: +X
+//     Slot: body
 //
-void Armor::displayInfo() const {
+void Armor::displayInfo(std::ostream& out) const {
     // Display armor-specific information
 
 	//print type and name
-	std::cout << "[ARMOR] " << getName() << std::endl;
+	out << "[ARMOR] " << getName() << std::endl;
 
 	//print description
-        std::cout << "  " << getDescription() << std::endl;
+        out << "  " << getDescription() << std::endl;
 
 	//print defense bonus
-        std::cout << "  Defense Bonus: +" << getDefenseBonus() << std::endl;
+        out << "  Defense Bonus: +" << getDefenseBonus() << std::endl;
+
+	//print where it is worn
+	out << "  Slot: " << slotName(getSlot()) << std::endl;
 }
 
 
@@ -134,14 +191,13 @@ void Armor::displayInfo() const {
 
 // Consumable constructor
 // - MUST call base Item constructor using initializer list
-// - Type should be "Consumable"
-// - Value is the healing amount
-// - Initialize healing_amount and set used to false
+// - Kind is ITEM_CONSUMABLE
+// - Value is the healing amount (kept in the shared prototype)
+// - Set used to false - the one thing each potion keeps for itself
 //
 Consumable::Consumable(const std::string& name, const std::string& description, 
                        int healing)
-    : Item(name, description, "Consumable", healing), 
-      healing_amount(healing), used(false) {
+    : Item(name, description, ITEM_CONSUMABLE, healing), used(false) {
 }
 
 
@@ -151,18 +207,25 @@ Consumable::Consumable(const std::string& name, const std::string& description,
 //   [CONSUMABLE] ConsumableName
 //     Description
 //     Restores: X HP
+//     Effect: regenerating (6 turns)   [if it has one]
 //
-void Consumable::displayInfo() const {
+void Consumable::displayInfo(std::ostream& out) const {
     // Display consumable-specific information
 
 	//print type and name
-	std::cout << "[CONSUMABLE] " << getName() << std::endl;
+	out << "[CONSUMABLE] " << getName() << std::endl;
 
 	//print description
-	std::cout << "  " << getDescription() << std::endl;
+	out << "  " << getDescription() << std::endl;
 
 	//print healing amount
-	std::cout << "  Restores: " << getHealingAmount() << " HP" << std::endl;
+	out << "  Restores: " << getHealingAmount() << " HP" << std::endl;
+
+	//print effect
+	if(!getEffect().empty()){
+		out << "  Effect: " << StatusEffects::describe(getEffect().kind)
+		          << " (" << getEffect().turns << " turns)" << std::endl;
+	}
 }
 
 
@@ -170,21 +233,70 @@ void Consumable::displayInfo() const {
 // - Check if already used
 // - If not used: print message and set used to true
 // - If already used: print error message
-// - Format: "Used ItemName! Restored X HP."
+// - Format: "Used ItemName! Restored X HP." (no "Restored" if X is 0)
 //
-void Consumable::use() {
+void Consumable::use(std::ostream& out) {
     // Implement use logic
 
 	//Check if already used
 	if(isUsed() == true){
 		//If already used: print error message
-		std::cout << "Error: " << getName() << " already used!" << std::endl;
+		out << "Error: " << getName() << " already used!" << std::endl;
 	//otherwise
 	} else {
 		//use item (used = true)
 		used = true;
 
-		//print success message
-		std::cout << "Used " << getName() << "! Restored " << getHealingAmount() << " HP." << std::endl;
+		//print success message (effect-only consumables restore nothing)
+		out << "Used " << getName() << "!";
+		if(getHealingAmount() > 0){
+			out << " Restored " << getHealingAmount() << " HP.";
+		}
+		out << std::endl;
+	}
+}
+
+
+// ============================================================================
+// Serialization
+// ============================================================================
+
+// serialize
+// - Everything in the prototype: type tag, name, description, value,
+//   slot and effect
+//
+void Item::serialize(ByteWriter& out) const {
+	out.putU8((uint8_t)getKind());
+	out.putString(getName());
+	out.putString(getDescription());
+	out.putI32(getValue());
+	out.putU8((uint8_t)proto->slot);
+	out.putU8((uint8_t)proto->effect.kind);
+	out.putI32(proto->effect.power);
+	out.putU32(proto->effect.turns);
+}
+
+
+// deserialize
+// - Intern the data again, so a paged-in room reuses the prototypes and
+//   a shield stays a shield, a tonic keeps its effect
+// - Returns NULL if the data is truncated or out of range
+//
+Item* Item::deserialize(ByteReader& in) {
+	uint8_t tag = in.getU8();
+	std::string item_name = in.getString();
+	std::string item_desc = in.getString();
+	int item_value = in.getI32();
+	uint8_t slot = in.getU8();
+	EffectSpec effect;
+	uint8_t effect_kind = in.getU8();
+	effect.power = in.getI32();
+	effect.turns = in.getU32();
+	if(!in.ok() || tag > ITEM_CONSUMABLE || slot > EQUIP_NONE || effect_kind >= EFFECT_KIND_COUNT){
+		return NULL;
 	}
+	effect.kind = (EffectKind)effect_kind;
+
+	return ItemCatalog::instance().intern(item_name, item_desc, (ItemKind)tag, item_value,
+	                                      (EquipSlot)slot, effect)->create();
 }
@@ -0,0 +1,161 @@
+#include "ItemBag.h"
+#include "Item.h"
+#include <algorithm>
+
+// ItemBag constructor
+ItemBag::ItemBag() {
+}
+
+
+// add
+// - Append to the list and index the (folded) name once
+//
+void ItemBag::add(Item* item) {
+	if(item == NULL){
+		return;
+	}
+	index.insert(item->getName(), items.size());
+	items.push_back(item);
+}
+
+
+// find
+// - Hash lookup, no copies of the name
+//
+Item* ItemBag::find(const char* name, std::size_t len) const {
+	std::size_t pos = index.find(name, len);
+	return pos == NameIndex::NOT_FOUND ? NULL : items[pos];
+}
+
+
+// take
+// - Find by name, then remove that position
+//
+Item* ItemBag::take(const std::string& name) {
+	std::size_t pos = index.find(name);
+	if(pos == NameIndex::NOT_FOUND){
+		return NULL;
+	}
+	Item* item = items[pos];
+	removeAt(pos);
+	return item;
+}
+
+
+// remove
+// - Find this exact item among the entries with its name
+//
+bool ItemBag::remove(Item* item) {
+	const std::string& name = item->getName();
+	std::size_t cursor = 0;
+	for(;;){
+		std::size_t pos = index.findNext(name.data(), name.size(), cursor);
+		if(pos == NameIndex::NOT_FOUND){
+			return false;
+		}
+		if(items[pos] == item){
+			removeAt(pos);
+			return true;
+		}
+	}
+}
+
+
+// removeAt - unindex the item, then close the gap
+void ItemBag::removeAt(std::size_t pos) {
+	const std::string& name = items[pos]->getName();
+	index.erase(name.data(), name.size(), pos);
+	fillGap(pos);
+}
+
+
+// fillGap
+// - The item at pos is gone from the index: move the last item (and its
+//   index entry) into its place
+//
+void ItemBag::fillGap(std::size_t pos) {
+	std::size_t last = items.size() - 1;
+	if(pos != last){
+		const std::string& moved = items[last]->getName();
+		index.update(moved.data(), moved.size(), last, pos);
+		items[pos] = items[last];
+	}
+	items.pop_back();
+}
+
+
+// makeRoom
+// - Capacity for `more` items, doubling as push_back would so that a run
+//   of transfers into one bag stays linear
+//
+void ItemBag::makeRoom(std::size_t more) {
+	std::size_t needed = items.size() + more;
+	if(needed > items.capacity()){
+		items.reserve(std::max(2 * items.capacity(), needed));
+	}
+	index.reserve(index.size() + more);
+}
+
+
+// transfer
+// - One lookup here, then make room in the other bag
+// - After that nothing can fail, so the move is all-or-nothing
+//
+Item* ItemBag::transfer(ItemBag& to, const char* name, std::size_t len) {
+	std::size_t pos = index.find(name, len);
+	if(pos == NameIndex::NOT_FOUND || &to == this){
+		return NULL;
+	}
+	Item* item = items[pos];
+	to.makeRoom(1);
+
+	const std::string& key = item->getName();
+	index.moveTo(to.index, key.data(), key.size(), pos, to.items.size());
+	to.items.push_back(item);
+	fillGap(pos);
+	return item;
+}
+
+
+// transferAll
+// - Into an empty bag: just swap the list and the index
+// - Otherwise make room for everything, then move each entry across
+//   (keeps listing order)
+//
+std::size_t ItemBag::transferAll(ItemBag& to) {
+	std::size_t moved = items.size();
+	if(moved == 0 || &to == this){
+		return 0;
+	}
+	if(to.empty()){
+		items.swap(to.items);
+		index.swap(to.index);
+		return moved;
+	}
+
+	to.makeRoom(moved);
+	std::size_t base = to.items.size();
+	for(std::size_t i = 0; i < moved; i++){
+		const std::string& name = items[i]->getName();
+		index.moveTo(to.index, name.data(), name.size(), i, base + i);
+	}
+	to.items.insert(to.items.end(), items.begin(), items.end());
+	items.clear();
+	return moved;
+}
+
+
+// clear - forget the items without deleting them
+void ItemBag::clear() {
+	items.clear();
+	index.clear();
+}
+
+
+// deleteAll - for owners: delete every item, then forget them
+void ItemBag::deleteAll() {
+	for(std::size_t i = 0; i < items.size(); i++){
+		delete items[i];
+	}
+	clear();
+}
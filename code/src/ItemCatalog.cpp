@@ -0,0 +1,311 @@
+#include "ItemCatalog.h"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+
+// ItemCatalog constructor
+// - Defines the built-in items that monsters drop and the player starts with
+//
+ItemCatalog::ItemCatalog() {
+	pthread_mutex_init(&lock, NULL);
+
+	define("Rusty Dagger", "Does minor damage", ITEM_WEAPON, 2);
+	define("Iron Sword", "A sturdy blade", ITEM_WEAPON, 5);
+	define("Old Sword", "Causes 10 HP of damage", ITEM_WEAPON, 10);
+	define("Dragon Slayer Sword", "Causes 10 HP of damage", ITEM_WEAPON, 10);
+	define("Chain Mail", "Protective armor", ITEM_ARMOR, 3);
+	define("Dragon Scale Armor", "Defense +8 HP", ITEM_ARMOR, 8);
+	define("Bread", "A hearty food", ITEM_CONSUMABLE, 5);
+	define("Small Potion", "Restores 10 HP", ITEM_CONSUMABLE, 10);
+	define("Health Potion", "Restores health", ITEM_CONSUMABLE, 30);
+	define("Greater Health Potion", "Heals 100 HP", ITEM_CONSUMABLE, 100);
+}
+
+
+// ItemCatalog destructor - runs at exit, after every Game is gone
+ItemCatalog::~ItemCatalog() {
+	for(std::size_t i = 0; i < prototypes.size(); i++){
+		delete prototypes[i];
+	}
+	pthread_mutex_destroy(&lock);
+}
+
+
+// instance
+// - Built on first use (function statics are initialized thread-safely)
+//
+ItemCatalog& ItemCatalog::instance() {
+	static ItemCatalog catalog;
+	return catalog;
+}
+
+
+// hashContents
+// - FNV-1a over kind, value, slot, effect, name and description
+//   (case-sensitive: "potion" and "Potion" are different data)
+//
+unsigned int ItemCatalog::hashContents(const std::string& name, const std::string& description,
+                                       ItemKind kind, int value, EquipSlot equip, const EffectSpec& effect) {
+	unsigned int h = 2166136261u;
+	h = (h ^ (unsigned int)kind) * 16777619u;
+	h = (h ^ (unsigned int)value) * 16777619u;
+	h = (h ^ (unsigned int)equip) * 16777619u;
+	h = (h ^ (unsigned int)effect.kind) * 16777619u;
+	h = (h ^ (unsigned int)effect.power) * 16777619u;
+	h = (h ^ effect.turns) * 16777619u;
+	for(std::size_t i = 0; i < name.size(); i++){
+		h = (h ^ (unsigned char)name[i]) * 16777619u;
+	}
+	h = (h ^ 0xffu) * 16777619u;   //separator so "ab"+"c" != "a"+"bc"
+	for(std::size_t i = 0; i < description.size(); i++){
+		h = (h ^ (unsigned char)description[i]) * 16777619u;
+	}
+	return h;
+}
+
+
+// growTable
+// - Double the content table (minimum 64 slots) and reinsert every prototype
+// - Called with the lock held
+//
+void ItemCatalog::growTable() {
+	std::size_t new_size = table.empty() ? 64 : table.size() * 2;
+	table.assign(new_size, 0);
+	for(std::size_t i = 0; i < prototypes.size(); i++){
+		const ItemPrototype* p = prototypes[i];
+		std::size_t slot = hashContents(p->name, p->description, p->kind, p->value, p->slot, p->effect) & (new_size - 1);
+		while(table[slot] != 0){
+			slot = (slot + 1) & (new_size - 1);
+		}
+		table[slot] = i + 1;
+	}
+}
+
+
+// internLocked
+// - Index of the prototype with exactly this data, adding it if new
+// - EQUIP_NONE means the kind's usual slot
+// - Called with the lock held
+//
+std::size_t ItemCatalog::internLocked(const std::string& name, const std::string& description,
+                                      ItemKind kind, int value, EquipSlot equip, const EffectSpec& effect) {
+	if(equip == EQUIP_NONE){
+		equip = Item::defaultSlot(kind);
+	}
+	unsigned int h = hashContents(name, description, kind, value, equip, effect);
+	std::size_t slot = 0;
+	if(!table.empty()){
+		slot = h & (table.size() - 1);
+		while(table[slot] != 0){
+			const ItemPrototype* p = prototypes[table[slot] - 1];
+			if(p->kind == kind && p->value == value && p->slot == equip &&
+			   p->effect.kind == effect.kind && p->effect.power == effect.power &&
+			   p->effect.turns == effect.turns &&
+			   p->name == name && p->description == description){
+				return table[slot] - 1;
+			}
+			slot = (slot + 1) & (table.size() - 1);
+		}
+	}
+
+	//keep the content table under 50% full
+	if((prototypes.size() + 1) * 2 > table.size()){
+		growTable();
+		slot = h & (table.size() - 1);
+		while(table[slot] != 0){
+			slot = (slot + 1) & (table.size() - 1);
+		}
+	}
+
+	ItemPrototype* proto = new ItemPrototype;
+	proto->name = name;
+	proto->description = description;
+	proto->kind = kind;
+	proto->value = value;
+	proto->slot = equip;
+	proto->effect = effect;
+	prototypes.push_back(proto);
+	std::size_t index = prototypes.size() - 1;
+	table[slot] = index + 1;
+
+	if(by_name.find(name) == NameIndex::NOT_FOUND){
+		by_name.insert(name, index);
+	}
+	return index;
+}
+
+
+// intern - locked wrapper
+const ItemPrototype* ItemCatalog::intern(const std::string& name, const std::string& description,
+                                         ItemKind kind, int value, EquipSlot slot, const EffectSpec& effect) {
+	pthread_mutex_lock(&lock);
+	const ItemPrototype* proto = prototypes[internLocked(name, description, kind, value, slot, effect)];
+	pthread_mutex_unlock(&lock);
+	return proto;
+}
+
+
+// define
+// - Intern, then point the name at this prototype
+// - Items already made from an older definition keep their old data
+//
+const ItemPrototype* ItemCatalog::define(const std::string& name, const std::string& description,
+                                         ItemKind kind, int value, const EffectSpec& effect, EquipSlot slot) {
+	pthread_mutex_lock(&lock);
+	std::size_t index = internLocked(name, description, kind, value, slot, effect);
+	std::size_t old = by_name.find(name);
+	if(old != index){
+		if(old != NameIndex::NOT_FOUND){
+			by_name.erase(name, old);
+		}
+		by_name.insert(name, index);
+	}
+	const ItemPrototype* proto = prototypes[index];
+	pthread_mutex_unlock(&lock);
+	return proto;
+}
+
+
+// find - by name, case-insensitive
+const ItemPrototype* ItemCatalog::find(const std::string& name) {
+	pthread_mutex_lock(&lock);
+	std::size_t index = by_name.find(name);
+	const ItemPrototype* proto = (index == NameIndex::NOT_FOUND) ? NULL : prototypes[index];
+	pthread_mutex_unlock(&lock);
+	return proto;
+}
+
+
+// create
+// - New Weapon / Armor / Consumable from a named prototype
+//
+Item* ItemCatalog::create(const std::string& name) {
+	const ItemPrototype* proto = find(name);
+	if(proto == NULL){
+		std::cout << "Error: no item named " << name << " in the catalog" << std::endl;
+		return NULL;
+	}
+	return proto->create();
+}
+
+
+// trim - strip spaces and tabs from both ends
+static std::string trim(const std::string& s) {
+	std::size_t begin = s.find_first_not_of(" \t\r");
+	if(begin == std::string::npos){
+		return "";
+	}
+	std::size_t end = s.find_last_not_of(" \t\r");
+	return s.substr(begin, end - begin + 1);
+}
+
+
+// parseKind - weapon / armor / consumable, any case
+static bool parseKind(const std::string& word, ItemKind& kind) {
+	static const ItemKind KINDS[] = { ITEM_WEAPON, ITEM_ARMOR, ITEM_CONSUMABLE };
+	for(std::size_t i = 0; i < sizeof(KINDS) / sizeof(KINDS[0]); i++){
+		const char* name = Item::kindName(KINDS[i]);
+		if(NameIndex::equalsIgnoreCase(word.data(), word.size(), name, std::string(name).size())){
+			kind = KINDS[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// parseSlot - weapon / body / head / ..., any case
+static bool parseSlot(const std::string& word, EquipSlot& slot) {
+	for(int i = 0; i < EQUIP_SLOT_COUNT; i++){
+		const char* name = Item::slotName((EquipSlot)i);
+		if(NameIndex::equalsIgnoreCase(word.data(), word.size(), name, std::string(name).size())){
+			slot = (EquipSlot)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// loadFile
+// - Parse every line first, so a bad file changes nothing
+// - Then define each entry (later lines win over earlier ones and built-ins)
+//
+bool ItemCatalog::loadFile(const std::string& path) {
+	std::ifstream in(path.c_str());
+	if(!in){
+		std::cout << "Error: cannot open item catalog " << path << std::endl;
+		return false;
+	}
+
+	std::vector<ItemPrototype> entries;
+	std::string line;
+	int line_number = 0;
+	while(std::getline(in, line)){
+		line_number++;
+		std::size_t comment = line.find('#');
+		if(comment != std::string::npos){
+			line.erase(comment);
+		}
+		if(trim(line).empty()){
+			continue;
+		}
+
+		//split into four fields (five with an effect or slot)
+		std::vector<std::string> fields;
+		std::size_t start = 0;
+		for(;;){
+			std::size_t bar = line.find('|', start);
+			fields.push_back(trim(line.substr(start, bar == std::string::npos ? std::string::npos : bar - start)));
+			if(bar == std::string::npos){ break; }
+			start = bar + 1;
+		}
+
+		ItemPrototype entry;
+		char* end = NULL;
+		bool ok = (fields.size() == 4 || fields.size() == 5) && parseKind(fields[0], entry.kind) && !fields[1].empty();
+		if(ok){
+			entry.value = (int)strtol(fields[3].c_str(), &end, 10);
+			ok = !fields[3].empty() && *end == '\0';
+		}
+		if(!ok){
+			std::cout << "Error: " << path << ":" << line_number
+			          << ": expected 'kind | name | description | value [| effect or slot]'" << std::endl;
+			return false;
+		}
+		//the fifth field is a consumable's effect or an armor's slot
+		std::string error;
+		entry.slot = EQUIP_NONE;
+		if(fields.size() == 5 && entry.kind == ITEM_CONSUMABLE && !EffectSpec::parse(fields[4], entry.effect, error)){
+			std::cout << "Error: " << path << ":" << line_number << ": " << error << std::endl;
+			return false;
+		}
+		if(fields.size() == 5 && entry.kind == ITEM_ARMOR &&
+		   (!parseSlot(fields[4], entry.slot) || entry.slot == EQUIP_WEAPON)){
+			std::cout << "Error: " << path << ":" << line_number
+			          << ": armor slot must be body, head, hands, feet or shield" << std::endl;
+			return false;
+		}
+		if(fields.size() == 5 && entry.kind == ITEM_WEAPON){
+			std::cout << "Error: " << path << ":" << line_number << ": weapons take no fifth field" << std::endl;
+			return false;
+		}
+		entry.name = fields[1];
+		entry.description = fields[2];
+		entries.push_back(entry);
+	}
+
+	for(std::size_t i = 0; i < entries.size(); i++){
+		define(entries[i].name, entries[i].description, entries[i].kind, entries[i].value, entries[i].effect, entries[i].slot);
+	}
+	return true;
+}
+
+
+// size - number of distinct prototypes
+std::size_t ItemCatalog::size() {
+	pthread_mutex_lock(&lock);
+	std::size_t n = prototypes.size();
+	pthread_mutex_unlock(&lock);
+	return n;
+}
@@ -0,0 +1,334 @@
+#include "Journal.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+const uint32_t JournalWriter::MAGIC;
+const uint32_t JournalWriter::VERSION;
+const std::size_t JournalWriter::FLUSH_BYTES;
+const unsigned int JournalWriter::FULL_EVERY;
+
+// ============================================================================
+// JournalWriter
+// ============================================================================
+
+// JournalWriter constructor - no file yet
+JournalWriter::JournalWriter()
+    : fd(-1), keyframe_every(0), commands(0), keyframe_at(0), keyframes(0),
+      skipped(0), deltas(0), have_full(false), bytes(0), failed(false) {
+}
+
+
+// JournalWriter destructor - whatever is pending still goes out
+JournalWriter::~JournalWriter() {
+	close();
+}
+
+
+// open
+// - Header: magic, version, then the setup block as a string
+//
+bool JournalWriter::open(const std::string& path, const std::string& setup, unsigned int every) {
+	close();
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0){
+		std::cout << "Error: cannot create journal " << path << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	keyframe_every = every;
+	commands = 0;
+	keyframe_at = 0;
+	keyframes = 0;
+	skipped = 0;
+	deltas = 0;
+	have_full = false;
+	bytes = 0;
+	failed = false;
+
+	pending.clear();
+	pending.putU32(MAGIC);
+	pending.putU32(VERSION);
+	pending.putString(setup);
+	return flush();
+}
+
+
+// recordLine
+// - Type byte, varint length, text; a command counts towards keyframes
+//
+void JournalWriter::recordLine(JournalRecord kind, const std::string& line) {
+	if(fd < 0){
+		return;
+	}
+	pending.putU8((uint8_t)kind);
+	pending.putVarU64(line.size());
+	pending.putBytes(line.data(), line.size());
+	if(kind == JOURNAL_COMMAND){
+		commands++;
+	}
+	if(pending.size() >= FLUSH_BYTES){
+		flush();
+	}
+}
+
+
+// recordKeyframe
+// - Commands so far and the snapshot (full or delta), then straight to
+//   the file
+//
+void JournalWriter::recordKeyframe(const std::string& state, bool full) {
+	if(fd < 0){
+		return;
+	}
+	pending.putU8(full ? JOURNAL_KEYFRAME : JOURNAL_DELTA);
+	pending.putVarU64(commands);
+	pending.putVarU64(state.size());
+	pending.putBytes(state.data(), state.size());
+	keyframe_at = commands;
+	keyframes++;
+	deltas = full ? 0 : deltas + 1;
+	have_full = have_full || full;
+	flush();
+}
+
+
+// skipKeyframe - no keyframe this time (the game couldn't take one)
+void JournalWriter::skipKeyframe() {
+	keyframe_at = commands;
+	skipped++;
+}
+
+
+// recordReload - the archetype version the game switched to
+void JournalWriter::recordReload(unsigned int version) {
+	if(fd < 0){
+		return;
+	}
+	pending.putU8(JOURNAL_RELOAD);
+	pending.putVarU64(version);
+}
+
+
+// flush
+// - One write for everything pending; after a failure the journal stops
+//   (said once) and the game goes on without it
+//
+bool JournalWriter::flush() {
+	if(fd < 0 || failed){
+		pending.clear();
+		return !failed;
+	}
+	const char* data = pending.data().data();
+	std::size_t size = pending.size();
+	while(size > 0){
+		ssize_t put = ::write(fd, data, size);
+		if(put < 0 && errno == EINTR){
+			continue;
+		}
+		if(put <= 0){
+			std::cout << "Error: journal write failed: " << strerror(errno) << std::endl;
+			failed = true;
+			break;
+		}
+		data += put;
+		size -= (std::size_t)put;
+		bytes += (unsigned long long)put;
+	}
+	pending.clear();
+	return !failed;
+}
+
+
+// close - flush and let go of the file
+void JournalWriter::close() {
+	if(fd >= 0){
+		flush();
+		::close(fd);
+		fd = -1;
+	}
+}
+
+
+// ============================================================================
+// JournalReader
+// ============================================================================
+
+// JournalReader constructor - nothing loaded
+JournalReader::JournalReader() : commands(0), reloads(0), truncated(false) {
+}
+
+
+// load
+// - Read the whole file, check the header
+// - Index each record; stop quietly at a record cut short
+// - A delta is only kept if everything it builds on was
+//
+bool JournalReader::load(const std::string& path) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0){
+		std::cout << "Error: cannot open journal " << path << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	data.clear();
+	char block[65536];
+	for(;;){
+		ssize_t got = ::read(fd, block, sizeof(block));
+		if(got < 0 && errno == EINTR){
+			continue;
+		}
+		if(got <= 0){
+			break;
+		}
+		data.append(block, (std::size_t)got);
+	}
+	::close(fd);
+
+	lines.clear();
+	keyframes.clear();
+	commands = 0;
+	reloads = 0;
+	truncated = false;
+	bool based = false;                  //the last full keyframe and every delta since were kept
+
+	ByteReader in(data);
+	uint32_t magic = in.getU32();
+	uint32_t version = in.getU32();
+	uint32_t setup_size = in.getU32();
+	if(!in.ok() || magic != JournalWriter::MAGIC || setup_size > in.remaining()){
+		std::cout << "Error: " << path << " is not a session journal" << std::endl;
+		return false;
+	}
+	if(version != JournalWriter::VERSION){
+		std::cout << "Error: " << path << " is journal version " << version
+		          << ", this game reads version " << JournalWriter::VERSION << std::endl;
+		return false;
+	}
+	setup = TextView(in.current(), setup_size);
+	ByteReader body(setup.data + setup.size, in.remaining() - setup_size);
+
+	while(!body.atEnd()){
+		uint8_t kind = body.getU8();
+		if(kind == JOURNAL_NAME || kind == JOURNAL_COMMAND || kind == JOURNAL_ACTION){
+			uint64_t size = body.getVarU64();
+			if(!body.ok() || size > body.remaining()){
+				truncated = true;
+				break;
+			}
+			Line line;
+			line.kind = (JournalRecord)kind;
+			line.text = TextView(body.current(), (std::size_t)size);
+			body.skip((std::size_t)size);
+			lines.push_back(line);
+			commands += (kind == JOURNAL_COMMAND) ? 1 : 0;
+		} else if(kind == JOURNAL_KEYFRAME || kind == JOURNAL_DELTA){
+			Keyframe keyframe;
+			keyframe.command = body.getVarU64();
+			uint64_t size = body.getVarU64();
+			if(!body.ok() || size > body.remaining()){
+				truncated = true;
+				break;
+			}
+			keyframe.line = lines.size();
+			keyframe.state = TextView(body.current(), (std::size_t)size);
+			keyframe.full = (kind == JOURNAL_KEYFRAME);
+			body.skip((std::size_t)size);
+			bool in_order = keyframe.command == commands &&
+			                (keyframes.empty() || keyframes.back().command < keyframe.command);
+			based = in_order && (keyframe.full || based);
+			if(based){
+				keyframe.base = keyframe.full ? keyframes.size() : keyframes.back().base;
+				keyframes.push_back(keyframe);
+			}
+		} else if(kind == JOURNAL_RELOAD){
+			body.getVarU64();
+			if(!body.ok()){
+				truncated = true;
+				break;
+			}
+			reloads++;
+		} else {
+			//an unknown record can't be skipped: stop here
+			truncated = true;
+			break;
+		}
+	}
+
+	if(lines.empty() || lines[0].kind != JOURNAL_NAME){
+		std::cout << "Error: " << path << " has no session in it" << std::endl;
+		return false;
+	}
+	if(truncated){
+		std::cout << "Warning: " << path << " is cut short after " << commands
+		          << " commands; replaying those" << std::endl;
+	}
+	return true;
+}
+
+
+// findKeyframe - binary search for the last keyframe at or before `command`
+const JournalReader::Keyframe* JournalReader::findKeyframe(unsigned long long command) const {
+	std::size_t low = 0;
+	std::size_t high = keyframes.size();
+	while(low < high){
+		std::size_t mid = low + (high - low) / 2;
+		if(keyframes[mid].command <= command){
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low > 0 ? &keyframes[low - 1] : NULL;
+}
+
+
+// keyframeAt - the keyframe taken exactly at `command`, if there is one
+const JournalReader::Keyframe* JournalReader::keyframeAt(unsigned long long command) const {
+	const Keyframe* keyframe = findKeyframe(command);
+	return (keyframe != NULL && keyframe->command == command) ? keyframe : NULL;
+}
+
+
+// keyframeChain - the full keyframe under `last`, then the deltas up to it
+void JournalReader::keyframeChain(const Keyframe* last, std::vector<const Keyframe*>& chain) const {
+	chain.clear();
+	std::size_t end = (std::size_t)(last - &keyframes[0]);
+	for(std::size_t i = last->base; i <= end; i++){
+		chain.push_back(&keyframes[i]);
+	}
+}
+
+
+// ============================================================================
+// ReplayStats
+// ============================================================================
+
+// print
+// - Where the replay started, how much it played, what it checked
+//
+void ReplayStats::print() const {
+	std::cout << "========================================" << std::endl;
+	std::cout << "Replay" << std::endl;
+	std::cout << "  Commands:  " << commands << " played, ";
+	if(start == 0){
+		std::cout << "from the start" << std::endl;
+	} else {
+		std::cout << "from the keyframe after command " << start << std::endl;
+	}
+	if(seek > 0){
+		std::cout << "  Shown:     from command " << seek << std::endl;
+	}
+	std::cout << "  Keyframes: " << checked << " checked, ";
+	if(mismatched == 0){
+		std::cout << "all match" << std::endl;
+	} else {
+		std::cout << mismatched << " DIFFER (first at command " << first_mismatch << ")" << std::endl;
+	}
+	std::cout << "  Time:      " << seconds << " s" << std::endl;
+	if(reloads > 0){
+		std::cout << "  Warning:   monster archetypes were reloaded " << reloads
+		          << " time(s) while recording; this replay uses them as they are now" << std::endl;
+	}
+	std::cout << "========================================" << std::endl;
+}
@@ -0,0 +1,192 @@
+#include "LootTable.h"
+#include "Item.h"
+#include "ItemBag.h"
+#include "ItemCatalog.h"
+#include "Random.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cmath>
+
+const unsigned int LootTable::MAX_WEIGHT;
+const unsigned int LootTable::MAX_CHOICES;
+const unsigned int LootTable::MAX_ROLLS;
+
+// addAlways - dropped on every kill
+void LootTable::addAlways(const LootDrop& drop) {
+	always.push_back(drop);
+}
+
+
+// addChoice - one weighted entry of the rolls
+void LootTable::addChoice(const LootDrop& drop, unsigned int weight) {
+	choices.push_back(drop);
+	weights.push_back(weight);
+}
+
+
+// build
+// - Vose's alias method in integers: scale every weight by the number of
+//   choices so the average is the total; pair each below-average choice
+//   with an above-average one that fills the rest of its column
+// - threshold is the column's own share in 32-bit fixed point
+//
+void LootTable::build() {
+	std::size_t n = choices.size();
+	threshold.assign(n, 0xFFFFFFFFu);
+	alias.resize(n);
+	if(n == 0){
+		return;
+	}
+
+	unsigned long long total = 0;
+	std::vector<unsigned long long> scaled(n);
+	for(std::size_t i = 0; i < n; i++){
+		total += weights[i];
+		scaled[i] = (unsigned long long)weights[i] * n;
+		alias[i] = (unsigned int)i;
+	}
+	if(total == 0){
+		return;
+	}
+
+	std::vector<unsigned int> small;
+	std::vector<unsigned int> large;
+	for(std::size_t i = 0; i < n; i++){
+		(scaled[i] < total ? small : large).push_back((unsigned int)i);
+	}
+	while(!small.empty() && !large.empty()){
+		unsigned int s = small.back();
+		small.pop_back();
+		unsigned int l = large.back();
+		large.pop_back();
+
+		threshold[s] = (unsigned int)((scaled[s] << 32) / total);
+		alias[s] = l;
+
+		//the large one gave away what s was missing
+		scaled[l] -= total - scaled[s];
+		(scaled[l] < total ? small : large).push_back(l);
+	}
+	//whatever is left is (up to rounding) exactly full
+}
+
+
+// pick
+// - High bits choose a column, low bits decide column or alias
+//
+std::size_t LootTable::pick(RandomStream& rng) const {
+	unsigned long long r = rng.next();
+	std::size_t column = (std::size_t)(((r >> 32) * choices.size()) >> 32);
+	return ((unsigned int)r < threshold[column]) ? column : alias[column];
+}
+
+
+// roll
+// - Every guaranteed drop, then `rolls` weighted picks
+// - Nested tables roll in turn (always a lower index, so this ends)
+//
+void LootTable::roll(const std::vector<LootTable>& tables, RandomStream& rng, ItemBag& into) const {
+	for(std::size_t i = 0; i < always.size(); i++){
+		if(always[i].item != NULL){
+			into.add(always[i].item->create());
+		} else if(always[i].table >= 0){
+			tables[always[i].table].roll(tables, rng, into);
+		}
+	}
+	if(choices.empty()){
+		return;
+	}
+	for(unsigned int r = 0; r < rolls; r++){
+		const LootDrop& drop = choices[pick(rng)];
+		if(drop.item != NULL){
+			into.add(drop.item->create());
+		} else if(drop.table >= 0){
+			tables[drop.table].roll(tables, rng, into);
+		}
+	}
+}
+
+
+// maxNestedTable - over both lists
+int LootTable::maxNestedTable() const {
+	int highest = -1;
+	for(std::size_t i = 0; i < always.size(); i++){
+		if(always[i].table > highest){ highest = always[i].table; }
+	}
+	for(std::size_t i = 0; i < choices.size(); i++){
+		if(choices[i].table > highest){ highest = choices[i].table; }
+	}
+	return highest;
+}
+
+
+// check
+// - Common tier: 50 Small Potion, 30 Iron Sword, 15 @rare, 5 nothing;
+//   rare tier: 3 Chain Mail, 1 Dragon Slayer Sword
+// - Rolled through roll(), so nesting and item creation are what a kill
+//   really does; each kill's drop (or none) is counted by name
+//
+bool LootTable::check(unsigned int kills, unsigned long long seed) {
+	static const char* const NAMES[] = { "Small Potion", "Iron Sword", "Chain Mail", "Dragon Slayer Sword" };
+	static const std::size_t OUTCOMES = 5;      // the four items, then nothing
+	const double expected[OUTCOMES] = { 0.50, 0.30, 0.15 * 0.75, 0.15 * 0.25, 0.05 };
+
+	std::vector<LootDrop> drops(4);
+	for(std::size_t i = 0; i < drops.size(); i++){
+		drops[i].item = ItemCatalog::instance().find(NAMES[i]);
+	}
+	std::vector<LootTable> tables(1);
+	tables[0].addChoice(drops[2], 3);
+	tables[0].addChoice(drops[3], 1);
+	tables[0].build();
+	LootTable common;
+	LootDrop rare;
+	rare.table = 0;
+	common.addChoice(drops[0], 50);
+	common.addChoice(drops[1], 30);
+	common.addChoice(rare, 15);
+	common.addChoice(LootDrop(), 5);
+	common.build();
+
+	RandomStream rng(seed, 0);
+	ItemBag bag;
+	unsigned long long counts[OUTCOMES] = { 0, 0, 0, 0, 0 };
+	unsigned long long extra = 0;
+	for(unsigned int k = 0; k < kills; k++){
+		common.roll(tables, rng, bag);
+		if(bag.empty()){
+			counts[OUTCOMES - 1]++;
+			continue;
+		}
+		extra += bag.size() - 1;
+		for(std::size_t i = 0; i < drops.size(); i++){
+			if(bag[0]->getName() == drops[i].item->name){
+				counts[i]++;
+			}
+		}
+		bag.deleteAll();
+	}
+
+	//binomial standard deviation of each count
+	bool ok = extra == 0;
+	std::cout << "========================================" << std::endl;
+	std::cout << "Loot check: " << kills << " kills, a common tier with a nested rare one" << std::endl;
+	for(std::size_t i = 0; i < OUTCOMES; i++){
+		double mean = expected[i] * kills;
+		double sd = std::sqrt(mean * (1.0 - expected[i]));
+		double off = (sd > 0) ? ((double)counts[i] - mean) / sd : 0;
+		ok = ok && std::fabs(off) <= 5.0;
+		std::string name = (i < drops.size()) ? NAMES[i] : "Nothing";
+		std::cout << "  " << name << std::string(name.size() < 21 ? 21 - name.size() : 1, ' ')
+		          << std::fixed << std::setprecision(2) << std::setw(5) << expected[i] * 100 << "% weighted, "
+		          << std::setw(5) << (kills ? counts[i] * 100.0 / kills : 0) << "% rolled ("
+		          << std::showpos << std::setprecision(1) << off << std::noshowpos << " sd)" << std::endl;
+	}
+	if(extra > 0){
+		std::cout << "  Extra drops:         " << extra << std::endl;
+	}
+	std::cout << "  Results:             " << (ok ? "all within 5 sd" : "MISMATCH") << std::endl;
+	std::cout << "========================================" << std::endl;
+	return ok;
+}
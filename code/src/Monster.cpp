@@ -1,35 +1,139 @@
 #include "Monster.h"
+#include "Serializer.h"
 #include <iostream>
 
+// Lazy spawning counters, bumped from the generator's threads too
+static unsigned long long monsters_deferred = 0;
+static unsigned long long monsters_materialized = 0;
+static unsigned long long loot_deferred = 0;
+static unsigned long long loot_rolled_count = 0;
+
+
+// print
+// - Built vs. deferred monsters and loot tables
+//
+void SpawnStats::print(std::ostream& out) const {
+	out << "========================================" << std::endl;
+	out << "Lazy spawning" << std::endl;
+	out << "  Monsters:  " << monsters_materialized << " of " << monsters_deferred
+	          << " spawns built (" << monsters_deferred - monsters_materialized
+	          << " never materialized)" << std::endl;
+	out << "  Loot:      " << loot_rolled << " of " << loot_deferred
+	          << " loot tables rolled (" << loot_deferred - loot_rolled
+	          << " never materialized)" << std::endl;
+	out << "========================================" << std::endl;
+}
+
+
+// countSpawn
+// - A room took a spawn descriptor (false) or built its Monster (true)
+//
+void Monster::countSpawn(bool materialized) {
+	__sync_fetch_and_add(materialized ? &monsters_materialized : &monsters_deferred, 1ULL);
+}
+
+
+// getSpawnStats - snapshot of the counters
+SpawnStats Monster::getSpawnStats() {
+	SpawnStats stats;
+	stats.monsters_deferred = __sync_fetch_and_add(&monsters_deferred, 0ULL);
+	stats.monsters_materialized = __sync_fetch_and_add(&monsters_materialized, 0ULL);
+	stats.loot_deferred = __sync_fetch_and_add(&loot_deferred, 0ULL);
+	stats.loot_rolled = __sync_fetch_and_add(&loot_rolled_count, 0ULL);
+	return stats;
+}
+
+
 // ============================================================================
 // Base Monster class
 // ============================================================================
 
+// tableFor - retain the given table, or acquire the current one
+static const ArchetypeTable* tableFor(const ArchetypeTable* table) {
+	if(table == NULL){
+		return ArchetypeRegistry::instance().acquire();
+	}
+	table->retain();
+	return table;
+}
+
+
 // Monster constructor
 // - MUST call Character base constructor
-// - Initialize experience_reward and gold_reward
-// - Loot table starts empty automatically
+// - Hold the table, then take stats and rewards from its line
+// - Loot waits for dropLoot - most monsters never die
+//
+Monster::Monster(unsigned int kind, const ArchetypeTable* archetypes)
+    : Character("", 0, 0, 0),
+      experience_reward(0), gold_reward(0),
+      table(tableFor(archetypes)), archetype(kind), loot_rolled(false) {
+	applyArchetype();
+	__sync_fetch_and_add(&loot_deferred, 1ULL);
+}
+
+
+// applyArchetype
+// - Name, stats and rewards from our line of the table
+//
+void Monster::applyArchetype() {
+	const ArchetypeData& data = (*table)[archetype];
+	setName(data.name);
+	setMaxHP(data.max_hp);
+	setCurrentHP(data.max_hp);
+	setAttack(data.attack);
+	setDefense(data.defense);
+	experience_reward = data.experience;
+	gold_reward = data.gold;
+}
+
+
+// rollLoot
+// - Once: roll our archetype's loot table into the loot bag
+// - Only the items actually picked are made
+//
+void Monster::rollLoot() {
+	if(loot_rolled){
+		return;
+	}
+	loot_rolled = true;
+	__sync_fetch_and_add(&loot_rolled_count, 1ULL);
+	(*table)[archetype].loot.roll(table->lootTables(), getRandom(), loot_table);
+}
+
+
+// rebalance
+// - Move an untouched monster (alive, full HP) to the current table,
+//   so a reload reaches monsters that were spawned before it but haven't
+//   fought yet; a wounded one keeps the numbers its fight started with
+// - Returns true if anything changed
 //
-Monster::Monster(const std::string& name, int hp, int attack, int defense,
-                 int exp_reward, int gold_reward)
-    : Character(name, hp, attack, defense),
-      experience_reward(exp_reward), gold_reward(gold_reward) {
+bool Monster::rebalance() {
+	if(!isAlive() || getCurrentHP() != getMaxHP()){
+		return false;
+	}
+	const ArchetypeTable* latest = ArchetypeRegistry::instance().acquire();
+	if(latest == table){
+		latest->release();
+		return false;
+	}
+	table->release();
+	table = latest;
+	applyArchetype();
+	return true;
 }
 
 
 // Monster destructor
 // - Deallocate any allocated memory 
-// - Loop through loot_table vector and delete each Item*
-// - Clear the vector after deleting items
+// - Delete each Item* in the loot table and clear it
+// - Release the archetype table
 //
 Monster::~Monster() {
-        //loop through loot table
-        for(int i = 0; i < (int)loot_table.size(); i++){
-                //free each item in loot table
-                delete loot_table[i];
-        }
-        //actually clear the vector
-        loot_table.clear();
+        //free each item in loot table and clear it
+        loot_table.deleteAll();
+
+        //the table goes away with its last monster
+        table->release();
 }
 
 
@@ -38,17 +142,17 @@ Monster::~Monster() {
 // - Format: "MonsterName [HP: current/max]"
 // - Keep it simple - monsters don't need detailed stats display
 //
-void Monster::displayStats() const {
+void Monster::displayStats(std::ostream& out) const {
     // Display monster stats
 
 	//Display monster name and HP
-	std::cout << getName() << " [HP: " << getCurrentHP() << "/" << getMaxHP() << "]" << std::endl;
+	out << getName() << " [HP: " << getCurrentHP() << "/" << getMaxHP() << "]" << std::endl;
 }
 
 
 // addLoot
 // - Check if item pointer is not NULL
-// - Add item to loot_table vector using push_back()
+// - Add item to the loot bag
 //
 void Monster::addLoot(Item* item) {
     // Add item to loot table
@@ -63,185 +167,136 @@ void Monster::addLoot(Item* item) {
 
 	//otherwise
 	else{
-		//put loot in vector
-		loot_table.push_back(item);
+		//put loot in the bag
+		loot_table.add(item);
 	}
 
 }
 
 
 // dropLoot
-// - Create a copy of the loot_table vector
-// - Clear the original loot_table (transfer ownership to caller!)
-// - Return the copy
-// - This is important: caller now owns the items and must delete them
-//
-std::vector<Item*> Monster::dropLoot() {
-    // Return loot and transfer ownership
-
-	//create copy vector
-	std::vector<Item*> lootCopy;
-
-	//loop through original vector
-	for(int i = 0; i < (int)loot_table.size(); i++){
-		//put each element of loot_table in copy vector
-		lootCopy.push_back(loot_table[i]);
-	}
-
-	//Clear the original loot_table
-	loot_table.clear();
-
-    return lootCopy;
-}
-
-
-// getAttackMessage (base version)
-// - Return default attack message
-// - Format: "MonsterName attacks!"
-// - Use getName() to get monster's name
+// - Roll the loot if that hasn't happened yet
+// - Move every loot item into the given bag (e.g. the room floor)
+// - No copies: the bag takes the items and their name index entries
+// - Caller now owns the items; returns how many were dropped
 //
-std::string Monster::getAttackMessage() const {
-    // Return attack message
-
-	//concatinate monster name and attack message
-	std::string attackMessage = getName() + " attacks!";
-
-	//return full message
-	return attackMessage;
+std::size_t Monster::dropLoot(ItemBag& into) {
+    // Hand loot over and transfer ownership
+	rollLoot();
+	return loot_table.transferAll(into);
 }
 
 
-// ============================================================================
-// Goblin - Weak but common enemy
-// ============================================================================
-
-// Goblin constructor
-// - Call Monster constructor with these stats:
-//   * Name: "Goblin"
-//   * HP: 30
-//   * Attack: 5
-//   * Defense: 2
-//   * Experience: 10
-//   * Gold: 5
-// - Add a small potion to loot table
-// - Example: addLoot(new Consumable("Small Potion", "Restores 10 HP", 10));
+// clearLoot
+// - Delete every item in the loot table
+// - The table's loot counts as rolled (this monster drops nothing)
 //
-Goblin::Goblin() 
-    : Monster("Goblin", 30, 5, 2, 10, 5) {
-    // Add loot items
-
-	//add a small potion to loot table
-	addLoot(new Consumable("Small Potion", "Restores 10 HP", 10));
+void Monster::clearLoot() {
+	loot_table.deleteAll();
+	loot_rolled = true;
 }
 
 
-// Override getAttackMessage for Goblin
-// - Return goblin-specific attack message
-// - Example: "The goblin swipes at you with its rusty dagger!"
+// create
+// - Factory by monster name, used when rebuilding saved/paged state
+// - By archetype: the class for a built-in (so it lands in its pool),
+//   a plain Monster for one added by a data file
 //
-std::string Goblin::getAttackMessage() const {
-    // Return goblin attack message
-
-	//assign message to string
-	std::string message = "The goblin swipes at you with its rusty dagger!";
-
-	//return string
-	return message;
+Monster* Monster::create(const std::string& name) {
+	const ArchetypeTable* table = ArchetypeRegistry::instance().acquire();
+	unsigned int kind = table->find(name);
+	Monster* monster = (kind == ArchetypeTable::NOT_FOUND) ? NULL : create(kind, table);
+	table->release();
+	return monster;
 }
 
-
-// ============================================================================
-// Skeleton - Undead warrior
-// ============================================================================
-
-// Skeleton constructor
-// - Call Monster constructor with these stats:
-//   * Name: "Skeleton"
-//   * HP: 40
-//   * Attack: 8
-//   * Defense: 4
-//   * Experience: 20
-//   * Gold: 10
-// - Add an old sword to loot table
-//
-Skeleton::Skeleton()
-    : Monster("Skeleton", 40, 8, 4, 20, 10) {
-    // Add loot items
-
-	//add old sword to loot table
-	addLoot(new Weapon("Old Sword", "Causes 10 HP of damage", 10));
+Monster* Monster::create(unsigned int archetype, const ArchetypeTable* table) {
+	switch(archetype){
+#define ARCHETYPE_NEW(id, cls, hp, atk, def, exp, gold, bonus, pool, message, loot) \
+	case ARCHETYPE_##id: return new cls(table);
+	MONSTER_ARCHETYPES(ARCHETYPE_NEW)
+#undef ARCHETYPE_NEW
+	default: return new Monster(archetype, table);
+	}
 }
 
 
-// Override getAttackMessage for Skeleton
-// - Return skeleton-specific attack message
-// - Example: "The skeleton rattles its bones and slashes with a sword!"
+// serialize
+// - Name identifies the kind; then HP, alive flag, random stream position,
+//   whether the loot was rolled, and the loot table
 //
-std::string Skeleton::getAttackMessage() const {
-    // Return skeleton attack message
-
-	//populate string with skeleton attack message
-	std::string skeletonMessage = "The skeleton rattles its bones and slashes with a sword!";
-
-	//return the string
-	return skeletonMessage;
+void Monster::serialize(ByteWriter& out) const {
+	out.putString(getName());
+	out.putI32(getCurrentHP());
+	out.putU8(isAlive() ? 1 : 0);
+	out.putU64(getRandom().getKey());
+	out.putU64(getRandom().getCounter());
+	out.putU8(loot_rolled ? 1 : 0);
+	out.putU32((uint32_t)loot_table.size());
+	for(std::size_t i = 0; i < loot_table.size(); i++){
+		loot_table[i]->serialize(out);
+	}
 }
 
 
-// ============================================================================
-// Dragon - Boss enemy with special ability
-// ============================================================================
-
-// Dragon constructor
-// - Call Monster constructor with these stats:
-//   * Name: "Dragon"
-//   * HP: 150
-//   * Attack: 20
-//   * Defense: 10
-//   * Experience: 100
-//   * Gold: 50
-// - Add legendary loot:
-//   * Dragon Slayer sword (damage +10)
-//   * Dragon Scale Armor (defense +8)
-//   * Greater Health Potion (heals 100 HP)
+// deserialize
+// - Build the monster by name, then overwrite its state and loot
+// - Unrolled loot stays unrolled
+// - Returns NULL if the data is bad
 //
-Dragon::Dragon()
-    : Monster("Dragon", 150, 20, 10, 100, 50) {
-    // Add legendary loot items
-
-	//add dragon slayer sword with 10 damage
-	addLoot(new Weapon("Dragon Slayer Sword", "Causes 10 HP of damage", 10));
-
-	//add dragon scale armor with 8 defense
-	addLoot(new Armor("Dragon Scale Armor", "Defense +8 HP", 8));
+Monster* Monster::deserialize(ByteReader& in) {
+	std::string kind = in.getString();
+	int hp = in.getI32();
+	bool is_alive = in.getU8() != 0;
+	uint64_t rng_key = in.getU64();
+	uint64_t rng_counter = in.getU64();
+	bool rolled = in.getU8() != 0;
+	uint32_t loot_count = in.getU32();
+	if(!in.ok()){
+		return NULL;
+	}
 
-	//add greather health potion with 100 healing
-	addLoot(new Consumable("Greater Health Potion", "Heals 100 HP", 100));
+	Monster* monster = create(kind);
+	if(monster == NULL){
+		return NULL;
+	}
+	monster->setCurrentHP(hp);
+	monster->setAlive(is_alive);
+	monster->getRandom().restore(rng_key, rng_counter);
+	monster->loot_rolled = rolled;
+
+	//the same monster coming back, not a new loot table
+	__sync_fetch_and_sub(&loot_deferred, 1ULL);
+
+	//saved loot (rolled, or added with addLoot)
+	for(uint32_t i = 0; i < loot_count && in.ok(); i++){
+		Item* item = Item::deserialize(in);
+		if(item == NULL){
+			delete monster;
+			return NULL;
+		}
+		monster->loot_table.add(item);
+	}
+	return monster;
 }
 
 
-// Override getAttackMessage for Dragon
-// - Return dragon-specific attack message
-// - Example: "The dragon breathes fire at you!"
+// memoryFootprint
+// - Object, name and loot, roughly
 //
-std::string Dragon::getAttackMessage() const {
-    // Return dragon attack message
-    return "The dragon breathes fire at you!";
+std::size_t Monster::memoryFootprint() const {
+	std::size_t bytes = sizeof(Monster) + getName().capacity() + loot_table.memoryFootprint();
+	for(std::size_t i = 0; i < loot_table.size(); i++){
+		bytes += loot_table[i]->memoryFootprint();
+	}
+	return bytes;
 }
 
 
-// Override calculateDamage for Dragon
-// - Call Monster::calculateDamage() to get base damage
-// - Add bonus fire damage (+5)
-// - Return total damage
-// - This makes the dragon hit harder than other monsters!
+// calculateDamage
+// - Character's attack roll plus the archetype's damage bonus
+//   (only the Dragon has one: +5 fire damage)
 //
-int Dragon::calculateDamage() const {
-    // Calculate damage with fire bonus
-
-	//Call Monster::calculateDamage() to get base damage, Add bonus fire damage (+5)
-	int totDamage = Monster::calculateDamage() + 5;
-
-	//Return total damage
-    	return totDamage;
+int Monster::calculateDamage() const {
+	return Character::calculateDamage() + getDamageBonus();
 }
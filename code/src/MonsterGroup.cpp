@@ -0,0 +1,162 @@
+#include "MonsterGroup.h"
+#include "Monster.h"
+#include "NameIndex.h"
+#include <iostream>
+#include <cstdlib>
+
+const std::size_t MonsterGroup::MAX_SIZE;
+const std::size_t MonsterGroup::NOT_FOUND;
+const int MonsterGroup::NO_INITIATIVE;
+
+// MonsterGroup constructor
+MonsterGroup::MonsterGroup() : members(NULL), count(0), capacity(0), live(0) {
+}
+
+
+// MonsterGroup destructor - the group owns its monsters
+MonsterGroup::~MonsterGroup() {
+	clear();
+}
+
+
+// add
+// - Append with no initiative yet; count it if it's alive
+// - The array starts at 2 and doubles (most encounters are small)
+//
+bool MonsterGroup::add(Monster* monster) {
+	if(monster == NULL || count >= MAX_SIZE){
+		return false;
+	}
+	if(count == capacity){
+		unsigned char grown = (capacity == 0) ? 2 : (unsigned char)(capacity * 2);
+		Member* larger = new Member[grown];
+		for(unsigned char i = 0; i < count; i++){
+			larger[i] = members[i];
+		}
+		delete[] members;
+		members = larger;
+		capacity = grown;
+	}
+	Member& member = members[count++];
+	member.monster = monster;
+	member.initiative = NO_INITIATIVE;
+	member.counted = monster->isAlive();
+	if(member.counted){
+		live++;
+	}
+	return true;
+}
+
+
+// removeAt
+// - Delete the monster, move the last member into the hole
+//
+void MonsterGroup::removeAt(std::size_t i) {
+	if(i >= count){
+		return;
+	}
+	if(members[i].counted){
+		live--;
+	}
+	delete members[i].monster;
+	members[i] = members[--count];
+}
+
+
+// clear - delete every member and the array
+void MonsterGroup::clear() {
+	for(unsigned char i = 0; i < count; i++){
+		delete members[i].monster;
+	}
+	delete[] members;
+	members = NULL;
+	count = 0;
+	capacity = 0;
+	live = 0;
+}
+
+
+// rollInitiative
+// - d20 from each monster's own stream, once per monster
+//
+void MonsterGroup::rollInitiative() {
+	for(std::size_t i = 0; i < count; i++){
+		if(members[i].initiative == NO_INITIATIVE){
+			members[i].initiative = members[i].monster->getRandom().below(20) + 1;
+		}
+	}
+}
+
+
+// turnOrder
+// - Insertion sort of the living slots (a group is at most MAX_SIZE)
+//
+std::size_t MonsterGroup::turnOrder(std::size_t order[MAX_SIZE]) const {
+	std::size_t n = 0;
+	for(std::size_t i = 0; i < count; i++){
+		if(!members[i].monster->isAlive()){
+			continue;
+		}
+		std::size_t j = n++;
+		while(j > 0 && members[order[j - 1]].initiative < members[i].initiative){
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = i;
+	}
+	return n;
+}
+
+
+// findTarget
+// - Split an optional trailing number off the name
+// - Names match case-insensitively; numbers count living members only
+//
+std::size_t MonsterGroup::findTarget(const std::string& target) const {
+	//no target: whoever acts first
+	if(target.empty()){
+		std::size_t order[MAX_SIZE];
+		return turnOrder(order) > 0 ? order[0] : NOT_FOUND;
+	}
+
+	//trailing number: the slot itself, or the nth of a name
+	std::string name = target;
+	std::size_t nth = 1;
+	std::size_t space = target.find_last_of(" \t");
+	std::size_t digits = (space == std::string::npos) ? 0 : space + 1;
+	if(target.find_first_not_of("0123456789", digits) == std::string::npos){
+		nth = (std::size_t)strtoul(target.c_str() + digits, NULL, 10);
+		name = (space == std::string::npos) ? "" : target.substr(0, target.find_last_not_of(" \t", space) + 1);
+	}
+
+	if(name.empty()){
+		if(nth >= 1 && nth <= count && members[nth - 1].monster->isAlive()){
+			return nth - 1;
+		}
+		return NOT_FOUND;
+	}
+
+	for(std::size_t i = 0; i < count; i++){
+		const std::string& member_name = members[i].monster->getName();
+		if(members[i].monster->isAlive() &&
+		   NameIndex::equalsIgnoreCase(member_name.data(), member_name.size(), name.data(), name.size()) &&
+		   --nth == 0){
+			return i;
+		}
+	}
+	return NOT_FOUND;
+}
+
+
+// display
+// - "  2. Goblin [HP: 12/30]"
+//
+void MonsterGroup::display(std::ostream& out) const {
+	for(std::size_t i = 0; i < count; i++){
+		const Monster* m = members[i].monster;
+		if(m->isAlive()){
+			out << "  " << i + 1 << ". " << m->getName()
+			          << " [HP: " << m->getCurrentHP() << "/" << m->getMaxHP() << "]" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,297 @@
+#include "NameIndex.h"
+#include <cctype>
+#include <algorithm>
+
+const std::size_t NameIndex::NOT_FOUND;
+
+// NameIndex constructor
+// - Starts with no slots; the table is allocated on first insert
+//
+NameIndex::NameIndex() : count(0) {
+}
+
+
+// hashName
+// - FNV-1a over the lowercased characters
+// - Never allocates, so it can be used directly on the raw command text
+//
+unsigned int NameIndex::hashName(const char* name, std::size_t len) {
+	unsigned int h = 2166136261u;
+	for(std::size_t i = 0; i < len; i++){
+		h ^= static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(name[i])));
+		h *= 16777619u;
+	}
+	return h;
+}
+
+
+// equalsFolded
+// - Compare an already-folded key against raw text, folding the text as we go
+//
+bool NameIndex::equalsFolded(const std::string& folded, const char* name, std::size_t len) {
+	if(folded.size() != len){
+		return false;
+	}
+	for(std::size_t i = 0; i < len; i++){
+		if(folded[i] != static_cast<char>(std::tolower(static_cast<unsigned char>(name[i])))){
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// equalsIgnoreCase
+// - Compare two raw strings, folding both sides
+//
+bool NameIndex::equalsIgnoreCase(const char* a, std::size_t a_len, const char* b, std::size_t b_len) {
+	if(a_len != b_len){
+		return false;
+	}
+	for(std::size_t i = 0; i < a_len; i++){
+		if(std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))){
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// fold
+// - Return a lowercased copy of name (only used at insertion time)
+//
+std::string NameIndex::fold(const std::string& name) {
+	std::string folded(name);
+	for(std::size_t i = 0; i < folded.size(); i++){
+		folded[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(folded[i])));
+	}
+	return folded;
+}
+
+
+// grow
+// - Double the table (minimum 16 slots) and reinsert every entry
+// - Keys are swapped across instead of copied
+//
+void NameIndex::grow() {
+	std::vector<Entry> old;
+	old.swap(slots);
+
+	std::size_t new_size = old.empty() ? 16 : old.size() * 2;
+	Entry blank;
+	blank.hash = 0;
+	blank.value = 0;
+	blank.used = false;
+	slots.assign(new_size, blank);
+
+	for(std::size_t i = 0; i < old.size(); i++){
+		if(!old[i].used){ continue; }
+		std::size_t slot = probeStart(old[i].hash);
+		while(slots[slot].used){
+			slot = (slot + 1) & (slots.size() - 1);
+		}
+		slots[slot].hash = old[i].hash;
+		slots[slot].value = old[i].value;
+		slots[slot].key.swap(old[i].key);
+		slots[slot].used = true;
+	}
+}
+
+
+// reserve
+// - Grow until n entries fit under the 75% load factor
+//
+void NameIndex::reserve(std::size_t n) {
+	while(slots.size() * 3 < n * 4){
+		grow();
+	}
+}
+
+
+// insert
+// - Fold the key once and store it in the first free slot of its probe run
+//
+void NameIndex::insert(const std::string& name, std::size_t value) {
+	//keep load factor under 75%
+	if((count + 1) * 4 > slots.size() * 3){
+		grow();
+	}
+
+	unsigned int h = hashName(name.data(), name.size());
+	std::size_t slot = probeStart(h);
+	while(slots[slot].used){
+		slot = (slot + 1) & (slots.size() - 1);
+	}
+
+	slots[slot].hash = h;
+	slots[slot].value = value;
+	slots[slot].key = fold(name);
+	slots[slot].used = true;
+	count++;
+}
+
+
+// find
+// - Walk the probe run for this hash until an empty slot
+//
+std::size_t NameIndex::find(const char* name, std::size_t len) const {
+	if(count == 0){
+		return NOT_FOUND;
+	}
+
+	unsigned int h = hashName(name, len);
+	std::size_t slot = probeStart(h);
+	while(slots[slot].used){
+		if(slots[slot].hash == h && equalsFolded(slots[slot].key, name, len)){
+			return slots[slot].value;
+		}
+		slot = (slot + 1) & (slots.size() - 1);
+	}
+	return NOT_FOUND;
+}
+
+
+// findNext
+// - Like find(), but carry on along the probe run from where the last
+//   call stopped (cursor = slots walked so far)
+//
+std::size_t NameIndex::findNext(const char* name, std::size_t len, std::size_t& cursor) const {
+	if(count == 0){
+		return NOT_FOUND;
+	}
+
+	unsigned int h = hashName(name, len);
+	std::size_t slot = (probeStart(h) + cursor) & (slots.size() - 1);
+	while(slots[slot].used){
+		cursor++;
+		if(slots[slot].hash == h && equalsFolded(slots[slot].key, name, len)){
+			return slots[slot].value;
+		}
+		slot = (slot + 1) & (slots.size() - 1);
+	}
+	return NOT_FOUND;
+}
+
+
+// locate
+// - Slot of the entry with this name AND this value, or NOT_FOUND
+//
+std::size_t NameIndex::locate(const char* name, std::size_t len, std::size_t value) const {
+	if(count == 0){
+		return NOT_FOUND;
+	}
+
+	unsigned int h = hashName(name, len);
+	std::size_t slot = probeStart(h);
+	while(slots[slot].used){
+		if(slots[slot].value == value && slots[slot].hash == h &&
+		   equalsFolded(slots[slot].key, name, len)){
+			return slot;
+		}
+		slot = (slot + 1) & (slots.size() - 1);
+	}
+	return NOT_FOUND;
+}
+
+
+// erase
+// - Find the entry with this name AND this value, then backward-shift
+//
+bool NameIndex::erase(const char* name, std::size_t len, std::size_t value) {
+	std::size_t slot = locate(name, len, value);
+	if(slot == NOT_FOUND){
+		return false;
+	}
+	eraseSlot(slot);
+	return true;
+}
+
+
+// update
+// - The entry with this name and value holds new_value from now on
+//
+bool NameIndex::update(const char* name, std::size_t len, std::size_t value, std::size_t new_value) {
+	std::size_t slot = locate(name, len, value);
+	if(slot == NOT_FOUND){
+		return false;
+	}
+	slots[slot].value = new_value;
+	return true;
+}
+
+
+// moveTo
+// - Make room in dest first (the only step that can allocate or throw)
+// - Then swap the folded key across and erase it here
+//
+bool NameIndex::moveTo(NameIndex& dest, const char* name, std::size_t len, std::size_t value, std::size_t new_value) {
+	std::size_t from = locate(name, len, value);
+	if(from == NOT_FOUND){
+		return false;
+	}
+	if((dest.count + 1) * 4 > dest.slots.size() * 3){
+		dest.grow();
+	}
+
+	unsigned int h = slots[from].hash;
+	std::size_t slot = dest.probeStart(h);
+	while(dest.slots[slot].used){
+		slot = (slot + 1) & (dest.slots.size() - 1);
+	}
+	dest.slots[slot].hash = h;
+	dest.slots[slot].value = new_value;
+	dest.slots[slot].key.swap(slots[from].key);
+	dest.slots[slot].used = true;
+	dest.count++;
+
+	eraseSlot(from);
+	return true;
+}
+
+
+// swap - exchange whole tables
+void NameIndex::swap(NameIndex& other) {
+	slots.swap(other.slots);
+	std::swap(count, other.count);
+}
+
+
+// eraseSlot
+// - Backward-shift deletion: pull later members of the probe run into the
+//   hole so lookups never need tombstones
+//
+void NameIndex::eraseSlot(std::size_t hole) {
+	std::size_t mask = slots.size() - 1;
+	std::size_t next = (hole + 1) & mask;
+
+	while(slots[next].used){
+		std::size_t home = probeStart(slots[next].hash);
+		//entry may move into the hole only if the hole lies on its probe path
+		bool movable = (hole <= next) ? (home <= hole || home > next)
+		                              : (home <= hole && home > next);
+		if(movable){
+			slots[hole].hash = slots[next].hash;
+			slots[hole].value = slots[next].value;
+			slots[hole].key.swap(slots[next].key);
+			slots[hole].used = true;
+			hole = next;
+		}
+		next = (next + 1) & mask;
+	}
+
+	slots[hole].used = false;
+	slots[hole].key.clear();
+	count--;
+}
+
+
+// clear
+// - Drop every entry but keep the table allocated
+//
+void NameIndex::clear() {
+	for(std::size_t i = 0; i < slots.size(); i++){
+		slots[i].used = false;
+		slots[i].key.clear();
+	}
+	count = 0;
+}
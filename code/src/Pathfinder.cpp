@@ -0,0 +1,611 @@
+#include "Pathfinder.h"
+#include "WorldGenerator.h"
+#include "Random.h"
+#include <iostream>
+#include <queue>
+#include <algorithm>
+
+//constants are bound to const references (vector::assign), so they need storage
+const uint32_t Pathfinder::NO_CLUSTER;
+const uint32_t Pathfinder::INFINITE;
+const uint32_t Pathfinder::CLUSTER_SIZE;
+
+// Open-list entry for A* (ordered by f = g + h, smallest first)
+struct OpenNode {
+	uint32_t f;
+	uint32_t g;
+	RoomId room;
+	bool operator<(const OpenNode& other) const { return f > other.f; }
+};
+
+
+// Pathfinder constructor
+// - Clusters are built on the first long-distance query, not here
+//
+Pathfinder::Pathfinder(const World& world)
+    : world(world), clustered(false), generation(0), a_generation(0), table_builds(0) {
+}
+
+
+// prepareScratch
+// - Make the stamped arrays cover every room and start a new search
+//
+void Pathfinder::prepareScratch() {
+	std::size_t n = world.roomCount();
+	if(stamp.size() < n){
+		stamp.resize(n, 0);
+		dist.resize(n, 0);
+		parent.resize(n, NO_ROOM);
+	}
+	generation++;
+	if(generation == 0){
+		//wrapped around - old stamps could look current
+		std::fill(stamp.begin(), stamp.end(), 0);
+		generation = 1;
+	}
+}
+
+
+// heuristic
+// - Manhattan distance on the grid, or 0 when we don't know the layout
+//
+uint32_t Pathfinder::heuristic(RoomId from, RoomId to) const {
+	unsigned int fx, fy, tx, ty;
+	if(!world.gridPosition(from, fx, fy) || !world.gridPosition(to, tx, ty)){
+		return 0;
+	}
+	uint32_t dx = fx > tx ? fx - tx : tx - fx;
+	uint32_t dy = fy > ty ? fy - ty : ty - fy;
+	return dx + dy;
+}
+
+
+// bfs
+// - Breadth-first search from -> to, filling dist/parent
+// - only_cluster != NO_CLUSTER keeps the search inside that cluster
+// - to == NO_ROOM searches the whole reachable area
+//
+bool Pathfinder::bfs(RoomId from, RoomId to, uint32_t only_cluster) {
+	prepareScratch();
+	std::vector<RoomId> queue;
+	queue.push_back(from);
+	stamp[from] = generation;
+	dist[from] = 0;
+	parent[from] = NO_ROOM;
+
+	for(std::size_t head = 0; head < queue.size(); head++){
+		RoomId room = queue[head];
+		if(room == to){
+			return true;
+		}
+		unsigned int end = world.exitEnd(room);
+		for(unsigned int e = world.exitBegin(room); e < end; e++){
+			RoomId next = world.exitTarget(e);
+			if(stamp[next] == generation){
+				continue;
+			}
+			if(only_cluster != NO_CLUSTER && cluster_of[next] != only_cluster){
+				continue;
+			}
+			stamp[next] = generation;
+			dist[next] = dist[room] + 1;
+			parent[next] = room;
+			queue.push_back(next);
+		}
+	}
+	return to == NO_ROOM;
+}
+
+
+// aStar
+// - A* with the grid heuristic (every exit costs 1), filling dist/parent
+//
+bool Pathfinder::aStar(RoomId from, RoomId to) {
+	prepareScratch();
+	std::priority_queue<OpenNode> open;
+	stamp[from] = generation;
+	dist[from] = 0;
+	parent[from] = NO_ROOM;
+	OpenNode start = { heuristic(from, to), 0, from };
+	open.push(start);
+
+	while(!open.empty()){
+		OpenNode node = open.top();
+		open.pop();
+		if(node.g != dist[node.room]){
+			continue;   //stale entry
+		}
+		if(node.room == to){
+			return true;
+		}
+		unsigned int end = world.exitEnd(node.room);
+		for(unsigned int e = world.exitBegin(node.room); e < end; e++){
+			RoomId next = world.exitTarget(e);
+			uint32_t g = node.g + 1;
+			if(stamp[next] == generation && dist[next] <= g){
+				continue;
+			}
+			stamp[next] = generation;
+			dist[next] = g;
+			parent[next] = node.room;
+			OpenNode push = { g + heuristic(next, to), g, next };
+			open.push(push);
+		}
+	}
+	return false;
+}
+
+
+// appendPath
+// - Walk parent links back from 'to' and append from..to (without 'from')
+//
+void Pathfinder::appendPath(RoomId from, RoomId to, std::vector<RoomId>& path) const {
+	std::size_t mark = path.size();
+	for(RoomId r = to; r != from && r != NO_ROOM; r = parent[r]){
+		path.push_back(r);
+	}
+	std::reverse(path.begin() + mark, path.end());
+}
+
+
+// findPath
+// - Same room: a one-room path
+// - Big clustered worlds: hierarchical search between clusters
+// - Otherwise A* on grid worlds, BFS everywhere else
+//
+bool Pathfinder::findPath(RoomId from, RoomId to, std::vector<RoomId>& path) {
+	path.clear();
+	if(from >= world.roomCount() || to >= world.roomCount()){
+		return false;
+	}
+	path.push_back(from);
+	if(from == to){
+		return true;
+	}
+
+	if(world.roomCount() >= HIERARCHY_THRESHOLD){
+		if(!clustered){
+			buildClusters();
+		}
+		uint32_t cf = from < cluster_of.size() ? cluster_of[from] : NO_CLUSTER;
+		uint32_t ct = to < cluster_of.size() ? cluster_of[to] : NO_CLUSTER;
+		if(cf != NO_CLUSTER && ct != NO_CLUSTER && cf != ct){
+			if(hierarchical(from, to, path)){
+				return true;
+			}
+			path.resize(1);
+		}
+	}
+
+	bool found = heuristic(from, to) > 0 ? aStar(from, to) : bfs(from, to, NO_CLUSTER);
+	if(!found){
+		path.clear();
+		return false;
+	}
+	appendPath(from, to, path);
+	return true;
+}
+
+
+// buildClusters
+// - Grow clusters of up to CLUSTER_SIZE rooms by BFS over the exits
+// - Mark every room with an exit into (or from) another cluster as a border
+//
+void Pathfinder::buildClusters() {
+	std::size_t n = world.roomCount();
+	cluster_of.assign(n, NO_CLUSTER);
+	border_index.assign(n, NO_CLUSTER);
+	is_border.assign(n, 0);
+	clusters.clear();
+
+	std::vector<RoomId> queue;
+	for(RoomId seed = 0; seed < n; seed++){
+		if(cluster_of[seed] != NO_CLUSTER || world.exitBegin(seed) == world.exitEnd(seed)){
+			continue;   //already placed, or a room with no exits at all
+		}
+		uint32_t c = (uint32_t)clusters.size();
+		clusters.push_back(Cluster());
+		queue.clear();
+		queue.push_back(seed);
+		cluster_of[seed] = c;
+		for(std::size_t head = 0; head < queue.size() && queue.size() < CLUSTER_SIZE; head++){
+			unsigned int end = world.exitEnd(queue[head]);
+			for(unsigned int e = world.exitBegin(queue[head]); e < end && queue.size() < CLUSTER_SIZE; e++){
+				RoomId next = world.exitTarget(e);
+				if(cluster_of[next] == NO_CLUSTER){
+					cluster_of[next] = c;
+					queue.push_back(next);
+				}
+			}
+		}
+		clusters[c].members = queue;
+	}
+
+	//rooms only reachable one-way still need a cluster
+	for(RoomId r = 0; r < n; r++){
+		unsigned int end = world.exitEnd(r);
+		for(unsigned int e = world.exitBegin(r); e < end; e++){
+			RoomId next = world.exitTarget(e);
+			if(cluster_of[next] == NO_CLUSTER){
+				assignToCluster(next, NO_CLUSTER);
+			}
+			if(cluster_of[next] != cluster_of[r]){
+				is_border[r] = 1;
+				is_border[next] = 1;
+			}
+		}
+	}
+
+	clustered = true;
+}
+
+
+// assignToCluster
+// - Put a new room into a cluster that still has room, or a new one
+//
+void Pathfinder::assignToCluster(RoomId room, uint32_t cluster) {
+	if(room >= cluster_of.size()){
+		std::size_t n = std::max<std::size_t>(world.roomCount(), room + 1);
+		cluster_of.resize(n, NO_CLUSTER);
+		border_index.resize(n, NO_CLUSTER);
+		is_border.resize(n, 0);
+	}
+	if(cluster == NO_CLUSTER || clusters[cluster].members.size() >= 2 * CLUSTER_SIZE){
+		cluster = (uint32_t)clusters.size();
+		clusters.push_back(Cluster());
+	}
+	cluster_of[room] = cluster;
+	clusters[cluster].members.push_back(room);
+	invalidate(cluster);
+}
+
+
+// invalidate
+// - Throw away a cluster's border list and cached distance table
+//
+void Pathfinder::invalidate(uint32_t c) {
+	clusters[c].borders_valid = false;
+	clusters[c].table_valid = false;
+}
+
+
+// exitAdded
+// - Place rooms we have not seen before next to their neighbour
+// - A new edge changes distances in its own cluster; an edge between
+//   clusters also adds borders on both sides. Nothing else is touched.
+//
+void Pathfinder::exitAdded(RoomId from, RoomId to) {
+	if(!clustered){
+		return;
+	}
+	if(from >= cluster_of.size() || cluster_of[from] == NO_CLUSTER){
+		assignToCluster(from, to < cluster_of.size() ? cluster_of[to] : NO_CLUSTER);
+	}
+	if(to >= cluster_of.size() || cluster_of[to] == NO_CLUSTER){
+		assignToCluster(to, cluster_of[from]);
+	}
+
+	uint32_t cf = cluster_of[from];
+	uint32_t ct = cluster_of[to];
+	invalidate(cf);
+	if(cf != ct){
+		is_border[from] = 1;
+		is_border[to] = 1;
+		invalidate(ct);
+	}
+}
+
+
+// worldReset
+// - Every cached cluster is meaningless now; rebuild on the next query
+//
+void Pathfinder::worldReset() {
+	clustered = false;
+	cluster_of.clear();
+	border_index.clear();
+	is_border.clear();
+	clusters.clear();
+	stamp.clear();
+	dist.clear();
+	parent.clear();
+	a_stamp.clear();
+	a_dist.clear();
+	a_parent.clear();
+}
+
+
+// ensureBorders
+// - List the border rooms of a cluster and number them
+//
+void Pathfinder::ensureBorders(uint32_t c) {
+	Cluster& cluster = clusters[c];
+	if(cluster.borders_valid){
+		return;
+	}
+	cluster.borders.clear();
+	for(std::size_t i = 0; i < cluster.members.size(); i++){
+		RoomId r = cluster.members[i];
+		if(is_border[r]){
+			border_index[r] = (uint32_t)cluster.borders.size();
+			cluster.borders.push_back(r);
+		}
+	}
+	cluster.borders_valid = true;
+}
+
+
+// ensureTable
+// - The distance cache: one BFS inside the cluster per border room,
+//   keeping only the border-to-border distances
+//
+void Pathfinder::ensureTable(uint32_t c) {
+	ensureBorders(c);
+	Cluster& cluster = clusters[c];
+	if(cluster.table_valid){
+		return;
+	}
+
+	std::size_t b = cluster.borders.size();
+	cluster.table.assign(b * b, INFINITE);
+	for(std::size_t i = 0; i < b; i++){
+		bfs(cluster.borders[i], NO_ROOM, c);
+		for(std::size_t j = 0; j < b; j++){
+			RoomId other = cluster.borders[j];
+			if(stamp[other] == generation){
+				cluster.table[i * b + j] = dist[other];
+			}
+		}
+	}
+	cluster.table_valid = true;
+	table_builds++;
+}
+
+
+// hierarchical
+// - Distances from 'from' to its cluster's borders and from the target
+//   cluster's borders to 'to' (BFS inside those two clusters only)
+// - A* over border rooms: cached in-cluster distances plus single exits
+//   between clusters
+// - Refine each abstract step into rooms with BFS inside its cluster
+//
+bool Pathfinder::hierarchical(RoomId from, RoomId to, std::vector<RoomId>& path) {
+	uint32_t cf = cluster_of[from];
+	uint32_t ct = cluster_of[to];
+	ensureBorders(cf);
+	ensureBorders(ct);
+
+	//from -> borders of its own cluster
+	std::vector<uint32_t> start_dist(clusters[cf].borders.size(), INFINITE);
+	bfs(from, NO_ROOM, cf);
+	for(std::size_t i = 0; i < clusters[cf].borders.size(); i++){
+		RoomId border = clusters[cf].borders[i];
+		if(stamp[border] == generation){
+			start_dist[i] = dist[border];
+		}
+	}
+
+	//borders of the target cluster -> to
+	std::vector<uint32_t> goal_dist(clusters[ct].borders.size(), INFINITE);
+	for(std::size_t i = 0; i < clusters[ct].borders.size(); i++){
+		if(bfs(clusters[ct].borders[i], to, ct)){
+			goal_dist[i] = dist[to];
+		}
+	}
+
+	//A* over the border graph (a_* arrays; bfs() keeps using the others)
+	std::size_t n = world.roomCount();
+	if(a_stamp.size() < n){
+		a_stamp.resize(n, 0);
+		a_dist.resize(n, 0);
+		a_parent.resize(n, NO_ROOM);
+	}
+	a_generation++;
+	if(a_generation == 0){
+		std::fill(a_stamp.begin(), a_stamp.end(), 0);
+		a_generation = 1;
+	}
+
+	std::priority_queue<OpenNode> open;
+	a_stamp[from] = a_generation;
+	a_dist[from] = 0;
+	a_parent[from] = NO_ROOM;
+	OpenNode start = { heuristic(from, to), 0, from };
+	open.push(start);
+	bool found = false;
+	std::vector<std::pair<RoomId, uint32_t> > edges;
+
+	while(!open.empty()){
+		OpenNode node = open.top();
+		open.pop();
+		RoomId u = node.room;
+		if(node.g != a_dist[u]){
+			continue;
+		}
+		if(u == to){
+			found = true;
+			break;
+		}
+
+		//collect (next, cost) edges of this abstract node
+		edges.clear();
+		uint32_t cu = cluster_of[u];
+		if(u == from){
+			for(std::size_t i = 0; i < start_dist.size(); i++){
+				if(start_dist[i] != INFINITE){
+					edges.push_back(std::make_pair(clusters[cf].borders[i], start_dist[i]));
+				}
+			}
+		}
+		if(is_border[u]){
+			ensureTable(cu);
+			const Cluster& cluster = clusters[cu];
+			std::size_t b = cluster.borders.size();
+			std::size_t row = border_index[u] * b;
+			for(std::size_t j = 0; j < b; j++){
+				if(cluster.table[row + j] != INFINITE && cluster.borders[j] != u){
+					edges.push_back(std::make_pair(cluster.borders[j], cluster.table[row + j]));
+				}
+			}
+			unsigned int end = world.exitEnd(u);
+			for(unsigned int e = world.exitBegin(u); e < end; e++){
+				RoomId next = world.exitTarget(e);
+				if(cluster_of[next] != cu){
+					edges.push_back(std::make_pair(next, 1u));
+				}
+			}
+			if(cu == ct && goal_dist[border_index[u]] != INFINITE){
+				edges.push_back(std::make_pair(to, goal_dist[border_index[u]]));
+			}
+		}
+
+		for(std::size_t i = 0; i < edges.size(); i++){
+			RoomId next = edges[i].first;
+			uint32_t g = node.g + edges[i].second;
+			if(a_stamp[next] == a_generation && a_dist[next] <= g){
+				continue;
+			}
+			a_stamp[next] = a_generation;
+			a_dist[next] = g;
+			a_parent[next] = u;
+			OpenNode push = { g + heuristic(next, to), g, next };
+			open.push(push);
+		}
+	}
+	if(!found){
+		return false;
+	}
+
+	//abstract route, from .. to
+	std::vector<RoomId> route;
+	for(RoomId r = to; r != NO_ROOM; r = a_parent[r]){
+		route.push_back(r);
+	}
+	std::reverse(route.begin(), route.end());
+
+	//refine: neighbouring clusters are one exit apart, same cluster needs a BFS
+	for(std::size_t i = 1; i < route.size(); i++){
+		RoomId a = route[i - 1];
+		RoomId b = route[i];
+		if(a == b){
+			continue;
+		}
+		if(cluster_of[a] != cluster_of[b]){
+			path.push_back(b);
+			continue;
+		}
+		if(!bfs(a, b, cluster_of[a])){
+			return false;
+		}
+		appendPath(a, b, path);
+	}
+	return true;
+}
+
+
+// checkRoutes
+// - findPath against a BFS from scratch on random pairs: count routes
+//   that are longer, and routes that use an exit the world doesn't have
+//
+static void checkRoutes(const World& world, Pathfinder& finder, RandomStream& rng, unsigned int queries,
+                        unsigned int& longer, unsigned int& broken) {
+	std::size_t n = world.roomCount();
+	std::vector<uint32_t> dist(n);
+	std::vector<RoomId> queue;
+	std::vector<RoomId> path;
+	for(unsigned int q = 0; q < queries; q++){
+		RoomId from = (RoomId)rng.below((int)n);
+		RoomId to = (RoomId)rng.below((int)n);
+		bool found = finder.findPath(from, to, path);
+
+		std::fill(dist.begin(), dist.end(), 0xFFFFFFFFu);
+		dist[from] = 0;
+		queue.assign(1, from);
+		for(std::size_t head = 0; head < queue.size() && dist[to] == 0xFFFFFFFFu; head++){
+			RoomId room = queue[head];
+			for(unsigned int e = world.exitBegin(room); e < world.exitEnd(room); e++){
+				RoomId next = world.exitTarget(e);
+				if(dist[next] == 0xFFFFFFFFu){
+					dist[next] = dist[room] + 1;
+					queue.push_back(next);
+				}
+			}
+		}
+
+		if(found != (dist[to] != 0xFFFFFFFFu)){
+			broken++;
+			continue;
+		}
+		if(!found){
+			continue;
+		}
+		if(path.front() != from || path.back() != to){
+			broken++;
+			continue;
+		}
+		for(std::size_t i = 1; i < path.size(); i++){
+			bool exit = false;
+			for(unsigned int e = world.exitBegin(path[i - 1]); e < world.exitEnd(path[i - 1]); e++){
+				exit = exit || world.exitTarget(e) == path[i];
+			}
+			if(!exit){
+				broken++;
+				break;
+			}
+		}
+		if(path.size() - 1 > dist[to]){
+			longer++;
+		}
+	}
+}
+
+
+// check
+// - Routes on the plain grid (A* with the Manhattan heuristic), then
+//   after up/down exits between random rooms have been added, when only
+//   the exact searches are safe
+//
+bool Pathfinder::check(unsigned int rooms, unsigned int jumps, unsigned int queries, unsigned long long seed) {
+	World world;
+	Pathfinder finder(world);
+	world.setExitListener(&finder);
+
+	GeneratorConfig config;
+	config.room_count = rooms;
+	config.seed = seed;
+	config.monster_density = 0;
+	config.item_density = 0;
+	WorldGenerator generator(config);
+	generator.generate(world, NULL);
+	rooms = (unsigned int)world.roomCount();
+
+	RandomStream rng(seed, 0);
+	unsigned int longer[2] = { 0, 0 };
+	unsigned int broken[2] = { 0, 0 };
+	checkRoutes(world, finder, rng, queries, longer[0], broken[0]);
+
+	int up = world.internDirection("up");
+	int down = world.internDirection("down");
+	for(unsigned int j = 0; j < jumps; j++){
+		RoomId a = (RoomId)rng.below((int)rooms);
+		RoomId b = (RoomId)rng.below((int)rooms);
+		world.addExit(a, up, b);
+		world.addExit(b, down, a);
+	}
+	unsigned int x, y;
+	bool grid = world.gridPosition(0, x, y);
+	checkRoutes(world, finder, rng, queries, longer[1], broken[1]);
+	world.setExitListener(NULL);
+
+	bool ok = longer[0] + longer[1] + broken[0] + broken[1] == 0;
+	std::cout << "========================================" << std::endl;
+	std::cout << "Path check: " << rooms << " rooms, " << queries << " routes before and after "
+	          << jumps << " up/down exits" << std::endl;
+	for(int phase = 0; phase < 2; phase++){
+		std::cout << (phase == 0 ? "  Grid only:   " : "  With jumps:  ") << longer[phase]
+		          << " longer than BFS, " << broken[phase] << " broken" << std::endl;
+	}
+	std::cout << "  Heuristic:   " << (grid ? "grid kept" : "grid dropped") << std::endl;
+	std::cout << "  Results:     " << (ok ? "all shortest" : "MISMATCH") << std::endl;
+	std::cout << "========================================" << std::endl;
+	return ok;
+}
@@ -1,95 +1,110 @@
 #include "Player.h"
+#include "Serializer.h"
 #include <iostream>
-#include <algorithm>
+
+// Bonuses for each level after the first (MOD_LEVEL modifiers)
+static const int LEVEL_HP = 10;
+static const int LEVEL_ATTACK = 2;
+static const int LEVEL_DEFENSE = 1;
+
+// The stat a worn item raises by its value
+static StatKind wornStat(const Item* item) {
+	return item->getKind() == ITEM_WEAPON ? STAT_ATTACK : STAT_DEFENSE;
+}
+
 
 // Player constructor
 // - MUST call Character base constructor. 
+// - Nothing equipped
 //
 Player::Player(const std::string& name)
     : Character(name, 100, 10, 5),
-      level(1), experience(0), gold(0),
-      equipped_weapon(NULL), equipped_armor(NULL) {
+      level(1), experience(0), gold(0) {
+	for(int s = 0; s < EQUIP_SLOT_COUNT; s++){
+		equipped[s] = NULL;
+	}
 }
 
 
 // Player destructor
 // - CRITICAL: Must delete all items in inventory to prevent memory leaks!
-// - DON'T delete equipped_weapon or equipped_armor - they point to items
-//   already in the inventory, so they're already deleted!
+// - DON'T delete the equipped items - they point to items already in
+//   the inventory, so they're already deleted!
 //
 Player::~Player() {
     // Delete all inventory items
 
-	//loop through inventory
-	for(int i = 0; i < (int)inventory.size(); i++){
-		//free each item in inventory
-		delete inventory[i];
-	}
-	//actually clear the vector
-	inventory.clear();
+	//free each item in inventory and clear the bag
+	inventory.deleteAll();
 }
 
 
 // Override displayStats
 // - Show player-specific information
-// - Include: level, HP, attack (with weapon bonus), defense (with armor bonus), gold, experience
-// - Show equipped weapon and armor names if any
+// - Include: level, HP, attack, defense (effective values, with where the
+//   bonuses come from), gold, experience
+// - Show what is in each equipment slot
 // - Use decorative formatting (borders, headers)
 // - Use getters to access inherited Character data
 //
-void Player::displayStats() const {
+void Player::displayStats(std::ostream& out) const {
     // Display comprehensive player stats
 
-	//set weaponBonus and armorBonus so its not just null
-	int weaponBonus = (equipped_weapon) ? equipped_weapon->getValue() : 0;
-	int armorBonus = (equipped_armor) ? equipped_armor->getValue() : 0;
-
 	//print divider
-	std::cout << "--------------------" << std::endl;
+	out << "--------------------" << std::endl;
 
 	//print name
-	std::cout << "[PLAYER] " << getName() << std::endl;
+	out << "[PLAYER] " << getName() << std::endl;
 
 	//print level
-	std::cout << "  Level: " << getLevel() << std::endl;
-
-	//print current HP
-	std::cout << "  HP: " << getCurrentHP() << std::endl;
-
-	//print attack and weapon bonus
-	std::cout << "  Attack: " << getAttack() << " (Weapon Bonus: " << weaponBonus << ")" << std::endl;
-
-	//print defense and armor bonus
-	std::cout << "  Defense: " << getDefense() << " (Armor Bonus: " << armorBonus << ")" << std::endl;
+	out << "  Level: " << getLevel() << std::endl;
+
+	//print current and max HP
+	out << "  HP: " << getCurrentHP() << "/" << getMaxHP();
+	getStats().displayBreakdown(STAT_MAX_HP, out);
+	out << std::endl;
+
+	//print attack and its bonuses
+	out << "  Attack: " << getAttack();
+	getStats().displayBreakdown(STAT_ATTACK, out);
+	out << std::endl;
+
+	//print defense and its bonuses
+	out << "  Defense: " << getDefense();
+	getStats().displayBreakdown(STAT_DEFENSE, out);
+	out << std::endl;
+
+	//print each filled equipment slot
+	for(int s = 0; s < EQUIP_SLOT_COUNT; s++){
+		if(equipped[s] != NULL){
+			out << "  [" << Item::slotName((EquipSlot)s) << "] " << equipped[s]->getName()
+			          << " (+" << equipped[s]->getValue() << ")" << std::endl;
+		}
+	}
 
 	//print gold
-	std::cout << "  Gold: " << getGold() << std::endl;
+	out << "  Gold: " << getGold() << std::endl;
 
 	//print experience
-	std::cout << "  Experience: " << getExperience() << std::endl;
+	out << "  Experience: " << getExperience() << std::endl;
+
+	//print status effects, if any
+	displayEffects(out);
 
 	//print divider
-	std::cout << "--------------------" << std::endl;
+	out << "--------------------" << std::endl;
 }
 
 
 // Override calculateDamage to include weapon bonus
-// - If weapon is equipped, add weapon's damage bonus
+// - The weapon's bonus is an equipment modifier, already in the cached
+//   attack total along with levels and buffs
 // - Return total damage
 //
 int Player::calculateDamage() const {
     // Calculate damage with weapon bonus
-	//get initial attack damage
-	int newDamage = getAttack();
-
-	//if weapon is equipped
-	if(equipped_weapon){
-		//add weapon damage and attack damage to get total damage
-		newDamage += equipped_weapon->getValue();
-	}
-
-	//return total damage
-	return newDamage;
+	//attack already includes the weapon (CombatRules::weaponStrike's sum)
+	return getAttack();
 }
 
 
@@ -97,7 +112,7 @@ int Player::calculateDamage() const {
 // - Add item to inventory vector using push_back()
 // - Print pickup message with item name
 //
-void Player::addItem(Item* item) {
+void Player::addItem(Item* item, std::ostream& out) {
     // Add item to inventory
 
 	//check if item is NULL
@@ -107,61 +122,39 @@ void Player::addItem(Item* item) {
 		return;
 	}
 
-	//add item to inventory
-	inventory.push_back(item);
+	//add item to inventory (indexes its name)
+	inventory.add(item);
 
 	//Tell user that they "picked up" the item (added it to their inventory)
-	std::cout << "You picked up: " << item->getName() << std::endl;
+	out << "You picked up: " << item->getName() << std::endl;
 }
 
 
 //  removeItem
-// - Search inventory for item by name (case-insensitive comparison)
-// - If found: delete the item, then erase from vector
+// - Take item out of the inventory by name (hashed, case-insensitive)
+// - If found: unequip it if needed, then delete it
 // - If not found: print error message
-// - Remember: inventory.erase(inventory.begin() + i) to remove at index i
 //
-void Player::removeItem(const std::string& item_name) {
+void Player::removeItem(const std::string& item_name, std::ostream& out) {
     // Find and remove item from inventory
 
-	//copy parameter to modify in s1
-	std::string s1 = item_name;
-
-	//make s1 lowercase
-	std::transform(s1.begin(), s1.end(), s1.begin(), ::tolower);
-
-	//place holder for string in inventory
-	std::string s2;
+	//take item out of the inventory (no copies of the name)
+	Item* item = inventory.take(item_name);
 
-	//flag to see if found
-	bool found = false;
-
-	//foe each item in inventory
-	for(int i = 0; i < (int)inventory.size(); i++) {
-		//put item name into s2
-		s2 = inventory[i]->getName();
-
-		//make s2 lowercase
-		std::transform(s2.begin(), s2.end(), s2.begin(), ::tolower);
-
-		//if names are identical
-		if(s1 == s2){
-			//delete item
-			delete inventory[i];
-			//remove item from inventory
-			inventory.erase(inventory.begin() + i);
-			//set found flag
-			found = true;
-			//break
-			break;
-		}
-
-	}
 	//if not found
-	if(!found){
+	if(item == NULL){
 		//print error message
-		std::cout << "Error: Item not found!" << std::endl;
+		out << "Error: Item not found!" << std::endl;
+		return;
+	}
+
+	//don't leave equipment pointing at a deleted item (or its bonus behind)
+	if(item->getSlot() != EQUIP_NONE && equipped[item->getSlot()] == item){
+		takeOff(item->getSlot());
 	}
+
+	//delete item
+	delete item;
 }
 
 
@@ -172,139 +165,133 @@ void Player::removeItem(const std::string& item_name) {
 // - Format: "- ItemName (ItemType)"
 // - Print footer: "--------------------"
 //
-void Player::displayInventory() const {
+void Player::displayInventory(std::ostream& out) const {
     // Display all items in inventory
 
 	//print header
-	std::cout << "----- Inventory -----" << std::endl;
+	out << "----- Inventory -----" << std::endl;
 
 	//if empty, skip to printing footer
 	if(inventory.size() == 0){
-		std::cout << "Empty" << std::endl;
+		out << "Empty" << std::endl;
 		goto print_end;
 	}
 
 	//print each item in inventory (name and type)
-	for(int i = 0; i < (int)inventory.size(); i++){
-		std::cout << "- " << inventory[i]->getName() << " (" << inventory[i]->getType() << ")" << std::endl;
+	for(std::size_t i = 0; i < inventory.size(); i++){
+		out << "- " << inventory[i]->getName() << " (" << inventory[i]->getType() << ")" << std::endl;
 	}
 	//print footer
 	print_end:
-		std::cout << "--------------------" << std::endl;
+		out << "--------------------" << std::endl;
 }
 
 
 // hasItem
-// - Search inventory for item by name (case-insensitive)
+// - Look item up in the name index (case-insensitive)
 // - Return true if found, false otherwise
-// - Use same case-insensitive comparison as removeItem
 //
 bool Player::hasItem(const std::string& item_name) const {
     // Check if item exists in inventory
-
-	//copy parameter to modify in s1
-        std::string s1 = item_name;
-
-        //make s1 lowercase
-        std::transform(s1.begin(), s1.end(), s1.begin(), ::tolower);
-
-        //place holder for string in inventory
-        std::string s2;
-
-        //print each item in inventory (name and type)
-        for(int i = 0; i < (int)inventory.size(); i++){
-                //put item name into s2
-                s2 = inventory[i]->getName();
-
-                //make s2 lowercase
-                std::transform(s2.begin(), s2.end(), s2.begin(), ::tolower);
-
-                //if names are identical
-                if(s1 == s2){
-			//return true
-                        return true;
-                }
-	}
-
-	//if not found, return false
-	return false;
+	return inventory.contains(item_name);
 }
 
 
 // getItem
-// - Search inventory for item by name (case-insensitive)
+// - Look item up in the name index (case-insensitive)
 // - Return pointer to item if found
 // - Return NULL if not found
 //
 Item* Player::getItem(const std::string& item_name) {
     // Find and return item pointer
+	return inventory.find(item_name);
+}
 
-        //copy parameter to modify in s1
-        std::string s1 = item_name;
 
-        //make s1 lowercase
-        std::transform(s1.begin(), s1.end(), s1.begin(), ::tolower);
+// pickUp
+// - Move one item by name from source into the inventory
+// - Print pickup message; return NULL if source doesn't have it
+//
+Item* Player::pickUp(ItemBag& source, const std::string& item_name, std::ostream& out) {
+	Item* item = source.transfer(inventory, item_name);
+	if(item != NULL){
+		out << "You picked up: " << item->getName() << std::endl;
+	}
+	return item;
+}
 
-        //place holder for string in inventory
-        std::string s2;
 
-        for(int i = 0; i < (int)inventory.size(); i++){
-                //put item name into s2
-                s2 = inventory[i]->getName();
+// pickUpAll
+// - Move everything from source into the inventory in one transfer
+// - Print a pickup message per item; return how many were taken
+//
+std::size_t Player::pickUpAll(ItemBag& source, std::ostream& out) {
+	std::size_t first = inventory.size();
+	std::size_t moved = source.transferAll(inventory);
+	for(std::size_t i = first; i < inventory.size(); i++){
+		out << "You picked up: " << inventory[i]->getName() << std::endl;
+	}
+	return moved;
+}
 
-                //make s2 lowercase
-                std::transform(s2.begin(), s2.end(), s2.begin(), ::tolower);
 
-                //if names are identical
-                if(s1 == s2){
-			//return pointer to item
-                        return inventory[i];
-                }
-        }
+// wear
+// - Take off whatever is in the item's slot, then put the item there
+// - Its value goes into the equipment modifier for its stat
+//
+void Player::wear(Item* item) {
+	EquipSlot slot = item->getSlot();
+	takeOff(slot);
+	equipped[slot] = item;
+	addModifier(MOD_EQUIPMENT, wornStat(item), item->getValue());
+}
+
 
-        //if not found, return NULL
-        return NULL;
+// takeOff
+// - Empty the slot and take its item's value back out of the modifier
+//
+void Player::takeOff(EquipSlot slot) {
+	Item* item = equipped[slot];
+	if(item == NULL){
+		return;
+	}
+	addModifier(MOD_EQUIPMENT, wornStat(item), -item->getValue());
+	equipped[slot] = NULL;
 }
 
 
 // equipWeapon
 // - Get item from inventory using getItem()
 // - Check if item exists (not NULL)
-// - Check if item type is "Weapon"
-// - If current weapon equipped, print unequip message
-// - Set equipped_weapon pointer to this item
+// - Check the type tag with item_cast<Weapon>
+// - Put it in the weapon slot (replacing the old one)
 // - Print equip message
 //
-void Player::equipWeapon(const std::string& weapon_name) {
+void Player::equipWeapon(const std::string& weapon_name, std::ostream& out) {
     // Equip weapon from inventory
 
 	//get pointer to weapon from inventory
-	Item* equip = getItem(weapon_name);
+	Item* item = getItem(weapon_name);
 
 	//if NULL (not there)
-	if(equip == NULL) {
+	if(item == NULL) {
 		//print error message
-		std::cout << "Error: " << weapon_name << " not found." << std::endl;
+		out << "Error: " << weapon_name << " not found." << std::endl;
 		//return
 		return;
 	}
 
-	//get item type to make sure it is a weapon
-	std::string itemType = equip->getType();
-
-	//make it lowercase for comparison
-	std::transform(itemType.begin(), itemType.end(), itemType.begin(), ::tolower);
-
 	//if correct type (weapon)
-	if(itemType == "weapon"){
+	Weapon* weapon = item_cast<Weapon>(item);
+	if(weapon){
 		//if already equipped, print already equipped message
-		if(equipped_weapon == equip) {
-			std::cout << weapon_name << " already equipped." << std::endl;
+		if(equipped[EQUIP_WEAPON] == weapon) {
+			out << weapon_name << " already equipped." << std::endl;
 		}
 		//otherwise, equip, and print equip message
 		else {
-			equipped_weapon = equip;
-			std::cout << weapon_name << " equipped." << std::endl;
+			wear(weapon);
+			out << weapon_name << " equipped." << std::endl;
 		}
 	}
 }
@@ -312,109 +299,81 @@ void Player::equipWeapon(const std::string& weapon_name) {
 
 // equipArmor
 // - Similar to equipWeapon but for armor
-// - Check if item type is "Armor"
-// - Set equipped_armor pointer
+// - Check the type tag with item_cast<Armor>
+// - Goes in the armor's own slot (body, head, shield, ...), so pieces
+//   for different slots are worn together
 //
-void Player::equipArmor(const std::string& armor_name) {
+void Player::equipArmor(const std::string& armor_name, std::ostream& out) {
     // Equip armor from inventory
 
         //get pointer to armor from inventory
-        Item* equip = getItem(armor_name);
+        Item* item = getItem(armor_name);
 
         //if NULL (not there)
-        if(equip == NULL) {
+        if(item == NULL) {
                 //print error message
-                std::cout << "Error: " << armor_name << " not found." << std::endl;
+                out << "Error: " << armor_name << " not found." << std::endl;
                 //return
                 return;
         }
 
-        //get item type to make sure it is armor
-        std::string itemType = equip->getType();
-
-        //make it lowercase for comparison
-        std::transform(itemType.begin(), itemType.end(), itemType.begin(), ::tolower);
-
         //if correct type (armor)
-        if(itemType == "armor"){
+        Armor* armor = item_cast<Armor>(item);
+        if(armor){
                 //if already equipped, print already equipped message
-                if(equipped_armor == equip) {
-                        std::cout << armor_name << " already equipped." << std::endl;
+                if(equipped[armor->getSlot()] == armor) {
+                        out << armor_name << " already equipped." << std::endl;
                 }
                 //otherwise, equip, and print equip message
                 else {
-                        equipped_armor = equip;
-                        std::cout << armor_name << " equipped." << std::endl;
+                        wear(armor);
+                        out << armor_name << " equipped (" << Item::slotName(armor->getSlot()) << ")." << std::endl;
                 }
         }
 }
 
 
-// unequipWeapon
-// - Check if weapon is currently equipped
-// - If so, print message and set equipped_weapon to NULL
+// unequip
+// - Check if the slot holds anything
+// - If so, print message and empty it (its bonus goes with it)
 // - If not, print error message
 //
-void Player::unequipWeapon() {
-    // Unequip current weapon
-
-	//if weapon not equipped
-	if(!equipped_weapon) {
+void Player::unequip(EquipSlot slot, std::ostream& out) {
+	//if nothing in the slot
+	if(equipped[slot] == NULL){
 		//print error message
-		std::cout << "Error: No weapon equipped." << std::endl;
-		//return
+		out << "Error: Nothing equipped (" << Item::slotName(slot) << ")." << std::endl;
 		return;
 	}
 
-	//if weapon is equipped
-	else{
-		//print unequipped message
-		std::cout << "[WEAPON]: " << equipped_weapon << " unequipped." << std::endl;
-
-		//set equipped_weapon to NULL
-		equipped_weapon = NULL;
-	}
+	//print unequipped message, then empty the slot
+	out << "[" << Item::slotName(slot) << "]: " << equipped[slot]->getName() << " unequipped." << std::endl;
+	takeOff(slot);
 }
 
 
-// unequipArmor
-// - Similar to unequipWeapon
-// - Set equipped_armor to NULL
-//
-void Player::unequipArmor() {
-    // Unequip current armor
-
-        //if armor not equipped
-        if(!equipped_armor) {
-                //print error message
-                std::cout << "Error: No armor equipped." << std::endl;
-                //return
-                return;
-        }
-
-        //if armor is equipped
-        else{
-                //print unequipped message
-                std::cout << "[ARMOR]: " << equipped_armor << " unequipped." << std::endl;
+// unequipWeapon / unequipArmor - the weapon and body slots
+void Player::unequipWeapon(std::ostream& out) {
+	unequip(EQUIP_WEAPON, out);
+}
 
-                //set equipped_armor to NULL
-                equipped_armor = NULL;
-        }
+void Player::unequipArmor(std::ostream& out) {
+	unequip(EQUIP_BODY, out);
 }
 
 
 // useItem
 // - Get item from inventory using getItem()
 // - Check if item exists (not NULL)
-// - Check if item type is "Consumable"
-// - Cast to Consumable*: Consumable* consumable = static_cast<Consumable*>(item)
+// - Checked cast on the type tag: Consumable* consumable = item_cast<Consumable>(item)
 // - Check if already used: consumable->isUsed()
 // - Get healing amount: consumable->getHealingAmount()
 // - Call heal() with that amount
+// - Apply its status effect, if any (regeneration, buffs)
 // - Call consumable->use() to mark as used
 // - Remove item from inventory (it's been consumed!)
 //
-void Player::useItem(const std::string& item_name) {
+void Player::useItem(const std::string& item_name, StatusEffects& effects, std::ostream& out) {
     // Use consumable item
 
 	//get pointer to item from inventory
@@ -423,42 +382,46 @@ void Player::useItem(const std::string& item_name) {
         //if NULL (not there)
         if(item == NULL) {
                 //print error message
-                std::cout << "Error: " << item_name << " not found." << std::endl;
+                out << "Error: " << item_name << " not found." << std::endl;
                 //return
                 return;
         }
 
 	//if there
 	else{
-		//if item type is "Consumable"
-		if(item->getType() == "Consumable"){
-
-			//Cast to Consumable*
-			Consumable* consumable = static_cast<Consumable*>(item);
+		//if item is a Consumable (type tag check, no RTTI)
+		Consumable* consumable = item_cast<Consumable>(item);
+		if(consumable){
 
 			//Check if already used
 			if(!consumable->isUsed()){
 
 				//Call heal() with healing amount
-				heal(consumable->getHealingAmount());
+				if(consumable->getHealingAmount() > 0){
+					heal(consumable->getHealingAmount(), out);
+				}
+
+				//and put on its effect, if it has one
+				effects.apply(*this, consumable->getEffect());
 
 				//Call consumable->use() to mark as used
-				consumable->use();
+				consumable->use(out);
 
-				//remove item from inventory
-				removeItem(item_name);
+				//remove this item from inventory (no second lookup)
+				inventory.remove(item);
+				delete item;
 			}
 
 			//if already used
 			else{
-				std::cout << "Error: " << item_name << " already used." << std::endl;
+				out << "Error: " << item_name << " already used." << std::endl;
 			}
 		}
 
 		//if item is not consumable
 		else {
 			//print error statement, not consumable
-			std::cout << "Error: " << item_name << " is not consumable." << std::endl;
+			out << "Error: " << item_name << " is not consumable." << std::endl;
 		}
 	}
 }
@@ -470,33 +433,33 @@ void Player::useItem(const std::string& item_name) {
 // - Check if enough exp to level up: if (experience >= level * 100)
 // - If so, call levelUp()
 //
-void Player::gainExperience(int exp) {
+void Player::gainExperience(int exp, std::ostream& out) {
     // Add experience and check for level up
 
 	//Add experience points
 	experience += exp;
 
 	//print message showing exp gained
-	std::cout << "+" << exp << " XP!" << std::endl;
+	out << "+" << exp << " XP!" << std::endl;
 
 	//check if enough exp to level up
 	if(experience >= level * 100)
-		levelUp();
+		levelUp(out);
 }
 
 
 // levelUp
 // - Increment level
 // - Reset experience to 0
-// - Increase stats:
-//   * Increase max_hp by 10 (use setMaxHP())
+// - Increase stats (the level modifiers, not the base stats):
+//   * Increase max_hp by 10 per level gained
 //   * Set current_hp to max (full heal on level up)
 //   * Increase attack by 2
 //   * Increase defense by 1
 // - Print celebratory level up message
 // - Display new stats
 //
-void Player::levelUp() {
+void Player::levelUp(std::ostream& out) {
     // Level up the player
 
 	//increment level
@@ -505,22 +468,92 @@ void Player::levelUp() {
 	//reset experience to 0
 	experience = 0;
 
-	//increase max_hp by 10
-	setMaxHP(getMaxHP() + 10);
+	//increase max_hp by 10 a level
+	int gained = level - 1;
+	setModifier(MOD_LEVEL, STAT_MAX_HP, gained * LEVEL_HP);
 
 	//set current_hp to max
 	setCurrentHP(getMaxHP());
 
-	//increase attack by 2
-	setAttack(getAttack() + 2);
+	//increase attack by 2 a level
+	setModifier(MOD_LEVEL, STAT_ATTACK, gained * LEVEL_ATTACK);
 
-	//increase defense by 1
-	setDefense(getDefense() + 1);
+	//increase defense by 1 a level
+	setModifier(MOD_LEVEL, STAT_DEFENSE, gained * LEVEL_DEFENSE);
 
 	//Print celebratory level up message
-	std::cout << "Yay! " << getName() << " leveled up!" << std::endl;
+	out << "Yay! " << getName() << " leveled up!" << std::endl;
 
 	//display stats
-	displayStats();
+	displayStats(out);
+
+}
+
+
+// serialize
+// - Character state, then level, experience and gold
+// - The inventory in order; each slot as an inventory index (-1 empty)
+//
+void Player::serialize(ByteWriter& out) const {
+	writeState(out);
+	out.putI32(level);
+	out.putI32(experience);
+	out.putI32(gold);
+
+	out.putU32((uint32_t)inventory.size());
+	for(std::size_t i = 0; i < inventory.size(); i++){
+		inventory[i]->serialize(out);
+	}
+	for(int s = 0; s < EQUIP_SLOT_COUNT; s++){
+		int worn = -1;
+		for(std::size_t i = 0; i < inventory.size() && equipped[s] != NULL; i++){
+			if(inventory[i] == equipped[s]){
+				worn = (int)i;
+			}
+		}
+		out.putI32(worn);
+	}
+}
+
+
+// restore
+// - Read everything serialize() wrote; the old inventory is deleted
+// - Slots point back into the new inventory without re-wearing anything
+//   (the equipment modifiers came back with the Character state)
+// - False if the data is bad
+//
+bool Player::restore(ByteReader& in) {
+	if(!readState(in)){
+		return false;
+	}
+	int saved_level = in.getI32();
+	int saved_experience = in.getI32();
+	int saved_gold = in.getI32();
+	uint32_t count = in.getU32();
+	if(!in.ok()){
+		return false;
+	}
+
+	for(int s = 0; s < EQUIP_SLOT_COUNT; s++){
+		equipped[s] = NULL;
+	}
+	inventory.deleteAll();
+	for(uint32_t i = 0; i < count; i++){
+		Item* item = Item::deserialize(in);
+		if(item == NULL){
+			return false;
+		}
+		inventory.add(item);
+	}
+	for(int s = 0; s < EQUIP_SLOT_COUNT; s++){
+		int worn = in.getI32();
+		if(worn >= 0 && (std::size_t)worn < inventory.size()){
+			equipped[s] = inventory[worn];
+		}
+	}
 
+	level = saved_level;
+	experience = saved_experience;
+	gold = saved_gold;
+	return in.ok();
 }
@@ -0,0 +1,28 @@
+#include "Random.h"
+
+const unsigned long long RandomStream::GOLDEN;
+
+// reseed
+// - Key is the seed hashed together with the stream id
+// - 0 is kept free to mean "not seeded"
+//
+void RandomStream::reseed(unsigned long long seed, unsigned long long stream) {
+	key = mix64(seed ^ mix64(stream));
+	if(key == 0){
+		key = GOLDEN;
+	}
+	counter = 0;
+}
+
+
+// fill
+// - No dependency between rolls, so the loop runs back to back
+//   (and vectorizes) instead of one call per roll
+//
+void RandomStream::fill(unsigned int* out, std::size_t n) {
+	unsigned long long base = key + GOLDEN * counter;
+	for(std::size_t i = 0; i < n; i++){
+		out[i] = (unsigned int)(mix64(base + GOLDEN * i) >> 32);
+	}
+	counter += n;
+}
@@ -1,29 +1,24 @@
 #include "Room.h"
+#include "Serializer.h"
 #include <iostream>
 #include <algorithm>
 
+const unsigned int Room::NO_SPAWN;
+
 // Room constructor
 Room::Room(const std::string& name, const std::string& description)
-    : name(name), description(description), visited(false), monster(NULL) {
+    : name(name), description(description), visited(false),
+      spawn(NO_SPAWN), spawn_count(0), world(NULL), id(NO_ROOM) {
 }
 
 
 // Room destructor
 Room::~Room() {
-    // Clean up monster and items
-
-	//if monster exists, delete it
-	if(monster != NULL) {
-		delete monster;
-	}
+    // Clean up monsters and items
+	//(the monster group deletes its own members)
 
-	//loop through items
-        for(int i = 0; i < (int)items.size(); i++){
-                //free each item
-                delete items[i];
-        }
-        //actually clear the vector
-        items.clear();
+	//free each item and clear the bag
+	items.deleteAll();
 
 }
 
@@ -37,6 +32,8 @@ Room::~Room() {
 //   Description text
 //   
 //   [If monster] A MonsterName blocks your path!
+//   [If several] Monsters block your path:
+//                  1. Goblin [HP: 30/30] ...
 //   
 //   [If items] Items here:
 //     - item1
@@ -45,156 +42,183 @@ Room::~Room() {
 //   Exits: north, south, east
 //   ========================================
 //
-void Room::display() const {
+void Room::display(std::ostream& out) const {
     // Display room information
 
-	std::cout << "========================================" << std::endl;
+	out << "========================================" << std::endl;
 
 	//Room Name
-	std::cout << getName() << std::endl;
-	std::cout << "========================================" << std::endl;
+	out << getName() << std::endl;
+	out << "========================================" << std::endl;
 
 	//Description text
-	std::cout << getDescription() << std::endl;
-	std::cout << std::endl;
+	out << getDescription() << std::endl;
+	out << std::endl;
 
 	//if monster exists and is alive
 	if(hasMonster()){
-		//print monster message
-		std::cout << "A " << monster->getName() << " blocks your path!" << std::endl;
-		std::cout << std::endl;
+		//print monster message (numbered list for a group, as targets)
+		if(monsters.liveCount() == 1){
+			out << "A " << monsters[monsters.findTarget("")]->getName() << " blocks your path!" << std::endl;
+		} else {
+			out << "Monsters block your path:" << std::endl;
+			monsters.display(out);
+		}
+		out << std::endl;
 	}
 	//if items not empty
 	if(items.size() > 0){
 		//loop through items vector and print the name of each item
-		std::cout << "Items here:" << std::endl;
-		for(int i = 0; i < (int)items.size(); i++){
-			std::cout << " - " << items[i]->getName() << std::endl;
+		out << "Items here:" << std::endl;
+		for(std::size_t i = 0; i < items.size(); i++){
+			out << " - " << items[i]->getName() << std::endl;
 		}
-		std::cout << std::endl;
+		out << std::endl;
 	}
 
 	//Display the exits
-	//flag to prevent comma from being printed before first exit
-	bool comma = false;
-
-	//loop through map and print comma (if flag), then name of exit
-	std::cout << "Exits: ";
-	for(std::map<std::string, Room*>::const_iterator it = exits.begin(); it != exits.end(); ++it){
-		if(comma){
-			std::cout << ", ";
-		}
-		comma = true;
-		std::cout << it->first;
-	}
-
-	std::cout << std::endl;
-	std::cout << "========================================" << std::endl;
+	displayExits(out);
+	out << "========================================" << std::endl;
 }
 
 
 // displayExits
 // - Print "Exits: "
-// - Iterate through exits map using iterator
-// - Print each direction (the key) separated by commas
+// - Walk this room's row of the World's exit table
+// - Print each direction separated by commas
 // - Example output: "Exits: north, south, east"
 //
-void Room::displayExits() const {
+void Room::displayExits(std::ostream& out) const {
     // Display available exits
 
-	//this is exactly the same as the printing exits part of the previous method
+	//flag to prevent comma from being printed before first exit
 	bool comma = false;
-        std::cout << "Exits: ";
-        for(std::map<std::string, Room*>::const_iterator it = exits.begin(); it != exits.end(); ++it){
-                if(comma){
-                        std::cout << ", ";
-                }
-                comma = true;
-                std::cout << it->first;
-        }
+        out << "Exits: ";
+	if(world){
+		for(unsigned int e = world->exitBegin(id); e < world->exitEnd(id); e++){
+			if(comma){
+				out << ", ";
+			}
+			comma = true;
+			out << world->directionName(world->exitDirection(e));
+		}
+	}
 
-        std::cout << std::endl;
+        out << std::endl;
 }
 
 
 // addExit
 // - Check if room pointer is not NULL
-// - Add to exits map: exits[direction] = room
+// - Both rooms must already belong to the same World
+// - Add edge to the World's exit table (new directions are interned)
 //
 void Room::addExit(const std::string& direction, Room* room) {
-    // Add exit to map
+    // Add exit to the world graph
 	//if room is null, leave
 	if(room == NULL) { return; }
 
-	//add room to exits map with direction as key
-	exits[direction] = room;
+	//both rooms have to be in the world first
+	if(world == NULL || room->world != world){
+		std::cout << "Error: rooms must be added to the world before connecting" << std::endl;
+		return;
+	}
+
+	//add edge with direction id as key
+	world->addExit(id, world->internDirection(direction), room->id);
 
 }
 
 
 // getExit
-// - Look up direction in exits map
-// - Use exits.find(direction)
+// - Translate direction to its id (unknown direction = no exit)
+// - Look up target id in the exit table
 // - If not found, return NULL
 //
 Room* Room::getExit(const std::string& direction) const {
     // Look up and return exit
+	if(world == NULL) { return NULL; }
 
-	//look up direction in exits map
-	std::map<std::string, Room*>::const_iterator it = exits.find(direction);
-
-	//create place for room pointer
-	Room* lookUp = NULL;
-
-	//if key exists
-	if(it != exits.end()){
-		//assign room ptr to lookup
-		lookUp = it->second;
-	}
-
-	//if found, return ptr to the room
-	if(lookUp){ return lookUp; }
+	//look up direction in exit table
+	RoomId target = world->getExit(id, world->directionId(direction));
 
-	//otherwise return null
-	return NULL;
+	//if found, return ptr to the room, otherwise NULL
+	return world->getRoom(target);
 }
 
 
 // hasExit
-// - Check if direction exists in exits map
+// - Check if direction exists in exit table
 bool Room::hasExit(const std::string& direction) const {
     // Check if exit exists
+	if(world == NULL) { return false; }
 
-        //look up direction in exits map
-        std::map<std::string, Room*>::const_iterator it = exits.find(direction);
+	return world->getExit(id, world->directionId(direction)) != NO_ROOM;
+}
 
-	//if it exists
-	if(it != exits.end()){
-		//return true
-		return true;
-	}
 
-	//otherwise
-	return false;
+// addMonster
+// - The group takes ownership unless it is full
+//
+bool Room::addMonster(Monster* m) {
+	materialize();
+	return monsters.add(m);
+}
+
+
+// setSpawn
+// - Remember which archetype lives here and how many; the Monsters are
+//   made when the room is first displayed or asked about its monsters
+// - Another archetype on top of a pending one builds the pending one first
+//
+void Room::setSpawn(unsigned int archetype, unsigned int count) {
+	if(spawn != NO_SPAWN && spawn != archetype){
+		materialize();
+	}
+	if(spawn_count + count > MonsterGroup::MAX_SIZE){
+		count = MonsterGroup::MAX_SIZE - spawn_count;
+	}
+	spawn = archetype;
+	spawn_count = (unsigned char)(spawn_count + count);
+	for(unsigned int i = 0; i < count; i++){
+		Monster::countSpawn(false);
+	}
 }
 
 
-// clearMonster
-// - If monster exists, delete it
-// - Set monster pointer to NULL
+// materialize
+// - Build the pending spawns from the current archetype table
 //
-void Room::clearMonster() {
-    // Delete and clear monster
-	if(monster){
-		delete monster;
+void Room::materialize() const {
+	if(spawn == NO_SPAWN){
+		return;
 	}
-	monster = NULL;
+	for(unsigned int i = 0; i < spawn_count; i++){
+		Monster* monster = Monster::create(spawn);
+		if(!monsters.add(monster)){
+			delete monster;
+			break;
+		}
+		Monster::countSpawn(true);
+	}
+	spawn = NO_SPAWN;
+	spawn_count = 0;
+}
+
+
+// clearMonsters
+// - Delete every monster, drop any pending spawn
+//
+void Room::clearMonsters() {
+	monsters.clear();
+	spawn = NO_SPAWN;
+	spawn_count = 0;
 }
 
 
 // addItem
 // - Check if item pointer is not NULL
-// - Add to items vector using push_back()
+// - Add to the item bag (indexed by name)
 //
 void Room::addItem(Item* item) {
     // Add item to room
@@ -202,54 +226,22 @@ void Room::addItem(Item* item) {
 	//if item ptr is NULL, leave
 	if(item == NULL) { return; }
 
-	//add item to vector
-	items.push_back(item);
+	//add item to the bag (indexes its name)
+	items.add(item);
 }
 
 
 // removeItem
-// - Search items vector for item by name (case-insensitive)
-// - If found: erase from vector (DON'T delete - ownership transferred)
+// - Take item out of the bag by name (hashed, case-insensitive)
+// - DON'T delete - ownership transferred
 //
-void Room::removeItem(const std::string& item_name) {
+void Room::removeItem(const std::string& item_name, std::ostream& out) {
     // Find and remove item from room
 
-	//assign name to s1
-	std::string s1 = item_name;
-
-        //make s1 lowercase
-        std::transform(s1.begin(), s1.end(), s1.begin(), ::tolower);
-
-        //place holder for string in inventory
-        std::string s2;
-
-        //flag to see if found
-        bool found = false;
-
-        //foe each item in inventory
-        for(int i = 0; i < (int)items.size(); i++) {
-                //put item name into s2
-                s2 = items[i]->getName();
-
-                //make s2 lowercase
-                std::transform(s2.begin(), s2.end(), s2.begin(), ::tolower);
-
-                //if names are identical
-                if(s1 == s2){
-                        //remove item from inventory (without deleting)
-                        items.erase(items.begin() + i);
-                        //set found flag
-                        found = true;
-                        //break
-                        break;
-                }
-
-        }
-        //if not found
-        if(!found){
-                //print error message
-                std::cout << "Error: Item not found!" << std::endl;
-        }
+	//if not found, print error message
+	if(items.take(item_name) == NULL){
+		out << "Error: Item not found!" << std::endl;
+	}
 }
 
 
@@ -257,45 +249,151 @@ void Room::removeItem(const std::string& item_name) {
 // - Print each item's name in a list
 // - Format: "  - ItemName"
 //
-void Room::displayItems() const {
+void Room::displayItems(std::ostream& out) const {
     // Display all items in room
-        for(int i = 0; i < (int)items.size(); i++){
-                std::cout << " - " << items[i]->getName() << std::endl;
+        for(std::size_t i = 0; i < items.size(); i++){
+                out << " - " << items[i]->getName() << std::endl;
         }
 }
 
 
 // getItem
-// - Search items vector for item by name (case-insensitive)
+// - Look item up in the bag's name index (case-insensitive)
 // - If found, return pointer to item
 // - If not found, return NULL
 //
 Item* Room::getItem(const std::string& item_name) {
     // Find and return item pointer
+	return items.find(item_name);
+}
+
+
+// serialize
+// - Everything needed to rebuild the room exactly as it is now
+// - Built monsters (with the initiative they keep between fights), then
+//   a pending spawn, which stays pending: just its
+//   count and archetype name
+// - Exits are not included (they live in the World)
+//
+void Room::serialize(ByteWriter& out) const {
+	out.putString(name);
+	out.putString(description);
+	out.putU8(visited ? 1 : 0);
+
+	out.putU8((uint8_t)monsters.size());
+	for(std::size_t i = 0; i < monsters.size(); i++){
+		out.putI32(monsters.getInitiative(i));
+		monsters[i]->serialize(out);
+	}
+	out.putU8(spawn_count);
+	if(spawn_count > 0){
+		const ArchetypeTable* table = ArchetypeRegistry::instance().acquire();
+		out.putString((*table)[spawn].name);
+		table->release();
+	}
 
-        //copy parameter to modify in s1
-        std::string s1 = item_name;
+	out.putU32((uint32_t)items.size());
+	for(std::size_t i = 0; i < items.size(); i++){
+		items[i]->serialize(out);
+	}
+}
 
-        //make s1 lowercase
-        std::transform(s1.begin(), s1.end(), s1.begin(), ::tolower);
 
-        //place holder for string in inventory
-        std::string s2;
+// deserialize
+// - Rebuild a room written by serialize()
+// - Returns NULL (and frees anything built so far) if the data is bad
+//
+Room* Room::deserialize(ByteReader& in) {
+	std::string room_name = in.getString();
+	std::string room_desc = in.getString();
+	if(!in.ok()){
+		return NULL;
+	}
 
-        for(int i = 0; i < (int)items.size(); i++){
-                //put item name into s2
-                s2 = items[i]->getName();
+	Room* room = new Room(room_name, room_desc);
+	if(!room->readContents(in)){
+		delete room;
+		return NULL;
+	}
+	return room;
+}
 
-                //make s2 lowercase
-                std::transform(s2.begin(), s2.end(), s2.begin(), ::tolower);
 
-                //if names are identical
-                if(s1 == s2){
-                        //return pointer to item
-                        return items[i];
-                }
-        }
+// restore
+// - Put a serialize()d state back into this room: the monsters and items
+//   it has now are deleted and replaced
+// - The saved name must be this room's
+// - False if the data is bad (the room is left empty)
+//
+bool Room::restore(ByteReader& in) {
+	std::string room_name = in.getString();
+	in.getString();
+	if(!in.ok() || room_name != name){
+		return false;
+	}
+	clearMonsters();
+	items.deleteAll();
+	return readContents(in);
+}
+
+
+// readContents
+// - Visited flag, monsters (each with its initiative), pending spawn,
+//   then items
+//
+bool Room::readContents(ByteReader& in) {
+	visited = in.getU8() != 0;
+	uint8_t monster_count = in.getU8();
+	if(!in.ok()){
+		return false;
+	}
+
+	for(uint8_t i = 0; i < monster_count; i++){
+		int initiative = in.getI32();
+		Monster* monster = Monster::deserialize(in);
+		if(monster == NULL || !monsters.add(monster)){
+			delete monster;
+			return false;
+		}
+		monsters.setInitiative(monsters.size() - 1, initiative);
+	}
+
+	//still pending (not new spawns, so not counted again)
+	uint8_t pending = in.getU8();
+	if(pending > 0){
+		const ArchetypeTable* table = ArchetypeRegistry::instance().acquire();
+		spawn = table->find(in.getString());
+		spawn_count = pending;
+		table->release();
+		if(spawn == NO_SPAWN){
+			spawn_count = 0;
+			return false;
+		}
+	}
+
+	uint32_t item_count = in.getU32();
+	for(uint32_t i = 0; i < item_count && in.ok(); i++){
+		Item* item = Item::deserialize(in);
+		if(item == NULL){
+			return false;
+		}
+		items.add(item);
+	}
+	return in.ok();
+}
+
 
-        //if not found, return NULL
-        return NULL;
+// memoryFootprint
+// - Room object, its strings, its monsters and its items
+//
+std::size_t Room::memoryFootprint() const {
+	std::size_t bytes = sizeof(Room) + name.capacity() + description.capacity() +
+	                    items.memoryFootprint();
+	for(std::size_t i = 0; i < monsters.size(); i++){
+		bytes += monsters[i]->memoryFootprint();
+	}
+	for(std::size_t i = 0; i < items.size(); i++){
+		bytes += items[i]->memoryFootprint();
+	}
+	return bytes;
 }
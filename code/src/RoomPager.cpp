@@ -0,0 +1,266 @@
+#include "RoomPager.h"
+#include "Room.h"
+#include "Serializer.h"
+#include <iostream>
+#include <unistd.h>
+
+// print
+// - One summary block, same layout as the generator report
+//
+void PagingStats::print(std::ostream& out) const {
+	out << "========================================" << std::endl;
+	out << "Room paging" << std::endl;
+	out << "  Hits:      " << hits << std::endl;
+	out << "  Misses:    " << misses << " (" << page_ins << " from page file)" << std::endl;
+	out << "  Evictions: " << evictions << std::endl;
+	out << "  Resident:  " << resident_rooms << " rooms, " << resident_bytes / 1024
+	          << " KB of " << budget_bytes / 1024 << " KB budget" << std::endl;
+	out << "========================================" << std::endl;
+}
+
+
+// RoomPager constructor
+// - Open an anonymous page file (deleted automatically when closed)
+//
+RoomPager::RoomPager(World& world, std::size_t budget_bytes)
+    : world(world), budget(budget_bytes), page_file(std::tmpfile()), page_file_end(0),
+      lru_head(NO_ROOM), lru_tail(NO_ROOM), hold_depth(0) {
+	stats.budget_bytes = budget_bytes;
+	if(page_file == NULL){
+		std::cout << "Error: cannot create page file, paging disabled" << std::endl;
+	}
+}
+
+
+// RoomPager destructor - closing the tmpfile removes it
+RoomPager::~RoomPager() {
+	if(page_file != NULL){
+		std::fclose(page_file);
+	}
+}
+
+
+// grow
+// - Make the per-room arrays big enough to hold id
+//
+void RoomPager::grow(RoomId id) {
+	if(id < lru_prev.size()){
+		return;
+	}
+	std::size_t n = id + 1;
+	if(n < lru_prev.size() * 2){
+		n = lru_prev.size() * 2;
+	}
+	lru_prev.resize(n, NO_ROOM);
+	lru_next.resize(n, NO_ROOM);
+	footprint.resize(n, 0);
+	is_held.resize(n, 0);
+}
+
+
+// unlink / pushFront - O(1) LRU list maintenance
+void RoomPager::unlink(RoomId id) {
+	RoomId p = lru_prev[id];
+	RoomId n = lru_next[id];
+	if(p != NO_ROOM) { lru_next[p] = n; } else { lru_head = n; }
+	if(n != NO_ROOM) { lru_prev[n] = p; } else { lru_tail = p; }
+	lru_prev[id] = NO_ROOM;
+	lru_next[id] = NO_ROOM;
+}
+
+void RoomPager::pushFront(RoomId id) {
+	lru_prev[id] = NO_ROOM;
+	lru_next[id] = lru_head;
+	if(lru_head != NO_ROOM) { lru_prev[lru_head] = id; }
+	lru_head = id;
+	if(lru_tail == NO_ROOM) { lru_tail = id; }
+}
+
+
+// touch
+// - A resident room was used: count a hit and move it to the front
+//
+void RoomPager::touch(RoomId id) {
+	stats.hits++;
+	if(id < lru_prev.size() && lru_head != id){
+		unlink(id);
+		pushFront(id);
+	}
+	hold(id);
+}
+
+
+// admit
+// - A room became resident: charge its footprint, put it at the front,
+//   then evict cold rooms until we are back under budget
+//
+void RoomPager::admit(RoomId id, Room* room) {
+	grow(id);
+	footprint[id] = (uint32_t)room->memoryFootprint();
+	stats.resident_bytes += footprint[id];
+	stats.resident_rooms++;
+	pushFront(id);
+	hold(id);
+	enforceBudget(id);
+}
+
+
+// forget
+// - The World deleted a resident room itself; stop tracking it
+//
+void RoomPager::forget(RoomId id) {
+	if(id >= lru_prev.size() || footprint[id] == 0){
+		return;
+	}
+	unlink(id);
+	stats.resident_bytes -= footprint[id];
+	stats.resident_rooms--;
+	footprint[id] = 0;
+}
+
+
+// isPinned - only a handful of pins exist, so a scan is fine
+bool RoomPager::isPinned(RoomId id) const {
+	if(id < is_held.size() && is_held[id]){
+		return true;
+	}
+	for(std::size_t i = 0; i < pinned.size(); i++){
+		if(pinned[i] == id){
+			return true;
+		}
+	}
+	return false;
+}
+
+void RoomPager::pin(RoomId id) {
+	pinned.push_back(id);
+}
+
+void RoomPager::unpin(RoomId id) {
+	for(std::size_t i = 0; i < pinned.size(); i++){
+		if(pinned[i] == id){
+			pinned.erase(pinned.begin() + i);
+			return;
+		}
+	}
+}
+
+
+// hold
+// - A room handed out while a hold is open stays until the hold closes
+//
+void RoomPager::hold(RoomId id) {
+	if(hold_depth > 0 && id < is_held.size() && !is_held[id]){
+		is_held[id] = 1;
+		held.push_back(id);
+	}
+}
+
+
+// openHold / closeHold
+// - Holds nest like scopes: closing one lets go of the rooms held since it
+//   was opened (ones an outer hold already had stay held), then evicts
+//   down to the budget again
+//
+std::size_t RoomPager::openHold() {
+	hold_depth++;
+	return held.size();
+}
+
+void RoomPager::closeHold(std::size_t mark) {
+	if(hold_depth == 0){
+		return;
+	}
+	hold_depth--;
+	for(std::size_t i = mark; i < held.size(); i++){
+		is_held[held[i]] = 0;
+	}
+	if(mark < held.size()){
+		held.resize(mark);
+		enforceBudget(NO_ROOM);
+	}
+}
+
+
+// enforceBudget
+// - Walk from the cold end of the LRU list evicting rooms
+// - Skip pinned and held rooms, and the room we are admitting right now
+//
+void RoomPager::enforceBudget(RoomId keep) {
+	if(page_file == NULL){
+		return;
+	}
+
+	RoomId victim = lru_tail;
+	while(stats.resident_bytes > budget && victim != NO_ROOM){
+		RoomId warmer = lru_prev[victim];
+		if(victim != keep && !isPinned(victim)){
+			evict(victim);
+		}
+		victim = warmer;
+	}
+}
+
+
+// evict
+// - Serialize the room to its page (reusing the old slot if it still fits)
+// - Delete the room and drop it from the LRU list
+//
+void RoomPager::evict(RoomId id) {
+	Room* room = world.releaseRoom(id);
+	if(room == NULL){
+		forget(id);
+		return;
+	}
+
+	ByteWriter page;
+	room->serialize(page);
+
+	if(pages.size() <= id){
+		PageSlot empty = { 0, 0, 0 };
+		pages.resize(lru_prev.size(), empty);
+	}
+	PageSlot& slot = pages[id];
+	if(slot.capacity < page.size()){
+		slot.offset = page_file_end;
+		slot.capacity = (uint32_t)page.size();
+		page_file_end += page.size();
+	}
+	slot.length = (uint32_t)page.size();
+
+	if(pwrite(fileno(page_file), page.data().data(), page.size(), (off_t)slot.offset) != (ssize_t)page.size()){
+		//could not write it out - keep the room instead of losing it
+		std::cout << "Error: page file write failed" << std::endl;
+		world.restoreRoom(id, room);
+		return;
+	}
+
+	delete room;
+	forget(id);
+	stats.evictions++;
+}
+
+
+// pageIn
+// - Read a room back from its page and rebuild it
+// - Returns NULL if the page can't be read
+//
+Room* RoomPager::pageIn(RoomId id) {
+	if(!hasPage(id)){
+		return NULL;
+	}
+
+	const PageSlot& slot = pages[id];
+	std::string page(slot.length, '\0');
+	if(pread(fileno(page_file), &page[0], slot.length, (off_t)slot.offset) != (ssize_t)slot.length){
+		std::cout << "Error: page file read failed" << std::endl;
+		return NULL;
+	}
+
+	ByteReader in(page);
+	Room* room = Room::deserialize(in);
+	if(room != NULL){
+		stats.page_ins++;
+	}
+	return room;
+}
@@ -0,0 +1,279 @@
+#include "SaveGame.h"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+const uint32_t SaveWriter::MAGIC;
+const uint32_t SaveWriter::VERSION;
+
+// ============================================================================
+// SaveWriter
+// ============================================================================
+
+// SaveWriter constructor - no file yet
+SaveWriter::SaveWriter()
+    : fd(-1), base_bytes(0), delta_bytes(0), full_saves(0), delta_saves(0),
+      full_written(0), delta_written(0) {
+}
+
+
+// SaveWriter destructor
+SaveWriter::~SaveWriter() {
+	close();
+}
+
+
+// open
+// - Remember where to save and what the game was built from; nothing is
+//   written until the first (full) save
+//
+void SaveWriter::open(const std::string& file, const std::string& game_setup) {
+	close();
+	path = file;
+	setup = game_setup;
+	base_bytes = 0;
+	delta_bytes = 0;
+}
+
+
+// resume
+// - Like open(), but the file already has a full save: the next saves
+//   are appended to it
+//
+bool SaveWriter::resume(const std::string& file, const std::string& game_setup,
+                        unsigned long long base_size, unsigned long long delta_size) {
+	open(file, game_setup);
+	fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+	if(fd < 0){
+		std::cout << "Error: cannot write to save file " << path << ": " << strerror(errno) << std::endl;
+		path.clear();
+		return false;
+	}
+	base_bytes = base_size;
+	delta_bytes = delta_size;
+	return true;
+}
+
+
+// putRecord - type byte, then the two blocks with their lengths
+void SaveWriter::putRecord(ByteWriter& out, SaveRecord kind, const std::string& player, const std::string& rooms) {
+	out.putU8((uint8_t)kind);
+	out.putString(player);
+	out.putString(rooms);
+}
+
+
+// writeAll - the whole buffer, however many writes it takes
+bool SaveWriter::writeAll(int out, const std::string& data) {
+	const char* p = data.data();
+	std::size_t size = data.size();
+	while(size > 0){
+		ssize_t put = ::write(out, p, size);
+		if(put < 0 && errno == EINTR){
+			continue;
+		}
+		if(put <= 0){
+			return false;
+		}
+		p += put;
+		size -= (std::size_t)put;
+	}
+	return true;
+}
+
+
+// writeFull
+// - Header and one full record into "<file>.tmp", synced, then renamed
+//   over the save file
+// - Later deltas are appended to the new file
+//
+bool SaveWriter::writeFull(const std::string& name, const std::string& player, const std::string& rooms) {
+	if(path.empty()){
+		return false;
+	}
+	ByteWriter out;
+	out.putU32(MAGIC);
+	out.putU32(VERSION);
+	out.putString(setup);
+	out.putString(name);
+	putRecord(out, SAVE_FULL, player, rooms);
+
+	std::string temp = path + ".tmp";
+	int out_fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(out_fd < 0){
+		std::cout << "Error: cannot create " << temp << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	bool written = writeAll(out_fd, out.data()) && fsync(out_fd) == 0;
+	int error = errno;
+	::close(out_fd);
+	if(!written || rename(temp.c_str(), path.c_str()) != 0){
+		std::cout << "Error: cannot save to " << path << ": " << strerror(written ? errno : error) << std::endl;
+		unlink(temp.c_str());
+		return false;
+	}
+
+	//deltas go on the end of the new file
+	if(fd >= 0){
+		::close(fd);
+	}
+	fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+	if(fd < 0){
+		std::cout << "Error: cannot reopen " << path << ": " << strerror(errno) << std::endl;
+	}
+	base_bytes = out.size();
+	delta_bytes = 0;
+	full_saves++;
+	full_written += out.size();
+	return true;
+}
+
+
+// writeDelta
+// - One record appended in one write
+//
+bool SaveWriter::writeDelta(const std::string& player, const std::string& rooms) {
+	if(fd < 0){
+		return false;
+	}
+	ByteWriter out;
+	putRecord(out, SAVE_DELTA, player, rooms);
+	if(!writeAll(fd, out.data())){
+		std::cout << "Error: cannot save to " << path << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	delta_bytes += out.size();
+	delta_saves++;
+	delta_written += out.size();
+	return true;
+}
+
+
+// close - stop saving
+void SaveWriter::close() {
+	if(fd >= 0){
+		::close(fd);
+		fd = -1;
+	}
+}
+
+
+// print
+// - How many saves of each kind and what they cost
+//
+void SaveWriter::print() const {
+	std::cout << "========================================" << std::endl;
+	std::cout << "Saves to " << path << std::endl;
+	std::cout << "  Full:        " << full_saves << " (" << full_written << " bytes)" << std::endl;
+	std::cout << "  Incremental: " << delta_saves << " (" << delta_written << " bytes";
+	if(delta_saves > 0){
+		std::cout << ", " << delta_written / delta_saves << " per save";
+	}
+	std::cout << ")" << std::endl;
+	std::cout << "  File:        " << base_bytes + delta_bytes << " bytes" << std::endl;
+	std::cout << "========================================" << std::endl;
+}
+
+
+// ============================================================================
+// SaveReader
+// ============================================================================
+
+// SaveReader constructor - nothing loaded
+SaveReader::SaveReader() : base_bytes(0), delta_bytes(0), damaged(false) {
+}
+
+
+// load
+// - Read the whole file, check the header
+// - Index each record; a full one starts the rooms over, and a record
+//   cut short ends the file
+//
+bool SaveReader::load(const std::string& path) {
+	int in_fd = ::open(path.c_str(), O_RDONLY);
+	if(in_fd < 0){
+		std::cout << "Error: cannot open save file " << path << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+	data.clear();
+	char block[65536];
+	for(;;){
+		ssize_t got = ::read(in_fd, block, sizeof(block));
+		if(got < 0 && errno == EINTR){
+			continue;
+		}
+		if(got <= 0){
+			break;
+		}
+		data.append(block, (std::size_t)got);
+	}
+	::close(in_fd);
+
+	rooms.clear();
+	player = TextView();
+	base_bytes = 0;
+	delta_bytes = 0;
+
+	ByteReader in(data);
+	uint32_t magic = in.getU32();
+	uint32_t version = in.getU32();
+	uint32_t setup_size = in.getU32();
+	if(!in.ok() || magic != SaveWriter::MAGIC || setup_size > in.remaining()){
+		std::cout << "Error: " << path << " is not a save file" << std::endl;
+		return false;
+	}
+	if(version != SaveWriter::VERSION){
+		std::cout << "Error: " << path << " is save version " << version
+		          << ", this game reads version " << SaveWriter::VERSION << std::endl;
+		return false;
+	}
+	setup = TextView(in.current(), setup_size);
+	in.skip(setup_size);
+	name = in.getString();
+	if(!in.ok()){
+		std::cout << "Error: " << path << " is not a save file" << std::endl;
+		return false;
+	}
+
+	damaged = false;
+	while(!in.atEnd()){
+		const char* start = in.current();
+		uint8_t kind = in.getU8();
+		TextView blocks[2];
+		int found = 0;
+		for(; found < 2; found++){
+			uint32_t size = in.getU32();
+			if(!in.ok() || size > in.remaining()){
+				break;
+			}
+			blocks[found] = TextView(in.current(), size);
+			in.skip(size);
+		}
+		if(found < 2 || (kind != SAVE_FULL && (kind != SAVE_DELTA || rooms.empty()))){
+			damaged = true;
+			break;
+		}
+		unsigned long long size = (unsigned long long)(in.current() - start);
+		if(kind == SAVE_FULL){
+			rooms.clear();
+			base_bytes = (unsigned long long)(in.current() - data.data());
+			delta_bytes = 0;
+		} else {
+			delta_bytes += size;
+		}
+		rooms.push_back(blocks[1]);
+		player = blocks[0];
+	}
+
+	if(rooms.empty()){
+		std::cout << "Error: " << path << " has no saved game in it" << std::endl;
+		return false;
+	}
+	if(damaged){
+		std::cout << "Warning: " << path << " ends in a damaged save; loading the one before it" << std::endl;
+	}
+	return true;
+}
@@ -0,0 +1,104 @@
+#include "ScriptStats.h"
+#include <iostream>
+#include <time.h>
+
+const unsigned int ScriptStats::SUB_BUCKETS;
+const unsigned int ScriptStats::BUCKETS;
+
+// bucketOf
+// - Values below 8 get a bucket each; above that, the power of two picks
+//   a group of 8 and the next three bits the bucket within it
+//
+static unsigned int bucketOf(unsigned long long ns) {
+	if(ns < ScriptStats::SUB_BUCKETS){
+		return (unsigned int)ns;
+	}
+	unsigned int top = 63 - __builtin_clzll(ns);
+	unsigned int sub = (unsigned int)(ns >> (top - 3)) & (ScriptStats::SUB_BUCKETS - 1);
+	return (top - 2) * ScriptStats::SUB_BUCKETS + sub;
+}
+
+
+// bucketTop - largest value that lands in a bucket
+static unsigned long long bucketTop(unsigned int bucket) {
+	if(bucket < ScriptStats::SUB_BUCKETS){
+		return bucket;
+	}
+	unsigned int top = bucket / ScriptStats::SUB_BUCKETS + 2;
+	unsigned long long sub = bucket % ScriptStats::SUB_BUCKETS;
+	unsigned long long low = (ScriptStats::SUB_BUCKETS + sub) << (top - 3);
+	return low + (1ULL << (top - 3)) - 1;
+}
+
+
+// ScriptStats constructor - nothing recorded
+ScriptStats::ScriptStats() : commands(0), total_ns(0), max_ns(0), seconds(0) {
+	for(unsigned int b = 0; b < BUCKETS; b++){
+		histogram[b] = 0;
+	}
+}
+
+
+// record - one more command
+void ScriptStats::record(unsigned long long ns) {
+	commands++;
+	total_ns += ns;
+	if(ns > max_ns){
+		max_ns = ns;
+	}
+	histogram[bucketOf(ns)]++;
+}
+
+
+// percentile
+// - Walk the buckets until p of the commands are counted; the true maximum
+//   for p = 1
+//
+unsigned long long ScriptStats::percentile(double p) const {
+	if(commands == 0){
+		return 0;
+	}
+	if(p >= 1.0){
+		return max_ns;
+	}
+	unsigned long long needed = (unsigned long long)(p * commands);
+	if(needed < 1){
+		needed = 1;
+	}
+	unsigned long long seen = 0;
+	for(unsigned int b = 0; b < BUCKETS; b++){
+		seen += histogram[b];
+		if(seen >= needed){
+			unsigned long long top = bucketTop(b);
+			return top < max_ns ? top : max_ns;
+		}
+	}
+	return max_ns;
+}
+
+
+// print
+// - Commands, time from the first command on, commands per second and
+//   the latency spread
+//
+void ScriptStats::print() const {
+	std::cout << "========================================" << std::endl;
+	std::cout << "Script run" << std::endl;
+	std::cout << "  Commands:     " << commands << std::endl;
+	std::cout << "  Time:         " << seconds << " s ("
+	          << (seconds > 0 ? commands / seconds : 0) << " commands/s)" << std::endl;
+	std::cout << "  Latency (ns): mean " << (commands ? total_ns / commands : 0)
+	          << "  p50 " << percentile(0.50)
+	          << "  p90 " << percentile(0.90)
+	          << "  p99 " << percentile(0.99)
+	          << "  max " << percentile(1.0) << std::endl;
+	std::cout << "========================================" << std::endl;
+}
+
+
+// now - CLOCK_MONOTONIC, in nanoseconds
+unsigned long long ScriptStats::now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
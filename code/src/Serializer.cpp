@@ -0,0 +1,105 @@
+#include "Serializer.h"
+#include <cstring>
+
+// ============================================================================
+// ByteWriter
+// ============================================================================
+
+void ByteWriter::putU8(uint8_t v) {
+	buffer.push_back((char)v);
+}
+
+void ByteWriter::putU32(uint32_t v) {
+	putBytes(&v, sizeof(v));
+}
+
+void ByteWriter::putU64(uint64_t v) {
+	putBytes(&v, sizeof(v));
+}
+
+// putVarU64 - 7 bits at a time, high bit set on all but the last byte
+void ByteWriter::putVarU64(uint64_t v) {
+	while(v >= 0x80){
+		buffer.push_back((char)(v | 0x80));
+		v >>= 7;
+	}
+	buffer.push_back((char)v);
+}
+
+// putString - length prefix, then the bytes (no terminator)
+void ByteWriter::putString(const std::string& s) {
+	putU32((uint32_t)s.size());
+	buffer.append(s);
+}
+
+
+// ============================================================================
+// ByteReader
+// ============================================================================
+
+// need
+// - Check that n more bytes are available; poison the reader if not
+//
+bool ByteReader::need(std::size_t n) {
+	if(!good || (std::size_t)(end - pos) < n){
+		good = false;
+		return false;
+	}
+	return true;
+}
+
+uint8_t ByteReader::getU8() {
+	if(!need(1)){ return 0; }
+	return (uint8_t)*pos++;
+}
+
+uint32_t ByteReader::getU32() {
+	uint32_t v = 0;
+	getBytes(&v, sizeof(v));
+	return v;
+}
+
+uint64_t ByteReader::getU64() {
+	uint64_t v = 0;
+	getBytes(&v, sizeof(v));
+	return v;
+}
+
+// getVarU64
+// - At most 10 bytes; a longer run (or running out) poisons the reader
+//
+uint64_t ByteReader::getVarU64() {
+	uint64_t v = 0;
+	for(unsigned int shift = 0; shift < 64; shift += 7){
+		if(!need(1)){ return 0; }
+		uint8_t byte = (uint8_t)*pos++;
+		v |= (uint64_t)(byte & 0x7F) << shift;
+		if((byte & 0x80) == 0){
+			return v;
+		}
+	}
+	good = false;
+	return 0;
+}
+
+std::string ByteReader::getString() {
+	uint32_t len = getU32();
+	if(!need(len)){ return std::string(); }
+	std::string s(pos, len);
+	pos += len;
+	return s;
+}
+
+bool ByteReader::getBytes(void* out, std::size_t n) {
+	if(!need(n)){ return false; }
+	std::memcpy(out, pos, n);
+	pos += n;
+	return true;
+}
+
+// skip - move past n bytes (e.g. a record being indexed, not read)
+bool ByteReader::skip(std::size_t n) {
+	if(!need(n)){ return false; }
+	pos += n;
+	return true;
+}
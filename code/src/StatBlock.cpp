@@ -0,0 +1,73 @@
+#include "StatBlock.h"
+#include <iostream>
+
+// Names of the sources, for the breakdown
+static const char* const SOURCE_NAMES[MOD_SOURCE_COUNT] = {
+	"level", "equipment", "effects"
+};
+
+// StatBlock constructor - base stats, no modifiers, every total current
+StatBlock::StatBlock(int max_hp, int attack, int defense) : dirty(0) {
+	base[STAT_MAX_HP] = max_hp;
+	base[STAT_ATTACK] = attack;
+	base[STAT_DEFENSE] = defense;
+	for(int s = 0; s < STAT_KIND_COUNT; s++){
+		for(int m = 0; m < MOD_SOURCE_COUNT; m++){
+			bonus[m][s] = 0;
+		}
+		total[s] = base[s];
+	}
+}
+
+
+// refresh
+// - Sum base and sources for one stat, and mark it current
+//
+void StatBlock::refresh(StatKind stat) const {
+	int sum = base[stat];
+	for(int m = 0; m < MOD_SOURCE_COUNT; m++){
+		sum += bonus[m][stat];
+	}
+	total[stat] = sum;
+	dirty &= (unsigned char)~(1u << stat);
+}
+
+
+// setBase - the stat's total is stale if the value changed
+void StatBlock::setBase(StatKind stat, int value) {
+	if(base[stat] != value){
+		base[stat] = value;
+		dirty |= (unsigned char)(1u << stat);
+	}
+}
+
+
+// setBonus - the stat's total is stale if the value changed
+void StatBlock::setBonus(ModifierSource source, StatKind stat, int value) {
+	if(bonus[source][stat] != value){
+		bonus[source][stat] = value;
+		dirty |= (unsigned char)(1u << stat);
+	}
+}
+
+
+// displayBreakdown
+// - The base, then each source that adds anything, with its sign
+//
+void StatBlock::displayBreakdown(StatKind stat, std::ostream& out) const {
+	const char* separator = ", ";
+	bool any = false;
+	for(int m = 0; m < MOD_SOURCE_COUNT; m++){
+		any = any || bonus[m][stat] != 0;
+	}
+	if(!any){
+		return;
+	}
+	out << " (base " << base[stat];
+	for(int m = 0; m < MOD_SOURCE_COUNT; m++){
+		if(bonus[m][stat] != 0){
+			out << separator << SOURCE_NAMES[m] << " " << (bonus[m][stat] > 0 ? "+" : "") << bonus[m][stat];
+		}
+	}
+	out << ")";
+}
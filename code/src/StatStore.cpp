@@ -0,0 +1,187 @@
+#include "StatStore.h"
+#include "Character.h"
+#include "CombatRules.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STAT_STORE_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+// Kernel signature: hp/defense/alive start at the first slot
+typedef std::size_t (*DamageKernel)(int* hp, const int* defense, int* alive,
+                                    const int* damage, std::size_t count);
+
+// damageScalar
+// - CombatRules one slot at a time: a glancing blow (damage < defense)
+//   does nothing, otherwise HP drops and below zero means dead at 0 HP
+//
+static std::size_t damageScalar(int* hp, const int* defense, int* alive,
+                                const int* damage, std::size_t count) {
+	std::size_t died = 0;
+	for(std::size_t i = 0; i < count; i++){
+		if(alive[i] == 0){ continue; }
+		int actual = CombatRules::mitigate(damage[i], defense[i]);
+		if(actual < 0){ continue; }
+		if(!CombatRules::applyDamage(hp[i], actual)){
+			alive[i] = 0;
+			died++;
+		}
+	}
+	return died;
+}
+
+
+#ifdef STAT_STORE_X86
+
+// damageSSE2
+// - Four slots per step, branch-free:
+//   apply = alive & (actual >= 0); hp -= actual & apply;
+//   dead = hp < 0; hp &= ~dead; alive &= ~dead
+//
+static std::size_t damageSSE2(int* hp, const int* defense, int* alive,
+                              const int* damage, std::size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	std::size_t died = 0;
+	std::size_t i = 0;
+	for(; i + 4 <= count; i += 4){
+		__m128i h = _mm_loadu_si128((const __m128i*)(hp + i));
+		__m128i a = _mm_loadu_si128((const __m128i*)(alive + i));
+		__m128i actual = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(damage + i)),
+		                               _mm_loadu_si128((const __m128i*)(defense + i)));
+		__m128i apply = _mm_andnot_si128(_mm_cmplt_epi32(actual, zero), a);
+		h = _mm_sub_epi32(h, _mm_and_si128(actual, apply));
+		__m128i dead = _mm_cmplt_epi32(h, zero);
+		h = _mm_andnot_si128(dead, h);
+		a = _mm_andnot_si128(dead, a);
+		_mm_storeu_si128((__m128i*)(hp + i), h);
+		_mm_storeu_si128((__m128i*)(alive + i), a);
+		died += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(dead)));
+	}
+	return died + damageScalar(hp + i, defense + i, alive + i, damage + i, count - i);
+}
+
+
+// damageAVX2
+// - The SSE2 kernel, eight slots per step (only called if the CPU has AVX2)
+//
+__attribute__((target("avx2")))
+static std::size_t damageAVX2(int* hp, const int* defense, int* alive,
+                              const int* damage, std::size_t count) {
+	const __m256i zero = _mm256_setzero_si256();
+	std::size_t died = 0;
+	std::size_t i = 0;
+	for(; i + 8 <= count; i += 8){
+		__m256i h = _mm256_loadu_si256((const __m256i*)(hp + i));
+		__m256i a = _mm256_loadu_si256((const __m256i*)(alive + i));
+		__m256i actual = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(damage + i)),
+		                                  _mm256_loadu_si256((const __m256i*)(defense + i)));
+		__m256i apply = _mm256_andnot_si256(_mm256_cmpgt_epi32(zero, actual), a);
+		h = _mm256_sub_epi32(h, _mm256_and_si256(actual, apply));
+		__m256i dead = _mm256_cmpgt_epi32(zero, h);
+		h = _mm256_andnot_si256(dead, h);
+		a = _mm256_andnot_si256(dead, a);
+		_mm256_storeu_si256((__m256i*)(hp + i), h);
+		_mm256_storeu_si256((__m256i*)(alive + i), a);
+		died += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(dead)));
+	}
+	return died + damageSSE2(hp + i, defense + i, alive + i, damage + i, count - i);
+}
+
+#endif
+
+
+// chooseKernel - widest kernel this CPU runs, picked once
+static DamageKernel chooseKernel(const char** name) {
+#ifdef STAT_STORE_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")){
+		*name = "avx2";
+		return damageAVX2;
+	}
+	*name = "sse2";
+	return damageSSE2;
+#else
+	*name = "scalar";
+	return damageScalar;
+#endif
+}
+
+static const char* kernel_name = NULL;
+static DamageKernel kernel = chooseKernel(&kernel_name);
+
+
+// Ref::takeDamage / Ref::heal - CombatRules on one slot
+void StatStore::Ref::takeDamage(int damage) {
+	damageScalar(&store->hp[slot], &store->defense[slot], &store->alive[slot], &damage, 1);
+}
+
+void StatStore::Ref::heal(int amount) {
+	store->hp[slot] = CombatRules::heal(store->hp[slot], amount, store->max_hp[slot]);
+}
+
+
+// add
+// - Append one fighter at full health
+//
+std::size_t StatStore::add(int hp_value, int attack_value, int defense_value) {
+	hp.push_back(hp_value);
+	max_hp.push_back(hp_value);
+	attack.push_back(attack_value);
+	defense.push_back(defense_value);
+	alive.push_back(-1);
+	return hp.size() - 1;
+}
+
+std::size_t StatStore::add(const Character& character) {
+	std::size_t slot = add(character.getMaxHP(), character.getAttack(), character.getDefense());
+	hp[slot] = character.getCurrentHP();
+	alive[slot] = character.isAlive() ? -1 : 0;
+	return slot;
+}
+
+
+// clear - drop every fighter
+void StatStore::clear() {
+	hp.clear();
+	max_hp.clear();
+	attack.clear();
+	defense.clear();
+	alive.clear();
+}
+
+
+// applyDamage / applyDamageScalar
+// - Same results either way; the first uses the SIMD kernel
+//
+std::size_t StatStore::applyDamage(const int* damage, std::size_t first, std::size_t count) {
+	if(count == 0){ return 0; }
+	return kernel(&hp[first], &defense[first], &alive[first], damage, count);
+}
+
+std::size_t StatStore::applyDamageScalar(const int* damage, std::size_t first, std::size_t count) {
+	if(count == 0){ return 0; }
+	return damageScalar(&hp[first], &defense[first], &alive[first], damage, count);
+}
+
+
+// aliveCount - alive is 0 or -1, so the sum is minus the count
+std::size_t StatStore::aliveCount() const {
+	long total = 0;
+	for(std::size_t i = 0; i < alive.size(); i++){
+		total -= alive[i];
+	}
+	return (std::size_t)total;
+}
+
+
+// copyTo - write a slot's outcome back into the Character it came from
+void StatStore::copyTo(std::size_t slot, Character& character) const {
+	character.setCurrentHP(hp[slot]);
+	character.setAlive(alive[slot] != 0);
+}
+
+
+const char* StatStore::kernelName() {
+	return kernel_name;
+}
@@ -0,0 +1,461 @@
+#include "StatusEffects.h"
+#include "Character.h"
+#include "Random.h"
+#include "NameIndex.h"
+#include "Serializer.h"
+#include <iostream>
+#include <cstdlib>
+#include <sys/time.h>
+
+const unsigned int StatusEffects::NO_EFFECT;
+const unsigned int StatusEffects::MAX_TURNS;
+
+// Names in data files, and how a character with the effect is described
+static const char* const KIND_NAMES[EFFECT_KIND_COUNT] = {
+	"none", "burn", "poison", "regeneration", "attack_up", "defense_up"
+};
+static const char* const KIND_STATES[EFFECT_KIND_COUNT] = {
+	"unaffected", "burning", "poisoned", "regenerating", "empowered", "shielded"
+};
+
+// Buffs act when they end; the others every turn
+static bool isBuff(EffectKind kind) {
+	return kind == EFFECT_ATTACK_UP || kind == EFFECT_DEFENSE_UP;
+}
+
+// The stat a buff raises
+static StatKind buffStat(EffectKind kind) {
+	return kind == EFFECT_ATTACK_UP ? STAT_ATTACK : STAT_DEFENSE;
+}
+
+
+// nowSeconds - wall clock for the benchmark
+static double nowSeconds() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+// parse
+// - "kind power turns", kind by name (case-insensitive), both numbers >= 1
+//
+bool EffectSpec::parse(const std::string& text, EffectSpec& spec, std::string& error) {
+	spec = EffectSpec();
+	std::size_t start = text.find_first_not_of(" \t");
+	if(start == std::string::npos){
+		return true;
+	}
+	std::size_t space = text.find_first_of(" \t", start);
+	std::string word = text.substr(start, space == std::string::npos ? std::string::npos : space - start);
+	for(int k = EFFECT_NONE + 1; k < EFFECT_KIND_COUNT; k++){
+		std::string name = KIND_NAMES[k];
+		if(NameIndex::equalsIgnoreCase(word.data(), word.size(), name.data(), name.size())){
+			spec.kind = (EffectKind)k;
+		}
+	}
+
+	const char* rest = text.c_str() + (space == std::string::npos ? text.size() : space);
+	char* end = NULL;
+	long power = strtol(rest, &end, 10);
+	bool ok = (end != rest);
+	rest = end;
+	long turns = strtol(rest, &end, 10);
+	ok = ok && (end != rest);
+	while(ok && (*end == ' ' || *end == '\t')){ end++; }
+
+	if(spec.kind == EFFECT_NONE || !ok || *end != '\0' ||
+	   power < 1 || power > 1000000 || turns < 1 || turns > (long)StatusEffects::MAX_TURNS){
+		error = "expected 'burn|poison|regeneration|attack_up|defense_up power turns' in '" + text + "'";
+		spec = EffectSpec();
+		return false;
+	}
+	spec.power = (int)power;
+	spec.turns = (unsigned int)turns;
+	return true;
+}
+
+
+// StatusEffects constructor - nothing active, turn 0
+StatusEffects::StatusEffects(std::ostream& output)
+    : free_list(NO_EFFECT), active(0), output(output), quiet(false) {
+}
+
+
+// describe - state word for messages
+const char* StatusEffects::describe(EffectKind kind) {
+	return KIND_STATES[kind < EFFECT_KIND_COUNT ? kind : EFFECT_NONE];
+}
+
+
+// find - walk the character's own list (a handful of effects at most)
+unsigned int StatusEffects::find(const Character& target, EffectKind kind) const {
+	for(unsigned int id = target.effects; id != NO_EFFECT; id = effects[id].next){
+		if(effects[id].kind == kind){
+			return id;
+		}
+	}
+	return NO_EFFECT;
+}
+
+
+// start
+// - Buffs raise the stat now (an effects modifier, see StatBlock) and
+//   are timed to their expiry
+// - Everything else is timed to its first tick
+//
+void StatusEffects::start(unsigned int id) {
+	Effect& e = effects[id];
+	if(isBuff(e.kind)){
+		e.target->addModifier(MOD_EFFECTS, buffStat(e.kind), e.power);
+	}
+	wheel.schedule(id, isBuff(e.kind) ? e.turns_left : 1);
+}
+
+
+// finish
+// - Unlink from the character and the wheel, undo a buff, free the slot
+//
+void StatusEffects::finish(unsigned int id, bool revert) {
+	Effect& e = effects[id];
+	if(revert && isBuff(e.kind)){
+		e.target->addModifier(MOD_EFFECTS, buffStat(e.kind), -e.power);
+	}
+
+	if(e.prev != NO_EFFECT){
+		effects[e.prev].next = e.next;
+	} else {
+		e.target->effects = e.next;
+	}
+	if(e.next != NO_EFFECT){
+		effects[e.next].prev = e.prev;
+	}
+	wheel.cancel(id);
+
+	e.target = NULL;
+	e.next = free_list;
+	free_list = id;
+	active--;
+}
+
+
+// apply
+// - Same kind again: keep the stronger power and the longer duration
+// - Otherwise take a free slot and put it at the head of the character's list
+//
+void StatusEffects::apply(Character& target, const EffectSpec& spec) {
+	if(spec.empty() || spec.turns == 0 || !target.isAlive()){
+		return;
+	}
+	unsigned int turns = spec.turns < MAX_TURNS ? spec.turns : MAX_TURNS;
+
+	unsigned int id = find(target, spec.kind);
+	if(id != NO_EFFECT){
+		Effect& e = effects[id];
+		if(isBuff(e.kind)){
+			if(spec.power > e.power){
+				target.addModifier(MOD_EFFECTS, buffStat(e.kind), spec.power - e.power);
+				e.power = spec.power;
+			}
+			if(wheel.getDeadline(id) - wheel.getNow() < turns){
+				wheel.schedule(id, turns);
+			}
+		} else {
+			e.power = spec.power > e.power ? spec.power : e.power;
+			e.turns_left = turns > e.turns_left ? turns : e.turns_left;
+		}
+		return;
+	}
+
+	if(free_list != NO_EFFECT){
+		id = free_list;
+		free_list = effects[id].next;
+	} else {
+		id = (unsigned int)effects.size();
+		effects.push_back(Effect());
+	}
+	Effect& e = effects[id];
+	e.target = &target;
+	target.effect_engine = this;
+	e.kind = spec.kind;
+	e.power = spec.power;
+	e.turns_left = turns;
+	e.prev = NO_EFFECT;
+	e.next = target.effects;
+	if(e.next != NO_EFFECT){
+		effects[e.next].prev = id;
+	}
+	target.effects = id;
+	active++;
+	start(id);
+
+	if(!quiet){
+		output << target.getName() << " is " << describe(spec.kind) << "! (" << turns << " turns)" << std::endl;
+	}
+}
+
+
+// clear - finish each effect on the character
+void StatusEffects::clear(Character& target, bool revert) {
+	while(target.effects != NO_EFFECT){
+		finish(target.effects, revert);
+	}
+}
+
+
+// advance
+// - One tick of the wheel; only the effects that fall due are touched
+// - Damage over time goes through takeDamage (past defense), regeneration
+//   through heal; a character that dies loses the rest of its effects
+//
+std::size_t StatusEffects::advance() {
+	due.clear();
+	wheel.advance(due);
+
+	for(std::size_t i = 0; i < due.size(); i++){
+		unsigned int id = due[i];
+		Effect& e = effects[id];
+		if(e.target == NULL){
+			continue;   //its character died earlier in this batch
+		}
+		Character* target = e.target;
+
+		if(isBuff(e.kind)){
+			if(!quiet){
+				output << target->getName() << " is no longer " << describe(e.kind) << "." << std::endl;
+			}
+			finish(id, true);
+			continue;
+		}
+
+		if(e.kind == EFFECT_REGENERATION){
+			target->heal(e.power, output);
+		} else {
+			if(!quiet){
+				output << target->getName() << " is " << describe(e.kind) << "! ";
+			}
+			target->takeDamage(e.power, output, true);
+		}
+
+		if(!target->isAlive()){
+			clear(*target, false);
+		} else if(--e.turns_left > 0){
+			wheel.schedule(id, 1);
+		} else {
+			if(!quiet){
+				output << target->getName() << " is no longer " << describe(e.kind) << "." << std::endl;
+			}
+			finish(id, false);
+		}
+	}
+	return due.size();
+}
+
+
+// serialize
+// - Each slot (free, the owner's, or someone else's as the two numbers
+//   `others` names them by, and its links), the free list, then the
+//   wheel as it is
+// - False if an effect is on someone `others` can't name
+//
+bool StatusEffects::serialize(const Character& owner, const EffectTargets& others, ByteWriter& out) const {
+	out.putU32((uint32_t)effects.size());
+	for(std::size_t id = 0; id < effects.size(); id++){
+		const Effect& e = effects[id];
+		if(e.target == NULL){
+			out.putU8(HOLDER_NONE);
+		} else if(e.target == &owner){
+			out.putU8(HOLDER_OWNER);
+		} else {
+			uint32_t where, slot;
+			if(!others.locate(*e.target, where, slot)){
+				return false;
+			}
+			out.putU8(HOLDER_OTHER);
+			out.putU32(where);
+			out.putU32(slot);
+		}
+		out.putU8((uint8_t)e.kind);
+		out.putI32(e.power);
+		out.putU32(e.turns_left);
+		out.putU32(e.next);
+		out.putU32(e.prev);
+	}
+	out.putU32(free_list);
+	wheel.serialize(out);
+	return true;
+}
+
+
+// restore
+// - Only into an idle engine (nothing active): the saved slots, each
+//   back on the owner or whoever `others` resolves it to, and the saved
+//   wheel; each character's first effect is the one with no prev
+// - The owner's stats were saved with its buffs in them; anyone else's
+//   buffs are put back on them here
+// - False (engine unchanged) if the data is bad
+//
+bool StatusEffects::restore(Character& owner, const EffectTargets& others, ByteReader& in) {
+	if(active != 0){
+		return false;
+	}
+	uint32_t count = in.getU32();
+	if(!in.ok() || count > in.remaining() / 18){
+		return false;
+	}
+
+	std::vector<Effect> saved(count);
+	std::size_t saved_active = 0;
+	for(uint32_t id = 0; id < count; id++){
+		Effect& e = saved[id];
+		uint8_t holder = in.getU8();
+		e.target = NULL;
+		if(holder == HOLDER_OWNER){
+			e.target = &owner;
+		} else if(holder == HOLDER_OTHER){
+			uint32_t where = in.getU32();
+			uint32_t slot = in.getU32();
+			e.target = in.ok() ? others.resolve(where, slot) : NULL;
+			if(e.target == NULL){
+				return false;
+			}
+		} else if(holder != HOLDER_NONE){
+			return false;
+		}
+		uint8_t kind = in.getU8();
+		e.kind = (EffectKind)(kind < EFFECT_KIND_COUNT ? kind : EFFECT_NONE);
+		e.power = in.getI32();
+		e.turns_left = in.getU32();
+		e.next = in.getU32();
+		e.prev = in.getU32();
+		if((e.next != NO_EFFECT && e.next >= count) || (e.prev != NO_EFFECT && e.prev >= count)){
+			return false;
+		}
+		saved_active += e.target != NULL ? 1 : 0;
+	}
+	uint32_t saved_free = in.getU32();
+	if(!in.ok() || (saved_free != NO_EFFECT && saved_free >= count) || !wheel.deserialize(in)){
+		return false;
+	}
+
+	effects.swap(saved);
+	free_list = saved_free;
+	active = saved_active;
+	for(std::size_t id = 0; id < effects.size(); id++){
+		Effect& e = effects[id];
+		if(e.target == NULL){
+			continue;
+		}
+		e.target->effect_engine = this;
+		if(e.prev == NO_EFFECT){
+			e.target->effects = (unsigned int)id;
+		}
+		if(e.target != &owner && isBuff(e.kind)){
+			e.target->addModifier(MOD_EFFECTS, buffStat(e.kind), e.power);
+		}
+	}
+	return true;
+}
+
+
+// others
+// - A character's first effect is the one with no prev, so taking only
+//   those lists each character once
+//
+void StatusEffects::others(const Character& owner, std::vector<const Character*>& out) const {
+	out.clear();
+	for(std::size_t id = 0; id < effects.size(); id++){
+		const Effect& e = effects[id];
+		if(e.target != NULL && e.target != &owner && e.prev == NO_EFFECT){
+			out.push_back(e.target);
+		}
+	}
+}
+
+
+// display
+// - "Effects: burning (2 turns), shielded (5 turns)", nothing if none
+//
+void StatusEffects::display(const Character& target, std::ostream& out) const {
+	if(target.effects == NO_EFFECT){
+		return;
+	}
+	out << "  Effects:";
+	const char* separator = " ";
+	for(unsigned int id = target.effects; id != NO_EFFECT; id = effects[id].next){
+		const Effect& e = effects[id];
+		unsigned long long left = isBuff(e.kind) ? wheel.getDeadline(id) - wheel.getNow() : e.turns_left;
+		out << separator << describe(e.kind) << " (" << left << (left == 1 ? " turn)" : " turns)");
+		separator = ", ";
+	}
+	out << std::endl;
+}
+
+
+// benchmark
+// - The same buffs twice: on a private engine's wheel, and as a plain
+//   array of countdowns decremented every turn (what a per-entity scan
+//   costs); both must expire the same number each turn
+//
+bool StatusEffects::benchmark(unsigned int count, unsigned int horizon, unsigned long long seed) {
+	if(horizon < 1){ horizon = 1; }
+	if(horizon > MAX_TURNS){ horizon = MAX_TURNS; }
+	RandomStream rng(seed, 0);
+
+	std::vector<Character*> characters(count);
+	std::vector<unsigned int> countdown(count);
+	StatusEffects engine(std::cout);
+	engine.quiet = true;
+
+	double start = nowSeconds();
+	for(unsigned int i = 0; i < count; i++){
+		characters[i] = new Character("Bench", 100, 10, 5);
+		EffectSpec spec;
+		spec.kind = (i & 1) ? EFFECT_ATTACK_UP : EFFECT_DEFENSE_UP;
+		spec.power = 1;
+		spec.turns = rng.below(horizon) + 1;
+		countdown[i] = spec.turns;
+		engine.apply(*characters[i], spec);
+	}
+	double applied = nowSeconds() - start;
+
+	//the wheel
+	unsigned int turns = horizon + 1;
+	std::vector<std::size_t> fired(turns, 0);
+	start = nowSeconds();
+	for(unsigned int t = 0; t < turns; t++){
+		fired[t] = engine.advance();
+	}
+	double wheel_time = nowSeconds() - start;
+
+	//the scan
+	bool same = true;
+	start = nowSeconds();
+	for(unsigned int t = 0; t < turns; t++){
+		std::size_t expired = 0;
+		for(unsigned int i = 0; i < count; i++){
+			if(countdown[i] > 0 && --countdown[i] == 0){
+				expired++;
+			}
+		}
+		same = same && expired == fired[t];
+	}
+	double scan_time = nowSeconds() - start;
+
+	//every buff gone and undone (take any leftovers off this engine, not the game's)
+	bool restored = engine.activeCount() == 0;
+	for(unsigned int i = 0; i < count; i++){
+		restored = restored && characters[i]->getAttack() == 10 && characters[i]->getDefense() == 5;
+		engine.clear(*characters[i], false);
+		delete characters[i];
+	}
+
+	std::cout << "========================================" << std::endl;
+	std::cout << "Status effect benchmark: " << count << " buffs over " << turns << " turns" << std::endl;
+	std::cout << "  Apply:        " << applied * 1e9 / (count ? count : 1) << " ns per effect" << std::endl;
+	std::cout << "  Timer wheel:  " << wheel_time * 1e9 / turns << " ns per turn" << std::endl;
+	std::cout << "  Scan:         " << scan_time * 1e9 / turns << " ns per turn" << std::endl;
+	std::cout << "  Results:      " << (same && restored ? "identical" : "MISMATCH") << std::endl;
+	std::cout << "========================================" << std::endl;
+	return same && restored;
+}
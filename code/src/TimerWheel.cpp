@@ -0,0 +1,203 @@
+#include "TimerWheel.h"
+#include "Serializer.h"
+
+const unsigned int TimerWheel::LEVELS;
+const unsigned int TimerWheel::SLOT_BITS;
+const unsigned int TimerWheel::SLOTS;
+const unsigned int TimerWheel::NONE;
+
+// Furthest a timer can be filed ahead (top level, last slot)
+static const unsigned long long MAX_DELAY =
+	(1ULL << (TimerWheel::SLOT_BITS * TimerWheel::LEVELS)) - 1;
+
+// TimerWheel constructor - every slot empty, time 0
+TimerWheel::TimerWheel() : now(0), scheduled(0) {
+	for(unsigned int i = 0; i < LEVELS * SLOTS; i++){
+		heads[i] = NONE;
+	}
+}
+
+
+// link
+// - File the node in the lowest level whose span covers its deadline;
+//   the slot is the deadline's digit at that level
+// - Beyond the top level it is parked as far out as possible and
+//   re-filed when that slot cascades
+//
+void TimerWheel::link(unsigned int handle) {
+	Node& node = nodes[handle];
+	unsigned long long delta = node.deadline - now;
+	unsigned long long when = node.deadline;
+	if(delta > MAX_DELAY){
+		when = now + MAX_DELAY;
+		delta = MAX_DELAY;
+	}
+
+	unsigned int level = 0;
+	while(level + 1 < LEVELS && delta >= (1ULL << (SLOT_BITS * (level + 1)))){
+		level++;
+	}
+	unsigned int slot = level * SLOTS + (unsigned int)((when >> (SLOT_BITS * level)) & (SLOTS - 1));
+
+	node.slot = slot;
+	node.prev = NONE;
+	node.next = heads[slot];
+	if(node.next != NONE){
+		nodes[node.next].prev = handle;
+	}
+	heads[slot] = handle;
+}
+
+
+// unlink - O(1), the node knows its slot and neighbours
+void TimerWheel::unlink(unsigned int handle) {
+	Node& node = nodes[handle];
+	if(node.prev != NONE){
+		nodes[node.prev].next = node.next;
+	} else {
+		heads[node.slot] = node.next;
+	}
+	if(node.next != NONE){
+		nodes[node.next].prev = node.prev;
+	}
+	node.slot = NONE;
+}
+
+
+// cascade
+// - Empty the current slot of `level` into the levels below it
+//
+void TimerWheel::cascade(unsigned int level) {
+	unsigned int slot = level * SLOTS + (unsigned int)((now >> (SLOT_BITS * level)) & (SLOTS - 1));
+	unsigned int handle = heads[slot];
+	heads[slot] = NONE;
+	while(handle != NONE){
+		unsigned int next = nodes[handle].next;
+		link(handle);
+		handle = next;
+	}
+}
+
+
+// schedule
+// - Grow the node array to fit the handle, then file it
+//
+void TimerWheel::schedule(unsigned int handle, unsigned long long delay) {
+	if(handle >= nodes.size()){
+		Node empty;
+		empty.deadline = 0;
+		empty.next = NONE;
+		empty.prev = NONE;
+		empty.slot = NONE;
+		nodes.resize(handle + 1, empty);
+	}
+	if(nodes[handle].slot != NONE){
+		unlink(handle);
+	} else {
+		scheduled++;
+	}
+	nodes[handle].deadline = now + (delay == 0 ? 1 : delay);
+	link(handle);
+}
+
+
+// cancel - no-op if the handle isn't scheduled
+void TimerWheel::cancel(unsigned int handle) {
+	if(isScheduled(handle)){
+		unlink(handle);
+		scheduled--;
+	}
+}
+
+
+// advance
+// - Move time on one tick; each time a level's digit wraps to 0 the
+//   next level's current slot comes down first
+// - Then everything in level 0's slot is due now
+//
+void TimerWheel::advance(std::vector<unsigned int>& due) {
+	now++;
+	for(unsigned int level = 1; level < LEVELS; level++){
+		if(((now >> (SLOT_BITS * (level - 1))) & (SLOTS - 1)) != 0){
+			break;
+		}
+		cascade(level);
+	}
+
+	unsigned int slot = (unsigned int)(now & (SLOTS - 1));
+	unsigned int handle = heads[slot];
+	heads[slot] = NONE;
+	while(handle != NONE){
+		unsigned int next = nodes[handle].next;
+		nodes[handle].slot = NONE;
+		scheduled--;
+		due.push_back(handle);
+		handle = next;
+	}
+}
+
+
+// serialize
+// - Clock, node count, each node, then the slot heads
+//
+void TimerWheel::serialize(ByteWriter& out) const {
+	out.putU64(now);
+	out.putU64(scheduled);
+	out.putU32((uint32_t)nodes.size());
+	for(std::size_t i = 0; i < nodes.size(); i++){
+		out.putU64(nodes[i].deadline);
+		out.putU32(nodes[i].next);
+		out.putU32(nodes[i].prev);
+		out.putU32(nodes[i].slot);
+	}
+	for(unsigned int i = 0; i < LEVELS * SLOTS; i++){
+		out.putU32(heads[i]);
+	}
+}
+
+
+// deserialize
+// - Replace everything with a wheel written by serialize()
+// - Links are checked against the node count; false (wheel unchanged)
+//   if the data is bad
+//
+bool TimerWheel::deserialize(ByteReader& in) {
+	unsigned long long saved_now = in.getU64();
+	unsigned long long saved_scheduled = in.getU64();
+	uint32_t count = in.getU32();
+	if(!in.ok() || count > in.remaining() / 20){
+		return false;
+	}
+
+	std::vector<Node> saved(count);
+	for(uint32_t i = 0; i < count; i++){
+		saved[i].deadline = in.getU64();
+		saved[i].next = in.getU32();
+		saved[i].prev = in.getU32();
+		saved[i].slot = in.getU32();
+		bool linked = (saved[i].next == NONE || saved[i].next < count) &&
+		              (saved[i].prev == NONE || saved[i].prev < count) &&
+		              (saved[i].slot == NONE || saved[i].slot < LEVELS * SLOTS);
+		if(!linked){
+			return false;
+		}
+	}
+	unsigned int saved_heads[LEVELS * SLOTS];
+	for(unsigned int i = 0; i < LEVELS * SLOTS; i++){
+		saved_heads[i] = in.getU32();
+		if(saved_heads[i] != NONE && saved_heads[i] >= count){
+			return false;
+		}
+	}
+	if(!in.ok()){
+		return false;
+	}
+
+	nodes.swap(saved);
+	for(unsigned int i = 0; i < LEVELS * SLOTS; i++){
+		heads[i] = saved_heads[i];
+	}
+	now = saved_now;
+	scheduled = (std::size_t)saved_scheduled;
+	return true;
+}
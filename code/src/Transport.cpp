@@ -0,0 +1,393 @@
+#include "Transport.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// Transport destructor
+Transport::~Transport() {
+}
+
+
+// dropCarriageReturn - "look\r" from a telnet client is "look"
+static void dropCarriageReturn(std::string& line) {
+	if(!line.empty() && line[line.size() - 1] == '\r'){
+		line.erase(line.size() - 1);
+	}
+}
+
+
+// ============================================================================
+// FdTransport
+// ============================================================================
+
+// FdTransport constructor - nothing read yet
+FdTransport::FdTransport(int in_fd, int out_fd)
+    : in_fd(in_fd), out_fd(out_fd), input(4096), start(0), end(0), at_eof(false) {
+}
+
+
+// readLine
+// - Return the next complete line already read, if there is one
+// - Otherwise move the partial line to the front and read another block
+//   (growing the buffer for very long lines)
+// - At end of input a last line without '\n' still counts
+//
+bool FdTransport::readLine(std::string& line) {
+	for(;;){
+		const char* first = &input[0] + start;
+		const char* newline = (const char*)memchr(first, '\n', end - start);
+		if(newline != NULL){
+			line.assign(first, newline - first);
+			start += (newline - first) + 1;
+			dropCarriageReturn(line);
+			return true;
+		}
+		if(at_eof){
+			if(start == end){
+				return false;
+			}
+			line.assign(first, end - start);
+			start = end;
+			dropCarriageReturn(line);
+			return true;
+		}
+
+		//make room after the partial line
+		if(start > 0){
+			memmove(&input[0], first, end - start);
+			end -= start;
+			start = 0;
+		}
+		if(end == input.size()){
+			input.resize(input.size() * 2);
+		}
+
+		ssize_t got = ::read(in_fd, &input[end], input.size() - end);
+		if(got < 0 && errno == EINTR){
+			continue;
+		}
+		if(got <= 0){
+			at_eof = true;
+		} else {
+			end += (std::size_t)got;
+		}
+	}
+}
+
+
+// writeAll
+// - One write call for the whole chunk unless the kernel takes less
+//
+bool FdTransport::writeAll(const char* data, std::size_t size) {
+	while(size > 0){
+		ssize_t put = ::write(out_fd, data, size);
+		if(put < 0 && errno == EINTR){
+			continue;
+		}
+		if(put <= 0){
+			return false;
+		}
+		data += put;
+		size -= (std::size_t)put;
+	}
+	return true;
+}
+
+
+// ============================================================================
+// SocketTransport
+// ============================================================================
+
+// SocketTransport constructor - one descriptor both ways
+SocketTransport::SocketTransport(int fd) : FdTransport(fd, fd) {
+}
+
+
+// SocketTransport destructor - hang up
+SocketTransport::~SocketTransport() {
+	close(getOutput());
+}
+
+
+// writeAll
+// - Like FdTransport's, but a closed connection is an error, not SIGPIPE
+//
+bool SocketTransport::writeAll(const char* data, std::size_t size) {
+	while(size > 0){
+		ssize_t put = ::send(getOutput(), data, size, MSG_NOSIGNAL);
+		if(put < 0 && errno == EINTR){
+			continue;
+		}
+		if(put <= 0){
+			return false;
+		}
+		data += put;
+		size -= (std::size_t)put;
+	}
+	return true;
+}
+
+
+// accept
+// - Listen on 127.0.0.1:port, take the first client, stop listening
+//
+SocketTransport* SocketTransport::accept(unsigned short port) {
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	if(listener < 0){
+		std::cout << "Error: cannot open a socket: " << strerror(errno) << std::endl;
+		return NULL;
+	}
+	int one = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if(bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 1) != 0){
+		std::cout << "Error: cannot listen on port " << port << ": " << strerror(errno) << std::endl;
+		close(listener);
+		return NULL;
+	}
+
+	std::cout << "Waiting for a player on 127.0.0.1:" << port << "..." << std::endl;
+	int client = -1;
+	do {
+		client = ::accept(listener, NULL, NULL);
+	} while(client < 0 && errno == EINTR);
+	close(listener);
+	if(client < 0){
+		std::cout << "Error: accept failed: " << strerror(errno) << std::endl;
+		return NULL;
+	}
+	return new SocketTransport(client);
+}
+
+
+// ============================================================================
+// MemoryTransport
+// ============================================================================
+
+// MemoryTransport constructor
+// - Output ring rounded up to a power of two (at least 64 bytes)
+//
+MemoryTransport::MemoryTransport(std::size_t capacity)
+    : written(0), dropped(0), writes(0) {
+	std::size_t size = 64;
+	while(size < capacity){
+		size *= 2;
+	}
+	output.data.resize(size);
+	output.head = output.tail = 0;
+	input.data.resize(4096);
+	input.head = input.tail = 0;
+}
+
+
+// put
+// - Copy into the ring at its head, in two pieces if it wraps
+// - The caller has made room
+//
+void MemoryTransport::put(Ring& ring, const char* data, std::size_t size) {
+	std::size_t at = (std::size_t)(ring.head & ring.mask());
+	std::size_t first = ring.data.size() - at;
+	if(first > size){
+		first = size;
+	}
+	memcpy(&ring.data[at], data, first);
+	memcpy(&ring.data[0], data + first, size - first);
+	ring.head += size;
+}
+
+
+// feed
+// - Grow the input ring (unwrapping what is queued) if it can't hold the
+//   new bytes, then append them
+//
+void MemoryTransport::feed(const char* data, std::size_t size) {
+	std::size_t used = input.used();
+	if(used + size > input.data.size()){
+		std::size_t grown = input.data.size();
+		while(grown < used + size){
+			grown *= 2;
+		}
+		Ring bigger;
+		bigger.data.resize(grown);
+		bigger.head = bigger.tail = 0;
+		std::size_t at = (std::size_t)(input.tail & input.mask());
+		std::size_t first = input.data.size() - at;
+		if(first > used){
+			first = used;
+		}
+		put(bigger, &input.data[at], first);
+		put(bigger, &input.data[0], used - first);
+		input.data.swap(bigger.data);
+		input.head = bigger.head;
+		input.tail = 0;
+	}
+	put(input, data, size);
+}
+
+
+// readLine
+// - Up to the next '\n' in the input ring; the rest of the input if
+//   there is none (end of input)
+//
+bool MemoryTransport::readLine(std::string& line) {
+	std::size_t used = input.used();
+	if(used == 0){
+		return false;
+	}
+	std::size_t length = 0;
+	while(length < used && input.data[(std::size_t)((input.tail + length) & input.mask())] != '\n'){
+		length++;
+	}
+
+	std::size_t at = (std::size_t)(input.tail & input.mask());
+	std::size_t first = input.data.size() - at;
+	if(first > length){
+		first = length;
+	}
+	line.assign(&input.data[at], first);
+	line.append(&input.data[0], length - first);
+	input.tail += (length < used) ? length + 1 : length;
+	dropCarriageReturn(line);
+	return true;
+}
+
+
+// write
+// - Never blocks or fails: whatever doesn't fit pushes the oldest unread
+//   output out (counted as dropped)
+//
+bool MemoryTransport::write(const char* data, std::size_t size) {
+	writes++;
+	written += size;
+	std::size_t capacity = output.data.size();
+	if(size >= capacity){
+		dropped += output.used() + (size - capacity);
+		output.tail = output.head;
+		data += size - capacity;
+		size = capacity;
+	}
+	std::size_t room = capacity - output.used();
+	if(size > room){
+		output.tail += size - room;
+		dropped += size - room;
+	}
+	put(output, data, size);
+	return true;
+}
+
+
+// peek - the unread output where it lies in the ring
+void MemoryTransport::peek(const char*& first, std::size_t& first_size,
+                           const char*& second, std::size_t& second_size) const {
+	std::size_t used = output.used();
+	std::size_t at = (std::size_t)(output.tail & output.mask());
+	first = &output.data[at];
+	first_size = output.data.size() - at;
+	if(first_size > used){
+		first_size = used;
+	}
+	second = &output.data[0];
+	second_size = used - first_size;
+}
+
+
+// consume - release up to `size` bytes of unread output
+void MemoryTransport::consume(std::size_t size) {
+	std::size_t used = output.used();
+	output.tail += (size < used) ? size : used;
+}
+
+
+// drain - copy out and release all unread output
+std::string MemoryTransport::drain() {
+	const char* first = NULL;
+	const char* second = NULL;
+	std::size_t first_size = 0;
+	std::size_t second_size = 0;
+	peek(first, first_size, second, second_size);
+	std::string text(first, first_size);
+	text.append(second, second_size);
+	consume(first_size + second_size);
+	return text;
+}
+
+
+// ============================================================================
+// RenderBuffer
+// ============================================================================
+
+// RenderBuffer constructor - room for a screenful to start with
+RenderBuffer::RenderBuffer(Transport* transport, bool flush_lines)
+    : storage(4096), transport(transport), flush_lines(flush_lines), failed(false) {
+	setp(&storage[0], &storage[0] + storage.size());
+}
+
+
+// overflow
+// - Out of room: double the storage (keeping what is there), then store c
+//
+RenderBuffer::int_type RenderBuffer::overflow(int_type c) {
+	std::size_t used = pending();
+	storage.resize(storage.size() * 2);
+	setp(&storage[0], &storage[0] + storage.size());
+	pbump((int)used);
+	if(!traits_type::eq_int_type(c, traits_type::eof())){
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+	}
+	return traits_type::not_eof(c);
+}
+
+
+// xsputn
+// - Grow once to fit, then one copy
+//
+std::streamsize RenderBuffer::xsputn(const char* data, std::streamsize size) {
+	std::size_t used = pending();
+	if(used + (std::size_t)size > storage.size()){
+		std::size_t grown = storage.size();
+		while(grown < used + (std::size_t)size){
+			grown *= 2;
+		}
+		storage.resize(grown);
+		setp(&storage[0], &storage[0] + storage.size());
+		pbump((int)used);
+	}
+	memcpy(pptr(), data, (std::size_t)size);
+	pbump((int)size);
+	return size;
+}
+
+
+// sync
+// - std::endl / std::flush: ignored, unless flushing every line
+//
+int RenderBuffer::sync() {
+	if(flush_lines){
+		flush();
+	}
+	return 0;
+}
+
+
+// flush
+// - One transport write for everything rendered since the last flush
+//
+bool RenderBuffer::flush() {
+	std::size_t used = pending();
+	if(used > 0 && !failed){
+		failed = !transport->write(pbase(), used);
+	}
+	setp(&storage[0], &storage[0] + storage.size());
+	return !failed;
+}
@@ -0,0 +1,521 @@
+#include "World.h"
+#include "WorldFile.h"
+#include "RoomPager.h"
+#include "Room.h"
+#include <iostream>
+#include <algorithm>
+
+// World constructor
+// - The four compass directions get the first ids so the common
+//   case never grows the direction table
+//
+World::World()
+    : room_total(0), mapped(NULL), pager(NULL), listener(NULL), grid_first(0), grid_count(0),
+      grid_width(0), csr_offsets(NULL), csr_targets(NULL),
+      csr_dirs(NULL), csr_rooms(0), exits_dirty(true) {
+	internDirection("north");
+	internDirection("south");
+	internDirection("east");
+	internDirection("west");
+}
+
+
+// World destructor
+// - Delete every room (rooms delete their own monsters and items)
+//
+World::~World() {
+	clear();
+}
+
+
+// clear
+// - Delete all rooms and drop the exit table and name index
+// - Unmap the world file if there is one
+//
+void World::clear() {
+	//stop paging first - nothing should be written out during teardown
+	delete pager;
+	pager = NULL;
+
+	for(std::size_t i = 0; i < rooms.size(); i++){
+		delete rooms[i];
+	}
+	rooms.clear();
+	room_total = 0;
+	room_names.clear();
+	delete mapped;
+	mapped = NULL;
+	csr_offsets = NULL;
+	csr_targets = NULL;
+	csr_dirs = NULL;
+	csr_rooms = 0;
+	exit_offsets.clear();
+	exit_targets.clear();
+	exit_dirs.clear();
+	pending.clear();
+	exits_dirty = true;
+	grid_width = 0;
+	if(listener != NULL){
+		listener->worldReset();
+	}
+}
+
+
+// reserve
+// - Pre-size storage when the caller knows how big the world will be
+//
+void World::reserve(std::size_t room_count, std::size_t exit_count) {
+	rooms.reserve(room_count);
+	room_names.reserve(room_count);
+	pending.reserve(exit_count);
+}
+
+
+// addRoom
+// - Check if room pointer is not NULL
+// - Assign it the next dense id and index it by name
+// - World takes ownership
+//
+RoomId World::addRoom(Room* room) {
+	if(room == NULL){
+		return NO_ROOM;
+	}
+
+	RoomId id = (RoomId)room_total++;
+	if(rooms.size() < room_total){
+		rooms.resize(room_total, NULL);
+	}
+	rooms[id] = room;
+	room->attach(this, id);
+	room_names.insert(room->getName(), id);
+	exits_dirty = true;
+	if(pager){
+		pager->admit(id, room);
+	}
+	return id;
+}
+
+
+// findRoom
+// - Case-insensitive name lookup, NO_ROOM if missing
+//
+RoomId World::findRoom(const std::string& name) const {
+	return findRoom(name.data(), name.size());
+}
+
+RoomId World::findRoom(const char* name, std::size_t len) const {
+	std::size_t id = room_names.find(name, len);
+	if(id != NameIndex::NOT_FOUND){
+		return (RoomId)id;
+	}
+
+	//rooms from the world file are indexed inside the file
+	return mapped ? mapped->findRoom(name, len) : NO_ROOM;
+}
+
+
+// attachFile
+// - Map a compiled world file into an empty world
+// - Take the direction table from the file and point the CSR at the mapping
+// - Rooms are created later, one at a time, by getRoom()
+//
+RoomId World::attachFile(const std::string& path) {
+	if(room_total != 0){
+		std::cout << "Error: world file must be loaded into an empty world" << std::endl;
+		return NO_ROOM;
+	}
+
+	MappedWorld* file = new MappedWorld();
+	if(!file->open(path)){
+		delete file;
+		return NO_ROOM;
+	}
+	mapped = file;
+
+	//the file's direction ids must mean the same thing here
+	direction_names.clear();
+	for(uint32_t d = 0; d < file->directionCount(); d++){
+		const WorldFileString& name = file->directionName(d);
+		internDirection(std::string(file->text(name), name.length));
+	}
+
+	room_total = file->roomCount();
+	csr_offsets = file->exitOffsets();
+	csr_targets = file->exitTargets();
+	csr_dirs = file->exitDirs();
+	csr_rooms = room_total;
+	pending.clear();
+	exits_dirty = false;
+	if(listener != NULL){
+		listener->worldReset();
+	}
+
+	return file->startRoom();
+}
+
+
+// lookupRoom
+// - Slow path of getRoom(): paging is on, or the room is not in memory
+// - Resident room: tell the pager it was used
+// - Otherwise rebuild it from its page, or create it from the world file
+// - Returns NULL for ids that don't exist at all
+//
+Room* World::lookupRoom(RoomId id) const {
+	if(id >= room_total){
+		return NULL;
+	}
+	if(id < rooms.size() && rooms[id] != NULL){
+		if(pager){
+			pager->touch(id);
+		}
+		return rooms[id];
+	}
+
+	Room* room = NULL;
+	if(pager && pager->hasPage(id)){
+		room = pager->pageIn(id);
+	} else if(mapped && id < mapped->roomCount()){
+		room = mapped->createRoom(id);
+	}
+	if(room == NULL){
+		return NULL;
+	}
+
+	if(rooms.size() <= id){
+		rooms.resize(id + 1, NULL);
+	}
+	rooms[id] = room;
+	room->attach(const_cast<World*>(this), id);
+
+	if(pager){
+		pager->countMiss();
+		pager->admit(id, room);
+	}
+	return room;
+}
+
+
+// enablePaging
+// - Start an LRU pager with the given budget
+// - Rooms already in memory are admitted oldest id first, so a big
+//   generated world is trimmed down to the budget right away
+//
+void World::enablePaging(std::size_t budget_bytes, RoomId pinned_room) {
+	if(pager != NULL){
+		return;
+	}
+	pager = new RoomPager(*this, budget_bytes);
+	if(pinned_room != NO_ROOM){
+		pager->pin(pinned_room);
+	}
+	for(std::size_t i = 0; i < rooms.size(); i++){
+		if(rooms[i] != NULL){
+			pager->admit((RoomId)i, rooms[i]);
+		}
+	}
+}
+
+
+// pagingStats - NULL when paging is off
+const PagingStats* World::pagingStats() const {
+	return pager ? &pager->getStats() : NULL;
+}
+
+
+// pin / unpin
+// - Pinned rooms are never evicted (no-op without paging)
+//
+void World::pin(RoomId id) {
+	if(pager){
+		pager->pin(id);
+	}
+}
+
+void World::unpin(RoomId id) {
+	if(pager){
+		pager->unpin(id);
+	}
+}
+
+
+// holdRooms / releaseRooms
+// - Open and close a RoomHold (nothing to do without paging)
+//
+std::size_t World::holdRooms() const {
+	return pager ? pager->openHold() : 0;
+}
+
+void World::releaseRooms(std::size_t mark) const {
+	if(pager){
+		pager->closeHold(mark);
+	}
+}
+
+
+// prefetchNeighbours
+// - Bring every room next to this one into memory before the player
+//   steps into it
+//
+void World::prefetchNeighbours(RoomId id) const {
+	if(id >= room_total){
+		return;
+	}
+	for(unsigned int e = exitBegin(id); e < exitEnd(id); e++){
+		getRoom(exitTarget(e));
+	}
+}
+
+
+// isCreated
+// - In memory, or written out to the pager's page file
+//
+bool World::isCreated(RoomId id) const {
+	return isLoaded(id) || (pager != NULL && pager->hasPage(id));
+}
+
+
+// firstResident / nextResident
+// - The pager's LRU list, or the created rooms in id order
+//
+RoomId World::firstResident() const {
+	return pager != NULL ? pager->firstResident() : nextResident(NO_ROOM);   //NO_ROOM + 1 wraps to 0
+}
+
+RoomId World::nextResident(RoomId id) const {
+	if(pager != NULL){
+		return pager->nextResident(id);
+	}
+	for(RoomId next = id + 1; next < rooms.size(); next++){
+		if(rooms[next] != NULL){
+			return next;
+		}
+	}
+	return NO_ROOM;
+}
+
+
+// releaseRoom / restoreRoom
+// - Hand a room's ownership to the pager and back
+//
+Room* World::releaseRoom(RoomId id) {
+	if(id >= rooms.size()){
+		return NULL;
+	}
+	Room* room = rooms[id];
+	rooms[id] = NULL;
+	return room;
+}
+
+void World::restoreRoom(RoomId id, Room* room) {
+	if(id < rooms.size()){
+		rooms[id] = room;
+	}
+}
+
+
+// internDirection
+// - Return the id for a direction name, adding it if it is new
+// - Recompute the alphabetical ranks used to order exits for display
+//
+int World::internDirection(const std::string& direction) {
+	int existing = directionId(direction);
+	if(existing >= 0){
+		return existing;
+	}
+
+	direction_names.push_back(direction);
+
+	//rank = position in sorted order (the old exits map printed alphabetically)
+	std::vector<std::string> sorted(direction_names);
+	std::sort(sorted.begin(), sorted.end());
+	direction_rank.resize(direction_names.size());
+	for(std::size_t i = 0; i < direction_names.size(); i++){
+		direction_rank[i] = (unsigned char)(std::lower_bound(sorted.begin(), sorted.end(), direction_names[i]) - sorted.begin());
+	}
+
+	//direction table changed order - rows must be re-sorted
+	exits_dirty = true;
+	return (int)direction_names.size() - 1;
+}
+
+
+// directionId
+// - Linear scan: there are only a handful of directions
+// - Any case ("go North" is "go north")
+// - Returns -1 if the direction has never been used
+//
+int World::directionId(const std::string& direction) const {
+	return directionId(direction.data(), direction.size());
+}
+
+int World::directionId(const char* direction, std::size_t len) const {
+	for(std::size_t i = 0; i < direction_names.size(); i++){
+		if(NameIndex::equalsIgnoreCase(direction_names[i].data(), direction_names[i].size(), direction, len)){
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+
+// addExit
+// - Queue the edge; the CSR table is rebuilt on the next lookup
+// - An exit that isn't between neighbouring grid cells (a jump across
+//   the grid, or a way on or off it) makes the Manhattan distance an
+//   overestimate, so the grid layout is forgotten and searches stop
+//   using it
+//
+void World::addExit(RoomId from, int dir, RoomId to) {
+	if(from >= room_total || to >= room_total || dir < 0){
+		return;
+	}
+
+	if(grid_width != 0){
+		unsigned int fx, fy, tx, ty;
+		bool from_grid = gridPosition(from, fx, fy);
+		bool to_grid = gridPosition(to, tx, ty);
+		if(from_grid != to_grid ||
+		   (from_grid && (fx > tx ? fx - tx : tx - fx) + (fy > ty ? fy - ty : ty - fy) > 1)){
+			grid_width = 0;
+		}
+	}
+
+	PendingExit e;
+	e.from = from;
+	e.to = to;
+	e.dir = (unsigned char)dir;
+	pending.push_back(e);
+	exits_dirty = true;
+	if(listener != NULL){
+		listener->exitAdded(from, to);
+	}
+}
+
+
+// getExit
+// - Scan the (tiny) CSR row of a room for a direction id
+//
+RoomId World::getExit(RoomId from, int dir) const {
+	if(from >= room_total || dir < 0){
+		return NO_ROOM;
+	}
+	ensureBuilt();
+
+	for(unsigned int e = csr_offsets[from]; e < csr_offsets[from + 1]; e++){
+		if(csr_dirs[e] == dir){
+			return csr_targets[e];
+		}
+	}
+	return NO_ROOM;
+}
+
+
+// buildExits
+// - Merge the current CSR rows with the pending edges in one counting sort
+// - Within a row, order exits alphabetically by direction and keep only
+//   the most recent edge for each direction
+//
+void World::buildExits() const {
+	std::size_t n = room_total;
+	std::size_t old_rooms = csr_rooms;
+
+	//count exits per room
+	std::vector<unsigned int> offsets(n + 1, 0);
+	for(std::size_t r = 0; r < old_rooms; r++){
+		offsets[r + 1] += csr_offsets[r + 1] - csr_offsets[r];
+	}
+	for(std::size_t i = 0; i < pending.size(); i++){
+		offsets[pending[i].from + 1]++;
+	}
+	for(std::size_t r = 0; r < n; r++){
+		offsets[r + 1] += offsets[r];
+	}
+
+	//scatter old rows first, then pending edges (so newer edges come later)
+	std::vector<RoomId> targets(offsets[n]);
+	std::vector<unsigned char> dirs(offsets[n]);
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for(std::size_t r = 0; r < old_rooms; r++){
+		for(unsigned int e = csr_offsets[r]; e < csr_offsets[r + 1]; e++){
+			targets[fill[r]] = csr_targets[e];
+			dirs[fill[r]] = csr_dirs[e];
+			fill[r]++;
+		}
+	}
+	for(std::size_t i = 0; i < pending.size(); i++){
+		RoomId r = pending[i].from;
+		targets[fill[r]] = pending[i].to;
+		dirs[fill[r]] = pending[i].dir;
+		fill[r]++;
+	}
+
+	//sort each row by direction rank (stable insertion sort), drop overwritten exits
+	unsigned int out = 0;
+	for(std::size_t r = 0; r < n; r++){
+		unsigned int begin = offsets[r];
+		unsigned int end = offsets[r + 1];
+
+		for(unsigned int i = begin + 1; i < end; i++){
+			RoomId t = targets[i];
+			unsigned char d = dirs[i];
+			unsigned int j = i;
+			while(j > begin && direction_rank[dirs[j - 1]] > direction_rank[d]){
+				targets[j] = targets[j - 1];
+				dirs[j] = dirs[j - 1];
+				j--;
+			}
+			targets[j] = t;
+			dirs[j] = d;
+		}
+
+		offsets[r] = out;
+		for(unsigned int i = begin; i < end; i++){
+			//a later edge in the same direction wins
+			if(i + 1 < end && dirs[i + 1] == dirs[i]){
+				continue;
+			}
+			targets[out] = targets[i];
+			dirs[out] = dirs[i];
+			out++;
+		}
+	}
+	offsets[n] = out;
+	targets.resize(out);
+	dirs.resize(out);
+
+	exit_offsets.swap(offsets);
+	exit_targets.swap(targets);
+	exit_dirs.swap(dirs);
+	pending.clear();
+	exits_dirty = false;
+
+	//from now on the CSR lives in our own vectors (even if it came from a file)
+	csr_offsets = &exit_offsets[0];
+	csr_targets = exit_targets.empty() ? NULL : &exit_targets[0];
+	csr_dirs = exit_dirs.empty() ? NULL : &exit_dirs[0];
+	csr_rooms = n;
+}
+
+
+// setGridLayout
+// - Remember where a block of generated rooms sits on its grid (exits
+//   already added are taken on trust; later ones are checked by addExit)
+//
+void World::setGridLayout(RoomId first, std::size_t count, unsigned int width) {
+	grid_first = first;
+	grid_count = count;
+	grid_width = width;
+}
+
+
+// gridPosition
+// - Grid cell of a room, if it is part of the grid layout
+//
+bool World::gridPosition(RoomId id, unsigned int& x, unsigned int& y) const {
+	if(grid_width == 0 || id < grid_first || id - grid_first >= grid_count){
+		return false;
+	}
+	x = (id - grid_first) % grid_width;
+	y = (id - grid_first) / grid_width;
+	return true;
+}
@@ -0,0 +1,453 @@
+#include "WorldFile.h"
+#include "NameIndex.h"
+#include "Room.h"
+#include "Monster.h"
+#include "Item.h"
+#include "ItemCatalog.h"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+	const char WORLD_MAGIC[8] = { 'D', 'C', 'W', 'O', 'R', 'L', 'D', 0 };
+
+	// Round a file offset up to the next 8 byte boundary
+	uint64_t align8(uint64_t offset) {
+		return (offset + 7) & ~(uint64_t)7;
+	}
+
+	// Does [offset, offset + count * width) fit inside a file of size bytes?
+	bool sectionFits(uint64_t offset, uint64_t count, uint64_t width, uint64_t size) {
+		if(offset > size || (offset & 7) != 0){
+			return false;
+		}
+		return count <= (size - offset) / (width ? width : 1);
+	}
+
+	// Collects deduplicated strings for the string blob
+	class StringTable {
+	private:
+		std::map<std::string, uint32_t> seen;
+	public:
+		std::string blob;
+
+		WorldFileString add(const std::string& s, bool dedupe) {
+			WorldFileString ref;
+			ref.length = (uint32_t)s.size();
+			if(dedupe){
+				std::map<std::string, uint32_t>::iterator it = seen.find(s);
+				if(it != seen.end()){
+					ref.offset = it->second;
+					return ref;
+				}
+				seen[s] = (uint32_t)blob.size();
+			}
+			ref.offset = (uint32_t)blob.size();
+			blob += s;
+			return ref;
+		}
+	};
+
+	// Write one section at its (aligned) offset
+	bool writeAt(FILE* f, uint64_t offset, const void* data, std::size_t bytes) {
+		if(fseek(f, (long)offset, SEEK_SET) != 0){
+			return false;
+		}
+		return bytes == 0 || fwrite(data, 1, bytes, f) == bytes;
+	}
+}
+
+
+// ============================================================================
+// MappedWorld
+// ============================================================================
+
+// MappedWorld constructor - nothing mapped yet
+MappedWorld::MappedWorld()
+    : base(NULL), size(0), header(NULL), rooms(NULL), exit_offsets(NULL),
+      exit_targets(NULL), exit_dirs(NULL), spawns(NULL), name_hash(NULL),
+      directions(NULL), strings(NULL) {
+}
+
+
+// MappedWorld destructor - unmap the file
+MappedWorld::~MappedWorld() {
+	close();
+}
+
+
+// open
+// - Map the whole file read-only
+// - Validate magic, version, that every section lies inside the file
+//   and that the exit table only points at rooms and directions it has
+// - Print an error and return false on any problem
+//
+bool MappedWorld::open(const std::string& path) {
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0){
+		std::cout << "Error: cannot open world file " << path << std::endl;
+		return false;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(WorldFileHeader)){
+		std::cout << "Error: " << path << " is not a world file" << std::endl;
+		::close(fd);
+		return false;
+	}
+
+	void* mapping = mmap(NULL, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(mapping == MAP_FAILED){
+		std::cout << "Error: cannot map world file " << path << std::endl;
+		return false;
+	}
+
+	//rooms are touched in whatever order the player walks
+	madvise(mapping, (std::size_t)st.st_size, MADV_RANDOM);
+
+	base = mapping;
+	size = (std::size_t)st.st_size;
+	if(!validate()){
+		std::cout << "Error: " << path << " is corrupt or has an unsupported version" << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+
+// validate
+// - Check the header, then point each section accessor into the mapping
+// - Check the exit table and room names in one linear pass (the rest of
+//   a room's record is checked when the room is created)
+//
+bool MappedWorld::validate() {
+	const char* bytes = static_cast<const char*>(base);
+	header = reinterpret_cast<const WorldFileHeader*>(bytes);
+
+	if(std::memcmp(header->magic, WORLD_MAGIC, sizeof(WORLD_MAGIC)) != 0 ||
+	   header->version != WORLD_FILE_VERSION ||
+	   header->header_size != sizeof(WorldFileHeader) ||
+	   header->file_size != size){
+		return false;
+	}
+
+	uint64_t n = header->room_count;
+	if(n == 0 || header->start_room >= n ||
+	   (header->hash_size & (header->hash_size - 1)) != 0 || header->hash_size < n ||
+	   !sectionFits(header->rooms_offset, n, sizeof(WorldFileRoom), size) ||
+	   !sectionFits(header->exit_offsets_offset, n + 1, sizeof(uint32_t), size) ||
+	   !sectionFits(header->exit_targets_offset, header->exit_count, sizeof(uint32_t), size) ||
+	   !sectionFits(header->exit_dirs_offset, header->exit_count, sizeof(uint8_t), size) ||
+	   !sectionFits(header->spawns_offset, header->spawn_count, sizeof(WorldFileSpawn), size) ||
+	   !sectionFits(header->hash_offset, header->hash_size, sizeof(uint32_t), size) ||
+	   !sectionFits(header->directions_offset, header->direction_count, sizeof(WorldFileString), size) ||
+	   !sectionFits(header->strings_offset, header->strings_size, 1, size) ||
+	   header->direction_count == 0 || header->direction_count > 255){
+		return false;
+	}
+
+	rooms = reinterpret_cast<const WorldFileRoom*>(bytes + header->rooms_offset);
+	exit_offsets = reinterpret_cast<const uint32_t*>(bytes + header->exit_offsets_offset);
+	exit_targets = reinterpret_cast<const uint32_t*>(bytes + header->exit_targets_offset);
+	exit_dirs = reinterpret_cast<const uint8_t*>(bytes + header->exit_dirs_offset);
+	spawns = reinterpret_cast<const WorldFileSpawn*>(bytes + header->spawns_offset);
+	name_hash = reinterpret_cast<const uint32_t*>(bytes + header->hash_offset);
+	directions = reinterpret_cast<const WorldFileString*>(bytes + header->directions_offset);
+	strings = bytes + header->strings_offset;
+
+	//the direction names must lie in the blob
+	for(uint32_t d = 0; d < header->direction_count; d++){
+		if((uint64_t)directions[d].offset + directions[d].length > header->strings_size){
+			return false;
+		}
+	}
+
+	//the World uses the CSR arrays as they are, so one pass over them:
+	//rows in order and inside the exit arrays, every target a room and
+	//every direction a known one
+	if(exit_offsets[0] != 0 || exit_offsets[n] != header->exit_count){
+		return false;
+	}
+	for(uint64_t r = 0; r < n; r++){
+		if(exit_offsets[r] > exit_offsets[r + 1]){
+			return false;
+		}
+	}
+	for(uint32_t e = 0; e < header->exit_count; e++){
+		if(exit_targets[e] >= n || exit_dirs[e] >= header->direction_count){
+			return false;
+		}
+	}
+
+	//room names are read by findRoom without creating the room
+	for(uint64_t r = 0; r < n; r++){
+		if((uint64_t)rooms[r].name.offset + rooms[r].name.length > header->strings_size){
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// close
+// - Unmap the file (safe to call twice)
+//
+void MappedWorld::close() {
+	if(base != NULL){
+		munmap(base, size);
+	}
+	base = NULL;
+	size = 0;
+	header = NULL;
+}
+
+
+// findRoom
+// - Linear probing over the on-disk table of room ids
+// - Hash is NameIndex::hashName, so it is case-insensitive
+//
+RoomId MappedWorld::findRoom(const char* name, std::size_t len) const {
+	uint32_t mask = header->hash_size - 1;
+	uint32_t slot = NameIndex::hashName(name, len) & mask;
+
+	for(uint32_t probes = 0; probes < header->hash_size; probes++){
+		uint32_t id = name_hash[slot];
+		if(id == NO_ROOM){
+			return NO_ROOM;
+		}
+		if(id < header->room_count &&
+		   NameIndex::equalsIgnoreCase(roomName(id), roomNameLength(id), name, len)){
+			return id;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return NO_ROOM;
+}
+
+
+// createRoom
+// - Build a Room from its record (name, description, spawn table)
+// - Records that point outside the file are rejected (returns NULL)
+//
+Room* MappedWorld::createRoom(RoomId id) const {
+	if(header == NULL || id >= header->room_count){
+		return NULL;
+	}
+
+	const WorldFileRoom& r = rooms[id];
+	if((uint64_t)r.name.offset + r.name.length > header->strings_size ||
+	   (uint64_t)r.description.offset + r.description.length > header->strings_size ||
+	   (uint64_t)r.spawn_begin + r.spawn_count > header->spawn_count){
+		std::cout << "Error: world file record for room " << id << " is corrupt" << std::endl;
+		return NULL;
+	}
+
+	Room* room = new Room(std::string(text(r.name), r.name.length),
+	                      std::string(text(r.description), r.description.length));
+
+	for(const WorldFileSpawn* s = spawnBegin(id); s != spawnEnd(id); ++s){
+		if((uint64_t)s->name.offset + s->name.length > header->strings_size ||
+		   (uint64_t)s->description.offset + s->description.length > header->strings_size){
+			continue;
+		}
+		std::string item_name(text(s->name), s->name.length);
+		std::string item_desc(text(s->description), s->description.length);
+
+		//items are rebuilt through the catalog with their slot and effect
+		ItemKind kind;
+		switch(s->kind){
+		case SPAWN_GOBLIN:     room->setSpawn(ARCHETYPE_GOBLIN); continue;
+		case SPAWN_SKELETON:   room->setSpawn(ARCHETYPE_SKELETON); continue;
+		case SPAWN_DRAGON:     room->setSpawn(ARCHETYPE_DRAGON); continue;
+		case SPAWN_WEAPON:     kind = ITEM_WEAPON; break;
+		case SPAWN_ARMOR:      kind = ITEM_ARMOR; break;
+		case SPAWN_CONSUMABLE: kind = ITEM_CONSUMABLE; break;
+		default: continue;
+		}
+		EffectSpec effect;
+		if(s->effect < EFFECT_KIND_COUNT){
+			effect.kind = (EffectKind)s->effect;
+			effect.power = s->effect_power;
+			effect.turns = s->effect_turns;
+		}
+		EquipSlot slot = s->slot <= EQUIP_NONE ? (EquipSlot)s->slot : EQUIP_NONE;
+		room->addItem(ItemCatalog::instance().intern(item_name, item_desc, kind, s->value, slot, effect)->create());
+	}
+	return room;
+}
+
+
+// ============================================================================
+// WorldCompiler
+// ============================================================================
+
+// compile
+// - Gather rooms, exits, spawns and strings from the World
+// - Build the on-disk name hash (load factor <= 50%)
+// - Write each section at an 8-byte aligned offset, header last
+//
+bool WorldCompiler::compile(const World& world, RoomId start_room, const std::string& path) {
+	uint32_t n = (uint32_t)world.roomCount();
+	if(n == 0 || start_room >= n){
+		std::cout << "Error: nothing to compile" << std::endl;
+		return false;
+	}
+
+	StringTable strings;
+	std::vector<WorldFileRoom> rooms(n);
+	std::vector<WorldFileSpawn> spawns;
+	std::vector<uint32_t> offsets(n + 1);
+	std::vector<uint32_t> targets;
+	std::vector<uint8_t> dirs;
+
+	targets.reserve(world.exitCount());
+	dirs.reserve(world.exitCount());
+
+	for(uint32_t id = 0; id < n; id++){
+		RoomHold hold(world);
+		Room* room = world.getRoom(id);
+		if(room == NULL){
+			std::cout << "Error: room " << id << " is not loaded" << std::endl;
+			return false;
+		}
+
+		rooms[id].name = strings.add(room->getName(), false);
+		rooms[id].description = strings.add(room->getDescription(), true);
+		rooms[id].spawn_begin = (uint32_t)spawns.size();
+
+		WorldFileSpawn spawn;
+		std::memset(&spawn, 0, sizeof(spawn));
+
+		//monsters (the format stores one kind per monster); pending spawns stay
+		//unbuilt, built ones are written if they're still alive
+		std::vector<unsigned int> kinds(room->getSpawnCount(), room->getSpawn());
+		const MonsterGroup& group = room->getBuiltMonsters();
+		for(std::size_t i = 0; i < group.size(); i++){
+			if(group[i]->isAlive()){
+				kinds.push_back(group[i]->getArchetypeId());
+			}
+		}
+		for(std::size_t i = 0; i < kinds.size(); i++){
+			spawn.kind = 0;
+			switch(kinds[i]){
+			case ARCHETYPE_GOBLIN:   spawn.kind = SPAWN_GOBLIN; break;
+			case ARCHETYPE_SKELETON: spawn.kind = SPAWN_SKELETON; break;
+			case ARCHETYPE_DRAGON:   spawn.kind = SPAWN_DRAGON; break;
+			default: break;
+			}
+			if(spawn.kind != 0){
+				spawns.push_back(spawn);
+			} else {
+				const ArchetypeTable* table = ArchetypeRegistry::instance().acquire();
+				std::cout << "Warning: unknown monster " << (*table)[kinds[i]].name << " not compiled" << std::endl;
+				table->release();
+			}
+		}
+
+		//items on the ground
+		const std::vector<Item*>& items = room->getItems();
+		for(std::size_t i = 0; i < items.size(); i++){
+			std::memset(&spawn, 0, sizeof(spawn));
+			switch(items[i]->getKind()){
+			case ITEM_WEAPON: spawn.kind = SPAWN_WEAPON; break;
+			case ITEM_ARMOR: spawn.kind = SPAWN_ARMOR; break;
+			case ITEM_CONSUMABLE: spawn.kind = SPAWN_CONSUMABLE; break;
+			}
+			spawn.value = items[i]->getValue();
+			spawn.slot = (uint8_t)items[i]->getSlot();
+			spawn.effect = (uint8_t)items[i]->getPrototype()->effect.kind;
+			spawn.effect_power = items[i]->getPrototype()->effect.power;
+			spawn.effect_turns = items[i]->getPrototype()->effect.turns;
+			spawn.name = strings.add(items[i]->getName(), true);
+			spawn.description = strings.add(items[i]->getDescription(), true);
+			spawns.push_back(spawn);
+		}
+		rooms[id].spawn_count = (uint32_t)spawns.size() - rooms[id].spawn_begin;
+
+		//exits, already in CSR order
+		offsets[id] = (uint32_t)targets.size();
+		for(unsigned int e = world.exitBegin(id); e < world.exitEnd(id); e++){
+			targets.push_back(world.exitTarget(e));
+			dirs.push_back((uint8_t)world.exitDirection(e));
+		}
+	}
+	offsets[n] = (uint32_t)targets.size();
+
+	//directions
+	std::vector<WorldFileString> directions(world.directionCount());
+	for(int d = 0; d < world.directionCount(); d++){
+		directions[d] = strings.add(world.directionName(d), true);
+	}
+
+	//name hash: power of two with at least 2 slots per room
+	uint32_t hash_size = 2;
+	while(hash_size < 2 * n){
+		hash_size *= 2;
+	}
+	std::vector<uint32_t> hash(hash_size, NO_ROOM);
+	for(uint32_t id = 0; id < n; id++){
+		const WorldFileString& name = rooms[id].name;
+		uint32_t slot = NameIndex::hashName(strings.blob.data() + name.offset, name.length) & (hash_size - 1);
+		while(hash[slot] != NO_ROOM){
+			slot = (slot + 1) & (hash_size - 1);
+		}
+		hash[slot] = id;
+	}
+
+	//lay out sections
+	WorldFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, WORLD_MAGIC, sizeof(WORLD_MAGIC));
+	header.version = WORLD_FILE_VERSION;
+	header.header_size = sizeof(WorldFileHeader);
+	header.room_count = n;
+	header.exit_count = (uint32_t)targets.size();
+	header.spawn_count = (uint32_t)spawns.size();
+	header.direction_count = (uint32_t)directions.size();
+	header.hash_size = hash_size;
+	header.start_room = start_room;
+
+	uint64_t at = align8(sizeof(WorldFileHeader));
+	header.rooms_offset = at;        at = align8(at + rooms.size() * sizeof(WorldFileRoom));
+	header.exit_offsets_offset = at; at = align8(at + offsets.size() * sizeof(uint32_t));
+	header.exit_targets_offset = at; at = align8(at + targets.size() * sizeof(uint32_t));
+	header.exit_dirs_offset = at;    at = align8(at + dirs.size());
+	header.spawns_offset = at;       at = align8(at + spawns.size() * sizeof(WorldFileSpawn));
+	header.hash_offset = at;         at = align8(at + hash.size() * sizeof(uint32_t));
+	header.directions_offset = at;   at = align8(at + directions.size() * sizeof(WorldFileString));
+	header.strings_offset = at;
+	header.strings_size = strings.blob.size();
+	header.file_size = at + strings.blob.size();
+
+	FILE* f = std::fopen(path.c_str(), "wb");
+	if(f == NULL){
+		std::cout << "Error: cannot write " << path << std::endl;
+		return false;
+	}
+
+	bool ok = writeAt(f, 0, &header, sizeof(header)) &&
+	          writeAt(f, header.rooms_offset, &rooms[0], rooms.size() * sizeof(WorldFileRoom)) &&
+	          writeAt(f, header.exit_offsets_offset, &offsets[0], offsets.size() * sizeof(uint32_t)) &&
+	          writeAt(f, header.exit_targets_offset, targets.empty() ? NULL : &targets[0], targets.size() * sizeof(uint32_t)) &&
+	          writeAt(f, header.exit_dirs_offset, dirs.empty() ? NULL : &dirs[0], dirs.size()) &&
+	          writeAt(f, header.spawns_offset, spawns.empty() ? NULL : &spawns[0], spawns.size() * sizeof(WorldFileSpawn)) &&
+	          writeAt(f, header.hash_offset, &hash[0], hash.size() * sizeof(uint32_t)) &&
+	          writeAt(f, header.directions_offset, &directions[0], directions.size() * sizeof(WorldFileString)) &&
+	          writeAt(f, header.strings_offset, strings.blob.data(), strings.blob.size());
+
+	if(std::fclose(f) != 0 || !ok){
+		std::cout << "Error: failed writing " << path << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,319 @@
+#include "WorldGenerator.h"
+#include "Room.h"
+#include "Monster.h"
+#include "Item.h"
+#include "ItemCatalog.h"
+#include "ArchetypeRegistry.h"
+#include "Random.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+// Salts keep the independent decisions for one room uncorrelated
+namespace {
+	const unsigned int SALT_LINK = 1;
+	const unsigned int SALT_LOOP = 2;
+	const unsigned int SALT_NAME = 3;
+	const unsigned int SALT_MONSTER = 4;
+	const unsigned int SALT_MONSTER_KIND = 5;
+	const unsigned int SALT_ITEM = 6;
+	const unsigned int SALT_ITEM_KIND = 7;
+	const unsigned int SALT_ITEM_VALUE = 8;
+	const unsigned int SALT_MONSTER_COUNT = 9;
+
+	// Exit bits computed by the workers for each room
+	const unsigned char LINK_NORTH = 1;
+	const unsigned char LINK_WEST = 2;
+
+	const char* ADJECTIVES[] = { "Damp", "Silent", "Crumbling", "Flooded", "Gloomy",
+	                             "Ancient", "Narrow", "Echoing", "Mossy", "Frozen" };
+	const char* NOUNS[] = { "Crypt", "Cell", "Gallery", "Cistern", "Chapel",
+	                        "Vault", "Passage", "Den", "Shrine", "Cavern" };
+	const char* DESCRIPTIONS[] = { "Water drips from the ceiling.",
+	                               "Old bones are scattered across the floor.",
+	                               "Torches flicker in iron sconces.",
+	                               "The air is thick with dust.",
+	                               "Strange runes are carved into the walls.",
+	                               "Something skitters in the dark." };
+	const char* WEAPONS[] = { "Iron Sword", "Battle Axe", "War Hammer", "Short Spear" };
+	const char* ARMORS[] = { "Leather Armor", "Chain Mail", "Iron Shield", "Plate Helm" };
+	const EquipSlot ARMOR_SLOTS[] = { EQUIP_BODY, EQUIP_BODY, EQUIP_SHIELD, EQUIP_HEAD };
+	const char* POTIONS[] = { "Small Potion", "Health Potion", "Bread", "Elixir" };
+
+	const unsigned int ADJECTIVE_COUNT = sizeof(ADJECTIVES) / sizeof(ADJECTIVES[0]);
+	const unsigned int NOUN_COUNT = sizeof(NOUNS) / sizeof(NOUNS[0]);
+	const unsigned int DESCRIPTION_COUNT = sizeof(DESCRIPTIONS) / sizeof(DESCRIPTIONS[0]);
+
+	double nowSeconds() {
+		struct timeval tv;
+		gettimeofday(&tv, NULL);
+		return tv.tv_sec + tv.tv_usec / 1000000.0;
+	}
+}
+
+
+// GeneratorConfig constructor - defaults give a medium density dungeon
+GeneratorConfig::GeneratorConfig()
+    : room_count(1000), seed(1), monster_density(0.3), item_density(0.2),
+      loop_density(0.1), threads(0) {
+}
+
+
+// print
+// - One summary block for load test logs
+//
+void GeneratorStats::print(std::ostream& out) const {
+	out << "========================================" << std::endl;
+	out << "World generation" << std::endl;
+	out << "  Rooms:    " << rooms << std::endl;
+	out << "  Exits:    " << exits << std::endl;
+	out << "  Monsters: " << monsters << std::endl;
+	out << "  Items:    " << items << std::endl;
+	out << "  Threads:  " << threads << std::endl;
+	out << "  Time:     " << seconds << " s" << std::endl;
+	out << "  Peak RSS: " << peak_rss_kb / 1024 << " MB" << std::endl;
+	out << "========================================" << std::endl;
+}
+
+
+// One worker's share of the rooms [begin, end)
+struct WorldGenerator::Slice {
+	const WorldGenerator* generator;
+	EntityArena* arena;    // the generating thread's, for the workers
+	unsigned int begin;
+	unsigned int end;
+	Room** rooms;          // output: rooms[i] for this slice
+	unsigned char* links;  // output: LINK_* bits for this slice
+	unsigned int monsters;
+	unsigned int items;
+};
+
+
+// WorldGenerator constructor
+// - Grid width is the ceiling of sqrt(room_count)
+//
+WorldGenerator::WorldGenerator(const GeneratorConfig& config)
+    : config(config), width(1), archetypes(NULL) {
+	while((unsigned long long)width * width < config.room_count){
+		width++;
+	}
+}
+
+
+// roll
+// - Pure function of (seed, room, salt): the same answer on every thread
+//
+unsigned long long WorldGenerator::roll(unsigned int room, unsigned int salt) const {
+	return RandomStream::mix64(config.seed ^ RandomStream::mix64(((unsigned long long)room << 8) | salt));
+}
+
+
+// chance
+// - Uniform double in [0, 1) for one decision
+//
+double WorldGenerator::chance(unsigned int room, unsigned int salt) const {
+	return (roll(room, salt) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+// buildSlice (thread entry point)
+// - Create every Room of the slice with its monster and items
+// - Decide which neighbours each room links to
+// - Touches nothing shared except its own output ranges
+//
+void* WorldGenerator::buildSlice(void* arg) {
+	Slice* slice = static_cast<Slice*>(arg);
+	const WorldGenerator& gen = *slice->generator;
+	unsigned int last = gen.config.room_count - 1;
+
+	//rooms come from the same arena whichever thread builds them
+	EntityArena* own = EntityArena::current();
+	EntityArena::adopt(slice->arena);
+
+	for(unsigned int i = slice->begin; i < slice->end; i++){
+		unsigned int x = i % gen.width;
+		unsigned int y = i / gen.width;
+
+		//name and description
+		Room* room;
+		if(i == 0){
+			room = new Room("Entrance", "A dark stone corridor");
+		} else if(i == last){
+			room = new Room("Throne Room", "The Dragon Boss Grand Room!");
+		} else {
+			unsigned long long r = gen.roll(i, SALT_NAME);
+			std::ostringstream name;
+			name << ADJECTIVES[r % ADJECTIVE_COUNT] << " " << NOUNS[(r >> 8) % NOUN_COUNT] << " " << i;
+			room = new Room(name.str(), DESCRIPTIONS[(r >> 16) % DESCRIPTION_COUNT]);
+		}
+
+		//monster
+		if(i == last && i != 0){
+			room->setSpawn(ARCHETYPE_DRAGON);
+			slice->monsters++;
+		} else if(i != 0 && gen.chance(i, SALT_MONSTER) < gen.config.monster_density){
+			//added archetypes each get the share goblins and skeletons have together
+			unsigned long long kind = gen.roll(i, SALT_MONSTER_KIND);
+			unsigned int added = (unsigned int)gen.archetypes->size() - ARCHETYPE_COUNT;
+			unsigned int pick = added ? (unsigned int)((kind >> 8) % (added + 1)) : 0;
+
+			//goblins come in packs of 1-3, skeletons in 1-2, the rest alone
+			unsigned int count = (unsigned int)gen.roll(i, SALT_MONSTER_COUNT);
+			if(pick > 0){
+				count = 1;
+				room->setSpawn(ARCHETYPE_COUNT + pick - 1);
+			} else if(kind % 100 < 65){
+				count = count % 3 + 1;
+				room->setSpawn(ARCHETYPE_GOBLIN, count);
+			} else {
+				count = count % 2 + 1;
+				room->setSpawn(ARCHETYPE_SKELETON, count);
+			}
+			slice->monsters += count;
+		}
+
+		//item on the ground
+		if(gen.chance(i, SALT_ITEM) < gen.config.item_density){
+			unsigned long long kind = gen.roll(i, SALT_ITEM_KIND);
+			int value = (int)(gen.roll(i, SALT_ITEM_VALUE) % 10) + 1;
+			room->addItem(gen.item_protos[kind % 3][(kind >> 8) % 4][value - 1]->create());
+			slice->items++;
+		}
+
+		//spanning tree: link north or west (whichever exists, else a coin flip)
+		unsigned char link = 0;
+		if(y > 0 && x > 0){
+			link = (gen.roll(i, SALT_LINK) & 1) ? LINK_NORTH : LINK_WEST;
+			if(gen.chance(i, SALT_LOOP) < gen.config.loop_density){
+				link = LINK_NORTH | LINK_WEST;
+			}
+		} else if(y > 0){
+			link = LINK_NORTH;
+		} else if(x > 0){
+			link = LINK_WEST;
+		}
+
+		slice->rooms[i - slice->begin] = room;
+		slice->links[i - slice->begin] = link;
+	}
+	EntityArena::adopt(own);
+	return NULL;
+}
+
+
+// generate
+// - Split the rooms into one contiguous slice per thread and build in parallel
+// - Add rooms to the world in id order, then connect them (single thread)
+// - Fill in stats (time, counts, peak RSS) if requested
+//
+RoomId WorldGenerator::generate(World& world, GeneratorStats* stats) {
+	double start = nowSeconds();
+	unsigned int n = config.room_count;
+	if(n == 0){
+		return NO_ROOM;
+	}
+
+	//decide thread count
+	int threads = config.threads;
+	if(threads <= 0){
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if(threads < 1){
+		threads = 1;
+	}
+	if((unsigned int)threads > n){
+		threads = (int)n;
+	}
+
+	//intern every possible item up front (workers only read the table)
+	ItemCatalog& catalog = ItemCatalog::instance();
+	for(int name = 0; name < 4; name++){
+		for(int value = 1; value <= 10; value++){
+			item_protos[0][name][value - 1] = catalog.intern(WEAPONS[name], "Found in the depths", ITEM_WEAPON, value);
+			item_protos[1][name][value - 1] = catalog.intern(ARMORS[name], "Found in the depths", ITEM_ARMOR, (value + 1) / 2, ARMOR_SLOTS[name]);
+			item_protos[2][name][value - 1] = catalog.intern(POTIONS[name], "Restores health", ITEM_CONSUMABLE, value * 5);
+		}
+	}
+
+	//one set of archetypes to roll from, however many reloads happen meanwhile
+	archetypes = ArchetypeRegistry::instance().acquire();
+
+	std::vector<Room*> rooms(n);
+	std::vector<unsigned char> links(n);
+	std::vector<Slice> slices(threads);
+	std::vector<pthread_t> workers(threads);
+
+	//launch workers (slice 0 runs on this thread)
+	unsigned int chunk = (n + threads - 1) / threads;
+	for(int t = 0; t < threads; t++){
+		Slice& s = slices[t];
+		s.generator = this;
+		s.arena = EntityArena::current();
+		s.begin = t * chunk < n ? t * chunk : n;
+		s.end = (t + 1) * chunk < n ? (t + 1) * chunk : n;
+		s.rooms = &rooms[0] + s.begin;
+		s.links = &links[0] + s.begin;
+		s.monsters = 0;
+		s.items = 0;
+		if(t > 0 && pthread_create(&workers[t], NULL, buildSlice, &s) != 0){
+			//could not start a thread - build this slice ourselves
+			buildSlice(&s);
+			workers[t] = pthread_self();
+		}
+	}
+	buildSlice(&slices[0]);
+
+	unsigned int monsters = 0;
+	unsigned int items = 0;
+	for(int t = 0; t < threads; t++){
+		if(t > 0 && !pthread_equal(workers[t], pthread_self())){
+			pthread_join(workers[t], NULL);
+		}
+		monsters += slices[t].monsters;
+		items += slices[t].items;
+	}
+	archetypes->release();
+	archetypes = NULL;
+
+	//add rooms and exits in id order so ids match the grid
+	world.reserve(world.roomCount() + n, 4 * (std::size_t)n);
+	RoomId base = (RoomId)world.roomCount();
+	for(unsigned int i = 0; i < n; i++){
+		world.addRoom(rooms[i]);
+	}
+
+	world.setGridLayout(base, n, width);
+
+	int north = world.internDirection("north");
+	int south = world.internDirection("south");
+	int east = world.internDirection("east");
+	int west = world.internDirection("west");
+	for(unsigned int i = 0; i < n; i++){
+		if(links[i] & LINK_NORTH){
+			world.addExit(base + i, north, base + i - width);
+			world.addExit(base + i - width, south, base + i);
+		}
+		if(links[i] & LINK_WEST){
+			world.addExit(base + i, west, base + i - 1);
+			world.addExit(base + i - 1, east, base + i);
+		}
+	}
+
+	if(stats){
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		stats->rooms = n;
+		stats->exits = (unsigned int)world.exitCount();
+		stats->monsters = monsters;
+		stats->items = items;
+		stats->threads = threads;
+		stats->seconds = nowSeconds() - start;
+		stats->peak_rss_kb = usage.ru_maxrss;
+	}
+
+	return base;
+}
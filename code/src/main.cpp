@@ -1,7 +1,20 @@
 #include "Game.h"
+#include "WorldGenerator.h"
+#include "RoomPager.h"
+#include "ItemCatalog.h"
+#include "ArchetypeRegistry.h"
+#include "CombatSimulator.h"
+#include "StatusEffects.h"
 #include <iostream>
+#include <vector>
+#include <sys/time.h>
+#include <sys/resource.h>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
 
 /**
  * Main entry point for Dungeon Crawler RPG
@@ -19,18 +32,451 @@
  * - Memory management patterns
  */
 
-int main() {
-    // Seed random number generator for combat calculations
-    // This ensures different random numbers each time the game runs
-      srand(static_cast<unsigned int>(time(0)));
+// Item definitions loaded at startup when --item-catalog isn't given
+static const char* const DEFAULT_ITEM_CATALOG = "data/items.txt";
+
+// Monster archetypes loaded (and watched for changes) when --monsters isn't given
+static const char* const DEFAULT_MONSTERS = "data/monsters.txt";
+
+
+// usage
+// - Print command line options
+//
+static void usage(const char* program) {
+	std::cout << "Usage: " << program << " [options]" << std::endl;
+	std::cout << "  --rooms N            Play in a generated dungeon with N rooms" << std::endl;
+	std::cout << "  --seed S             Seed for the generated dungeon (default 1)" << std::endl;
+	std::cout << "  --rng-seed S         Seed for combat rolls (default: the clock) - same seed, same fights" << std::endl;
+	std::cout << "  --threads T          Generator worker threads (default: one per CPU)" << std::endl;
+	std::cout << "  --monster-density D  Chance a room has a monster (0-1)" << std::endl;
+	std::cout << "  --item-density D     Chance a room has an item (0-1)" << std::endl;
+	std::cout << "  --loop-density D     Chance of an extra exit forming a loop (0-1)" << std::endl;
+	std::cout << "  --world FILE         Play a compiled world file (memory-mapped)" << std::endl;
+	std::cout << "  --compile-world FILE Write the world (default or generated) to FILE and exit" << std::endl;
+	std::cout << "  --memory-budget MB   Page cold rooms out to disk above this many MB" << std::endl;
+	std::cout << "  --generate-only      Build or load the world, print timing and memory, then exit" << std::endl;
+	std::cout << "  --pool-stats         Print entity pool occupancy at the end" << std::endl;
+	std::cout << "  --item-catalog FILE  Load item definitions (default: data/items.txt if present)" << std::endl;
+	std::cout << "  --monsters FILE      Load monster archetypes, reloaded when the file changes (default: data/monsters.txt if present)" << std::endl;
+	std::cout << "  --simulate MONSTER   Run headless fights against one monster archetype or all, then exit" << std::endl;
+	std::cout << "  --fights N           Fights per simulated monster (default 1000000)" << std::endl;
+	std::cout << "  --weapon NAME        Weapon the simulated player has equipped (default Rusty Dagger)" << std::endl;
+	std::cout << "  --armor NAME         Armor the simulated player wears (repeatable, one per slot; default none)" << std::endl;
+	std::cout << "  --potions N          Health Potions the simulated player carries (default 0)" << std::endl;
+	std::cout << "  --heal-below HP      Simulated player drinks a potion below this HP (default 40)" << std::endl;
+	std::cout << "  --horde-bench N      Time damage against N monsters: objects vs. SIMD stat arrays, then exit" << std::endl;
+	std::cout << "  --effects-bench N    Time N status effects expiring: timer wheel vs. scanning every turn, then exit" << std::endl;
+	std::cout << "  --path-check N       Compare travel routes with plain BFS on N generated rooms, with and without shortcuts, then exit" << std::endl;
+	std::cout << "  --loot-check N       Roll a nested loot table N times and compare the drop rates with its weights, then exit" << std::endl;
+	std::cout << "  --socket PORT        Play over TCP: wait for one client on 127.0.0.1:PORT instead of the terminal" << std::endl;
+	std::cout << "  --script FILE        Play commands from FILE (- for stdin) without prompts or output, then report speed" << std::endl;
+	std::cout << "  --script-output FILE With --script, write the game's output to FILE (- for stdout)" << std::endl;
+	std::cout << "  --journal FILE       Record the session (seed, world, every line typed, keyframes) to FILE" << std::endl;
+	std::cout << "  --keyframe-every N   With --journal, snapshot the game every N commands (default 1000, 0 = never)" << std::endl;
+	std::cout << "  --replay FILE        Play a recorded session again from its journal" << std::endl;
+	std::cout << "  --seek N             With --replay, start at the keyframe before command N (from 1) and show output from there" << std::endl;
+	std::cout << "  --save FILE          Save the game to FILE: in full the first time, then only what changed" << std::endl;
+	std::cout << "  --load FILE          Resume the game saved in FILE (and keep saving to it, unless --save says otherwise)" << std::endl;
+	std::cout << "  --autosave N         With --save or --load, also save every N commands (default 20, 0 = never)" << std::endl;
+	std::cout << "  --io-bench N         Time N commands played from memory: output sent per line vs. per command, then exit" << std::endl;
+}
+
+
+// nowSeconds - wall clock for startup timing
+static double nowSeconds() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main(int argc, char* argv[]) {
+	//parse command line options
+	GeneratorConfig config;
+	bool generate = false;
+	bool generate_only = false;
+	std::string world_file;
+	std::string compile_file;
+	std::size_t memory_budget = 0;
+	bool pool_stats = false;
+	std::string catalog_file;
+	std::string monsters_file;
+	//different fights each run unless a seed is given
+	unsigned long long rng_seed = (unsigned long long)time(0);
+	SimulationConfig simulation;
+	std::string simulate;
+	std::string weapon_name = "Rusty Dagger";
+	std::vector<std::string> armor_names;
+	unsigned int horde_bench = 0;
+	unsigned int effects_bench = 0;
+	unsigned int path_check = 0;
+	unsigned int loot_check = 0;
+	unsigned int io_bench = 0;
+	unsigned long socket_port = 0;
+	std::string script_file;
+	std::string script_output;
+	std::string journal_file;
+	unsigned int keyframe_every = 1000;
+	std::string replay_file;
+	unsigned long long seek = 0;
+	std::string save_file;
+	std::string load_file;
+	unsigned int autosave_every = 20;
+	for(int i = 1; i < argc; i++){
+		std::string arg = argv[i];
+		bool has_value = (i + 1 < argc);
+
+		if(arg == "--rooms" && has_value){
+			config.room_count = (unsigned int)strtoul(argv[++i], NULL, 10);
+			generate = true;
+		} else if(arg == "--seed" && has_value){
+			config.seed = strtoull(argv[++i], NULL, 10);
+			generate = true;
+		} else if(arg == "--rng-seed" && has_value){
+			rng_seed = strtoull(argv[++i], NULL, 10);
+			simulation.seed = rng_seed;
+		} else if(arg == "--threads" && has_value){
+			config.threads = atoi(argv[++i]);
+		} else if(arg == "--monster-density" && has_value){
+			config.monster_density = atof(argv[++i]);
+		} else if(arg == "--item-density" && has_value){
+			config.item_density = atof(argv[++i]);
+		} else if(arg == "--loop-density" && has_value){
+			config.loop_density = atof(argv[++i]);
+		} else if(arg == "--world" && has_value){
+			world_file = argv[++i];
+		} else if(arg == "--compile-world" && has_value){
+			compile_file = argv[++i];
+		} else if(arg == "--memory-budget" && has_value){
+			memory_budget = (std::size_t)(atof(argv[++i]) * 1024 * 1024);
+		} else if(arg == "--generate-only"){
+			generate = true;
+			generate_only = true;
+		} else if(arg == "--pool-stats"){
+			pool_stats = true;
+		} else if(arg == "--item-catalog" && has_value){
+			catalog_file = argv[++i];
+		} else if(arg == "--monsters" && has_value){
+			monsters_file = argv[++i];
+		} else if(arg == "--simulate" && has_value){
+			simulate = argv[++i];
+		} else if(arg == "--fights" && has_value){
+			simulation.fights = strtoull(argv[++i], NULL, 10);
+		} else if(arg == "--weapon" && has_value){
+			weapon_name = argv[++i];
+		} else if(arg == "--armor" && has_value){
+			armor_names.push_back(argv[++i]);
+		} else if(arg == "--potions" && has_value){
+			simulation.player.potions = atoi(argv[++i]);
+		} else if(arg == "--heal-below" && has_value){
+			simulation.player.heal_below = atoi(argv[++i]);
+		} else if(arg == "--horde-bench" && has_value){
+			horde_bench = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if(arg == "--effects-bench" && has_value){
+			effects_bench = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if(arg == "--path-check" && has_value){
+			path_check = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if(arg == "--loot-check" && has_value){
+			loot_check = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if(arg == "--io-bench" && has_value){
+			io_bench = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if(arg == "--script" && has_value){
+			script_file = argv[++i];
+		} else if(arg == "--script-output" && has_value){
+			script_output = argv[++i];
+		} else if(arg == "--journal" && has_value){
+			journal_file = argv[++i];
+		} else if(arg == "--keyframe-every" && has_value){
+			keyframe_every = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if(arg == "--replay" && has_value){
+			replay_file = argv[++i];
+		} else if(arg == "--seek" && has_value){
+			seek = strtoull(argv[++i], NULL, 10);
+		} else if(arg == "--save" && has_value){
+			save_file = argv[++i];
+		} else if(arg == "--load" && has_value){
+			load_file = argv[++i];
+		} else if(arg == "--autosave" && has_value){
+			autosave_every = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if(arg == "--socket" && has_value){
+			socket_port = strtoul(argv[++i], NULL, 10);
+			if(socket_port == 0 || socket_port > 65535){
+				std::cout << "Error: --socket needs a port from 1 to 65535" << std::endl;
+				return 1;
+			}
+		} else {
+			usage(argv[0]);
+			return (arg == "--help" || arg == "-h") ? 0 : 1;
+		}
+	}
+
+	//item definitions: an explicit file must load, the default one is optional
+	if(!catalog_file.empty()){
+		if(!ItemCatalog::instance().loadFile(catalog_file)){
+			return 1;
+		}
+	} else if(access(DEFAULT_ITEM_CATALOG, R_OK) == 0 && ItemCatalog::instance().loadFile(DEFAULT_ITEM_CATALOG)){
+		catalog_file = DEFAULT_ITEM_CATALOG;
+	}
+
+	//monster archetypes after the items their loot names
+	if(!monsters_file.empty()){
+		if(!ArchetypeRegistry::instance().loadFile(monsters_file)){
+			return 1;
+		}
+	} else if(access(DEFAULT_MONSTERS, R_OK) == 0 && ArchetypeRegistry::instance().loadFile(DEFAULT_MONSTERS)){
+		monsters_file = DEFAULT_MONSTERS;
+	}
+
+	//mass battle kernel benchmark
+	if(horde_bench > 0){
+		return CombatSimulator::benchmarkHorde(horde_bench, 20, simulation.seed) ? 0 : 1;
+	}
+
+	//status effect timer benchmark (buffs lasting up to 1000 turns)
+	if(effects_bench > 0){
+		return StatusEffects::benchmark(effects_bench, 1000, simulation.seed) ? 0 : 1;
+	}
+
+	//loot rates against the weights, through a nested table
+	if(loot_check > 0){
+		return LootTable::check(loot_check, simulation.seed) ? 0 : 1;
+	}
+
+	//routes against BFS, before and after exits that jump across the grid
+	if(path_check > 0){
+		return Pathfinder::check(path_check, path_check / 250 + 1, 200, config.seed) ? 0 : 1;
+	}
+
+	//render/transport benchmark on the built-in dungeon
+	if(io_bench > 0){
+		return Game::benchmarkTransport(io_bench, rng_seed) ? 0 : 1;
+	}
+
+	//balance run: no game, just fights
+	if(!simulate.empty()){
+		ItemCatalog& catalog = ItemCatalog::instance();
+		const ItemPrototype* weapon = catalog.find(weapon_name);
+		const ItemPrototype* potion = catalog.find("Health Potion");
+		if(weapon == NULL || weapon->kind != ITEM_WEAPON){
+			std::cout << "Error: " << weapon_name << " is not a weapon in the item catalog" << std::endl;
+			return 1;
+		}
+		simulation.player.weapon_bonus = weapon->value;
+		bool worn[EQUIP_SLOT_COUNT] = { false };
+		for(std::size_t a = 0; a < armor_names.size(); a++){
+			const ItemPrototype* armor = catalog.find(armor_names[a]);
+			if(armor == NULL || armor->kind != ITEM_ARMOR){
+				std::cout << "Error: " << armor_names[a] << " is not armor in the item catalog" << std::endl;
+				return 1;
+			}
+			if(worn[armor->slot]){
+				std::cout << "Error: two pieces of armor for the " << Item::slotName(armor->slot) << " slot" << std::endl;
+				return 1;
+			}
+			worn[armor->slot] = true;
+			simulation.player.armor_bonus += armor->value;
+		}
+		if(potion != NULL){
+			simulation.player.potion_heal = potion->value;
+		}
+		simulation.threads = config.threads;
+
+		std::vector<std::string> monsters(1, simulate);
+		if(simulate == "all"){
+			const ArchetypeTable* table = ArchetypeRegistry::instance().acquire();
+			monsters.clear();
+			for(std::size_t a = 0; a < table->size(); a++){
+				monsters.push_back((*table)[a].name);
+			}
+			table->release();
+		}
+		for(std::size_t m = 0; m < monsters.size(); m++){
+			simulation.monster = monsters[m];
+			CombatSimulator simulator(simulation);
+			SimulationStats stats;
+			if(!simulator.run(stats)){
+				return 1;
+			}
+			stats.print();
+		}
+		return 0;
+	}
     
     try {
         // Create game object
         Game game;
+
+	if(generate){
+		game.setGenerator(config);
+	}
+	game.setPagingBudget(memory_budget);
+	game.setPoolStats(pool_stats);
+	game.setRandomSeed(rng_seed);
+	game.setDataFiles(catalog_file, monsters_file);
+
+	//offline compile: build the world, write it, leave
+	if(!compile_file.empty()){
+		double start = nowSeconds();
+		if(!game.compileWorld(compile_file)){
+			return 1;
+		}
+		std::cout << "Compiled " << game.getWorld().roomCount() << " rooms to " << compile_file
+		          << " in " << nowSeconds() - start << " s" << std::endl;
+		return 0;
+	}
+
+	//startup test on a compiled world: map it, report and leave
+	if(generate_only && !world_file.empty()){
+		double start = nowSeconds();
+		game.setWorldFile(world_file);
+		if(!game.loadWorldFile()){
+			return 1;
+		}
+		double elapsed = nowSeconds() - start;
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		std::cout << "Loaded " << game.getWorld().roomCount() << " rooms in "
+		          << elapsed * 1000.0 << " ms (peak RSS " << usage.ru_maxrss / 1024 << " MB)" << std::endl;
+		game.startPaging();
+		if(game.getWorld().pagingStats() != NULL){
+			game.getWorld().pagingStats()->print(std::cout);
+		}
+		if(pool_stats){
+			game.printPoolStats();
+		}
+		return 0;
+	}
+
+	//load test: build the world, report and leave
+	if(generate_only){
+		GeneratorStats stats;
+		game.generateWorld(&stats);
+		stats.print(std::cout);
+		game.startPaging();
+		if(game.getWorld().pagingStats() != NULL){
+			game.getWorld().pagingStats()->print(std::cout);
+		}
+		if(pool_stats){
+			game.printPoolStats();
+		}
+		return 0;
+	}
+
+	if(!world_file.empty()){
+		game.setWorldFile(world_file);
+	}
+        
+	//one remote player instead of the terminal
+	SocketTransport* socket = NULL;
+	if(socket_port != 0){
+		socket = SocketTransport::accept((unsigned short)socket_port);
+		if(socket == NULL){
+			return 1;
+		}
+		game.setTransport(socket);
+	}
+
+	//or a script, its output thrown away or sent to a file
+	ScriptStats script_stats;
+	FdTransport* script = NULL;
+	if(!script_file.empty()){
+		int in_fd = (script_file == "-") ? 0 : open(script_file.c_str(), O_RDONLY);
+		int out_fd = (script_output.empty() || script_output == "-") ? 1 :
+		             open(script_output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(in_fd < 0 || out_fd < 0){
+			std::cout << "Error: cannot open " << (in_fd < 0 ? script_file : script_output)
+			          << ": " << strerror(errno) << std::endl;
+			return 1;
+		}
+		script = new FdTransport(in_fd, out_fd);
+		game.setTransport(script);
+		game.setScriptMode(&script_stats, !script_output.empty());
+	}
+
+	//a recorded session played again (its journal decides seed and world)
+	ReplayStats replay_stats;
+	JournalReader* replay = NULL;
+	if(!replay_file.empty()){
+		if(!journal_file.empty()){
+			std::cout << "Error: --journal and --replay can't be used together" << std::endl;
+			return 1;
+		}
+		replay = new JournalReader();
+		if(!replay->load(replay_file) || !game.setReplay(replay, seek, &replay_stats)){
+			delete replay;
+			return 1;
+		}
+	}
+
+	//a saved game resumed (its setup decides seed and world)
+	SaveReader* resume = NULL;
+	if(!load_file.empty()){
+		if(!replay_file.empty() || !journal_file.empty()){
+			std::cout << "Error: --load can't be used with --journal or --replay" << std::endl;
+			return 1;
+		}
+		resume = new SaveReader();
+		if(!resume->load(load_file) || !game.setResume(resume)){
+			delete resume;
+			return 1;
+		}
+	}
+
+	//saved as it goes, to the file it came from unless told otherwise
+	SaveWriter save;
+	std::string save_path = save_file.empty() ? load_file : save_file;
+	if(!save_path.empty()){
+		if(!replay_file.empty()){
+			std::cout << "Error: --save can't be used with --replay" << std::endl;
+			return 1;
+		}
+		ByteWriter setup;
+		game.writeSetup(setup);
+		if(resume != NULL && save_path == load_file && !resume->isDamaged()){
+			if(!save.resume(save_path, setup.data(), resume->baseBytes(), resume->deltaBytes())){
+				delete resume;
+				return 1;
+			}
+		} else {
+			save.open(save_path, setup.data());
+		}
+		game.setSaveFile(&save, autosave_every);
+	}
+
+	//or this session recorded, once everything it depends on is set
+	JournalWriter journal;
+	if(!journal_file.empty()){
+		ByteWriter setup;
+		game.writeSetup(setup);
+		if(!journal.open(journal_file, setup.data(), keyframe_every)){
+			return 1;
+		}
+		game.setJournal(&journal);
+	}
         
         // Run main game loop
         // This doesn't return until game is over
         game.run();
+	game.setTransport(NULL);
+	delete socket;
+	journal.close();
+	if(journal.skippedCount() > 0){
+		std::cout << "Warning: " << journal.skippedCount() << " keyframe(s) were not recorded;"
+		          << " a replay seeking past them starts further back" << std::endl;
+	}
+	if(save.isOpen()){
+		save.close();
+		save.print();
+	}
+	delete resume;
+	if(script != NULL){
+		delete script;
+		script_stats.print();
+	}
+	if(replay != NULL){
+		delete replay;
+		replay_stats.print();
+	}
     }
     catch (const std::exception& e) {
         // Catch any exceptions and print error message
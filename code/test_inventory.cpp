@@ -24,7 +24,7 @@ int main() {
 
     // Display all
     for (int i = 0; i < inventory.size(); i++) {
-        inventory[i]->displayInfo();
+        inventory[i]->displayInfo(std::cout);
     }
 
     // Clean up - VERY IMPORTANT!